@@ -0,0 +1,61 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace octoweave { namespace bench {
+
+// One benchmark run: setup happens in the case function, only run() is timed. Per-iteration
+// work is declared with points()/nodes()/items() so the report can derive rates.
+class Bench {
+public:
+  Bench(double min_time, double scale, uint64_t seed)
+    : min_time_(min_time), scale_(scale), seed_(seed) {}
+
+  // Repeat fn until min_time has elapsed (at least once) after one untimed warm-up call
+  void run(const std::function<void()>& fn);
+
+  // Workload size scaled by --scale (at least 1)
+  size_t scaled(size_t n) const;
+  uint64_t seed() const { return seed_; }
+
+  void points(size_t n) { points_ = n; }
+  void nodes(size_t n) { nodes_ = n; }
+  void items(size_t n) { items_ = n; }
+  // Keep a result observable so the optimizer cannot drop the work
+  template <class T> void keep(const T& v) { sink_ += (uint64_t)(v != T{}); }
+
+  double seconds() const { return seconds_; }
+  uint64_t iterations() const { return iters_; }
+  size_t points_per_iter() const { return points_; }
+  size_t nodes_per_iter() const { return nodes_; }
+  size_t items_per_iter() const { return items_; }
+
+private:
+  double min_time_, scale_;
+  uint64_t seed_;
+  double seconds_ = 0.0;
+  uint64_t iters_ = 0;
+  size_t points_ = 0, nodes_ = 0, items_ = 0;
+  volatile uint64_t sink_ = 0;
+};
+
+struct Case {
+  const char* name;
+  const char* kind; // "micro" or "macro"
+  void (*fn)(Bench&);
+};
+
+void register_micro(std::vector<Case>& out);
+void register_macro(std::vector<Case>& out);
+
+// Peak resident set size in bytes since the last reset_peak_rss() (process lifetime when
+// resetting is unsupported), 0 if unknown
+size_t peak_rss_bytes();
+// Reset the peak RSS high-water mark (Linux /proc/self/clear_refs); false if unsupported
+bool reset_peak_rss();
+
+}} // namespace octoweave::bench
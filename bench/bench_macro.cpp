@@ -0,0 +1,127 @@
+// End-to-end macrobenchmarks: points -> chunk binning and build -> merge and roll-up ->
+// forest, on the seeded synthetic generators.
+#include "bench.hpp"
+#include "generators.hpp"
+#include "octoweave/chunk_cache.hpp"
+#include "octoweave/hierarchy.hpp"
+#include "octoweave/p4est_builder.hpp"
+#include "octoweave/parallel.hpp"
+#include "octoweave/session.hpp"
+#include <memory>
+
+namespace octoweave { namespace bench {
+
+namespace {
+
+constexpr int kChunks = 4; // n×n×n chunk grid and forest trees
+
+OctoChunker::Params params_for(const Workload& w, double res) {
+  OctoChunker::Params p;
+  p.res = res; p.emit_res = 2.0 * res; p.max_depth_cap = 16;
+  p.origin = w.origin;
+  return p;
+}
+
+void pipeline(Bench& b, const Workload& w, double res) {
+  const auto p = params_for(w, res);
+  const ChunkGrid grid(kChunks, w.box);
+  size_t nodes = 0;
+  b.run([&] {
+    auto outs = build_chunked_workers(grid, w.pts, p);
+    const Hierarchy H = make_hierarchy_from_workers(outs, 0.5, false, 0.5, 1);
+    P4estBuilder::Config cfg; cfg.n = kChunks; cfg.min_level = 0; cfg.max_level = 8;
+    cfg.level_policy = P4estBuilder::Policy::by_leafcount_quantiles(H, cfg.tree_map(), 0.2, 0.8, 1, 2, 3);
+    std::unique_ptr<P4estBuilder::ForestHandle> fh(P4estBuilder::build_forest_handle(H, cfg));
+    nodes = H.nodes.size();
+    b.keep(fh->num_quadrants());
+  });
+  b.points(w.pts.size()); b.nodes(nodes); b.items(w.pts.size());
+}
+
+void bm_uniform(Bench& b) { pipeline(b, uniform_cloud(b.scaled(1u << 18), b.seed()), 0.05); }
+void bm_clustered(Bench& b) { pipeline(b, clustered_mvn(b.scaled(1u << 18), b.seed()), 0.05); }
+void bm_planar(Bench& b) { pipeline(b, planar_scene(b.scaled(1u << 18), b.seed()), 0.1); }
+void bm_lidar(Bench& b) { pipeline(b, lidar_scan(b.scaled(1u << 18), b.seed()), 0.1); }
+
+// Streaming: eight lidar sweeps inserted into a Session one by one, hierarchy after each
+void bm_lidar_session(Bench& b) {
+  const size_t per = b.scaled(1u << 15);
+  std::vector<Workload> sweeps;
+  for (uint64_t s=0; s<8; ++s) sweeps.push_back(lidar_scan(per, b.seed() + s));
+  Session::Options opt;
+  opt.box = sweeps[0].box; opt.n = kChunks; opt.params = params_for(sweeps[0], 0.1);
+  size_t pts = 0, nodes = 0;
+  for (const auto& w : sweeps) pts += w.pts.size();
+  b.run([&] {
+    Session s(opt);
+    for (const auto& w : sweeps) {
+      s.insert(w.pts, w.origin);
+      nodes = s.hierarchy().nodes.size();
+    }
+  });
+  b.points(pts); b.nodes(nodes); b.items(sweeps.size());
+}
+
+// Offline fusion: 64 lidar sweeps, each with its origin, in one build_chunked_scans call
+// (or build_routed_scans, carving free space across chunk borders)
+void lidar_batch(Bench& b, bool routed) {
+  const size_t per = b.scaled(1u << 12);
+  std::vector<Workload> sweeps;
+  for (uint64_t s=0; s<64; ++s) sweeps.push_back(lidar_scan(per, b.seed() + s));
+  std::vector<Scan> scans;
+  size_t pts = 0;
+  for (const auto& w : sweeps) { scans.push_back(Scan{ w.pts, w.origin }); pts += w.pts.size(); }
+  const auto p = params_for(sweeps[0], 0.1);
+  const ChunkGrid grid(kChunks, sweeps[0].box);
+  size_t nodes = 0;
+  b.run([&] {
+    auto outs = routed ? build_routed_scans(grid, scans, p) : build_chunked_scans(grid, scans, p);
+    nodes = make_hierarchy_from_workers(outs, 0.5, false, 0.5, 1).nodes.size();
+  });
+  b.points(pts); b.nodes(nodes); b.items(scans.size());
+}
+
+void bm_lidar_batch(Bench& b) { lidar_batch(b, false); }
+void bm_lidar_routed(Bench& b) { lidar_batch(b, true); }
+
+// Long drive: 16 lidar sweeps 32 m apart into a ChunkCache whose budget holds a few
+// sweeps' chunks, then a hierarchy over the whole route (spilled chunks read back)
+void bm_lidar_drive(Bench& b) {
+  const size_t per = b.scaled(1u << 14);
+  const double step = 32.0;
+  std::vector<Workload> sweeps;
+  for (uint64_t s=0; s<16; ++s) {
+    sweeps.push_back(lidar_scan(per, b.seed() + s));
+    Workload& w = sweeps.back();
+    for (Pt& q : w.pts) q.x += step * (double)s;
+    w.origin.x += step * (double)s;
+  }
+  ChunkCache::Options opt;
+  opt.box = sweeps[0].box; opt.box.xmax += step * (double)(sweeps.size() - 1);
+  opt.n = 4 * kChunks; opt.params = params_for(sweeps[0], 0.1);
+  opt.budget_bytes = size_t(8) << 20;
+  size_t pts = 0, nodes = 0;
+  for (const auto& w : sweeps) pts += w.pts.size();
+  b.run([&] {
+    ChunkCache cache(opt);
+    for (const auto& w : sweeps) cache.insert(w.pts, w.origin);
+    nodes = cache.hierarchy(0.5, 0.5, 1).nodes.size();
+    b.keep(cache.stats().evictions);
+  });
+  b.points(pts); b.nodes(nodes); b.items(sweeps.size());
+}
+
+} // namespace
+
+void register_macro(std::vector<Case>& out) {
+  out.push_back({ "e2e_uniform", "macro", bm_uniform });
+  out.push_back({ "e2e_clustered_mvn", "macro", bm_clustered });
+  out.push_back({ "e2e_planar_scene", "macro", bm_planar });
+  out.push_back({ "e2e_lidar_scan", "macro", bm_lidar });
+  out.push_back({ "e2e_lidar_session", "macro", bm_lidar_session });
+  out.push_back({ "e2e_lidar_batch", "macro", bm_lidar_batch });
+  out.push_back({ "e2e_lidar_routed", "macro", bm_lidar_routed });
+  out.push_back({ "e2e_lidar_drive", "macro", bm_lidar_drive });
+}
+
+}} // namespace octoweave::bench
@@ -0,0 +1,173 @@
+// octoweave_bench: micro and end-to-end benchmarks with a JSON report.
+//
+//   octoweave_bench [--filter SUBSTR] [--kind micro|macro] [--min-time SEC] [--scale F]
+//                   [--seed N] [--json PATH] [--list]
+#include "bench.hpp"
+#include "octoweave/memory.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+namespace octoweave { namespace bench {
+
+void Bench::run(const std::function<void()>& fn) {
+  using clock = std::chrono::steady_clock;
+  fn(); // warm-up: caches, allocator pools, lazily built state
+  iters_ = 0;
+  const auto t0 = clock::now();
+  double el = 0.0;
+  do {
+    fn(); ++iters_;
+    el = std::chrono::duration<double>(clock::now() - t0).count();
+  } while (el < min_time_);
+  seconds_ = el;
+}
+
+size_t Bench::scaled(size_t n) const {
+  return std::max<size_t>(1, (size_t)((double)n * scale_));
+}
+
+size_t peak_rss_bytes() {
+#if defined(__linux__)
+  // VmHWM follows clear_refs resets, unlike ru_maxrss
+  std::ifstream f("/proc/self/status");
+  std::string line;
+  while (std::getline(f, line))
+    if (line.compare(0, 6, "VmHWM:") == 0) return (size_t)std::strtoull(line.c_str() + 6, nullptr, 10) * 1024;
+#endif
+#if defined(__unix__) || defined(__APPLE__)
+  struct rusage ru;
+  if (getrusage(RUSAGE_SELF, &ru) == 0) {
+#if defined(__APPLE__)
+    return (size_t)ru.ru_maxrss;        // bytes
+#else
+    return (size_t)ru.ru_maxrss * 1024; // kilobytes
+#endif
+  }
+#endif
+  return 0;
+}
+
+bool reset_peak_rss() {
+#if defined(__linux__)
+  std::ofstream f("/proc/self/clear_refs");
+  f << "5";
+  return (bool)f;
+#else
+  return false;
+#endif
+}
+
+}} // namespace octoweave::bench
+
+using namespace octoweave::bench;
+
+static std::string json_escape(const std::string& s) {
+  std::string o;
+  for (char c : s) {
+    if (c == '"' || c == '\\') { o += '\\'; o += c; }
+    else if ((unsigned char)c < 0x20) { char b[8]; std::snprintf(b, sizeof(b), "\\u%04x", c); o += b; }
+    else o += c;
+  }
+  return o;
+}
+
+static void usage() {
+  std::fprintf(stderr,
+    "usage: octoweave_bench [--filter SUBSTR] [--kind micro|macro] [--min-time SEC]\n"
+    "                       [--scale F] [--seed N] [--json PATH] [--list]\n");
+}
+
+int main(int argc, char** argv) {
+  std::string filter, kind, json_path;
+  double min_time = 0.5, scale = 1.0;
+  uint64_t seed = 42;
+  bool list = false;
+  for (int i=1; i<argc; ++i) {
+    const std::string a = argv[i];
+    auto next = [&]() -> const char* {
+      if (i + 1 >= argc) { usage(); std::exit(2); }
+      return argv[++i];
+    };
+    if (a == "--filter") filter = next();
+    else if (a == "--kind") kind = next();
+    else if (a == "--min-time") min_time = std::atof(next());
+    else if (a == "--scale") scale = std::atof(next());
+    else if (a == "--seed") seed = std::strtoull(next(), nullptr, 10);
+    else if (a == "--json") json_path = next();
+    else if (a == "--list") list = true;
+    else { usage(); return 2; }
+  }
+  if (scale <= 0.0) { std::fprintf(stderr, "--scale must be positive\n"); return 2; }
+
+  std::vector<Case> cases;
+  register_micro(cases);
+  register_macro(cases);
+
+  std::ostringstream js;
+  js << "{\n  \"config\": {\"min_time\": " << min_time << ", \"scale\": " << scale
+     << ", \"seed\": " << seed << ", \"threads\": " << std::thread::hardware_concurrency()
+     << "},\n  \"benchmarks\": [";
+  bool first = true;
+  size_t max_rss = 0;
+  std::fprintf(stderr, "%-28s %-5s %10s %10s %14s %14s %10s\n",
+               "benchmark", "kind", "iters", "sec/iter", "points/s", "nodes/s", "peakMiB");
+  for (const auto& c : cases) {
+    if (!filter.empty() && std::strstr(c.name, filter.c_str()) == nullptr) continue;
+    if (!kind.empty() && kind != c.kind) continue;
+    if (list) { std::printf("%s %s\n", c.kind, c.name); continue; }
+
+    const bool reset = reset_peak_rss();
+    octoweave::mem::reset_peaks();
+    Bench b(min_time, scale, seed);
+    c.fn(b);
+    const size_t rss = peak_rss_bytes();
+    max_rss = std::max(max_rss, rss);
+    const double per = b.iterations() ? b.seconds() / (double)b.iterations() : 0.0;
+    auto rate = [&](size_t n) { return per > 0.0 ? (double)n / per : 0.0; };
+    std::fprintf(stderr, "%-28s %-5s %10llu %10.3g %14.4g %14.4g %10.1f\n", c.name, c.kind,
+                 (unsigned long long)b.iterations(), per, rate(b.points_per_iter()),
+                 rate(b.nodes_per_iter()), (double)rss / (1024.0 * 1024.0));
+
+    js << (first ? "\n" : ",\n") << "    {\"name\": \"" << json_escape(c.name) << "\", \"kind\": \""
+       << c.kind << "\", \"iterations\": " << b.iterations() << ", \"seconds\": " << b.seconds()
+       << ", \"seconds_per_iter\": " << per
+       << ", \"points\": " << b.points_per_iter() << ", \"nodes\": " << b.nodes_per_iter()
+       << ", \"items\": " << b.items_per_iter()
+       << ", \"points_per_sec\": " << rate(b.points_per_iter())
+       << ", \"nodes_per_sec\": " << rate(b.nodes_per_iter())
+       << ", \"items_per_sec\": " << rate(b.items_per_iter())
+       << ", \"peak_rss_bytes\": " << rss
+       << ", \"peak_rss_scope\": \"" << (reset ? "benchmark" : "process") << "\"";
+    if (octoweave::mem::tracking_enabled()) {
+      // Per-pool high-water marks of the pipeline containers (OCTOWEAVE_TRACK_MEMORY)
+      js << ", \"peak_pool_bytes\": {";
+      const auto pools = octoweave::mem::usage();
+      for (size_t i=0; i<pools.size(); ++i)
+        js << (i ? ", " : "") << "\"" << pools[i].name << "\": " << pools[i].peak_bytes;
+      js << "}";
+    }
+    js << "}";
+    first = false;
+  }
+  if (list) return 0;
+  js << (first ? "]" : "\n  ]") << ",\n  \"peak_rss_bytes\": " << max_rss << "\n}\n";
+
+  if (json_path.empty() || json_path == "-") {
+    std::fputs(js.str().c_str(), stdout);
+  } else {
+    std::ofstream o(json_path);
+    o << js.str();
+    if (!o) { std::fprintf(stderr, "cannot write %s\n", json_path.c_str()); return 1; }
+  }
+  return 0;
+}
@@ -0,0 +1,227 @@
+// Microbenchmarks: one pipeline stage each, on synthetic inputs independent of the OctoMap
+// backend (worker maps are generated directly at depth td).
+#include "bench.hpp"
+#include "generators.hpp"
+#include "octoweave/chunk_grid.hpp"
+#include "octoweave/csv.hpp"
+#include "octoweave/flat_map.hpp"
+#include "octoweave/hierarchy.hpp"
+#include "octoweave/octo_iface.hpp"
+#include "octoweave/p4est_builder.hpp"
+#include "octoweave/union.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <unordered_map>
+
+namespace octoweave { namespace bench {
+
+namespace {
+
+constexpr int kTd = 10;
+
+// `chunks` workers of `per_chunk` keys each, clustered so roughly a quarter of the keys
+// are shared with a neighbouring worker (the merge path) and parents have several children
+std::vector<WorkerOut> synthetic_workers(int chunks, size_t per_chunk, uint64_t seed) {
+  std::mt19937_64 rng(seed);
+  std::uniform_real_distribution<double> prob(0.05, 0.95);
+  const uint32_t side = 1u << kTd;
+  std::vector<WorkerOut> outs((size_t)chunks);
+  for (int c=0; c<chunks; ++c) {
+    auto& w = outs[(size_t)c]; w.td = kTd;
+    // Each worker covers a slab of x; slabs overlap their neighbours by 25%
+    const uint32_t x0 = (uint32_t)((uint64_t)side * (uint64_t)c / (uint64_t)chunks);
+    const uint32_t wx = std::max<uint32_t>(1, side / (uint32_t)chunks + side / (4u * (uint32_t)chunks));
+    std::uniform_int_distribution<uint32_t> ux(x0, std::min(side - 1, x0 + wx));
+    std::uniform_int_distribution<uint32_t> uyz(0, side / 8 - 1);
+    w.Ptd.reserve(per_chunk);
+    while (w.Ptd.size() < per_chunk) w.Ptd.emplace(Key3{ ux(rng), uyz(rng), uyz(rng) }, prob(rng));
+  }
+  return outs;
+}
+
+Hierarchy synthetic_hierarchy(size_t keys, uint64_t seed) {
+  return make_hierarchy_from_workers(synthetic_workers(8, keys / 8, seed), 0.5, false, 0.5, 1);
+}
+
+size_t leaf_count(const Hierarchy& H) {
+  size_t n = 0;
+  for (const auto& kv : H.nodes) n += kv.second.is_leaf ? 1 : 0;
+  return n;
+}
+
+void bm_chunkgrid_which(Bench& b) {
+  auto w = uniform_cloud(b.scaled(1u << 20), b.seed());
+  ChunkGrid grid(16, w.box);
+  b.run([&] {
+    uint64_t sum = 0;
+    for (const auto& p : w.pts) sum += (uint64_t)std::get<3>(grid.which(p.x, p.y, p.z));
+    b.keep(sum);
+  });
+  b.points(w.pts.size()); b.items(w.pts.size());
+}
+
+void bm_union_prob8(Bench& b) {
+  std::mt19937_64 rng(b.seed());
+  std::uniform_real_distribution<double> prob(0.0, 1.0);
+  std::vector<std::array<double, 8>> in(b.scaled(1u << 18));
+  for (auto& a : in) for (auto& v : a) v = prob(rng);
+  b.run([&] {
+    double sum = 0.0;
+    for (const auto& a : in) sum += union_prob8_stable(a);
+    b.keep(sum);
+  });
+  b.items(in.size());
+}
+
+// Union of overlapping worker maps only: base_depth == td skips the roll-up
+void bm_worker_merge(Bench& b) {
+  auto outs = synthetic_workers(16, b.scaled(1u << 13), b.seed());
+  size_t in = 0;
+  for (const auto& o : outs) in += o.Ptd.size();
+  size_t nodes = 0;
+  b.run([&] { nodes = make_hierarchy_from_workers(outs, 0.5, false, 0.5, kTd).nodes.size(); });
+  b.items(in); b.nodes(nodes);
+}
+
+// Roll-up and node emission from one pre-merged map down to depth 1
+void bm_rollup(Bench& b) {
+  auto outs = synthetic_workers(1, b.scaled(1u << 16), b.seed());
+  size_t nodes = 0;
+  b.run([&] { nodes = make_hierarchy_from_workers(outs, 0.5, false, 0.5, 1).nodes.size(); });
+  b.items(outs[0].Ptd.size()); b.nodes(nodes);
+}
+
+// The same roll-up with the per-depth maps held as 16-bit log-odds codes
+void bm_rollup_logodds16(Bench& b) {
+  auto outs = synthetic_workers(1, b.scaled(1u << 16), b.seed());
+  size_t nodes = 0;
+  b.run([&] {
+    nodes = make_hierarchy_from_workers(outs, 0.5, false, 0.5, 1, nullptr, ProbStorage::logodds16).nodes.size();
+  });
+  b.items(outs[0].Ptd.size()); b.nodes(nodes);
+}
+
+// Chunk build and emission of its depth-td map (backend dependent)
+void bm_chunk_emission(Bench& b) {
+  auto w = uniform_cloud(b.scaled(1u << 17), b.seed());
+  OctoChunker::Params p; p.res = 0.05; p.emit_res = 0.1; p.max_depth_cap = 16;
+  size_t keys = 0;
+  b.run([&] { keys = OctoChunker::build_and_export(w.pts, p).Ptd.size(); });
+  b.points(w.pts.size()); b.nodes(keys);
+}
+
+// Pre-insertion voxel filter over a dense clustered scan (items: representatives kept)
+void bm_prefilter(Bench& b) {
+  auto w = clustered_mvn(b.scaled(1u << 19), b.seed());
+  const double res = std::max({ w.box.xmax - w.box.xmin, w.box.ymax - w.box.ymin, w.box.zmax - w.box.zmin }) / 128.0;
+  size_t kept = 0;
+  b.run([&] { kept = voxel_filter(w.pts, res, 0).points.size(); });
+  b.points(w.pts.size()); b.items(kept);
+}
+
+// Per-point accumulation into voxel keys (the chunk export and merge pattern): a clustered
+// key stream with many repeats, into the node-based map and into the flat Morton table
+std::vector<Key3> voxel_stream(Bench& b) {
+  auto w = clustered_mvn(b.scaled(1u << 19), b.seed());
+  std::vector<Key3> keys;
+  keys.reserve(w.pts.size());
+  const double s = 1024.0 / std::max({ w.box.xmax - w.box.xmin, w.box.ymax - w.box.ymin, w.box.zmax - w.box.zmin });
+  for (const auto& p : w.pts)
+    keys.push_back(Key3{ (uint32_t)((p.x - w.box.xmin) * s), (uint32_t)((p.y - w.box.ymin) * s),
+                         (uint32_t)((p.z - w.box.zmin) * s) });
+  return keys;
+}
+
+void bm_accumulate_unordered(Bench& b) {
+  const auto keys = voxel_stream(b);
+  std::unordered_map<Key3, double, Key3Hash> m;
+  b.run([&] {
+    m.clear();
+    for (const Key3& k : keys) { double& s = m[k]; s = 1.0 - (1.0 - s) * 0.3; }
+    b.keep(m.size());
+  });
+  b.points(keys.size()); b.nodes(m.size());
+}
+
+void bm_accumulate_flat(Bench& b) {
+  const auto keys = voxel_stream(b);
+  FlatMap<uint64_t, double> m;
+  b.run([&] {
+    m.clear();
+    for (const Key3& k : keys) { double& s = m[morton_encode(k)]; s = 1.0 - (1.0 - s) * 0.3; }
+    b.keep(m.size());
+  });
+  b.points(keys.size()); b.nodes(m.size());
+}
+
+void bm_policy_eval(Bench& b) {
+  const Hierarchy H = synthetic_hierarchy(b.scaled(1u << 17), b.seed());
+  P4estBuilder::Config cfg; cfg.n = 8;
+  const auto tm = cfg.tree_map();
+  b.run([&] {
+    cfg.level_policy = P4estBuilder::Policy::by_leafcount_quantiles(H, tm, 0.2, 0.8, 1, 2, 3);
+    b.keep(P4estBuilder::resolve_levels(H, cfg).size());
+  });
+  b.nodes(H.nodes.size()); b.items(leaf_count(H));
+}
+
+// Forest refinement, balance and per-quadrant aggregation of leaf statistics
+void bm_forest_aggregate(Bench& b) {
+  const Hierarchy H = synthetic_hierarchy(b.scaled(1u << 16), b.seed());
+  P4estBuilder::Config cfg; cfg.n = 4; cfg.min_level = 0; cfg.max_level = 8;
+  cfg.level_policy = P4estBuilder::Policy::uniform(3);
+  size_t quads = 0;
+  b.run([&] {
+    std::unique_ptr<P4estBuilder::ForestHandle> fh(P4estBuilder::build_forest_handle(H, cfg));
+    double sum = 0.0;
+    fh->for_each_quadrant([&](const P4estBuilder::QuadrantView& q) { sum += q.mean * q.leaves; });
+    quads = fh->num_quadrants();
+    b.keep(sum);
+  });
+  b.nodes(H.nodes.size()); b.items(quads);
+}
+
+void bm_csv_parse(Bench& b) {
+  const Hierarchy H = synthetic_hierarchy(b.scaled(1u << 17), b.seed());
+  const auto path = std::filesystem::temp_directory_path() /
+                    ("octoweave_bench_" + std::to_string(b.seed()) + ".csv");
+  {
+    std::ofstream f(path);
+    for (const auto& kv : H.nodes) if (kv.second.is_leaf) {
+      const Key3& k = kv.first.k;
+      f << k.x << "," << k.y << "," << k.z << "," << kv.first.d << "," << kv.second.p << "\n";
+    }
+  }
+  size_t rows = 0;
+  b.run([&] {
+    CsvReadResult r;
+    read_leaves_csv(path.string(), CsvReadOptions{}, r);
+    rows = r.rows;
+  });
+  b.items(rows); b.nodes(rows);
+  std::error_code ec;
+  std::filesystem::remove(path, ec);
+}
+
+} // namespace
+
+void register_micro(std::vector<Case>& out) {
+  out.push_back({ "chunkgrid_which", "micro", bm_chunkgrid_which });
+  out.push_back({ "union_prob8_stable", "micro", bm_union_prob8 });
+  out.push_back({ "worker_merge", "micro", bm_worker_merge });
+  out.push_back({ "rollup", "micro", bm_rollup });
+  out.push_back({ "rollup_logodds16", "micro", bm_rollup_logodds16 });
+  out.push_back({ "accumulate_unordered_map", "micro", bm_accumulate_unordered });
+  out.push_back({ "accumulate_flat_map", "micro", bm_accumulate_flat });
+  out.push_back({ "chunk_emission", "micro", bm_chunk_emission });
+  out.push_back({ "prefilter", "micro", bm_prefilter });
+  out.push_back({ "policy_eval", "micro", bm_policy_eval });
+  out.push_back({ "forest_aggregate", "micro", bm_forest_aggregate });
+  out.push_back({ "csv_parse", "micro", bm_csv_parse });
+}
+
+}} // namespace octoweave::bench
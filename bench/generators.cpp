@@ -0,0 +1,171 @@
+#include "generators.hpp"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <random>
+
+namespace octoweave { namespace bench {
+
+namespace {
+
+constexpr double kPi = 3.14159265358979323846;
+
+struct Building { double x0, x1, y0, y1, h; };
+
+// Box buildings on a 64 m block, kept clear of the center where the lidar sits
+std::vector<Building> buildings(std::mt19937_64& rng) {
+  std::uniform_real_distribution<double> pos(2.0, 54.0), side(4.0, 10.0), height(3.0, 20.0);
+  std::vector<Building> out;
+  while (out.size() < 14) {
+    Building b;
+    b.x0 = pos(rng); b.y0 = pos(rng);
+    b.x1 = b.x0 + side(rng); b.y1 = b.y0 + side(rng); b.h = height(rng);
+    if (b.x0 < 36 && b.x1 > 28 && b.y0 < 36 && b.y1 > 28) continue;
+    out.push_back(b);
+  }
+  return out;
+}
+
+// Nearest ray hit against the ground plane and the buildings, or a negative distance
+double cast(const Pt& o, const Pt& d, const std::vector<Building>& bs, double max_range) {
+  double best = -1.0;
+  if (d.z < 0.0) best = -o.z / d.z;
+  for (const auto& b : bs) {
+    // Slab test against the box [x0,x1] x [y0,y1] x [0,h]
+    const double lo[3] = { b.x0, b.y0, 0.0 }, hi[3] = { b.x1, b.y1, b.h };
+    const double oo[3] = { o.x, o.y, o.z }, dd[3] = { d.x, d.y, d.z };
+    double t0 = 0.0, t1 = max_range;
+    bool hit = true;
+    for (int k=0; k<3 && hit; ++k) {
+      if (std::abs(dd[k]) < 1e-12) { hit = oo[k] >= lo[k] && oo[k] <= hi[k]; continue; }
+      double a = (lo[k] - oo[k]) / dd[k], c = (hi[k] - oo[k]) / dd[k];
+      if (a > c) std::swap(a, c);
+      t0 = std::max(t0, a); t1 = std::min(t1, c);
+      hit = t0 <= t1;
+    }
+    if (hit && t0 > 0.0 && (best < 0.0 || t0 < best)) best = t0;
+  }
+  return best >= 0.0 && best <= max_range ? best : -1.0;
+}
+
+} // namespace
+
+Workload uniform_cloud(size_t n, uint64_t seed) {
+  Workload w{ "uniform", {}, AABB{ 0, 8, 0, 8, 0, 8 }, Pt{ 4, 4, 4 } };
+  std::mt19937_64 rng(seed);
+  std::uniform_real_distribution<double> u(0.0, 8.0);
+  w.pts.reserve(n);
+  for (size_t i=0; i<n; ++i) w.pts.push_back(Pt{ u(rng), u(rng), u(rng) });
+  return w;
+}
+
+Workload clustered_mvn(size_t n, uint64_t seed) {
+  Workload w{ "clustered_mvn", {}, AABB{ 0, 8, 0, 8, 0, 4 }, Pt{ 4, 4, 2 } };
+  std::mt19937_64 rng(seed);
+  const double weights[3] = { 0.55, 0.3, 0.15 };
+  const double means[3][3] = { { 2.0, 2.0, 1.0 }, { 5.5, 2.5, 1.5 }, { 3.5, 6.0, 2.5 } };
+  const double covs[3][3][3] = {
+    { { 0.20, 0.05, 0.00 }, { 0.05, 0.20, 0.00 }, { 0.00, 0.00, 0.10 } },
+    { { 0.15, -0.04, 0.00 }, { -0.04, 0.25, 0.00 }, { 0.00, 0.00, 0.10 } },
+    { { 0.30, 0.10, 0.00 }, { 0.10, 0.15, 0.00 }, { 0.00, 0.00, 0.12 } },
+  };
+  // Lower Cholesky factors of the covariances
+  double L[3][3][3] = {};
+  for (int c=0; c<3; ++c)
+    for (int i=0; i<3; ++i)
+      for (int j=0; j<=i; ++j) {
+        double s = covs[c][i][j];
+        for (int k=0; k<j; ++k) s -= L[c][i][k] * L[c][j][k];
+        L[c][i][j] = i == j ? std::sqrt(s) : s / L[c][j][j];
+      }
+  std::discrete_distribution<int> comp(weights, weights + 3);
+  std::normal_distribution<double> g(0.0, 1.0);
+  std::uniform_real_distribution<double> u(0.0, 1.0);
+  const AABB& b = w.box;
+  const double c[3] = { 0.5 * (b.xmin + b.xmax), 0.5 * (b.ymin + b.ymax), 0.5 * (b.zmin + b.zmax) };
+  const double s[3] = { 0.5 * (b.xmax - b.xmin), 0.5 * (b.ymax - b.ymin), 0.5 * (b.zmax - b.zmin) };
+  w.pts.reserve(n);
+  while (w.pts.size() < n) {
+    const int k = comp(rng);
+    const double z[3] = { g(rng), g(rng), g(rng) };
+    double p[3];
+    for (int i=0; i<3; ++i) {
+      p[i] = means[k][i];
+      for (int j=0; j<=i; ++j) p[i] += L[k][i][j] * z[j];
+    }
+    // Acceptance decays with normalized radius: sparse or empty borders
+    double r2 = 0.0;
+    for (int i=0; i<3; ++i) r2 += ((p[i] - c[i]) / s[i]) * ((p[i] - c[i]) / s[i]);
+    if (u(rng) >= std::exp(-3.0 * std::max(0.0, r2 - 0.4))) continue;
+    if (p[0] < b.xmin || p[0] > b.xmax || p[1] < b.ymin || p[1] > b.ymax || p[2] < b.zmin || p[2] > b.zmax)
+      continue;
+    w.pts.push_back(Pt{ p[0], p[1], p[2] });
+  }
+  return w;
+}
+
+Workload planar_scene(size_t n, uint64_t seed) {
+  Workload w{ "planar_scene", {}, AABB{ 0, 64, 0, 64, 0, 24 }, Pt{ 32, 32, 1.8 } };
+  std::mt19937_64 rng(seed);
+  const auto bs = buildings(rng);
+  // Surfaces: ground, then per building 4 walls and a roof, picked by area
+  struct Face { int kind; const Building* b; double area; };
+  std::vector<Face> faces{ { 0, nullptr, 64.0 * 64.0 } };
+  for (const auto& b : bs) {
+    const double dx = b.x1 - b.x0, dy = b.y1 - b.y0;
+    faces.push_back({ 1, &b, dx * b.h }); faces.push_back({ 2, &b, dx * b.h });
+    faces.push_back({ 3, &b, dy * b.h }); faces.push_back({ 4, &b, dy * b.h });
+    faces.push_back({ 5, &b, dx * dy });
+  }
+  std::vector<double> area;
+  for (const auto& f : faces) area.push_back(f.area);
+  std::discrete_distribution<size_t> pick(area.begin(), area.end());
+  std::uniform_real_distribution<double> u(0.0, 1.0);
+  std::normal_distribution<double> noise(0.0, 0.02);
+  w.pts.reserve(n);
+  for (size_t i=0; i<n; ++i) {
+    const Face& f = faces[pick(rng)];
+    const Building* b = f.b;
+    const double a = u(rng), c = u(rng);
+    Pt p;
+    switch (f.kind) {
+      case 0: p = { 64.0 * a, 64.0 * c, 0.0 }; break;
+      case 1: p = { b->x0 + a * (b->x1 - b->x0), b->y0, c * b->h }; break;
+      case 2: p = { b->x0 + a * (b->x1 - b->x0), b->y1, c * b->h }; break;
+      case 3: p = { b->x0, b->y0 + a * (b->y1 - b->y0), c * b->h }; break;
+      case 4: p = { b->x1, b->y0 + a * (b->y1 - b->y0), c * b->h }; break;
+      default: p = { b->x0 + a * (b->x1 - b->x0), b->y0 + c * (b->y1 - b->y0), b->h }; break;
+    }
+    w.pts.push_back(Pt{ p.x + noise(rng), p.y + noise(rng), std::max(0.0, p.z + noise(rng)) });
+  }
+  return w;
+}
+
+Workload lidar_scan(size_t n, uint64_t seed, double max_range) {
+  Workload w{ "lidar_scan", {}, AABB{ 0, 64, 0, 64, 0, 24 }, Pt{ 32, 32, 1.8 } };
+  std::mt19937_64 rng(seed);
+  const auto bs = buildings(rng);
+  std::normal_distribution<double> noise(0.0, 0.01); // range noise per metre
+  std::uniform_real_distribution<double> jitter(0.0, 1.0);
+  const int beams = 32;
+  // Azimuth steps for about n returns per sweep; sweeps repeat with jittered phase
+  const size_t steps = std::max<size_t>(1, n / beams);
+  w.pts.reserve(n);
+  for (int sweep=0; w.pts.size() < n && sweep < 8; ++sweep) {
+    const double phase = jitter(rng);
+    for (size_t a=0; a<steps && w.pts.size() < n; ++a) {
+      const double az = 2.0 * kPi * ((double)a + phase) / (double)steps;
+      for (int e=0; e<beams && w.pts.size() < n; ++e) {
+        const double el = (-25.0 + 40.0 * e / (beams - 1)) * kPi / 180.0;
+        const Pt d{ std::cos(el) * std::cos(az), std::cos(el) * std::sin(az), std::sin(el) };
+        double t = cast(w.origin, d, bs, max_range);
+        if (t < 0.0) continue;
+        t += noise(rng) * t;
+        w.pts.push_back(Pt{ w.origin.x + t * d.x, w.origin.y + t * d.y, w.origin.z + t * d.z });
+      }
+    }
+  }
+  return w;
+}
+
+}} // namespace octoweave::bench
@@ -0,0 +1,30 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "octoweave/chunk_grid.hpp"
+#include "octoweave/octo_iface.hpp"
+
+namespace octoweave { namespace bench {
+
+// Seeded synthetic point workloads for the macrobenchmarks. Same (n, seed) => same points.
+struct Workload {
+  std::string name;
+  std::vector<Pt> pts;
+  AABB box;      // bounds for the chunk grid
+  Pt origin{};   // sensor position the points were observed from
+};
+
+// Uniform points in an 8 m cube
+Workload uniform_cloud(size_t n, uint64_t seed);
+// Three-component Gaussian mixture with radial rejection toward the borders, as in
+// python/examples/mvn_viz_demo.py (domain 8 x 8 x 4 m)
+Workload clustered_mvn(size_t n, uint64_t seed);
+// Building-like scene: ground plane plus box buildings (walls and roofs) on a 64 m block,
+// surfaces sampled by area with 2 cm noise
+Workload planar_scene(size_t n, uint64_t seed);
+// Rotating lidar at 1.8 m in the planar scene: 32 beams from -25 to +15 degrees elevation,
+// returns up to `max_range` (rays that hit nothing are dropped)
+Workload lidar_scan(size_t n, uint64_t seed, double max_range = 80.0);
+
+}} // namespace octoweave::bench
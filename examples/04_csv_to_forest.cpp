@@ -1,42 +1,20 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
 #include <string>
-#include <unordered_map>
+#include "octoweave/csv.hpp"
 #include "octoweave/hierarchy.hpp"
 #include "octoweave/p4est_builder.hpp"
 
-// Parse CSV lines: x,y,z,depth,prob
-static bool parse_csv(const std::string& path, std::vector<std::tuple<octoweave::Key3,int,double>>& out) {
-  std::ifstream f(path);
-  if (!f) return false;
-  std::string line;
-  while (std::getline(f, line)) {
-    if (line.empty()) continue;
-    std::istringstream ss(line);
-    std::string tok;
-    octoweave::Key3 k{}; int d=0; double p=0.0;
-    if (!std::getline(ss, tok, ',')) return false; k.x = (uint32_t)std::stoul(tok);
-    if (!std::getline(ss, tok, ',')) return false; k.y = (uint32_t)std::stoul(tok);
-    if (!std::getline(ss, tok, ',')) return false; k.z = (uint32_t)std::stoul(tok);
-    if (!std::getline(ss, tok, ',')) return false; d = std::stoi(tok);
-    if (!std::getline(ss, tok, ',')) return false; p = std::stod(tok);
-    out.emplace_back(k, d, p);
-  }
-  return true;
-}
-
 int main(int argc, char** argv) {
   using namespace octoweave;
   std::string csv = argc > 1 ? argv[1] : "examples_out/leaves.csv";
   std::cout << "[ex04] Reading CSV: " << csv << "\n";
-  std::vector<std::tuple<Key3,int,double>> recs;
-  if (!parse_csv(csv, recs)) { std::cerr << "Failed to read CSV\n"; return 2; }
+  CsvReadResult recs;
+  if (!read_leaves_csv(csv, CsvReadOptions{}, recs)) { std::cerr << "Failed to read CSV\n"; return 2; }
 
   // Build a minimal Hierarchy using CSV leaves
   Hierarchy H; H.base_depth = 1; H.td = 0;
-  for (auto& r : recs) {
-    Key3 k; int d; double p; std::tie(k,d,p) = r;
+  for (auto& r : recs.leaves) {
+    Key3 k{ r.x, r.y, r.z }; int d = r.d; double p = r.p;
     H.td = std::max(H.td, d);
     NDKey nd{ k, (uint16_t)d };
     auto it = H.nodes.find(nd);
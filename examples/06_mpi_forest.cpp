@@ -0,0 +1,92 @@
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include <mpi.h>
+#include "octoweave/chunk_grid.hpp"
+#include "octoweave/octo_iface.hpp"
+#include "octoweave/parallel.hpp"
+#include "octoweave/p4est_mpi.hpp"
+
+// Distributed forest assembly over MPI ranks. Run e.g.
+//   mpirun -np 4 ./ex06_mpi_forest --n 8 --points 20000
+// and vary -np for a strong-scaling series (rank 0 prints one JSON line per run).
+// --check rebuilds the same forest serially on rank 0 and compares quadrant counts.
+int main(int argc, char** argv){
+  using namespace octoweave;
+  MPI_Init(&argc, &argv);
+  int rank = 0, size = 1;
+  MPI_Comm_rank(MPI_COMM_WORLD, &rank);
+  MPI_Comm_size(MPI_COMM_WORLD, &size);
+
+  int n = 4, points = 2000, level = 2, threads = 0;
+  bool check = false;
+  for (int i=1;i<argc;++i) {
+    std::string a = argv[i];
+    if (a == "--n" && i+1<argc) n = std::stoi(argv[++i]);
+    else if (a == "--points" && i+1<argc) points = std::stoi(argv[++i]);
+    else if (a == "--level" && i+1<argc) level = std::stoi(argv[++i]);
+    else if (a == "--threads" && i+1<argc) threads = std::stoi(argv[++i]);
+    else if (a == "--check") check = true;
+  }
+
+  // n^3 chunks of 8 units each; density grows along x so the weighted partition matters
+  const double side = 8.0 * n;
+  ChunkGrid grid(n, AABB{0,side, 0,side, 0,side});
+  OctoChunker::Params p; p.res = 1.0; p.emit_res = 1.0; p.max_depth_cap = 8;
+  auto chunk_points = [&](int idx){
+    int ix = idx % n, iy = (idx / n) % n, iz = idx / (n*n);
+    auto B = grid.chunk_box(ix,iy,iz);
+    std::mt19937 rng(4242 + idx);
+    std::uniform_real_distribution<double> ux(B.xmin, B.xmax), uy(B.ymin, B.ymax), uz(B.zmin, B.zmax);
+    std::vector<Pt> pts((size_t)points * (size_t)(1 + ix));
+    for (auto& q : pts) q = {ux(rng), uy(rng), uz(rng)};
+    return pts;
+  };
+  auto build = [&](int idx){ return OctoChunker::build_and_export(chunk_points(idx), p); };
+
+  P4estBuilder::Config cfg;
+  cfg.n = n;
+  cfg.mapping = P4estBuilder::TreeMapping::Block;
+  cfg.block = P4estBuilder::block_layout(grid, p);
+  cfg.level_policy = P4estBuilder::Policy::uniform(level);
+
+  MpiBuildOptions opt;
+  opt.tau = check ? 0.0 : 0.5;
+  opt.threads = threads;
+  opt.chunk_weights.resize((size_t)n*n*n);
+  for (int i=0;i<n*n*n;++i) opt.chunk_weights[(size_t)i] = (double)points * (1 + i % n);
+
+  MPI_Barrier(MPI_COMM_WORLD);
+  double t0 = MPI_Wtime();
+  MpiBuildStats st;
+  auto* fh = build_forest_handle_mpi(build, cfg, opt, MPI_COMM_WORLD, &st);
+  double wall = MPI_Wtime() - t0;
+  double wall_max = 0.0;
+  MPI_Reduce(&wall, &wall_max, 1, MPI_DOUBLE, MPI_MAX, 0, MPI_COMM_WORLD);
+  unsigned long long local_q = fh ? (unsigned long long) fh->num_quadrants() : 0ull, min_q = 0, max_q = 0;
+  MPI_Reduce(&local_q, &min_q, 1, MPI_UNSIGNED_LONG_LONG, MPI_MIN, 0, MPI_COMM_WORLD);
+  MPI_Reduce(&local_q, &max_q, 1, MPI_UNSIGNED_LONG_LONG, MPI_MAX, 0, MPI_COMM_WORLD);
+
+  int rc = fh ? 0 : 1;
+  if (rank == 0) {
+    std::cout << "{\"ranks\": " << size << ", \"n\": " << n << ", \"points\": " << points
+              << ", \"seconds\": " << wall_max << ", \"quadrants\": " << st.global_quadrants
+              << ", \"min_local\": " << min_q << ", \"max_local\": " << max_q << "}\n";
+    if (check) {
+      auto outs = parallel_build_workers(n*n*n, build, threads);
+      Hierarchy H = make_hierarchy_from_workers(outs, opt.tau, opt.use_logodds, opt.p_unknown, opt.base_depth);
+      auto* serial = P4estBuilder::build_forest_handle(H, cfg);
+      size_t sq = serial ? serial->num_quadrants() : 0;
+      delete serial;
+      bool ok = sq == st.global_quadrants;
+      std::cout << "[ex06] serial quadrants=" << sq << " distributed=" << st.global_quadrants
+                << (ok ? " (match)" : " (MISMATCH)") << "\n";
+      if (!ok) rc = 1;
+    }
+  }
+  delete fh;
+  MPI_Bcast(&rc, 1, MPI_INT, 0, MPI_COMM_WORLD);
+  MPI_Finalize();
+  return rc;
+}
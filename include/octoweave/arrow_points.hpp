@@ -0,0 +1,30 @@
+#pragma once
+#include <functional>
+#include <string>
+#include "arrow_abi.h"
+#include "octo_iface.hpp"
+
+namespace octoweave {
+
+// Names of the point columns in Arrow record batches
+struct ArrowColumns {
+  const char* x = "x";
+  const char* y = "y";
+  const char* z = "z";
+};
+
+// View one record batch (a struct array, e.g. pyarrow RecordBatch.__arrow_c_array__) as
+// a columnar PointSpan over the x, y, z children's value buffers, valid while the batch
+// is. The columns must share one type, float32 ("f") or float64 ("g"), and hold no nulls.
+// Returns false (reason in *err) otherwise.
+bool arrow_point_span(const ArrowSchema& schema, const ArrowArray& batch,
+                      const ArrowColumns& cols, PointSpan& out, std::string* err = nullptr);
+
+// Pull record batches from `stream` (e.g. a chunked table or a Parquet batch reader) one
+// at a time: each is viewed in place, passed to fn and released before the next is read.
+// The stream is released on return. Returns the number of batches or -1 (reason in *err).
+long consume_arrow_stream(ArrowArrayStream* stream, const ArrowColumns& cols,
+                          const std::function<void(const PointSpan&)>& fn,
+                          std::string* err = nullptr);
+
+} // namespace octoweave
@@ -1,5 +1,6 @@
 #pragma once
 #include <stddef.h>
+#include "arrow_abi.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -8,6 +9,8 @@ extern "C" {
 // Opaque handles
 typedef struct ow_hierarchy_s* ow_hierarchy_t;
 typedef struct ow_forest_s* ow_forest_t;
+typedef struct ow_session_s* ow_session_t;
+typedef struct ow_leaf_columns_ref_s* ow_leaf_columns_ref_t;
 
 // OctoChunker params for C API
 typedef struct {
@@ -31,18 +34,66 @@ ow_hierarchy_t ow_build_hierarchy_from_points(const double* xyz, size_t count,
                                               double p_unknown,
                                               int base_depth);
 
+// Strided point input read in place (no float64 conversion or intermediate copies):
+// `count` points of x, y, z scalars of `type`, `stride` bytes apart (0 = packed), e.g.
+// float32 x, y, z, intensity records with stride 16.
+#define OW_POINTS_F64 0
+#define OW_POINTS_F32 1
+typedef struct {
+  const void* data;
+  size_t      count;
+  size_t      stride;
+  int         type;
+} ow_points_t;
+ow_hierarchy_t ow_build_hierarchy_from_span(const ow_points_t* pts,
+                                            const ow_chunk_params_t* params,
+                                            double tau, double p_unknown, int base_depth);
+// Chunked build over strided input; chunks are binned by index, points are never copied
+ow_hierarchy_t ow_build_hierarchy_chunked_span(const ow_points_t* pts,
+                                               const ow_chunk_params_t* params,
+                                               const double box[6], int n, int threads,
+                                               double tau, double p_unknown, int base_depth);
+
+// Chunked parallel build: bin points into an n×n×n ChunkGrid over `box`
+// (xmin,xmax,ymin,ymax,zmin,zmax; points outside go to the border chunks), build the
+// non-empty chunks on up to `threads` threads (<= 0: all cores) and merge them.
+// Returns NULL on invalid input.
+ow_hierarchy_t ow_build_hierarchy_chunked(const double* xyz, size_t count,
+                                          const ow_chunk_params_t* params,
+                                          const double box[6], int n, int threads,
+                                          double tau, double p_unknown, int base_depth);
+
 // Write hierarchy leaves to CSV (x,y,z,depth,prob)
 int ow_hierarchy_write_csv(ow_hierarchy_t h, const char* path);
 
 // Destroy hierarchy handle
 void ow_hierarchy_free(ow_hierarchy_t h);
 
-// Build a p4est-based octree forest with uniform target level (real build) or stub (returns success)
+// Build an octree forest with uniform target level (p4est when built with it, otherwise the
+// built-in linear-octree backend)
 ow_forest_t ow_build_forest_uniform(ow_hierarchy_t h, int n, int level);
 
+// Re-adapt an existing forest to new per-tree levels (len >= n^3) on the current (possibly
+// updated) hierarchy; only changed trees and their neighbors are coarsened/refined and
+// refreshed. Returns the number of refreshed trees, or a negative value on error.
+int ow_forest_adapt_levels(ow_forest_t f, ow_hierarchy_t h, const int* levels, size_t len);
+
+// Number of quadrants in the forest (local part when distributed)
+size_t ow_forest_num_quadrants(ow_forest_t f);
+
 // Destroy forest handle
 void ow_forest_free(ow_forest_t f);
 
+// Key -> tree mapping for forest builds and level functions on this hierarchy
+#define OW_TREE_MAPPING_MODULO 0  // tree = k % n (default)
+#define OW_TREE_MAPPING_BLOCK  1  // each tree owns a contiguous key block
+// Select the mapping. For BLOCK, origin/extent (3 keys each, at `depth`) describe the
+// key-space box split into n^3 blocks; NULL or zero extents mean the full 2^depth range,
+// depth < 0 means the hierarchy's leaf depth. Returns 0 on success.
+int ow_hierarchy_set_tree_mapping(ow_hierarchy_t h, int mapping,
+                                  const unsigned int origin[3], const unsigned int extent[3],
+                                  int depth);
+
 // Compute per-tree levels by leafcount quantiles; out_levels must have length n^3
 int ow_levels_by_leafcount_quantiles(ow_hierarchy_t h, int n,
                                      double q_lo, double q_hi,
@@ -59,6 +110,131 @@ int ow_levels_bands_by_mean_prob(ow_hierarchy_t h, int n,
 int ow_viz_slice(const char* csv_path, int slice_z, int depth,
                  const char* out_pgm, const char* out_svg);
 
+// Rasters straight from a hierarchy (no CSV). Buffers are caller-owned, row-major
+// (y*width + x), width*height doubles; cells without leaves get `background`. The leaf
+// index is built on first use; calls on one hierarchy may run concurrently.
+#define OW_PROJECTION_MAX  0
+#define OW_PROJECTION_MEAN 1
+#define OW_PROJECTION_SUM  2
+// One past the largest leaf key per axis at `depth` (< 0: deepest leaf depth)
+int ow_hierarchy_leaf_extent(ow_hierarchy_t h, int depth, unsigned int out_extent[3]);
+// Leaves at `depth` (< 0: deepest) in z-slice `z`; returns leaves drawn or < 0 on error
+long ow_render_slice(ow_hierarchy_t h, int depth, unsigned int z,
+                     double* out, int width, int height, double background);
+// Max, mean (over present leaves) or sum projection along z of leaves at `depth`
+long ow_render_projection(ow_hierarchy_t h, int depth, int mode,
+                          double* out, int width, int height, double background);
+
+// Raster kernels over caller-owned leaf columns (e.g. numpy arrays), n entries each.
+// `d` may be null when all leaves share the requested depth. Rasters follow the rules
+// above; a projection along `axis` maps the remaining axes in x, y, z order to column
+// and row. threads <= 0 uses all cores. Returns leaves drawn/counted or < 0 on error.
+#define OW_AXIS_X 0
+#define OW_AXIS_Y 1
+#define OW_AXIS_Z 2
+typedef struct {
+  const unsigned int* x;
+  const unsigned int* y;
+  const unsigned int* z;
+  const int*          d;
+  const double*       p;
+  size_t              n;
+} ow_leaf_columns_t;
+// Leaves at `depth` with lo <= axis coordinate <= hi, projected along `axis`
+long ow_raster_project(const ow_leaf_columns_t* cols, int depth, int axis,
+                       unsigned int lo, unsigned int hi, int mode,
+                       double* out, int width, int height, double background, int threads);
+// Slice at `coord` along `axis`
+long ow_raster_slice(const ow_leaf_columns_t* cols, int depth, int axis, unsigned int coord,
+                     double* out, int width, int height, double background, int threads);
+// Probability histograms per depth into out[(max_depth+1)*bins] (row = depth); bins
+// split [lo, hi], last bin closed. Only d and p are read.
+long ow_depth_histogram(const ow_leaf_columns_t* cols, int max_depth, int bins,
+                        double lo, double hi, unsigned long long* out, int threads);
+
+// Columnar leaf export without a CSV round trip. Leaves are ordered by depth, then
+// (z, y, x), and share the leaf index used by the render calls.
+size_t ow_hierarchy_num_leaves(ow_hierarchy_t h);
+// Copy up to `cap` leaves into caller arrays; null column pointers are skipped.
+// Returns leaves written or < 0 on error.
+long ow_hierarchy_copy_leaves(ow_hierarchy_t h, unsigned int* x, unsigned int* y,
+                              unsigned int* z, int* d, double* p, size_t cap);
+// Borrow the internal columns (zero copy); valid until ow_hierarchy_free(h) and may be
+// passed straight to the raster kernels. Returns 0 on success.
+int ow_hierarchy_leaf_columns(ow_hierarchy_t h, ow_leaf_columns_t* out);
+// Like ow_hierarchy_leaf_columns, but the returned reference keeps the columns alive past
+// ow_hierarchy_free, ow_session_free and session updates until ow_leaf_columns_release.
+// Returns null on error.
+ow_leaf_columns_ref_t ow_hierarchy_leaf_columns_retain(ow_hierarchy_t h, ow_leaf_columns_t* out);
+void ow_leaf_columns_release(ow_leaf_columns_ref_t ref);
+
+// Streaming sessions: scans are inserted one at a time into persistent per-chunk state and
+// the hierarchy is updated only around the chunks each scan touched. Calls on one session
+// must be serialized.
+ow_session_t ow_session_create(const ow_chunk_params_t* params, const double box[6], int n,
+                               int threads, double tau, double p_unknown, int base_depth);
+// Insert one scan taken from sensor position `origin` (null: (0, 0, 0)).
+// Returns the number of chunks touched or < 0 on error.
+long ow_session_insert(ow_session_t s, const ow_points_t* pts, const double origin[3]);
+// Hierarchy over all scans so far. The handle is owned by the session (ow_hierarchy_free is
+// a no-op on it) and stays valid until ow_session_free; borrowed leaf columns are
+// invalidated by the next insert followed by this call (retained ones are not).
+ow_hierarchy_t ow_session_hierarchy(ow_session_t s);
+// Session forest over the current hierarchy, re-adapted in place after inserts; level < 0
+// keeps the default level policy, and a level different from the previous call's rebuilds
+// the forest. Owned by the session like the hierarchy handle.
+ow_forest_t ow_session_forest(ow_session_t s, int n, int level);
+void ow_session_free(ow_session_t s);
+
+// Arrow C Data Interface ingestion. Batches are struct arrays (record batches) whose point
+// columns (`columns` = three names, null = "x", "y", "z") are float32 or float64 of one
+// type without nulls; value buffers are read in place. Streams are consumed batch by batch
+// and released on return.
+long ow_session_insert_arrow(ow_session_t s, const struct ArrowSchema* schema,
+                             const struct ArrowArray* batch, const char* const columns[3],
+                             const double origin[3]);
+// Returns batches inserted, or < 0 on error (-2: unsupported or malformed Arrow data)
+long ow_session_insert_arrow_stream(ow_session_t s, struct ArrowArrayStream* stream,
+                                    const char* const columns[3], const double origin[3]);
+// One-shot build from a stream: batches are inserted into a temporary session as scans from
+// params->origin_xyz (box may be null when n == 1)
+ow_hierarchy_t ow_build_hierarchy_from_arrow_stream(struct ArrowArrayStream* stream,
+                                                    const char* const columns[3],
+                                                    const ow_chunk_params_t* params,
+                                                    const double box[6], int n, int threads,
+                                                    double tau, double p_unknown, int base_depth);
+
+// Stage tracing (off by default; near-free while off). Spans and counters are recorded
+// per thread by every library call made while enabled.
+typedef struct {
+  const char* name;     // "stage" or "stage/arg", e.g. "rollup/7"
+  unsigned long long calls;
+  double total_ms;      // summed over threads
+  double max_ms;
+} ow_trace_stage_t;
+typedef struct {
+  const char* name;
+  long long value;
+} ow_trace_counter_t;
+typedef struct {
+  const char* name;     // container pool, e.g. "depth_maps"
+  long long current_bytes;
+  long long peak_bytes; // since the last ow_trace_reset
+} ow_trace_memory_t;
+void ow_trace_enable(int on);
+int ow_trace_enabled(void);
+// Drop everything recorded so far
+void ow_trace_reset(void);
+// Snapshot the recorded stages / counters and copy up to `cap` entries; returns the total
+// count. Names stay valid until the next call of the same function or ow_trace_reset.
+size_t ow_trace_stages(ow_trace_stage_t* out, size_t cap);
+size_t ow_trace_counters(ow_trace_counter_t* out, size_t cap);
+// Bytes held per container pool; returns the pool count, 0 unless the library was built
+// with OCTOWEAVE_TRACK_MEMORY. Pool names are static strings.
+size_t ow_trace_memory(ow_trace_memory_t* out, size_t cap);
+// Write Chrome trace JSON (chrome://tracing, Perfetto). Returns 0 on success.
+int ow_trace_write_chrome(const char* path);
+
 #ifdef __cplusplus
 }
 #endif
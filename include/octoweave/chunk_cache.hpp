@@ -0,0 +1,95 @@
+#pragma once
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "chunk_grid.hpp"
+#include "hierarchy.hpp"
+#include "octo_iface.hpp"
+
+namespace octoweave {
+
+// Per-chunk occupancy state under a memory budget, for maps larger than RAM (city-scale
+// drives). Chunks are kept in least-recently-touched order; once the resident states exceed
+// the budget the coldest are written to a spill directory (ChunkState::save) and dropped,
+// and reloaded transparently when later points reach them. Only resident chunks are kept in
+// memory; spilled chunks are tracked by their files, so bookkeeping stays within the budget
+// however far the drive goes. Not thread-safe; calls must be serialized by the caller.
+class ChunkCache {
+public:
+  struct Options {
+    AABB box{0, 1, 0, 1, 0, 1}; // chunk grid extent; points outside go to border chunks
+    int n = 1;                  // n×n×n chunks
+    OctoChunker::Params params;
+    size_t budget_bytes = size_t(256) << 20; // resident ChunkState::memory_bytes() after each insert
+    std::string spill_dir;      // chunk files (created if missing; empty: the temp directory)
+    int threads = 0;            // chunk loads and updates in parallel (<= 0: all cores)
+  };
+
+  struct Stats {
+    size_t resident_chunks = 0;
+    size_t spilled_chunks = 0;
+    size_t resident_bytes = 0;
+    size_t peak_resident_bytes = 0; // high-water mark, including chunks reloaded by an insert
+    size_t spilled_bytes = 0;       // chunk files currently on disk
+    size_t evictions = 0;
+    size_t reloads = 0;
+    // Failed writes keep the chunk resident; a chunk whose file cannot be read keeps the
+    // file and its points are skipped (exports of it are empty)
+    size_t io_errors = 0;
+  };
+
+  explicit ChunkCache(const Options& opt);
+  ~ChunkCache(); // removes the chunk files it wrote
+
+  // Insert one scan taken from `origin`, or a batch of scans (same result as Session's
+  // batch insert). Spilled chunks the points reach are reloaded first; the budget is
+  // enforced afterwards. Return the number of chunks updated.
+  size_t insert(const PointSpan& pts, const Pt& origin);
+  size_t insert(const std::vector<Scan>& scans);
+
+  // Export every chunk holding data in ascending chunk order. Spilled chunks are read one
+  // at a time and dropped again, so exporting does not bring the map back into memory and
+  // does not change the eviction order.
+  void for_each_worker(const std::function<void(int chunk, WorkerOut&& w)>& fn);
+  // All exports, ready for make_hierarchy_from_workers. Every export is held at once; use
+  // hierarchy() when the exports of the whole map do not fit in memory.
+  std::vector<WorkerOut> export_workers(std::vector<int>* chunk_ids = nullptr);
+  // make_hierarchy_from_workers(export_workers(), tau, false, p_unknown, base_depth), built
+  // from for_each_worker through a HierarchyBuilder: one export is held at a time, next to
+  // the merged leaves and the hierarchy.
+  Hierarchy hierarchy(double tau, double p_unknown = 0.5, int base_depth = 1,
+                      std::pmr::memory_resource* scratch = nullptr);
+
+  const Stats& stats() const { return stats_; }
+  const ChunkGrid& grid() const { return grid_; }
+
+private:
+  struct Entry {
+    std::unique_ptr<ChunkState> state;
+    size_t bytes = 0;             // memory_bytes() as of the last update
+    std::list<int>::iterator lru;
+  };
+
+  std::string path_of(int c) const;
+  std::vector<int> spilled_ids() const; // from the spill directory
+  std::vector<int> chunk_ids() const;   // resident and spilled, ascending
+  bool spill(int c);
+  void touch(Entry& e);
+  void enforce_budget();
+  // Export of chunk c without changing residency; false if its file could not be read
+  bool export_chunk(int c, WorkerOut& out) const;
+
+  Options opt_;
+  std::string dir_;
+  std::string tag_; // "<random tag>-" file name prefix, so caches can share a directory
+  ChunkGrid grid_;
+  std::unordered_map<int, Entry> entries_; // resident chunks
+  std::list<int> lru_; // resident chunks, most recently touched first
+  Stats stats_;
+};
+
+} // namespace octoweave
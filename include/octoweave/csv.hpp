@@ -0,0 +1,37 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace octoweave {
+
+// One row of the leaves CSV (x,y,z,depth,prob) written by ow_hierarchy_write_csv.
+struct CsvLeaf {
+  uint32_t x, y, z;
+  int d;
+  double p;
+};
+
+struct CsvReadOptions {
+  int depth = -1;            // keep only rows at this depth (-1 = all)
+  int64_t slice_z = -1;      // keep only rows with this z (-1 = all)
+  // Optional sets (non-negative values) combined with depth/slice_z; empty = no filter
+  std::vector<int> depths;
+  std::vector<int64_t> slices;
+  int threads = 0;           // parser ranges/threads (0 = about one per 4 MiB, up to the cores)
+};
+
+struct CsvReadResult {
+  std::vector<CsvLeaf> leaves;         // rows passing the filter, in file order
+  std::map<int, size_t> depth_counts;  // rows per depth before filtering
+  size_t rows = 0;                     // non-empty rows parsed
+};
+
+// Memory-map `path`, split it into line-aligned ranges parsed in parallel, and filter
+// rows while parsing. Returns false if the file cannot be read or a non-empty row is
+// malformed (fewer than five fields or a bad number).
+bool read_leaves_csv(const std::string& path, const CsvReadOptions& opt, CsvReadResult& out);
+
+} // namespace octoweave
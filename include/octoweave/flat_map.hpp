@@ -0,0 +1,237 @@
+#pragma once
+// Open-addressing hash map for the voxel accumulation hot paths (chunk export, worker
+// merge, roll-up buckets). Keys and values are trivially copyable and kept in separate
+// arrays, so narrow values (e.g. int16 log-odds) are not padded to the key's alignment;
+// slots are probed in groups of 16 control bytes (SSE2 compares when available) and
+// storage comes from a std::pmr::memory_resource, so arenas and caller-supplied resources
+// work unchanged.
+#include "octoweave/key_traits.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <iterator>
+#include <memory_resource>
+#include <type_traits>
+#include <utility>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define OCTOWEAVE_FLAT_MAP_SSE2 1
+#endif
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace octoweave {
+
+// Full-avalanche mixing (murmur3 finalizer): every key bit reaches the 7 tag bits and the
+// group index, which open addressing needs and Key3Hash's xor-shift chain does not give
+inline uint64_t mix64(uint64_t h) {
+  h ^= h >> 33; h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33; h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+template <class K> struct FlatHash;
+template <> struct FlatHash<uint64_t> {
+  uint64_t operator()(uint64_t k) const noexcept { return mix64(k); }
+};
+template <> struct FlatHash<uint128> {
+  uint64_t operator()(uint128 k) const noexcept { return mix64((uint64_t)k ^ mix64((uint64_t)(k >> 64))); }
+};
+template <> struct FlatHash<Key3> {
+  uint64_t operator()(const Key3& k) const noexcept {
+    return mix64(((uint64_t)k.x << 32 | k.y) ^ mix64((uint64_t)k.z + 0x9e3779b97f4a7c15ULL));
+  }
+};
+
+template <class K, class V, class Hash = FlatHash<K>>
+class FlatMap {
+  static_assert(std::is_trivially_copyable<K>::value && std::is_trivially_copyable<V>::value,
+                "FlatMap stores trivially copyable keys and values");
+public:
+  using key_type = K;
+  using mapped_type = V;
+  using value_type = std::pair<K, V>;
+  static constexpr size_t kGroup = 16;
+
+  explicit FlatMap(std::pmr::memory_resource* mr = nullptr) noexcept
+    : mr_(mr ? mr : std::pmr::get_default_resource()) {}
+  ~FlatMap() { release(); }
+  FlatMap(const FlatMap&) = delete;
+  FlatMap& operator=(const FlatMap&) = delete;
+  FlatMap(FlatMap&& o) noexcept { steal(o); }
+  FlatMap& operator=(FlatMap&& o) noexcept {
+    if (this != &o) { release(); steal(o); }
+    return *this;
+  }
+
+  size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+  size_t capacity() const noexcept { return cap_; }
+
+  // Room for n entries without rehashing (load factor <= 7/8)
+  void reserve(size_t n) {
+    size_t want = kGroup;
+    while (want - want / 8 < n) want *= 2;
+    if (want > cap_) rehash(want);
+  }
+
+  // Drop all entries and keep the storage for reuse
+  void clear() noexcept {
+    if (cap_) std::memset(ctrl_, kEmpty, cap_);
+    size_ = 0;
+  }
+
+  // Slot for k, value-initialized when inserted; .second tells whether it was
+  std::pair<V*, bool> try_emplace(const K& k) {
+    const uint64_t h = Hash{}(k);
+    if (cap_) {
+      if (V* v = find_hashed(k, h)) return { v, false };
+    }
+    if (size_ + 1 > cap_ - cap_ / 8) rehash(cap_ ? cap_ * 2 : kGroup);
+    const size_t i = insert_slot(h);
+    keys_[i] = k;
+    vals_[i] = V{};
+    ++size_;
+    return { &vals_[i], true };
+  }
+  V& operator[](const K& k) { return *try_emplace(k).first; }
+
+  V* find(const K& k) noexcept { return cap_ ? find_hashed(k, Hash{}(k)) : nullptr; }
+  const V* find(const K& k) const noexcept {
+    return cap_ ? const_cast<FlatMap*>(this)->find_hashed(k, Hash{}(k)) : nullptr;
+  }
+  bool contains(const K& k) const noexcept { return find(k) != nullptr; }
+
+  // Iterators yield (key, value) reference pairs: bind them with `const auto&` or `auto&&`
+  template <bool Const>
+  class Iter {
+  public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = FlatMap::value_type;
+    using difference_type = std::ptrdiff_t;
+    using reference = std::pair<const K&, std::conditional_t<Const, const V&, V&>>;
+    struct pointer {
+      reference r;
+      const reference* operator->() const { return &r; }
+    };
+    Iter(const FlatMap* m, size_t i) : m_(m), i_(i) { skip(); }
+    reference operator*() const { return reference(m_->keys_[i_], m_->vals_[i_]); }
+    pointer operator->() const { return pointer{ **this }; }
+    Iter& operator++() { ++i_; skip(); return *this; }
+    bool operator==(const Iter& o) const { return i_ == o.i_; }
+    bool operator!=(const Iter& o) const { return i_ != o.i_; }
+  private:
+    void skip() { while (i_ < m_->cap_ && m_->ctrl_[i_] == kEmpty) ++i_; }
+    const FlatMap* m_;
+    size_t i_;
+  };
+  using iterator = Iter<false>;
+  using const_iterator = Iter<true>;
+  iterator begin() { return iterator(this, 0); }
+  iterator end() { return iterator(this, cap_); }
+  const_iterator begin() const { return const_iterator(this, 0); }
+  const_iterator end() const { return const_iterator(this, cap_); }
+
+private:
+  static constexpr int8_t kEmpty = -128; // full slots hold the 7-bit tag (0..127)
+
+  static int8_t tag(uint64_t h) { return (int8_t)(h >> 57); }
+
+  // Bit i set where ctrl[i] == c, for the 16 control bytes at g
+  static uint32_t match(const int8_t* g, int8_t c) {
+#ifdef OCTOWEAVE_FLAT_MAP_SSE2
+    const __m128i ctrl = _mm_loadu_si128(reinterpret_cast<const __m128i*>(g));
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8(c)));
+#else
+    uint32_t m = 0;
+    for (size_t i=0; i<kGroup; ++i) m |= (uint32_t)(g[i] == c) << i;
+    return m;
+#endif
+  }
+  // Index of the lowest set bit; m != 0
+  static int lowest(uint32_t m) {
+#ifdef _MSC_VER
+    unsigned long i;
+    _BitScanForward(&i, m);
+    return (int)i;
+#else
+    return __builtin_ctz(m);
+#endif
+  }
+
+  // Triangular probing over whole groups visits every group of a power-of-two table
+  V* find_hashed(const K& k, uint64_t h) {
+    const size_t groups = cap_ / kGroup;
+    size_t g = (size_t)h & (groups - 1);
+    const int8_t t = tag(h);
+    for (size_t step=1; ; ++step) {
+      const int8_t* c = ctrl_ + g * kGroup;
+      for (uint32_t m = match(c, t); m; m &= m - 1) {
+        const size_t i = g * kGroup + (size_t)lowest(m);
+        if (keys_[i] == k) return &vals_[i];
+      }
+      if (match(c, kEmpty)) return nullptr;
+      g = (g + step) & (groups - 1);
+    }
+  }
+
+  size_t insert_slot(uint64_t h) {
+    const size_t groups = cap_ / kGroup;
+    size_t g = (size_t)h & (groups - 1);
+    for (size_t step=1; ; ++step) {
+      if (const uint32_t m = match(ctrl_ + g * kGroup, kEmpty)) {
+        const size_t i = g * kGroup + (size_t)lowest(m);
+        ctrl_[i] = tag(h);
+        return i;
+      }
+      g = (g + step) & (groups - 1);
+    }
+  }
+
+  void rehash(size_t cap) {
+    int8_t* old_ctrl = ctrl_;
+    K* old_keys = keys_;
+    V* old_vals = vals_;
+    const size_t old_cap = cap_;
+    ctrl_ = static_cast<int8_t*>(mr_->allocate(cap, kGroup));
+    keys_ = static_cast<K*>(mr_->allocate(cap * sizeof(K), alignof(K)));
+    vals_ = static_cast<V*>(mr_->allocate(cap * sizeof(V), alignof(V)));
+    std::memset(ctrl_, kEmpty, cap);
+    cap_ = cap;
+    for (size_t i=0; i<old_cap; ++i) {
+      if (old_ctrl[i] == kEmpty) continue;
+      const size_t j = insert_slot(Hash{}(old_keys[i]));
+      std::memcpy((void*)&keys_[j], (const void*)&old_keys[i], sizeof(K));
+      std::memcpy((void*)&vals_[j], (const void*)&old_vals[i], sizeof(V));
+    }
+    if (old_cap) deallocate(old_ctrl, old_keys, old_vals, old_cap);
+  }
+
+  void deallocate(int8_t* ctrl, K* keys, V* vals, size_t cap) noexcept {
+    mr_->deallocate(ctrl, cap, kGroup);
+    mr_->deallocate(keys, cap * sizeof(K), alignof(K));
+    mr_->deallocate(vals, cap * sizeof(V), alignof(V));
+  }
+
+  void release() noexcept {
+    if (cap_) deallocate(ctrl_, keys_, vals_, cap_);
+    ctrl_ = nullptr; keys_ = nullptr; vals_ = nullptr; cap_ = 0; size_ = 0;
+  }
+
+  void steal(FlatMap& o) noexcept {
+    mr_ = o.mr_; ctrl_ = o.ctrl_; keys_ = o.keys_; vals_ = o.vals_; cap_ = o.cap_; size_ = o.size_;
+    o.ctrl_ = nullptr; o.keys_ = nullptr; o.vals_ = nullptr; o.cap_ = 0; o.size_ = 0;
+  }
+
+  std::pmr::memory_resource* mr_ = nullptr;
+  int8_t* ctrl_ = nullptr;
+  K* keys_ = nullptr;
+  V* vals_ = nullptr;
+  size_t cap_ = 0;  // power of two, multiple of kGroup (or 0)
+  size_t size_ = 0;
+};
+
+} // namespace octoweave
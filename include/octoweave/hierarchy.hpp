@@ -1,5 +1,8 @@
 #pragma once
+#include "octoweave/memory.hpp"
+#include <cstddef>
 #include <cstdint>
+#include <memory_resource>
 #include <unordered_map>
 #include <vector>
 
@@ -26,24 +29,78 @@ struct NDHash {
 
 struct NodeRec { double p; bool is_leaf; };
 
+// Probabilities per key at one depth
+using DepthMap = mem::HashMap<Key3, double, Key3Hash, mem::Pool::depth_maps>;
+
 struct Hierarchy {
-  std::unordered_map<NDKey, NodeRec, NDHash> nodes;
+  mem::HashMap<NDKey, NodeRec, NDHash, mem::Pool::hierarchy_nodes> nodes;
   int base_depth = 1;
   int td = 1;
 };
 
 struct WorkerOut {
   // probability map at max depth td
-  std::unordered_map<Key3,double,Key3Hash> Ptd;
+  mem::HashMap<Key3, double, Key3Hash, mem::Pool::worker_maps> Ptd;
   int td = 0;
 };
 
+/// Storage of the per-depth probabilities while a hierarchy is built: doubles, or 16-bit
+/// fixed-point log-odds (union.hpp) with unions in the log-complement domain, a quarter of
+/// the payload. Inputs and NodeRec::p stay double either way.
+enum class ProbStorage { f64, logodds16 };
+
 /// Build a hierarchy from per-chunk WorkerOut results.
 /// - tau: probability threshold (if comparing in log-odds, pass `use_logodds=true`)
 /// - p_unknown: default probability for missing children
+/// - scratch: upstream of the monotonic arenas holding the per-depth maps and roll-up
+///   buckets, released in bulk (null: std::pmr::get_default_resource())
+/// - storage: ProbStorage::logodds16 trades the error bounds of docs/cpp_api.rst for the
+///   smaller maps and a table-driven roll-up
 Hierarchy make_hierarchy_from_workers(
   const std::vector<WorkerOut>& outs,
   double tau, bool use_logodds=false,
-  double p_unknown=0.5, int base_depth=1);
+  double p_unknown=0.5, int base_depth=1,
+  std::pmr::memory_resource* scratch=nullptr,
+  ProbStorage storage=ProbStorage::f64);
+
+/// Incrementally maintained hierarchy for streaming updates. Probabilities at depth td are
+/// edited key by key; refresh() re-derives only the ancestors of edited keys and the
+/// hierarchy nodes below them. After refresh(), hierarchy() equals
+/// make_hierarchy_from_workers over a single worker holding leaves().
+class HierarchyBuilder {
+public:
+  /// `scratch` backs the arena of each refresh's temporary key sets (null: default resource)
+  HierarchyBuilder(int td, double tau, bool use_logodds=false,
+                   double p_unknown=0.5, int base_depth=1,
+                   std::pmr::memory_resource* scratch=nullptr);
+
+  /// Set a depth-td probability (clamped to [0, 1]) or remove the key.
+  void set(const Key3& k, double p);
+  void erase(const Key3& k);
+  const DepthMap& leaves() const { return P_[(size_t)td_]; }
+
+  /// A depth-td leaf written or erased by refresh: `count` is +1 (added), -1 (removed) or
+  /// 0 (probability rewritten) and `dp` the change of its probability.
+  struct LeafDelta { Key3 k; int count; double dp; };
+
+  /// Apply pending edits. Returns the number of hierarchy nodes written or erased;
+  /// `changed`, when given, receives their keys and `leaf_deltas` the depth-td leaf changes
+  /// among them (enough to keep per-region leaf sums current without walking the hierarchy).
+  size_t refresh(std::vector<NDKey>* changed = nullptr,
+                 std::vector<LeafDelta>* leaf_deltas = nullptr);
+  const Hierarchy& hierarchy() const { return H_; }
+
+private:
+  using Level = DepthMap;
+  int td_;
+  double tau_;
+  bool use_logodds_;
+  double p_unknown_;
+  int base_depth_;
+  std::pmr::memory_resource* scratch_;
+  std::vector<Level> P_;      // P_[d]: probabilities at depth d (td and roll-ups)
+  std::vector<Key3> pending_; // edited depth-td keys since the last refresh
+  Hierarchy H_;
+};
 
 } // namespace octoweave
@@ -0,0 +1,133 @@
+#pragma once
+// Octree key machinery. Key3 helpers work on unpacked keys; KeyTraits<MaxDepth> packs a
+// (depth, key) pair into the smallest integer that holds it: the Morton code of the key
+// (x in the lowest bit of each triple) above the depth bits, so parent, child and child
+// index are shifts and masks.
+#include "octoweave/hierarchy.hpp"
+#include <cstdint>
+#include <type_traits>
+
+namespace octoweave {
+
+inline Key3 parent_key(const Key3& kc) { return { kc.x>>1, kc.y>>1, kc.z>>1 }; }
+inline int child_index(const Key3& kc) { return (int)((kc.x&1) | ((kc.y&1)<<1) | ((kc.z&1)<<2)); }
+inline Key3 child_key(const Key3& kp, int i) {
+  return { (kp.x<<1)|((i>>0)&1u), (kp.y<<1)|((i>>1)&1u), (kp.z<<1)|((i>>2)&1u) };
+}
+
+// Morton code of the low 21 bits of each coordinate (63 bits)
+constexpr int kMortonAxisBits = 21;
+
+inline bool morton_fits(const Key3& k) {
+  return ((k.x | k.y | k.z) >> kMortonAxisBits) == 0;
+}
+
+inline uint64_t morton_encode(const Key3& k) {
+  auto spread = [](uint64_t v) {
+    v &= 0x1fffff;
+    v = (v | v << 32) & 0x1f00000000ffffULL;
+    v = (v | v << 16) & 0x1f0000ff0000ffULL;
+    v = (v | v << 8)  & 0x100f00f00f00f00fULL;
+    v = (v | v << 4)  & 0x10c30c30c30c30c3ULL;
+    v = (v | v << 2)  & 0x1249249249249249ULL;
+    return v;
+  };
+  return spread(k.x) | (spread(k.y) << 1) | (spread(k.z) << 2);
+}
+
+inline Key3 morton_decode(uint64_t m) {
+  auto compact = [](uint64_t v) {
+    v &= 0x1249249249249249ULL;
+    v = (v ^ (v >> 2))  & 0x10c30c30c30c30c3ULL;
+    v = (v ^ (v >> 4))  & 0x100f00f00f00f00fULL;
+    v = (v ^ (v >> 8))  & 0x1f0000ff0000ffULL;
+    v = (v ^ (v >> 16)) & 0x1f00000000ffffULL;
+    v = (v ^ (v >> 32)) & 0x1fffff;
+    return (uint32_t)v;
+  };
+  return Key3{ compact(m), compact(m >> 1), compact(m >> 2) };
+}
+
+#if defined(__SIZEOF_INT128__)
+__extension__ typedef unsigned __int128 uint128; // GCC/Clang
+#else
+// Compilers without __int128 (MSVC): two 64-bit halves with the operators KeyTraits, the
+// wide Morton helpers and FlatHash use
+struct uint128 {
+  uint64_t lo = 0, hi = 0;
+  constexpr uint128() = default;
+  constexpr uint128(uint64_t v) : lo(v) {}
+  constexpr uint128(uint64_t l, uint64_t h) : lo(l), hi(h) {}
+  template <class T, class = std::enable_if_t<std::is_integral<T>::value>>
+  constexpr explicit operator T() const { return (T)lo; }
+
+  friend constexpr uint128 operator<<(uint128 a, int s) {
+    if (s == 0) return a;
+    if (s >= 64) return uint128(0, a.lo << (s - 64));
+    return uint128(a.lo << s, a.hi << s | a.lo >> (64 - s));
+  }
+  friend constexpr uint128 operator>>(uint128 a, int s) {
+    if (s == 0) return a;
+    if (s >= 64) return uint128(a.hi >> (s - 64), 0);
+    return uint128(a.lo >> s | a.hi << (64 - s), a.hi >> s);
+  }
+  friend constexpr uint128 operator|(uint128 a, uint128 b) { return uint128(a.lo | b.lo, a.hi | b.hi); }
+  friend constexpr uint128 operator&(uint128 a, uint128 b) { return uint128(a.lo & b.lo, a.hi & b.hi); }
+  friend constexpr uint128 operator-(uint128 a, uint128 b) {
+    return uint128(a.lo - b.lo, a.hi - b.hi - (a.lo < b.lo ? 1 : 0));
+  }
+  friend constexpr bool operator==(uint128 a, uint128 b) { return a.lo == b.lo && a.hi == b.hi; }
+  friend constexpr bool operator!=(uint128 a, uint128 b) { return !(a == b); }
+  friend constexpr bool operator<(uint128 a, uint128 b) { return a.hi < b.hi || (a.hi == b.hi && a.lo < b.lo); }
+};
+#endif
+
+// Full 96-bit Morton code of a Key3: bits 21..31 of each coordinate continue above bit 62
+inline uint128 morton_encode_wide(const Key3& k) {
+  const Key3 hi{ k.x >> kMortonAxisBits, k.y >> kMortonAxisBits, k.z >> kMortonAxisBits };
+  return (uint128)morton_encode(k) | ((uint128)morton_encode(hi) << (3 * kMortonAxisBits));
+}
+
+inline Key3 morton_decode_wide(uint128 m) {
+  const Key3 lo = morton_decode((uint64_t)m & ((1ULL << (3 * kMortonAxisBits)) - 1));
+  const Key3 hi = morton_decode((uint64_t)(m >> (3 * kMortonAxisBits)));
+  return Key3{ lo.x | hi.x << kMortonAxisBits, lo.y | hi.y << kMortonAxisBits,
+               lo.z | hi.z << kMortonAxisBits };
+}
+
+// Packed (depth, key) for maps of depth <= MaxDepth: 64 bits up to depth 19 (57 Morton bits
+// + 5 depth bits), 128 bits up to depth 32 (96 + 8). Key coordinates must be < 2^MaxDepth.
+template <int MaxDepth>
+struct KeyTraits {
+  static_assert(MaxDepth >= 1 && MaxDepth <= 32, "Key3 coordinates hold at most 32 levels");
+  static constexpr int kMaxDepth = MaxDepth;
+  static constexpr bool kNarrow = 3 * MaxDepth + 5 <= 64;
+  static constexpr int kDepthBits = kNarrow ? 5 : 8;
+  using Key = std::conditional_t<kNarrow, uint64_t, uint128>;
+  static constexpr Key kDepthMask = ((Key)1 << kDepthBits) - 1;
+
+  static bool fits(const Key3& k) {
+    return MaxDepth == 32 || ((k.x | k.y | k.z) >> (MaxDepth % 32)) == 0;
+  }
+  static Key code(const Key3& k) {
+    if constexpr (kNarrow) return morton_encode(k);
+    else return morton_encode_wide(k);
+  }
+  static Key make(const Key3& k, int d) { return code(k) << kDepthBits | (Key)(unsigned)d; }
+  static Key3 key3(Key key) {
+    if constexpr (kNarrow) return morton_decode(key >> kDepthBits);
+    else return morton_decode_wide(key >> kDepthBits);
+  }
+  static int depth(Key key) { return (int)(key & kDepthMask); }
+  static NDKey nd(Key key) { return NDKey{ key3(key), (uint16_t)depth(key) }; }
+
+  static Key parent(Key key) {
+    return (key >> (kDepthBits + 3)) << kDepthBits | (Key)(unsigned)(depth(key) - 1);
+  }
+  static int child_index(Key key) { return (int)((key >> kDepthBits) & 7); }
+  static Key child(Key key, int i) {
+    return ((key >> kDepthBits) << 3 | (Key)(unsigned)i) << kDepthBits | (Key)(unsigned)(depth(key) + 1);
+  }
+};
+
+} // namespace octoweave
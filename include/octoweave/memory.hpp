@@ -0,0 +1,111 @@
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <memory_resource>
+#include <new>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace octoweave { namespace mem {
+
+// Allocation accounting for the large pipeline containers. Each pool is the storage of one
+// stage: the containers below allocate through TrackingAllocator when the library is built
+// with OCTOWEAVE_TRACK_MEMORY (CMake option of the same name) and through std::allocator
+// otherwise, so untracked builds keep the plain standard container types.
+enum class Pool : int {
+  worker_maps,        // WorkerOut::Ptd (chunk build, session chunk exports)
+  depth_maps,         // per-depth probability maps (merge, roll-up, HierarchyBuilder)
+  rollup_buckets,     // child buckets of one roll-up step
+  hierarchy_nodes,    // Hierarchy::nodes (emission)
+  forest_aggregation, // per-quadrant leaf statistics (forest aggregation)
+  count
+};
+
+const char* pool_name(Pool p);
+
+namespace detail {
+struct Counter {
+  std::atomic<int64_t> current{0};
+  std::atomic<int64_t> peak{0};
+};
+extern Counter g_pools[(int)Pool::count];
+
+inline void on_alloc(Pool p, size_t bytes) {
+  Counter& c = g_pools[(int)p];
+  const int64_t now = c.current.fetch_add((int64_t)bytes, std::memory_order_relaxed) + (int64_t)bytes;
+  int64_t pk = c.peak.load(std::memory_order_relaxed);
+  while (now > pk && !c.peak.compare_exchange_weak(pk, now, std::memory_order_relaxed)) {}
+}
+inline void on_free(Pool p, size_t bytes) {
+  g_pools[(int)p].current.fetch_sub((int64_t)bytes, std::memory_order_relaxed);
+}
+} // namespace detail
+
+// Stateless allocator charging every allocation to pool P
+template <class T, Pool P>
+struct TrackingAllocator {
+  using value_type = T;
+  template <class U> struct rebind { using other = TrackingAllocator<U, P>; };
+  TrackingAllocator() noexcept = default;
+  template <class U> TrackingAllocator(const TrackingAllocator<U, P>&) noexcept {}
+  T* allocate(size_t n) {
+    T* ptr = std::allocator<T>().allocate(n);
+    detail::on_alloc(P, n * sizeof(T));
+    return ptr;
+  }
+  void deallocate(T* ptr, size_t n) noexcept {
+    detail::on_free(P, n * sizeof(T));
+    std::allocator<T>().deallocate(ptr, n);
+  }
+  template <class U> bool operator==(const TrackingAllocator<U, P>&) const noexcept { return true; }
+  template <class U> bool operator!=(const TrackingAllocator<U, P>&) const noexcept { return false; }
+};
+
+// Memory resource charging the blocks it obtains from `upstream` to pool `p`; placed under
+// arenas it accounts their chunks rather than each small allocation
+class TrackingResource : public std::pmr::memory_resource {
+public:
+  explicit TrackingResource(Pool p, std::pmr::memory_resource* upstream = nullptr) noexcept
+    : pool_(p), up_(upstream ? upstream : std::pmr::get_default_resource()) {}
+private:
+  void* do_allocate(size_t bytes, size_t align) override {
+    void* ptr = up_->allocate(bytes, align);
+    detail::on_alloc(pool_, bytes);
+    return ptr;
+  }
+  void do_deallocate(void* ptr, size_t bytes, size_t align) override {
+    detail::on_free(pool_, bytes);
+    up_->deallocate(ptr, bytes, align);
+  }
+  bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override { return this == &o; }
+  Pool pool_;
+  std::pmr::memory_resource* up_;
+};
+
+#if defined(OCTOWEAVE_TRACK_MEMORY) && OCTOWEAVE_TRACK_MEMORY
+constexpr bool tracking_enabled() { return true; }
+template <class T, Pool P> using Allocator = TrackingAllocator<T, P>;
+#else
+constexpr bool tracking_enabled() { return false; }
+template <class T, Pool P> using Allocator = std::allocator<T>;
+#endif
+
+template <class K, class V, class H, Pool P>
+using HashMap = std::unordered_map<K, V, H, std::equal_to<K>, Allocator<std::pair<const K, V>, P>>;
+
+struct PoolUsage {
+  const char* name;
+  int64_t current_bytes = 0;
+  int64_t peak_bytes = 0;    // high-water mark since the last reset_peaks()
+};
+
+// One entry per pool, in Pool order (all zero when tracking is compiled out)
+std::vector<PoolUsage> usage();
+// Restart every high-water mark at the pool's current size, e.g. before a budgeted call
+void reset_peaks();
+
+}} // namespace octoweave::mem
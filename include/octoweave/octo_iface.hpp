@@ -1,13 +1,104 @@
 #pragma once
 #include <vector>
+#include <cstddef>
 #include <cstdint>
+#include <cstring>
+#include <iosfwd>
 #include <memory>
+#include <type_traits>
 #include "hierarchy.hpp"
 
 namespace octoweave {
 
 struct Pt { double x, y, z; };
 
+// Non-owning view of points stored as x, y, z scalars (float or double) with a byte
+// stride between consecutive points, e.g. float32 x, y, z, intensity records, or as three
+// separate columns (columns()). An optional index array selects and orders a subset
+// without copying the points.
+struct PointSpan {
+  enum class Type { F32, F64 };
+  const void* data = nullptr;     // interleaved x, y, z, or the x column
+  const void* data_y = nullptr;   // y and z columns (null: interleaved)
+  const void* data_z = nullptr;
+  size_t count = 0;               // points addressable through data
+  size_t stride = 0;              // bytes between consecutive points
+  Type type = Type::F64;
+  const size_t* index = nullptr;  // optional: element i is point index[i]
+  size_t index_size = 0;
+
+  PointSpan() = default;
+  // stride_bytes 0 = packed (three scalars per point)
+  PointSpan(const double* xyz, size_t n, size_t stride_bytes = 0)
+    : data(xyz), count(n), stride(stride_bytes ? stride_bytes : 3 * sizeof(double)), type(Type::F64) {}
+  PointSpan(const float* xyz, size_t n, size_t stride_bytes = 0)
+    : data(xyz), count(n), stride(stride_bytes ? stride_bytes : 3 * sizeof(float)), type(Type::F32) {}
+  PointSpan(const std::vector<Pt>& pts)  // implicit: views the vector in place
+    : data(pts.data()), count(pts.size()), stride(sizeof(Pt)), type(Type::F64) {}
+
+  // Structure-of-arrays input (e.g. Arrow or Parquet columns); stride 0 = packed scalars
+  template <class T>
+  static PointSpan columns(const T* x, const T* y, const T* z, size_t n, size_t stride_bytes = 0) {
+    static_assert(std::is_same<T, float>::value || std::is_same<T, double>::value,
+                  "point columns are float or double");
+    PointSpan s(x, n, stride_bytes ? stride_bytes : sizeof(T));
+    s.data_y = y; s.data_z = z;
+    return s;
+  }
+
+  size_t size() const { return index ? index_size : count; }
+  Pt operator[](size_t i) const {
+    const size_t off = (index ? index[i] : i) * stride;
+    const char* b = static_cast<const char*>(data) + off;
+    if (data_y) {
+      const char* by = static_cast<const char*>(data_y) + off;
+      const char* bz = static_cast<const char*>(data_z) + off;
+      if (type == Type::F32) {
+        float v[3]; std::memcpy(&v[0], b, 4); std::memcpy(&v[1], by, 4); std::memcpy(&v[2], bz, 4);
+        return Pt{ v[0], v[1], v[2] };
+      }
+      double v[3]; std::memcpy(&v[0], b, 8); std::memcpy(&v[1], by, 8); std::memcpy(&v[2], bz, 8);
+      return Pt{ v[0], v[1], v[2] };
+    }
+    if (type == Type::F32) {
+      float v[3]; std::memcpy(v, b, sizeof(v));
+      return Pt{ v[0], v[1], v[2] };
+    }
+    double v[3]; std::memcpy(v, b, sizeof(v));
+    return Pt{ v[0], v[1], v[2] };
+  }
+  // The same storage restricted to `n` entries of `idx` (indices into the full storage)
+  PointSpan select(const size_t* idx, size_t n) const {
+    PointSpan s = *this; s.index = idx; s.index_size = n; return s;
+  }
+};
+
+// One scan of a trajectory: world-frame points and the sensor origin they were taken from
+struct Scan {
+  PointSpan points;
+  Pt origin{0.0, 0.0, 0.0};
+};
+
+// Piece of a sensor ray inside one chunk (route_rays): free space from `a` towards `b`, and
+// a hit at `b` when the ray ends there
+struct RaySegment {
+  Pt a, b;
+  uint32_t scan = 0;     // index of the scan the ray belongs to
+  bool terminal = false;
+};
+
+// Points reduced to one representative per voxel of edge `res` (grid aligned to the
+// coordinate origin): the centroid of the voxel's points, in order of first appearance, with
+// the number of points it stands for. Every input point lies within res * sqrt(3) of its
+// representative. Binning runs on up to `threads` threads (<= 0: all cores) over fixed
+// slices, so the result does not depend on the thread count.
+struct VoxelFiltered {
+  std::vector<Pt> points;
+  std::vector<uint32_t> weights;
+  size_t removed = 0; // input points minus representatives
+};
+VoxelFiltered voxel_filter(const PointSpan& pts, double res, int threads = 1);
+
 class IOctoTree {
 public:
   virtual ~IOctoTree() = default;
@@ -34,9 +125,50 @@ public:
     double emit_res = -1.0;
     // Safety cap on maximum depth used for emission to prevent huge trees
     int max_depth_cap = 8;
+    // Pre-insertion voxel filter (voxel_filter): points sharing a voxel of this edge collapse
+    // to one representative before insertion. <= 0: off.
+    double prefilter_res = -1.0;
+    bool prefilter_weighted = false; // representative counts one hit per merged point
+    int prefilter_threads = 1;       // binning threads (<= 0: all cores)
   };
-  // Build a per-chunk tree from points and export WorkerOut
-  static WorkerOut build_and_export(const std::vector<Pt>& pts, const Params& p);
+  // Build a per-chunk tree from points and export WorkerOut. Points are read through the
+  // span in place; a std::vector<Pt> converts implicitly.
+  static WorkerOut build_and_export(const PointSpan& pts, const Params& p);
+
+  // Depth of the keys that build_and_export emits for these params (WorkerOut::td)
+  static int emit_depth(const Params& p);
+  // Key of a world coordinate at `depth`, using the same discretization as build_and_export
+  static Key3 coord_to_key(const Pt& pt, const Params& p, int depth);
+};
+
+// Persistent occupancy state of one chunk for streaming ingestion: scans are inserted one
+// after another and the accumulated state exports like build_and_export over all of them.
+class ChunkState {
+public:
+  explicit ChunkState(const OctoChunker::Params& p);
+  ~ChunkState();
+  ChunkState(const ChunkState&) = delete;
+  ChunkState& operator=(const ChunkState&) = delete;
+
+  // Insert a scan with free-space updates from the sensor `origin`. Returns the number of
+  // points the pre-insertion filter removed (0 when Params::prefilter_res is off).
+  size_t insert(const PointSpan& pts, const Pt& origin);
+  // Carve routed ray pieces, grouped by scan in ascending order: per scan, the cells the
+  // pieces cross are updated as free and the ends of terminal pieces as occupied (occupied
+  // wins), as insert() does for whole rays
+  void insert_segments(const RaySegment* segs, size_t n);
+  WorkerOut export_worker() const;
+
+  // Approximate bytes held by the occupancy state
+  size_t memory_bytes() const;
+  // Compact binary form of the state (backend specific). load() replaces the state and
+  // returns false for a truncated or foreign stream, leaving the state empty.
+  bool save(std::ostream& os) const;
+  bool load(std::istream& is);
+
+private:
+  struct Impl;
+  std::unique_ptr<Impl> impl_;
 };
 
 // Build an in-memory stub tree from a WorkerOut for testing/integration.
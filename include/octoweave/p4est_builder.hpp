@@ -1,19 +1,47 @@
 #pragma once
 #include "hierarchy.hpp"
+#include "chunk_grid.hpp"
+#include "octo_iface.hpp"
 #include <functional>
 #include <vector>
 #include <cmath>
 #include <algorithm>
 #include <numeric>
+#include <memory>
 
 namespace octoweave {
 
 // Note: Named P4estBuilder for consistency with the p4est project packaging.
-// This implements a 3D octree mapping API (n^3 brick roots) with a stubbed
-// backend by default. Real integration, if enabled, should be guarded by
-// OCTOWEAVE_WITH_P4EST and include the appropriate headers from the p4est project
+// This implements a 3D octree mapping API (n^3 brick roots) with a built-in
+// linear-octree backend by default. Real integration, if enabled, is guarded by
+// OCTOWEAVE_WITH_P4EST and includes the appropriate headers from the p4est project
 // (using the p8est API for 3D under the hood).
 struct P4estBuilder {
+  // How global keys are assigned to the n^3 brick trees.
+  enum class TreeMapping {
+    Modulo, // tree = k % n, local = k / n (strided; the original contract)
+    Block   // each tree owns an aligned, contiguous block of the key space
+  };
+
+  // Key-space box covered by the brick under TreeMapping::Block.
+  struct BlockLayout {
+    Key3 origin{0,0,0};  // first key of tree (0,0,0), at `depth`
+    Key3 extent{0,0,0};  // keys per axis covered by the whole brick at `depth`; 0 = 2^depth
+    int depth = -1;      // depth of origin/extent; -1 = the depth of the key being split
+  };
+
+  // Mapping descriptor. Implicitly constructible from n for the modulo contract, so
+  // every API taking `const TreeMap&` also accepts a plain brick size.
+  struct TreeMap {
+    int n = 2;
+    TreeMapping mapping = TreeMapping::Modulo;
+    BlockLayout block;
+    TreeMap() = default;
+    TreeMap(int n_) : n(n_) {}
+    TreeMap(int n_, TreeMapping m) : n(n_), mapping(m) {}
+    TreeMap(int n_, TreeMapping m, const BlockLayout& b) : n(n_), mapping(m), block(b) {}
+  };
+
   struct Config {
     int n = 2; // brick n×n×n
     // Optional per-tree target level policy. If unset, defaults to (H.td - H.base_depth).
@@ -21,8 +49,39 @@ struct P4estBuilder {
     std::function<int(int /*tree_idx*/, const Hierarchy&)> level_policy;
     int min_level = 0;
     int max_level = 30;
+    // Key -> tree assignment used by the forest build and aggregation.
+    TreeMapping mapping = TreeMapping::Modulo;
+    BlockLayout block;
+    TreeMap tree_map() const { return TreeMap(n, mapping, block); }
+  };
+
+  // Per-tree evidence summary over leaves at the hierarchy's finest depth (H.td).
+  struct TreeStats {
+    size_t leaf_count = 0;
+    double prob_sum = 0.0;
+    double mean() const { return leaf_count ? prob_sum / (double)leaf_count : 0.0; }
   };
-  
+  // Compute TreeStats for all n^3 trees (flattened index x + n*(y + n*z)).
+  static std::vector<TreeStats> tree_stats(const Hierarchy& H, const TreeMap& tm);
+
+  // Bytes per quadrant assumed by byte budgets: p8est_quadrant_t (24) + one double of user data.
+  static constexpr size_t kQuadrantBytes = 32;
+
+  // Estimate the forest size (quadrants) for per-tree levels after 2:1 balance.
+  // Trees without leaves stay at their root quadrant (matching build_forest); for every
+  // face/edge/corner neighbor more than one level finer, the graded layers that balance
+  // would insert are added. The estimate is conservative (overlapping layers are not
+  // deduplicated) and capped at the uniform refinement one level below the finest neighbor.
+  static size_t estimate_balanced_quadrants(const std::vector<int>& levels,
+                                            const std::vector<TreeStats>& stats, int n);
+
+  // Greedy per-tree levels under a quadrant budget. All trees start at Lmin; a max-heap
+  // repeatedly raises the tree with the most occupancy evidence (prob_sum) per quadrant
+  // at its next level, accepting the raise only while the balanced estimate fits.
+  // If Lmin alone exceeds the budget, all trees stay at Lmin.
+  static std::vector<int> budget_levels(const std::vector<TreeStats>& stats, int n,
+                                        size_t max_quadrants, int Lmin, int Lmax);
+
   struct Policy {
     // Uniform level across all trees
     static inline std::function<int(int,const Hierarchy&)> uniform(int level) {
@@ -41,18 +100,12 @@ struct P4estBuilder {
 
     // Compute per-tree levels by linearly mapping leaf counts to [Lmin, Lmax]
     static inline std::function<int(int,const Hierarchy&)> by_leafcount_linear(
-        const Hierarchy& H, int n, int Lmin, int Lmax)
+        const Hierarchy& H, const TreeMap& tm, int Lmin, int Lmax)
     {
-      const size_t T = (size_t)n*n*n;
+      const auto stats = P4estBuilder::tree_stats(H, tm);
+      const size_t T = stats.size();
       std::vector<size_t> counts(T, 0);
-      for (const auto& kv : H.nodes) {
-        const NDKey& nd = kv.first; const NodeRec& rec = kv.second;
-        if (!rec.is_leaf || nd.d != (uint16_t)H.td) continue;
-        auto split = P4estBuilder::split_global_to_tree_local(nd.k, nd.d, n);
-        const Key3& t = split.first;
-        size_t idx = (size_t)t.x + (size_t)n * ((size_t)t.y + (size_t)n * (size_t)t.z);
-        if (idx < T) counts[idx] += 1;
-      }
+      for (size_t i=0;i<T;++i) counts[i] = stats[i].leaf_count;
       size_t cmin = SIZE_MAX, cmax = 0;
       for (auto c : counts) { cmin = std::min(cmin, c); cmax = std::max(cmax, c); }
       std::vector<int> levels(T, Lmin);
@@ -70,40 +123,25 @@ struct P4estBuilder {
 
     // Compute per-tree levels by mean probability threshold
     static inline std::function<int(int,const Hierarchy&)> by_mean_prob_threshold(
-        const Hierarchy& H, int n, double threshold, int Llow, int Lhigh)
+        const Hierarchy& H, const TreeMap& tm, double threshold, int Llow, int Lhigh)
     {
-      const size_t T = (size_t)n*n*n;
-      std::vector<double> sum(T, 0.0); std::vector<size_t> cnt(T, 0);
-      for (const auto& kv : H.nodes) {
-        const NDKey& nd = kv.first; const NodeRec& rec = kv.second;
-        if (!rec.is_leaf || nd.d != (uint16_t)H.td) continue;
-        auto split = P4estBuilder::split_global_to_tree_local(nd.k, nd.d, n);
-        const Key3& t = split.first;
-        size_t idx = (size_t)t.x + (size_t)n * ((size_t)t.y + (size_t)n * (size_t)t.z);
-        if (idx < T) { sum[idx] += rec.p; cnt[idx] += 1; }
-      }
+      const auto stats = P4estBuilder::tree_stats(H, tm);
+      const size_t T = stats.size();
       std::vector<int> levels(T, Llow);
       for (size_t i=0;i<T;++i) {
-        double mean = cnt[i] ? (sum[i] / (double)cnt[i]) : 0.0;
-        levels[i] = (mean >= threshold) ? Lhigh : Llow;
+        levels[i] = (stats[i].mean() >= threshold) ? Lhigh : Llow;
       }
       return from_levels(std::move(levels));
     }
 
     // Quantile-based mapping by leaf count: levels for [<=q_lo, between, >=q_hi]
     static inline std::function<int(int,const Hierarchy&)> by_leafcount_quantiles(
-        const Hierarchy& H, int n, double q_lo, double q_hi, int Llow, int Lmid, int Lhigh)
+        const Hierarchy& H, const TreeMap& tm, double q_lo, double q_hi, int Llow, int Lmid, int Lhigh)
     {
-      const size_t T = (size_t)n*n*n;
+      const auto stats = P4estBuilder::tree_stats(H, tm);
+      const size_t T = stats.size();
       std::vector<size_t> counts(T, 0);
-      for (const auto& kv : H.nodes) {
-        const NDKey& nd = kv.first; const NodeRec& rec = kv.second;
-        if (!rec.is_leaf || nd.d != (uint16_t)H.td) continue;
-        auto split = P4estBuilder::split_global_to_tree_local(nd.k, nd.d, n);
-        const Key3& t = split.first;
-        size_t idx = (size_t)t.x + (size_t)n * ((size_t)t.y + (size_t)n * (size_t)t.z);
-        if (idx < T) counts[idx] += 1;
-      }
+      for (size_t i=0;i<T;++i) counts[i] = stats[i].leaf_count;
       // Build sorted list and compute quantiles
       std::vector<size_t> sorted = counts;
       std::sort(sorted.begin(), sorted.end());
@@ -128,25 +166,17 @@ struct P4estBuilder {
 
     // Multi-threshold bands by count: thresholds ascending, levels.size()==thresholds.size()+1
     static inline std::function<int(int,const Hierarchy&)> bands_by_count(
-        const Hierarchy& H, int n, const std::vector<size_t>& thresholds, const std::vector<int>& levels)
+        const Hierarchy& H, const TreeMap& tm, const std::vector<size_t>& thresholds, const std::vector<int>& levels)
     {
-      const size_t T = (size_t)n*n*n;
       if (levels.size() != thresholds.size() + 1) {
         // Fallback: uniform zero
         return uniform(0);
       }
-      std::vector<size_t> counts(T, 0);
-      for (const auto& kv : H.nodes) {
-        const NDKey& nd = kv.first; const NodeRec& rec = kv.second;
-        if (!rec.is_leaf || nd.d != (uint16_t)H.td) continue;
-        auto split = P4estBuilder::split_global_to_tree_local(nd.k, nd.d, n);
-        const Key3& t = split.first;
-        size_t idx = (size_t)t.x + (size_t)n * ((size_t)t.y + (size_t)n * (size_t)t.z);
-        if (idx < T) counts[idx] += 1;
-      }
+      const auto stats = P4estBuilder::tree_stats(H, tm);
+      const size_t T = stats.size();
       std::vector<int> out(T, levels.back());
       for (size_t i=0;i<T;++i) {
-        size_t c = counts[i];
+        size_t c = stats[i].leaf_count;
         size_t b = 0;
         while (b < thresholds.size() && c > thresholds[b]) ++b;
         if (b >= levels.size()) b = levels.size()-1;
@@ -157,24 +187,16 @@ struct P4estBuilder {
 
     // Multi-threshold bands by mean probability (double thresholds ascending)
     static inline std::function<int(int,const Hierarchy&)> bands_by_mean_prob(
-        const Hierarchy& H, int n, const std::vector<double>& thresholds, const std::vector<int>& levels)
+        const Hierarchy& H, const TreeMap& tm, const std::vector<double>& thresholds, const std::vector<int>& levels)
     {
-      const size_t T = (size_t)n*n*n;
       if (levels.size() != thresholds.size() + 1) {
         return uniform(0);
       }
-      std::vector<double> sum(T, 0.0); std::vector<size_t> cnt(T, 0);
-      for (const auto& kv : H.nodes) {
-        const NDKey& nd = kv.first; const NodeRec& rec = kv.second;
-        if (!rec.is_leaf || nd.d != (uint16_t)H.td) continue;
-        auto split = P4estBuilder::split_global_to_tree_local(nd.k, nd.d, n);
-        const Key3& t = split.first;
-        size_t idx = (size_t)t.x + (size_t)n * ((size_t)t.y + (size_t)n * (size_t)t.z);
-        if (idx < T) { sum[idx] += rec.p; cnt[idx] += 1; }
-      }
+      const auto stats = P4estBuilder::tree_stats(H, tm);
+      const size_t T = stats.size();
       std::vector<int> out(T, levels.back());
       for (size_t i=0;i<T;++i) {
-        double m = cnt[i] ? (sum[i] / (double)cnt[i]) : 0.0;
+        double m = stats[i].mean();
         size_t b = 0;
         while (b < thresholds.size() && m > thresholds[b]) ++b;
         if (b >= levels.size()) b = levels.size()-1;
@@ -182,26 +204,107 @@ struct P4estBuilder {
       }
       return from_levels(std::move(out));
     }
+
+    // Maximize resolution where evidence is highest under a total quadrant budget
+    static inline std::function<int(int,const Hierarchy&)> by_quadrant_budget(
+        const Hierarchy& H, const TreeMap& tm, size_t max_quadrants, int Lmin, int Lmax)
+    {
+      return from_levels(P4estBuilder::budget_levels(P4estBuilder::tree_stats(H, tm), tm.n,
+                                                     max_quadrants, Lmin, Lmax));
+    }
+
+    // Same as by_quadrant_budget with the budget given in bytes of forest storage
+    static inline std::function<int(int,const Hierarchy&)> by_byte_budget(
+        const Hierarchy& H, const TreeMap& tm, size_t max_bytes, int Lmin, int Lmax,
+        size_t bytes_per_quadrant = kQuadrantBytes)
+    {
+      size_t per = bytes_per_quadrant ? bytes_per_quadrant : 1;
+      return by_quadrant_budget(H, tm, max_bytes / per, Lmin, Lmax);
+    }
   };
-  // Stub: map hierarchy to per-tree "want sets" structure (no external dep yet)
+  // Print a summary of the hierarchy that the forest build will map onto trees
   static void prepare_want_sets(const Hierarchy& H, const Config& cfg);
 
-  // Build a (stubbed or real) forest from the hierarchy and config. Returns 0 on success.
+  // Build a forest from the hierarchy and config and release it. Returns 0 on success.
   static int build_forest(const Hierarchy& H, const Config& cfg);
 
-  // Opaque forest handle for later phases (owns forest resources when real).
+  // One forest quadrant: flattened tree index, integer position at its own level inside
+  // the tree (0..2^level-1 per axis), and its data (mean leaf probability, leaf count).
+  struct QuadrantView {
+    int tree;
+    Key3 coord;
+    int level;
+    double mean;
+    uint32_t leaves;
+  };
+
+  // Opaque forest handle for later phases (owns forest resources). Backed by p4est when
+  // OCTOWEAVE_WITH_P4EST is set, otherwise by the built-in linear-octree forest.
   struct ForestHandle {
     ~ForestHandle();
-    void* impl = nullptr; // internal impl; nullptr in stub builds
+    void* impl = nullptr; // backend forest
+    // Quadrants stored on this process (local part of a distributed forest)
+    size_t num_quadrants() const;
+    // Visit local quadrants tree by tree in Morton order
+    void for_each_quadrant(const std::function<void(const QuadrantView&)>& fn) const;
+    // State of the last build/adapt per flattened tree index, used to find changed trees
+    int n = 0;
+    std::vector<int> levels;
+    std::vector<TreeStats> stats;
   };
-  // Create a forest handle (real under flag, opaque/stub otherwise).
+  // Refine trees with content to their policy levels, 2:1 balance (faces, edges, corners)
+  // and attach per-quadrant data.
   static ForestHandle* build_forest_handle(const Hierarchy& H, const Config& cfg);
 
+  // Per-tree target levels: cfg.level_policy clamped to [min_level, max_level], or
+  // (H.td - H.base_depth) when no policy is set.
+  static std::vector<int> resolve_levels(const Hierarchy& H, const Config& cfg);
+  // The same for one flattened tree index.
+  static int resolve_level(const Hierarchy& H, const Config& cfg, int tree);
+
+  // Trees (ascending) whose target level or TreeStats differ from the handle's recorded
+  // state, plus every index in `dirty`. All trees when the handle has no matching state.
+  static std::vector<int> changed_trees(const ForestHandle& fh, const std::vector<int>& levels,
+                                        const std::vector<TreeStats>& stats,
+                                        const std::vector<int>& dirty = {});
+
+  // Re-adapt an existing forest in place instead of rebuilding it. Changed trees (see
+  // changed_trees; pass `dirty` for edits that keep a tree's stats) and their 26 neighbors
+  // are coarsened/refined to their new levels, the forest is re-balanced, and quadrant
+  // data is recomputed only in those trees and in trees that balance touched. `touched`
+  // receives the refreshed trees. Returns 0 on success, 1 on a null handle or a brick
+  // size different from the one the handle was built with.
+  static int adapt_forest(ForestHandle* fh, const Hierarchy& H, const Config& cfg,
+                          const std::vector<int>& dirty = {},
+                          std::vector<int>* touched = nullptr);
+  // adapt_forest for callers that track tree changes themselves (Session): `stats` are the
+  // current TreeStats of H for all n^3 trees, and target levels are re-resolved only for
+  // the trees in `dirty` while the others keep the handle's levels, so neither step walks
+  // H. A policy whose result for one tree depends on others needs adapt_forest instead.
+  // Returns 1 also when `stats` or the handle's levels do not cover n^3 trees.
+  static int adapt_forest_trees(ForestHandle* fh, const Hierarchy& H, const Config& cfg,
+                                std::vector<TreeStats> stats, const std::vector<int>& dirty,
+                                std::vector<int>* touched = nullptr);
+
   // Utility: split a global node key at depth d into (tree_idx, local_key)
   // Contract (stub): brick partitioning by modulo along each axis
   // - tree_idx = (k.x % n, k.y % n, k.z % n)
   // - local_key = (k.x / n, k.y / n, k.z / n)
   static std::pair<Key3, Key3> split_global_to_tree_local(const Key3& k, int d, int n);
+
+  // Mapping-aware split. Under TreeMapping::Block, with the layout box rescaled to depth d
+  // as [o, o+E) per axis: tree = floor((k - o) * n / E) (clamped to the brick) and
+  // local = (k - o) - floor(tree * E / n), i.e. the offset inside the tree's block.
+  static std::pair<Key3, Key3> split_global_to_tree_local(const Key3& k, int d, const TreeMap& tm);
+
+  // Depth at which tree-local keys of depth-d nodes address a tree's root cube.
+  // Modulo keeps the original contract (d); Block uses ceil(log2(block cells per axis)).
+  static int tree_local_depth(int d, const TreeMap& tm);
+
+  // Block layout whose trees coincide with the chunks of `grid` (requires n == grid.n()).
+  // Keys are expressed at the emission depth that OctoChunker uses for `p`; chunk edges
+  // line up with tree edges when chunk sizes are multiples of the emission resolution.
+  static BlockLayout block_layout(const ChunkGrid& grid, const OctoChunker::Params& p);
 };
 
 } // namespace octoweave
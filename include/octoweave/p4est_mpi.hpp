@@ -0,0 +1,50 @@
+#pragma once
+#include "p4est_builder.hpp"
+#include <functional>
+#include <vector>
+
+#ifdef OCTOWEAVE_WITH_MPI
+#include <mpi.h>
+
+namespace octoweave {
+
+// MPI mode for P4estBuilder. Each rank builds only the chunks whose trees it owns, rolls
+// them into a rank-local hierarchy slice, and all ranks assemble one distributed p8est on
+// `comm`; the global Hierarchy is never gathered. Requires cfg.mapping == Block with one
+// tree per ChunkGrid chunk (chunk index == flattened tree index), e.g. from
+// P4estBuilder::block_layout(grid, params).
+struct MpiBuildOptions {
+  // Hierarchy parameters for the rank-local slices (see make_hierarchy_from_workers)
+  double tau = 0.5;
+  bool use_logodds = false;
+  double p_unknown = 0.5;
+  int base_depth = 1;
+  // Optional per-chunk cost hints (size n^3, e.g. point counts) used to partition the
+  // root trees before building; empty means an even split by tree count.
+  std::vector<double> chunk_weights;
+  // Optional global policy over the allreduced TreeStats. When unset, cfg.level_policy is
+  // evaluated per owned tree against the rank-local slice only.
+  std::function<std::vector<int>(const std::vector<P4estBuilder::TreeStats>&)> levels_from_stats;
+  // Threads per rank for the local chunk builds (0 = hardware concurrency)
+  int threads = 0;
+};
+
+struct MpiBuildStats {
+  size_t local_chunks = 0;     // chunks built on this rank
+  size_t local_leaves = 0;     // leaves at td in this rank's slice
+  size_t global_quadrants = 0; // forest size after balance and final partition
+  double seconds_build = 0.0;  // chunk builds + slice rollup on this rank
+  double seconds_forest = 0.0; // levels, refine, balance, quadrant data, partition
+};
+
+// Collective over `comm`. The returned handle owns this rank's part of the forest;
+// quadrant data is the mean leaf probability, and the final p8est_partition weighs each
+// quadrant by 1 + the number of hierarchy leaves aggregated into it.
+P4estBuilder::ForestHandle* build_forest_handle_mpi(
+    const std::function<WorkerOut(int /*chunk_idx*/)>& build_chunk,
+    const P4estBuilder::Config& cfg, const MpiBuildOptions& opt, MPI_Comm comm,
+    MpiBuildStats* stats = nullptr);
+
+} // namespace octoweave
+
+#endif // OCTOWEAVE_WITH_MPI
@@ -1,14 +1,78 @@
 #pragma once
 #include <vector>
 #include <functional>
+#include "chunk_grid.hpp"
 #include "hierarchy.hpp"
+#include "octo_iface.hpp"
 
 namespace octoweave {
 
+// Run fn(i) for every i in [0, n) on up to max_threads threads (<= 0: all cores), handing
+// out indices dynamically.
+void parallel_for_index(int n, const std::function<void(int)>& fn, int max_threads = 0);
+
 // Run a per-chunk builder in parallel and return results in chunk-index order.
 std::vector<WorkerOut> parallel_build_workers(int num_chunks,
                                               const std::function<WorkerOut(int)>& build,
                                               int max_threads = 0);
 
+// Binned layout: only the chunks that received entries, ascending, chunks[j] owning entries
+// [begin[j], begin[j+1]). Its size and the binning cost follow the input rather than the n³
+// grid, for streaming into large grids.
+struct ChunkBins {
+  std::vector<int> chunks;
+  std::vector<size_t> begin; // chunks.size() + 1 offsets
+};
+
+// Counting sort of points into the grid's chunks: `perm` receives storage indices grouped
+// by chunk (input order kept within a chunk).
+void bin_points(const ChunkGrid& grid, const PointSpan& pts,
+                std::vector<size_t>& perm, ChunkBins& bins);
+
+// Counting sort of many scans' points into the grid's chunks: each chunk's entries of `idx`
+// (storage indices) and `scan_of` (owning scan) are grouped by scan in ascending order and
+// in input order within a scan. Scans are classified in parallel.
+void bin_scans(const ChunkGrid& grid, const std::vector<Scan>& scans,
+               std::vector<size_t>& idx, std::vector<uint32_t>& scan_of,
+               ChunkBins& bins, int max_threads = 0);
+
+// Insert the `n` binned entries of one chunk (from bin_scans) into its state: one insertion
+// per scan, in scan order, from that scan's origin
+void insert_binned_scans(ChunkState& state, const std::vector<Scan>& scans,
+                         const size_t* idx, const uint32_t* scan_of, size_t n);
+
+// Bin points into the grid's chunks (an index permutation, no point copies) and build the
+// non-empty chunks in parallel. Results are in ascending chunk order; `chunk_ids`, when
+// given, receives the linear chunk index of each result.
+std::vector<WorkerOut> build_chunked_workers(const ChunkGrid& grid, const PointSpan& pts,
+                                             const OctoChunker::Params& p,
+                                             int max_threads = 0,
+                                             std::vector<int>* chunk_ids = nullptr);
+
+// Fuse many scans into per-chunk workers in one call. Scans are binned into chunks in
+// parallel; each chunk then inserts, in scan order and from each scan's own origin, only the
+// points of the scans that reached it, so results do not depend on the thread count.
+// Chunks are built in parallel; results are in ascending chunk order as for
+// build_chunked_workers (Params::origin is not used).
+std::vector<WorkerOut> build_chunked_scans(const ChunkGrid& grid, const std::vector<Scan>& scans,
+                                           const OctoChunker::Params& p,
+                                           int max_threads = 0,
+                                           std::vector<int>* chunk_ids = nullptr);
+
+// Clip every ray (scan origin -> point, cut at `max_range` when > 0) against the grid and
+// split it into the pieces inside each chunk it crosses. Pieces before the point's own
+// chunk are pass-through; the piece in the chunk the point bins to (ChunkGrid::which) ends at
+// the point and is terminal, unless the ray was cut short. Each chunk's pieces in `segs` are
+// grouped by scan in ascending order. Scans are routed in parallel.
+void route_rays(const ChunkGrid& grid, const std::vector<Scan>& scans, double max_range,
+                std::vector<RaySegment>& segs, ChunkBins& bins, int max_threads = 0);
+
+// build_chunked_scans with free space carved across chunk borders: rays are routed to every
+// chunk they cross (route_rays) and each chunk carves its pieces, chunks in parallel
+std::vector<WorkerOut> build_routed_scans(const ChunkGrid& grid, const std::vector<Scan>& scans,
+                                          const OctoChunker::Params& p,
+                                          int max_threads = 0,
+                                          std::vector<int>* chunk_ids = nullptr);
+
 } // namespace octoweave
 
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "hierarchy.hpp"
+
+namespace octoweave {
+
+// Borrowed structure-of-arrays leaves, e.g. numpy columns handed over the C API. `d` may
+// be null when every leaf is at the requested depth; the depth filter is then skipped.
+struct LeafColumns {
+  const uint32_t* x = nullptr;
+  const uint32_t* y = nullptr;
+  const uint32_t* z = nullptr;
+  const int32_t* d = nullptr;
+  const double* p = nullptr;
+  size_t size = 0;
+};
+
+// Immutable spatial index over hierarchy leaves for raster queries and columnar export.
+// All leaves live in one set of contiguous columns ordered by depth, then (z, y, x), so a
+// depth or z-slice is one range found by binary search. All const members are safe to
+// call concurrently.
+class LeafIndex {
+public:
+  // Structure-of-arrays view of consecutive leaves at one depth
+  struct Span {
+    const uint32_t* x = nullptr;
+    const uint32_t* y = nullptr;
+    const uint32_t* z = nullptr;
+    const double* p = nullptr;
+    size_t size = 0;
+  };
+
+  LeafIndex() = default;
+  explicit LeafIndex(const Hierarchy& H);
+
+  size_t size() const { return p_.size(); }
+  // Depths that hold leaves, ascending
+  std::vector<int> depths() const;
+  // One past the largest leaf coordinate per axis at depth d ({0,0,0} if none)
+  Key3 extent(int d) const;
+  Span depth_span(int d) const;
+  Span slice_span(int d, uint32_t z) const;
+
+  // All leaves as columns (with depths), valid for the lifetime of the index
+  LeafColumns columns() const;
+
+private:
+  std::vector<uint32_t> x_, y_, z_;
+  std::vector<int32_t> d_;
+  std::vector<double> p_;
+  std::vector<size_t> begin_;   // begin_[d] .. begin_[d+1]: leaves at depth d
+  std::vector<Key3> extent_;    // per depth
+};
+
+enum class Projection { Max, Mean, Sum };
+enum class Axis { X, Y, Z };
+
+// Rasters are row-major (index y*width + x) with caller-owned storage of width*height
+// doubles. Leaves outside the raster are skipped; cells without leaves get `background`.
+// Each call returns the number of leaves drawn.
+
+// Probabilities of leaves at depth d in the z-slice `z`.
+size_t render_slice(const LeafIndex& idx, int d, uint32_t z,
+                    double* out, int width, int height, double background = 0.0);
+
+// Projection along z of leaves at depth d: maximum, mean over the leaves present in each
+// (x, y) column, or sum.
+size_t render_projection(const LeafIndex& idx, int d, Projection mode,
+                         double* out, int width, int height, double background = 0.0);
+
+// Kernels over LeafColumns split the leaves across `threads` workers (<= 0: all cores)
+// with private accumulators merged at the end; sums may differ in the last bits between
+// thread counts.
+// The raster plane of a projection along `axis` is spanned by the two remaining axes in
+// x, y, z order: column index from the first, row index from the second.
+
+// Leaves at depth `d` whose `axis` coordinate lies in [lo, hi], projected along `axis`.
+// Mean averages over the leaves present in each cell.
+size_t project_columns(const LeafColumns& c, int d, Axis axis, uint32_t lo, uint32_t hi,
+                       Projection mode, double* out, int width, int height,
+                       double background = 0.0, int threads = 0);
+
+// Slice at `coord` along `axis`; the maximum wins if the columns repeat a key.
+size_t slice_columns(const LeafColumns& c, int d, Axis axis, uint32_t coord,
+                     double* out, int width, int height,
+                     double background = 0.0, int threads = 0);
+
+// Probability histograms per depth: `out` holds (max_depth + 1) rows of `bins` counts and
+// is overwritten. Bins split [lo, hi] evenly, the last one closed; probabilities outside
+// and depths above max_depth are skipped. With null `d` all leaves land in row 0.
+// Returns the number of leaves counted.
+size_t depth_histogram(const LeafColumns& c, int max_depth, int bins, double lo, double hi,
+                       uint64_t* out, int threads = 0);
+
+} // namespace octoweave
@@ -0,0 +1,79 @@
+#pragma once
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "chunk_grid.hpp"
+#include "hierarchy.hpp"
+#include "octo_iface.hpp"
+#include "p4est_builder.hpp"
+
+namespace octoweave {
+
+// Streaming ingestion: persistent per-chunk occupancy state fed scan by scan. A scan only
+// updates the chunks its points fall into; the hierarchy is merged from those chunks on
+// demand and re-derived only around the keys they changed, so per-scan cost follows the
+// scan rather than the map. Not thread-safe; calls must be serialized by the caller.
+class Session {
+public:
+  struct Options {
+    AABB box{0, 1, 0, 1, 0, 1}; // chunk grid extent; points outside go to border chunks
+    int n = 1;                  // n×n×n chunks
+    OctoChunker::Params params;
+    double tau = 0.5;
+    double p_unknown = 0.5;
+    int base_depth = 1;
+    int threads = 0;            // chunk updates in parallel (<= 0: all cores)
+    std::pmr::memory_resource* scratch = nullptr; // hierarchy refresh temporaries (null: default)
+    bool route_rays = false;    // carve free space in every chunk a ray crosses (route_rays)
+  };
+
+  explicit Session(const Options& opt);
+  ~Session();
+
+  // Insert one scan taken from sensor position `origin`. Returns the number of chunks
+  // the scan touched.
+  size_t insert(const PointSpan& pts, const Pt& origin);
+  // Insert a batch of scans, each from its own origin, in one pass: the same result as
+  // inserting them one by one in order, with one binning pass and one parallel round over
+  // the touched chunks. Returns the number of chunks touched.
+  size_t insert(const std::vector<Scan>& scans);
+
+  // Hierarchy over all scans so far. Chunks touched since the last call are exported and
+  // merged; the reference stays valid for the session's lifetime.
+  const Hierarchy& hierarchy();
+
+  // Forest over hierarchy(): built on first use (or when cfg.n changes) and afterwards
+  // re-adapted in place (adapt_forest_trees) for trees whose nodes changed. Tree stats are
+  // kept current from the refreshed leaves and cfg.level_policy is re-evaluated only for
+  // those trees, so a different policy, level bounds or mapping takes effect after
+  // reset_forest(). Owned by the session.
+  P4estBuilder::ForestHandle* forest(const P4estBuilder::Config& cfg);
+  // Drop the forest; the next forest() builds it from scratch.
+  void reset_forest();
+
+  size_t scans() const { return scans_; }
+  // Chunks that have received points
+  size_t active_chunks() const;
+
+private:
+  struct Chunk {
+    std::unique_ptr<ChunkState> state;
+    WorkerOut exported; // last merged export
+    bool dirty = false;
+  };
+  // Chunks that received points; the returned pointers stay valid while chunks are added
+  std::vector<Chunk*> touch(const std::vector<int>& ids);
+
+  Options opt_;
+  ChunkGrid grid_;
+  std::unordered_map<int, Chunk> chunks_; // by linear chunk index, created on first touch
+  std::vector<int> dirty_;                // chunks updated since the last merge
+  std::unordered_map<Key3, uint32_t, Key3Hash> owners_; // chunks exporting each td key
+  HierarchyBuilder builder_;
+  std::vector<NDKey> forest_pending_; // hierarchy nodes changed since the last forest()
+  std::vector<HierarchyBuilder::LeafDelta> forest_deltas_; // depth-td leaf changes among them
+  std::unique_ptr<P4estBuilder::ForestHandle> forest_;
+  size_t scans_ = 0;
+};
+
+} // namespace octoweave
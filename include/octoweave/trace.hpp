@@ -0,0 +1,70 @@
+#pragma once
+#include "octoweave/memory.hpp"
+#include <atomic>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace octoweave { namespace trace {
+
+// Low-overhead stage instrumentation. Disabled by default; while disabled a Scope or count()
+// costs one relaxed atomic load. When enabled, spans and counters go to per-thread buffers
+// (no cross-thread contention) and can be summarized or exported as Chrome trace JSON
+// (chrome://tracing, Perfetto) at any time. Names must be string literals (stored by pointer).
+
+namespace detail {
+extern std::atomic<bool> g_enabled;
+// Steady clock in ns, always > 0; record() takes spans on this clock
+uint64_t clock_ns();
+void record(const char* name, int64_t arg, uint64_t t0, uint64_t t1);
+void add_count(const char* name, int64_t delta);
+}
+
+inline bool enabled() { return detail::g_enabled.load(std::memory_order_relaxed); }
+void set_enabled(bool on);
+// Nanoseconds since the trace epoch (process start or last reset), always > 0
+uint64_t now_ns();
+
+// Timed span from construction to destruction. `arg` (>= 0) refines the stage, e.g. the
+// depth of a roll-up step, and is reported as "name/arg".
+class Scope {
+public:
+  explicit Scope(const char* name, int64_t arg = -1) noexcept
+    : name_(name), arg_(arg), t0_(enabled() ? detail::clock_ns() : 0) {}
+  ~Scope() { if (t0_) detail::record(name_, arg_, t0_, detail::clock_ns()); }
+  Scope(const Scope&) = delete;
+  Scope& operator=(const Scope&) = delete;
+private:
+  const char* name_;
+  int64_t arg_;
+  uint64_t t0_;
+};
+
+// Add to a named counter (e.g. points binned, nodes emitted)
+inline void count(const char* name, int64_t delta) {
+  if (enabled()) detail::add_count(name, delta);
+}
+
+struct StageSummary {
+  std::string name;   // "name" or "name/arg"
+  uint64_t calls = 0;
+  double total_ms = 0.0;  // summed over threads
+  double max_ms = 0.0;
+};
+
+struct Summary {
+  std::vector<StageSummary> stages;                    // by first occurrence
+  std::vector<std::pair<std::string, int64_t>> counters;
+  size_t threads = 0;                                  // threads that recorded anything
+  // Bytes per container pool (mem::usage()); empty unless built with OCTOWEAVE_TRACK_MEMORY
+  std::vector<mem::PoolUsage> memory;
+};
+
+Summary summary();
+std::string chrome_trace_json();
+bool write_chrome_trace(const std::string& path);
+// Drop recorded spans and counters, restart the epoch and the memory high-water marks
+void reset();
+
+}} // namespace octoweave::trace
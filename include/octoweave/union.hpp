@@ -2,6 +2,7 @@
 #include <array>
 #include <cmath>
 #include <algorithm>
+#include <cstdint>
 
 namespace octoweave {
 
@@ -11,4 +12,34 @@ inline double inv_logit(double l){ return 1.0/(1.0 + std::exp(-l)); }
 // Numerically-stable 8-way union: P = 1 - Π_i (1 - p_i)
 double union_prob8_stable(const std::array<double,8>& p8, double p_unknown=0.5);
 
+// 16-bit fixed-point log-odds: code q stands for logit(p) = q * kLogOdds16Step, covering
+// |logit| < 32 in steps of 1/1024. The saturated codes are exact: kLogOdds16Min is p = 0
+// (an absent child) and kLogOdds16Max is p = 1. Rounding to the nearest code moves a
+// probability by at most p(1-p) * kLogOdds16Step / 2 <= 1.23e-4.
+constexpr double kLogOdds16Step = 1.0 / 1024;
+constexpr int16_t kLogOdds16Min = -32767;
+constexpr int16_t kLogOdds16Max = 32767;
+
+inline int16_t logodds16_from_logit(double l) {
+  const double q = std::nearbyint(l / kLogOdds16Step);
+  return (int16_t)std::clamp(q, (double)kLogOdds16Min + 1, (double)kLogOdds16Max - 1);
+}
+// NaN maps to p_unknown
+inline int16_t logodds16_from_prob(double p, double p_unknown=0.5) {
+  if (!(p == p)) p = p_unknown;
+  if (p <= 0.0) return kLogOdds16Min;
+  if (p >= 1.0) return kLogOdds16Max;
+  return logodds16_from_logit(logit(p));
+}
+inline double prob_from_logodds16(int16_t q) {
+  if (q <= kLogOdds16Min) return 0.0;
+  if (q >= kLogOdds16Max) return 1.0;
+  return inv_logit(q * kLogOdds16Step);
+}
+
+// Unions on codes, summed in the log-complement domain: -log(1 - p_i) = softplus(l_i)
+// comes from a table, so each union costs one expm1 and one log whatever its arity
+int16_t union_logodds16(int16_t a, int16_t b);
+int16_t union_logodds16(const std::array<int16_t,8>& q8);
+
 } // namespace octoweave
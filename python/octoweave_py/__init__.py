@@ -1,10 +1,21 @@
 from ._ctypes import (
     OctoWeave,
     ChunkParams,
+    Session,
+    trace_enable,
+    trace_enabled,
+    trace_reset,
+    trace_summary,
+    trace_write_chrome,
 )
 
 __all__ = [
     "OctoWeave",
     "ChunkParams",
+    "Session",
+    "trace_enable",
+    "trace_enabled",
+    "trace_reset",
+    "trace_summary",
+    "trace_write_chrome",
 ]
-
@@ -58,18 +58,156 @@ class _ChunkParams(C.Structure):
 
 _L.ow_build_hierarchy_from_points.argtypes = [C.POINTER(C.c_double), C.c_size_t, C.POINTER(_ChunkParams), C.c_double, C.c_double, C.c_int]
 _L.ow_build_hierarchy_from_points.restype = ow_hierarchy_t
+_L.ow_build_hierarchy_chunked.argtypes = [C.POINTER(C.c_double), C.c_size_t, C.POINTER(_ChunkParams), C.POINTER(C.c_double), C.c_int, C.c_int, C.c_double, C.c_double, C.c_int]
+_L.ow_build_hierarchy_chunked.restype = ow_hierarchy_t
+
+
+class _Points(C.Structure):
+    _fields_ = [
+        ("data", C.c_void_p),
+        ("count", C.c_size_t),
+        ("stride", C.c_size_t),
+        ("type", C.c_int),
+    ]
+
+
+_L.ow_build_hierarchy_from_span.argtypes = [C.POINTER(_Points), C.POINTER(_ChunkParams), C.c_double, C.c_double, C.c_int]
+_L.ow_build_hierarchy_from_span.restype = ow_hierarchy_t
+_L.ow_build_hierarchy_chunked_span.argtypes = [C.POINTER(_Points), C.POINTER(_ChunkParams), C.POINTER(C.c_double), C.c_int, C.c_int, C.c_double, C.c_double, C.c_int]
+_L.ow_build_hierarchy_chunked_span.restype = ow_hierarchy_t
 _L.ow_hierarchy_write_csv.argtypes = [ow_hierarchy_t, C.c_char_p]
 _L.ow_hierarchy_write_csv.restype = C.c_int
 _L.ow_hierarchy_free.argtypes = [ow_hierarchy_t]
 _L.ow_build_forest_uniform.argtypes = [ow_hierarchy_t, C.c_int, C.c_int]
 _L.ow_build_forest_uniform.restype = ow_forest_t
+_L.ow_forest_adapt_levels.argtypes = [ow_forest_t, ow_hierarchy_t, C.POINTER(C.c_int), C.c_size_t]
+_L.ow_forest_adapt_levels.restype = C.c_int
+_L.ow_forest_num_quadrants.argtypes = [ow_forest_t]
+_L.ow_forest_num_quadrants.restype = C.c_size_t
 _L.ow_forest_free.argtypes = [ow_forest_t]
+_L.ow_hierarchy_set_tree_mapping.argtypes = [ow_hierarchy_t, C.c_int, C.POINTER(C.c_uint), C.POINTER(C.c_uint), C.c_int]
+_L.ow_hierarchy_set_tree_mapping.restype = C.c_int
 _L.ow_levels_by_leafcount_quantiles.argtypes = [ow_hierarchy_t, C.c_int, C.c_double, C.c_double, C.c_int, C.c_int, C.c_int, C.POINTER(C.c_int), C.c_size_t]
 _L.ow_levels_by_leafcount_quantiles.restype = C.c_int
 _L.ow_levels_bands_by_mean_prob.argtypes = [ow_hierarchy_t, C.c_int, C.POINTER(C.c_double), C.c_size_t, C.POINTER(C.c_int), C.c_size_t, C.POINTER(C.c_int), C.c_size_t]
 _L.ow_levels_bands_by_mean_prob.restype = C.c_int
 _L.ow_viz_slice.argtypes = [C.c_char_p, C.c_int, C.c_int, C.c_char_p, C.c_char_p]
 _L.ow_viz_slice.restype = C.c_int
+_L.ow_hierarchy_leaf_extent.argtypes = [ow_hierarchy_t, C.c_int, C.POINTER(C.c_uint)]
+_L.ow_hierarchy_leaf_extent.restype = C.c_int
+_L.ow_render_slice.argtypes = [ow_hierarchy_t, C.c_int, C.c_uint, C.POINTER(C.c_double), C.c_int, C.c_int, C.c_double]
+_L.ow_render_slice.restype = C.c_long
+_L.ow_render_projection.argtypes = [ow_hierarchy_t, C.c_int, C.c_int, C.POINTER(C.c_double), C.c_int, C.c_int, C.c_double]
+_L.ow_render_projection.restype = C.c_long
+
+
+class _LeafColumns(C.Structure):
+    _fields_ = [
+        ("x", C.POINTER(C.c_uint)),
+        ("y", C.POINTER(C.c_uint)),
+        ("z", C.POINTER(C.c_uint)),
+        ("d", C.POINTER(C.c_int)),
+        ("p", C.POINTER(C.c_double)),
+        ("n", C.c_size_t),
+    ]
+
+
+_L.ow_raster_project.argtypes = [C.POINTER(_LeafColumns), C.c_int, C.c_int, C.c_uint, C.c_uint, C.c_int, C.POINTER(C.c_double), C.c_int, C.c_int, C.c_double, C.c_int]
+_L.ow_raster_project.restype = C.c_long
+_L.ow_raster_slice.argtypes = [C.POINTER(_LeafColumns), C.c_int, C.c_int, C.c_uint, C.POINTER(C.c_double), C.c_int, C.c_int, C.c_double, C.c_int]
+_L.ow_raster_slice.restype = C.c_long
+_L.ow_depth_histogram.argtypes = [C.POINTER(_LeafColumns), C.c_int, C.c_int, C.c_double, C.c_double, C.POINTER(C.c_ulonglong), C.c_int]
+_L.ow_depth_histogram.restype = C.c_long
+
+_L.ow_hierarchy_num_leaves.argtypes = [ow_hierarchy_t]
+_L.ow_hierarchy_num_leaves.restype = C.c_size_t
+_L.ow_hierarchy_copy_leaves.argtypes = [ow_hierarchy_t, C.POINTER(C.c_uint), C.POINTER(C.c_uint), C.POINTER(C.c_uint), C.POINTER(C.c_int), C.POINTER(C.c_double), C.c_size_t]
+_L.ow_hierarchy_copy_leaves.restype = C.c_long
+_L.ow_hierarchy_leaf_columns.argtypes = [ow_hierarchy_t, C.POINTER(_LeafColumns)]
+_L.ow_hierarchy_leaf_columns.restype = C.c_int
+_L.ow_hierarchy_leaf_columns_retain.argtypes = [ow_hierarchy_t, C.POINTER(_LeafColumns)]
+_L.ow_hierarchy_leaf_columns_retain.restype = C.c_void_p
+_L.ow_leaf_columns_release.argtypes = [C.c_void_p]
+_L.ow_leaf_columns_release.restype = None
+
+
+# Native reference keeping retained leaf columns alive; the base of zero-copy numpy views
+class _ColumnsRef:
+    def __init__(self, h, cols):
+        self._ref = _L.ow_hierarchy_leaf_columns_retain(h, C.byref(cols))
+        if not self._ref:
+            raise RuntimeError("ow_hierarchy_leaf_columns_retain failed")
+
+    def __del__(self):
+        if self._ref:
+            _L.ow_leaf_columns_release(self._ref)
+            self._ref = None
+
+ow_session_t = C.c_void_p
+_L.ow_session_create.argtypes = [C.POINTER(_ChunkParams), C.POINTER(C.c_double), C.c_int, C.c_int, C.c_double, C.c_double, C.c_int]
+_L.ow_session_create.restype = ow_session_t
+_L.ow_session_insert.argtypes = [ow_session_t, C.POINTER(_Points), C.POINTER(C.c_double)]
+_L.ow_session_insert.restype = C.c_long
+_L.ow_session_hierarchy.argtypes = [ow_session_t]
+_L.ow_session_hierarchy.restype = ow_hierarchy_t
+_L.ow_session_forest.argtypes = [ow_session_t, C.c_int, C.c_int]
+_L.ow_session_forest.restype = ow_forest_t
+_L.ow_session_free.argtypes = [ow_session_t]
+
+_L.ow_session_insert_arrow.argtypes = [ow_session_t, C.c_void_p, C.c_void_p, C.POINTER(C.c_char_p), C.POINTER(C.c_double)]
+_L.ow_session_insert_arrow.restype = C.c_long
+_L.ow_session_insert_arrow_stream.argtypes = [ow_session_t, C.c_void_p, C.POINTER(C.c_char_p), C.POINTER(C.c_double)]
+_L.ow_session_insert_arrow_stream.restype = C.c_long
+_L.ow_build_hierarchy_from_arrow_stream.argtypes = [C.c_void_p, C.POINTER(C.c_char_p), C.POINTER(_ChunkParams), C.POINTER(C.c_double), C.c_int, C.c_int, C.c_double, C.c_double, C.c_int]
+_L.ow_build_hierarchy_from_arrow_stream.restype = ow_hierarchy_t
+
+
+class _TraceStage(C.Structure):
+    _fields_ = [("name", C.c_char_p), ("calls", C.c_ulonglong),
+                ("total_ms", C.c_double), ("max_ms", C.c_double)]
+
+
+class _TraceCounter(C.Structure):
+    _fields_ = [("name", C.c_char_p), ("value", C.c_longlong)]
+
+
+class _TraceMemory(C.Structure):
+    _fields_ = [("name", C.c_char_p), ("current_bytes", C.c_longlong), ("peak_bytes", C.c_longlong)]
+
+
+_L.ow_trace_enable.argtypes = [C.c_int]
+_L.ow_trace_enabled.restype = C.c_int
+_L.ow_trace_stages.argtypes = [C.POINTER(_TraceStage), C.c_size_t]
+_L.ow_trace_stages.restype = C.c_size_t
+_L.ow_trace_counters.argtypes = [C.POINTER(_TraceCounter), C.c_size_t]
+_L.ow_trace_counters.restype = C.c_size_t
+_L.ow_trace_memory.argtypes = [C.POINTER(_TraceMemory), C.c_size_t]
+_L.ow_trace_memory.restype = C.c_size_t
+_L.ow_trace_write_chrome.argtypes = [C.c_char_p]
+_L.ow_trace_write_chrome.restype = C.c_int
+
+_capsule_pointer = C.pythonapi.PyCapsule_GetPointer
+_capsule_pointer.restype = C.c_void_p
+_capsule_pointer.argtypes = [C.py_object, C.c_char_p]
+
+
+# Arrow PyCapsule protocol (pyarrow, polars, ...): returns (capsules to keep alive, pointers).
+# Streams are moved into the C side, which releases them.
+def _arrow_stream(data):
+    if not hasattr(data, "__arrow_c_stream__"):
+        raise TypeError("expected an object implementing __arrow_c_stream__ (e.g. pyarrow Table or RecordBatchReader)")
+    cap = data.__arrow_c_stream__()
+    return cap, _capsule_pointer(cap, b"arrow_array_stream")
+
+
+def _arrow_columns(columns):
+    if len(columns) != 3:
+        raise ValueError("columns must name x, y and z")
+    return (C.c_char_p * 3)(*[str(c).encode("utf-8") for c in columns])
+
+
+_AXES = {"x": 0, "y": 1, "z": 2}
+_PROJECTIONS = {"max": 0, "mean": 1, "sum": 2}
 
 
 @dataclass
@@ -106,27 +244,87 @@ class OctoWeave:
     def __init__(self):
         self._h = None
         self._f = None
+        self._owner = None  # native session behind a Session.hierarchy() view
 
-    def build_hierarchy_from_points(self, xyz: Iterable[tuple[float, float, float]], params: ChunkParams = ChunkParams(), tau: float = 0.5, p_unknown: float = 0.5, base_depth: int = 1):
-        # Accept list/iterable of tuples or a numpy (k,3) array
+    # Points as an ow_points_t plus the object that owns the storage. numpy float32/float64
+    # arrays of shape (k, >=3) (x, y, z first, e.g. with intensity) and record arrays with
+    # x, y, z fields of one float type are read in place; other input is converted.
+    @staticmethod
+    def _points(xyz):
         if _np is not None and isinstance(xyz, _np.ndarray):
-            a = _np.asarray(xyz, dtype=_np.float64)
-            if a.ndim != 2 or a.shape[1] != 3:
-                raise ValueError("numpy array must be shape (k,3)")
-            arr = a.ravel()
-            ptr = arr.ctypes.data_as(C.POINTER(C.c_double))
-            count = a.shape[0]
-        else:
-            buf = []
-            for (x, y, z) in xyz:
-                buf.extend([float(x), float(y), float(z)])
-            arr = (C.c_double * len(buf))(*buf)
-            ptr = arr
-            count = len(buf) // 3
+            a = xyz
+            if a.dtype.names and a.ndim == 1 and all(k in a.dtype.names for k in "xyz"):
+                f = [a.dtype.fields[k] for k in "xyz"]
+                t, off = f[0][0], f[0][1]
+                if (t in (_np.float32, _np.float64) and all(g[0] == t for g in f)
+                        and [g[1] for g in f] == [off, off + t.itemsize, off + 2 * t.itemsize]):
+                    typ = 1 if t == _np.float32 else 0
+                    return a, _Points(a.ctypes.data + off, a.shape[0], a.strides[0], typ)
+                a = _np.stack([a["x"], a["y"], a["z"]], axis=1)
+            if a.ndim != 2 or a.shape[1] < 3:
+                raise ValueError("numpy array must be shape (k,3), or (k,>3) with x,y,z first")
+            if a.dtype not in (_np.float32, _np.float64) or a.strides[1] != a.itemsize or a.strides[0] <= 0:
+                a = _np.ascontiguousarray(a[:, :3], dtype=_np.float64)
+            typ = 1 if a.dtype == _np.float32 else 0
+            return a, _Points(a.ctypes.data, a.shape[0], a.strides[0], typ)
+        buf = []
+        for (x, y, z) in xyz:
+            buf.extend([float(x), float(y), float(z)])
+        arr = (C.c_double * len(buf))(*buf)
+        return arr, _Points(C.addressof(arr), len(buf) // 3, 0, 0)
+
+    def build_hierarchy_from_points(self, xyz: Iterable[tuple[float, float, float]], params: ChunkParams = ChunkParams(), tau: float = 0.5, p_unknown: float = 0.5, base_depth: int = 1):
+        keep, pts = self._points(xyz)
+        cp = params.to_c()
+        h = _L.ow_build_hierarchy_from_span(C.byref(pts), C.byref(cp), C.c_double(tau), C.c_double(p_unknown), C.c_int(base_depth))
+        if not h:
+            raise RuntimeError("ow_build_hierarchy_from_span failed")
+        self._h = h
+        return self
+
+    # Chunked parallel build: points binned into an n×n×n grid over `box`
+    # (xmin, xmax, ymin, ymax, zmin, zmax; None = point bounds), chunks built on
+    # `threads` threads (0 = all cores) and merged.
+    def build_hierarchy_chunked(self, xyz, params: ChunkParams = ChunkParams(), n: int = 2, threads: int = 0,
+                                box=None, tau: float = 0.5, p_unknown: float = 0.5, base_depth: int = 1):
+        keep, pts = self._points(xyz)
+        if box is None:
+            if pts.count == 0:
+                box = (0.0, 1.0, 0.0, 1.0, 0.0, 1.0)
+            else:
+                if _np is not None and isinstance(keep, _np.ndarray):
+                    cols = [keep[k] for k in "xyz"] if keep.dtype.names else [keep[:, i] for i in range(3)]
+                    lohi = [(float(c.min()), float(c.max())) for c in cols]
+                else:
+                    lohi = [(min(keep[i::3]), max(keep[i::3])) for i in range(3)]
+                box = []
+                for lo, hi in lohi:
+                    box.extend([lo, hi if hi > lo else lo + max(params.res, 1e-9)])
+        b = (C.c_double * 6)(*[float(v) for v in box])
+        cp = params.to_c()
+        h = _L.ow_build_hierarchy_chunked_span(C.byref(pts), C.byref(cp), b, int(n), int(threads),
+                                               C.c_double(tau), C.c_double(p_unknown), C.c_int(base_depth))
+        if not h:
+            raise RuntimeError("ow_build_hierarchy_chunked_span failed")
+        self._h = h
+        return self
+
+    # Arrow input (any object with __arrow_c_stream__: pyarrow Table/RecordBatchReader, ...):
+    # float32/float64 x, y, z columns are read in place batch by batch, each batch inserted
+    # as a scan from params.origin. box is required when n > 1.
+    def build_hierarchy_from_arrow(self, data, params: ChunkParams = ChunkParams(), n: int = 1, box=None,
+                                   threads: int = 0, columns=("x", "y", "z"),
+                                   tau: float = 0.5, p_unknown: float = 0.5, base_depth: int = 1):
+        if box is None and n != 1:
+            raise ValueError("box is required when n > 1")
+        cap, stream = _arrow_stream(data)
+        b = (C.c_double * 6)(*[float(v) for v in box]) if box is not None else None
         cp = params.to_c()
-        h = _L.ow_build_hierarchy_from_points(ptr, count, C.byref(cp), C.c_double(tau), C.c_double(p_unknown), C.c_int(base_depth))
+        h = _L.ow_build_hierarchy_from_arrow_stream(stream, _arrow_columns(columns), C.byref(cp), b,
+                                                    int(n), int(threads), C.c_double(tau),
+                                                    C.c_double(p_unknown), C.c_int(base_depth))
         if not h:
-            raise RuntimeError("ow_build_hierarchy_from_points failed")
+            raise RuntimeError("ow_build_hierarchy_from_arrow_stream failed (columns missing, not float, or with nulls?)")
         self._h = h
         return self
 
@@ -145,6 +343,22 @@ class OctoWeave:
         self._f = f
         return self
 
+    def forest_num_quadrants(self) -> int:
+        if not self._f:
+            raise RuntimeError("Forest not built")
+        return int(_L.ow_forest_num_quadrants(self._f))
+
+    # Re-adapt the current forest in place to per-tree levels (length n^3); returns the
+    # number of trees whose quadrants were refreshed.
+    def adapt_forest_levels(self, levels):
+        if not self._h or not self._f:
+            raise RuntimeError("Forest not built")
+        lv = (C.c_int * len(levels))(*[int(x) for x in levels])
+        rc = _L.ow_forest_adapt_levels(self._f, self._h, lv, C.c_size_t(len(levels)))
+        if rc < 0:
+            raise RuntimeError(f"ow_forest_adapt_levels failed rc={rc}")
+        return int(rc)
+
     def close(self):
         if self._f:
             _L.ow_forest_free(self._f)
@@ -152,6 +366,7 @@ class OctoWeave:
         if self._h:
             _L.ow_hierarchy_free(self._h)
             self._h = None
+        self._owner = None
 
     def __del__(self):
         try:
@@ -159,6 +374,21 @@ class OctoWeave:
         except Exception:
             pass
 
+    # Select how keys map to trees for forests and level computations ("modulo" or "block").
+    # For "block", origin/extent are key triplets at `depth` (None = full key range / leaf depth).
+    def set_tree_mapping(self, mapping: str = "modulo", origin=None, extent=None, depth: int = -1):
+        if not self._h:
+            raise RuntimeError("Hierarchy not built")
+        modes = {"modulo": 0, "block": 1}
+        if mapping not in modes:
+            raise ValueError("mapping must be 'modulo' or 'block'")
+        o = (C.c_uint * 3)(*[int(v) for v in origin]) if origin is not None else None
+        e = (C.c_uint * 3)(*[int(v) for v in extent]) if extent is not None else None
+        rc = _L.ow_hierarchy_set_tree_mapping(self._h, modes[mapping], o, e, int(depth))
+        if rc != 0:
+            raise RuntimeError(f"ow_hierarchy_set_tree_mapping failed rc={rc}")
+        return self
+
     # Compute levels on C++ side using quantiles; returns list of length n^3
     def compute_levels_by_leafcount_quantiles(self, n: int, q_lo: float, q_hi: float, Llow: int, Lmid: int, Lhigh: int):
         if not self._h:
@@ -183,7 +413,98 @@ class OctoWeave:
             raise RuntimeError(f"ow_levels_bands_by_mean_prob failed rc={rc}")
         return [out[i] for i in range(T)]
 
-    # Full pipeline helper: points -> hierarchy -> forest (uniform from policy) -> CSV -> viz
+    # One past the largest leaf key per axis at `depth` (-1 = deepest)
+    def leaf_extent(self, depth: int = -1):
+        if not self._h:
+            raise RuntimeError("Hierarchy not built")
+        out = (C.c_uint * 3)()
+        if _L.ow_hierarchy_leaf_extent(self._h, int(depth), out) != 0:
+            raise RuntimeError("ow_hierarchy_leaf_extent failed")
+        return (out[0], out[1], out[2])
+
+    # Raster of shape (height, width): numpy array when available, else list of rows.
+    # Without width/height the leaf extent at `depth` is used; depth -1 = deepest.
+    def _render(self, fn, depth: int, arg: int, width, height, background: float):
+        if not self._h:
+            raise RuntimeError("Hierarchy not built")
+        if width is None or height is None:
+            ext = self.leaf_extent(depth)
+            width = ext[0] if width is None else width
+            height = ext[1] if height is None else height
+        width, height = max(1, int(width)), max(1, int(height))
+        if _np is not None:
+            img = _np.empty((height, width), dtype=_np.float64)
+            ptr = img.ctypes.data_as(C.POINTER(C.c_double))
+        else:
+            img = (C.c_double * (width * height))()
+            ptr = img
+        rc = fn(self._h, int(depth), arg, ptr, width, height, float(background))
+        if rc < 0:
+            raise RuntimeError(f"render failed rc={rc}")
+        if _np is not None:
+            return img
+        return [[img[y * width + x] for x in range(width)] for y in range(height)]
+
+    def render_slice(self, depth: int, z: int, width=None, height=None, background: float = 0.0):
+        return self._render(_L.ow_render_slice, depth, int(z), width, height, background)
+
+    # mode: "max", "mean" or "sum" (projection along z)
+    def render_projection(self, depth: int, mode: str = "max", width=None, height=None, background: float = 0.0):
+        if mode not in _PROJECTIONS:
+            raise ValueError("mode must be 'max', 'mean' or 'sum'")
+        return self._render(_L.ow_render_projection, depth, _PROJECTIONS[mode], width, height, background)
+
+    def num_leaves(self) -> int:
+        if not self._h:
+            raise RuntimeError("Hierarchy not built")
+        return int(_L.ow_hierarchy_num_leaves(self._h))
+
+    # Leaf columns {"x","y","z","depth","prob"} ordered by depth, then (z, y, x). With numpy
+    # and copy=False these are read-only views of the native storage, which they keep alive
+    # past close() and later session updates. Otherwise copies (lists without numpy).
+    def leaf_columns(self, copy: bool = False) -> dict:
+        if not self._h:
+            raise RuntimeError("Hierarchy not built")
+        if _np is None or copy:
+            n = self.num_leaves()
+            bufs = [(C.c_uint * n)(), (C.c_uint * n)(), (C.c_uint * n)(), (C.c_int * n)(), (C.c_double * n)()]
+            if _L.ow_hierarchy_copy_leaves(self._h, *bufs, C.c_size_t(n)) != n:
+                raise RuntimeError("ow_hierarchy_copy_leaves failed")
+            if _np is None:
+                cols = [list(b) for b in bufs]
+            else:
+                cols = [_np.frombuffer(b, dtype=dt) for b, dt in
+                        zip(bufs, (_np.uint32, _np.uint32, _np.uint32, _np.int32, _np.float64))]
+            return dict(zip(("x", "y", "z", "depth", "prob"), cols))
+        c = _LeafColumns()
+        ref = _ColumnsRef(self._h, c)
+
+        def view(ptr, ct, dt):
+            if c.n == 0:
+                return _np.zeros(0, dtype=dt)
+            buf = (ct * c.n).from_address(C.addressof(ptr.contents))
+            buf._owner = ref
+            a = _np.frombuffer(buf, dtype=dt)
+            a.flags.writeable = False
+            return a
+        return {
+            "x": view(c.x, C.c_uint, _np.uint32),
+            "y": view(c.y, C.c_uint, _np.uint32),
+            "z": view(c.z, C.c_uint, _np.uint32),
+            "depth": view(c.d, C.c_int, _np.int32),
+            "prob": view(c.p, C.c_double, _np.float64),
+        }
+
+    # Leaves as a pandas DataFrame with the CSV column names (x, y, z, depth, prob)
+    def leaves_dataframe(self, copy: bool = False):
+        try:
+            import pandas as _pd  # type: ignore
+        except Exception as e:
+            raise ImportError("pandas is required for leaves_dataframe") from e
+        return _pd.DataFrame(self.leaf_columns(copy=copy), copy=False)
+
+    # Full pipeline helper: points -> hierarchy -> forest (uniform from policy) -> CSV -> viz.
+    # xyz=None runs on the hierarchy already built (e.g. from Parquet/Arrow).
     def run_pipeline(self,
                      xyz: Iterable[tuple[float, float, float]],
                      params: ChunkParams,
@@ -195,7 +516,10 @@ class OctoWeave:
                      out_svg: str = None,
                      policy: str = "uniform",
                      policy_args = None):
-        self.build_hierarchy_from_points(xyz, params)
+        if xyz is not None:
+            self.build_hierarchy_from_points(xyz, params)
+        elif not self._h:
+            raise RuntimeError("Hierarchy not built")
         # Compute a derived uniform level from policy helpers for deterministic tests
         lvl = None
         if policy == "uniform":
@@ -232,18 +556,261 @@ class OctoWeave:
             "uniform_level": lvl,
         }
 
-    # Load a parquet file and build a hierarchy; requires pandas with pyarrow/fastparquet
-    def build_hierarchy_from_parquet(self, parquet_path: str, params: ChunkParams = ChunkParams(), columns=("x","y","z"), **kwargs):
+    # Load a parquet file and build a hierarchy. The file is one scan from params.origin, as
+    # with the pandas fallback. With pyarrow and a `batch_size`, record batches of that many
+    # rows stream through build_hierarchy_from_arrow instead and each batch is inserted as
+    # its own scan (bounded memory, but free-space updates then depend on the batching).
+    # Non-float columns are cast; box for n > 1 defaults to the row-group statistics.
+    def build_hierarchy_from_parquet(self, parquet_path: str, params: ChunkParams = ChunkParams(), columns=("x","y","z"),
+                                     n: int = 1, box=None, threads: int = 0, batch_size=None, **kwargs):
         try:
-            import pandas as _pd  # type: ignore
-        except Exception as e:
-            raise ImportError("pandas is required to load parquet") from e
-        df = _pd.read_parquet(parquet_path, **kwargs)
-        a = df[list(columns)].to_numpy(dtype=float, copy=False)
-        return self.build_hierarchy_from_points(a, params)
+            import pyarrow as _pa  # type: ignore
+            import pyarrow.parquet as _pq  # type: ignore
+        except Exception:
+            _pa = None
+        if _pa is None or kwargs:
+            try:
+                import pandas as _pd  # type: ignore
+            except Exception as e:
+                raise ImportError("pyarrow or pandas is required to load parquet") from e
+            df = _pd.read_parquet(parquet_path, **kwargs)
+            a = df[list(columns)].to_numpy(dtype=float, copy=False)
+            if n == 1:
+                return self.build_hierarchy_from_points(a, params)
+            return self.build_hierarchy_chunked(a, params, n=n, threads=threads, box=box)
+        pf = _pq.ParquetFile(parquet_path)
+        cols = list(columns)
+        if box is None and n != 1:
+            box = _parquet_bounds(pf, cols)
+        fields = [pf.schema_arrow.field(c) for c in cols]
+        floats = (_pa.float32(), _pa.float64())
+        same = all(f.type == fields[0].type for f in fields) and fields[0].type in floats
+        schema = _pa.schema([_pa.field(c, fields[0].type if same else _pa.float64()) for c in cols])
+
+        def cast(rb):
+            if same:
+                return rb
+            return _pa.RecordBatch.from_arrays([rb.column(c).cast(_pa.float64()) for c in cols], schema=schema)
+        if batch_size is None:
+            batches = [cast(rb) for rb in pf.read(columns=cols).combine_chunks().to_batches()]
+        else:
+            batches = (cast(rb) for rb in pf.iter_batches(batch_size=int(batch_size), columns=cols))
+        reader = _pa.RecordBatchReader.from_batches(schema, batches)
+        return self.build_hierarchy_from_arrow(reader, params, n=n, box=box, threads=threads, columns=columns)
 
     # Simple CSV -> PGM/SVG renderer
     def render_csv(self, csv_path: str, slice_z: int, depth: int = -1, out_pgm: str = "slice.pgm", out_svg: str = "") -> int:
         if depth < 0:
             depth = -1
         return int(_L.ow_viz_slice(csv_path.encode("utf-8"), int(slice_z), int(depth), out_pgm.encode("utf-8"), (out_svg or "").encode("utf-8")))
+
+
+# Box (xmin, xmax, ymin, ymax, zmin, zmax) over `cols` from Parquet row-group statistics;
+# a flat axis is widened slightly
+def _parquet_bounds(pf, cols):
+    md = pf.metadata
+    names = [md.schema.column(i).path for i in range(md.num_columns)]
+    box = []
+    for c in cols:
+        j = names.index(c)
+        lo, hi = None, None
+        for g in range(md.num_row_groups):
+            st = md.row_group(g).column(j).statistics
+            if st is None or not st.has_min_max:
+                raise ValueError(f"no min/max statistics for column '{c}'; pass box=")
+            lo = st.min if lo is None else min(lo, st.min)
+            hi = st.max if hi is None else max(hi, st.max)
+        if lo is None:
+            lo, hi = 0.0, 1.0
+        box.extend([float(lo), float(hi) if hi > lo else float(lo) + 1e-9])
+    return box
+
+
+# Native session shared by a Session and the hierarchy views it hands out
+class _SessionRef:
+    def __init__(self, s):
+        self._s = s
+
+    def __del__(self):
+        if self._s:
+            _L.ow_session_free(self._s)
+            self._s = None
+
+
+# Streaming ingestion: scans are inserted one at a time into persistent per-chunk state over
+# an n×n×n grid on `box` (xmin, xmax, ymin, ymax, zmin, zmax); only the chunks a scan touches
+# are updated, and the hierarchy/forest are refreshed incrementally on demand.
+class Session:
+    def __init__(self, box, params: ChunkParams = ChunkParams(), n: int = 2, threads: int = 0,
+                 tau: float = 0.5, p_unknown: float = 0.5, base_depth: int = 1):
+        b = (C.c_double * 6)(*[float(v) for v in box])
+        cp = params.to_c()
+        self._s = _L.ow_session_create(C.byref(cp), b, int(n), int(threads), C.c_double(tau),
+                                       C.c_double(p_unknown), C.c_int(base_depth))
+        if not self._s:
+            raise RuntimeError("ow_session_create failed")
+        self._ref = _SessionRef(self._s)
+
+    # Insert one scan (same point input as OctoWeave builds) taken from sensor position
+    # `origin`; returns the number of chunks touched.
+    def insert(self, xyz, origin=(0.0, 0.0, 0.0)) -> int:
+        if not self._s:
+            raise RuntimeError("Session closed")
+        keep, pts = OctoWeave._points(xyz)
+        o = (C.c_double * 3)(*[float(v) for v in origin])
+        rc = _L.ow_session_insert(self._s, C.byref(pts), o)
+        if rc < 0:
+            raise RuntimeError(f"ow_session_insert failed rc={rc}")
+        return int(rc)
+
+    # Current hierarchy as an OctoWeave view of the session: it keeps the native session
+    # alive past close() (its handle reflects the scans inserted so far), and leaf column
+    # views taken from it stay valid across later inserts.
+    def hierarchy(self) -> OctoWeave:
+        if not self._s:
+            raise RuntimeError("Session closed")
+        ow = OctoWeave()
+        ow._h = _L.ow_session_hierarchy(self._s)
+        ow._owner = self._ref
+        return ow
+
+    # Insert Arrow data read in place: a stream (__arrow_c_stream__) inserts each batch as a
+    # scan, a single record batch (__arrow_c_array__) as one scan. Returns chunks touched for
+    # a batch, or batches inserted for a stream.
+    def insert_arrow(self, data, origin=(0.0, 0.0, 0.0), columns=("x", "y", "z")) -> int:
+        if not self._s:
+            raise RuntimeError("Session closed")
+        o = (C.c_double * 3)(*[float(v) for v in origin])
+        names = _arrow_columns(columns)
+        if hasattr(data, "__arrow_c_stream__"):
+            cap, stream = _arrow_stream(data)
+            rc = _L.ow_session_insert_arrow_stream(self._s, stream, names, o)
+        elif hasattr(data, "__arrow_c_array__"):
+            caps = data.__arrow_c_array__()
+            rc = _L.ow_session_insert_arrow(self._s, _capsule_pointer(caps[0], b"arrow_schema"),
+                                            _capsule_pointer(caps[1], b"arrow_array"), names, o)
+        else:
+            raise TypeError("expected an Arrow stream or record batch")
+        if rc < 0:
+            raise RuntimeError(f"Arrow insert failed rc={rc} (columns missing, not float, or with nulls?)")
+        return int(rc)
+
+    # Session forest re-adapted in place after inserts (level < 0: default level policy)
+    def forest_num_quadrants(self, n: int, level: int = -1) -> int:
+        if not self._s:
+            raise RuntimeError("Session closed")
+        f = _L.ow_session_forest(self._s, int(n), int(level))
+        if not f:
+            raise RuntimeError("ow_session_forest failed")
+        return int(_L.ow_forest_num_quadrants(f))
+
+    # Releases this object's reference; the native session is freed with the last view
+    def close(self):
+        self._s = None
+        self._ref = None
+
+    def __del__(self):
+        try:
+            self.close()
+        except Exception:
+            pass
+
+
+# Native raster kernels over numpy leaf columns (x, y, z keys, depth, prob). Columns are
+# converted to contiguous 32-bit/float64 arrays only when needed; the kernels write into
+# numpy-owned output buffers. depth None skips the depth filter. threads <= 0: all cores.
+def _columns(x, y, z, depth_col, prob):
+    if _np is None:
+        raise ImportError("numpy is required for the raster kernels")
+    keep = []
+
+    def arr(a, dt, ct):
+        if a is None:
+            return None
+        a = _np.ascontiguousarray(a, dtype=dt)
+        keep.append(a)
+        return a.ctypes.data_as(C.POINTER(ct))
+    p = _np.ascontiguousarray(prob, dtype=_np.float64)
+    keep.append(p)
+    n = len(p)
+    cols = _LeafColumns(arr(x, _np.uint32, C.c_uint), arr(y, _np.uint32, C.c_uint),
+                        arr(z, _np.uint32, C.c_uint), arr(depth_col, _np.int32, C.c_int),
+                        p.ctypes.data_as(C.POINTER(C.c_double)), n)
+    return cols, keep
+
+
+# Projection along `axis` of leaves with lo <= axis coordinate <= hi; returns an array of
+# shape (height, width) indexed by the remaining axes in x, y, z order (row = second)
+def raster_project(x, y, z, depth_col, prob, width: int, height: int, axis: str = "z",
+                   lo: int = 0, hi: int = 0xFFFFFFFF, mode: str = "max", depth=None,
+                   background: float = 0.0, threads: int = 0):
+    if axis not in _AXES or mode not in _PROJECTIONS:
+        raise ValueError("axis must be x/y/z and mode max/mean/sum")
+    cols, _keep = _columns(x, y, z, depth_col if depth is not None else None, prob)
+    img = _np.empty((max(1, int(height)), max(1, int(width))), dtype=_np.float64)
+    rc = _L.ow_raster_project(C.byref(cols), -1 if depth is None else int(depth), _AXES[axis],
+                              int(lo), int(hi), _PROJECTIONS[mode],
+                              img.ctypes.data_as(C.POINTER(C.c_double)), img.shape[1], img.shape[0],
+                              float(background), int(threads))
+    if rc < 0:
+        raise RuntimeError(f"ow_raster_project failed rc={rc}")
+    return img
+
+
+def raster_slice(x, y, z, depth_col, prob, width: int, height: int, coord: int, axis: str = "z",
+                 depth=None, background: float = 0.0, threads: int = 0):
+    return raster_project(x, y, z, depth_col, prob, width, height, axis, coord, coord, "max",
+                          depth, background, threads)
+
+
+# Probability histograms per depth: uint64 array of shape (max_depth + 1, bins)
+def depth_histogram(depth_col, prob, bins: int = 10, lo: float = 0.0, hi: float = 1.0,
+                    max_depth=None, threads: int = 0):
+    cols, _keep = _columns(None, None, None, depth_col, prob)
+    if max_depth is None:
+        max_depth = int(_np.max(depth_col)) if depth_col is not None and len(prob) else 0
+    out = _np.zeros((int(max_depth) + 1, int(bins)), dtype=_np.uint64)
+    rc = _L.ow_depth_histogram(C.byref(cols), int(max_depth), int(bins), float(lo), float(hi),
+                               out.ctypes.data_as(C.POINTER(C.c_ulonglong)), int(threads))
+    if rc < 0:
+        raise RuntimeError(f"ow_depth_histogram failed rc={rc}")
+    return out
+
+
+# Stage tracing: off by default; spans and counters are recorded by library calls made
+# while enabled and accumulate until trace_reset()
+def trace_enable(on: bool = True) -> None:
+    _L.ow_trace_enable(1 if on else 0)
+
+
+def trace_enabled() -> bool:
+    return bool(_L.ow_trace_enabled())
+
+
+def trace_reset() -> None:
+    _L.ow_trace_reset()
+
+
+# {"stages": {name: {"calls", "total_ms", "max_ms"}}, "counters": {name: value},
+#  "memory": {pool: {"current_bytes", "peak_bytes"}}} (memory empty unless OCTOWEAVE_TRACK_MEMORY)
+def trace_summary() -> dict:
+    n = _L.ow_trace_stages(None, 0)
+    stages = (_TraceStage * max(1, n))()
+    n = min(n, _L.ow_trace_stages(stages, n))
+    out = {"stages": {s.name.decode("utf-8"): {"calls": int(s.calls), "total_ms": s.total_ms,
+                                               "max_ms": s.max_ms} for s in stages[:n]}}
+    m = _L.ow_trace_counters(None, 0)
+    counters = (_TraceCounter * max(1, m))()
+    m = min(m, _L.ow_trace_counters(counters, m))
+    out["counters"] = {c.name.decode("utf-8"): int(c.value) for c in counters[:m]}
+    k = _L.ow_trace_memory(None, 0)
+    pools = (_TraceMemory * max(1, k))()
+    k = min(k, _L.ow_trace_memory(pools, k))
+    out["memory"] = {p.name.decode("utf-8"): {"current_bytes": int(p.current_bytes),
+                                              "peak_bytes": int(p.peak_bytes)} for p in pools[:k]}
+    return out
+
+
+def trace_write_chrome(path: str) -> None:
+    if _L.ow_trace_write_chrome(str(path).encode("utf-8")) != 0:
+        raise RuntimeError(f"cannot write trace to {path}")
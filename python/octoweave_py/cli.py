@@ -54,13 +54,26 @@ def main(argv=None):
         print("--columns must specify three names (x,y,z)", file=sys.stderr)
         return 2
 
-    # Load points into numpy for run_pipeline
+    params = ChunkParams(res=args.res, emit_res=args.emit_res, max_depth_cap=args.max_depth_cap)
+    ow = OctoWeave()
+
+    # Load points into numpy for run_pipeline; Parquet streams through Arrow when pyarrow is
+    # installed (pts = None: the hierarchy is built already)
     if args.parquet:
-        if pd is None:
-            print("pandas is required for parquet input", file=sys.stderr)
+        try:
+            import pyarrow.parquet  # noqa: F401  # type: ignore
+            have_arrow = True
+        except Exception:
+            have_arrow = False
+        if have_arrow:
+            ow.build_hierarchy_from_parquet(args.parquet, params, columns=cols)
+            pts = None
+        elif pd is None:
+            print("pyarrow or pandas is required for parquet input", file=sys.stderr)
             return 2
-        df = pd.read_parquet(args.parquet)
-        pts = df[cols].to_numpy(dtype=float, copy=False)
+        else:
+            df = pd.read_parquet(args.parquet)
+            pts = df[cols].to_numpy(dtype=float, copy=False)
     else:
         if pd is None:
             # fallback simple CSV parsing without pandas
@@ -78,8 +91,6 @@ def main(argv=None):
             df = pd.read_csv(args.points_csv)
             pts = df[cols].to_numpy(dtype=float, copy=False)
 
-    params = ChunkParams(res=args.res, emit_res=args.emit_res, max_depth_cap=args.max_depth_cap)
-
     # Prepare policy args
     policy_args = None
     if args.policy == "uniform":
@@ -91,7 +102,6 @@ def main(argv=None):
         lev = [int(x) for x in args.levels.split(",") if x]
         policy_args = (thr, lev)
 
-    ow = OctoWeave()
     res = ow.run_pipeline(
         pts, params, n=args.n,
         csv_path=os.path.join(args.outdir, "pipeline_leaves.csv"),
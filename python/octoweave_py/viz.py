@@ -11,8 +11,18 @@ import matplotlib
 matplotlib.use('Agg')  # non-interactive backend for headless environments
 import matplotlib.pyplot as plt
 
+try:  # native raster kernels when the shared library is built
+    from . import _ctypes as _ow
+except Exception:
+    _ow = None
+
 
-def _load_csv(csv_path: str):
+def _load_csv(csv_path):
+    """Leaves from a CSV path, an OctoWeave (zero-copy columns) or a column mapping."""
+    if hasattr(csv_path, "leaf_columns"):
+        return csv_path.leaf_columns()
+    if not isinstance(csv_path, (str, os.PathLike)):
+        return csv_path
     if pd is not None:
         df = pd.read_csv(csv_path, header=None, names=["x","y","z","depth","prob"], dtype={"x":int,"y":int,"z":int,"depth":int,"prob":float})
         return df
@@ -41,23 +51,62 @@ def _filter_depth_and_z(data, depth: int | None, z_values: Sequence[int] | None)
     return out, depth
 
 
-def _make_grid(data) -> tuple[np.ndarray, int, int]:
+def _cols(data):
+    """Leaf columns as numpy arrays: x, y, z, depth, prob."""
     if pd is not None and isinstance(data, pd.DataFrame):
-        xmax = int(data["x"].max()) if len(data) else 0
-        ymax = int(data["y"].max()) if len(data) else 0
-        W, H = xmax + 1, ymax + 1
-        img = np.zeros((H, W), dtype=float)
-        for _, r in data.iterrows():
-            img[int(r["y"]), int(r["x"])] = float(r["prob"])
-        return img, W, H
-    x = data["x"]; y = data["y"]; p = data["prob"]
-    W = int(np.max(x)) + 1 if len(x) else 1
-    H = int(np.max(y)) + 1 if len(y) else 1
+        return tuple(data[k].to_numpy() for k in ("x", "y", "z", "depth", "prob"))
+    return tuple(np.asarray(data[k]) for k in ("x", "y", "z", "depth", "prob"))
+
+
+_PLANE = {"x": ("y", "z"), "y": ("x", "z"), "z": ("x", "y")}
+
+
+def _project(data, axis: str = "z", lo: int = 0, hi: int = 0xFFFFFFFF, op: str = "max"):
+    """Project leaves with lo <= axis coordinate <= hi along `axis`.
+
+    The image is indexed [row, col] by the remaining axes in x, y, z order; cells without
+    leaves are 0. Uses the native kernels when available, else vectorized numpy.
+    """
+    x, y, z, d, p = _cols(data)
+    cu, cv = _PLANE[axis]
+    c = {"x": x, "y": y, "z": z}
+    a = c[axis]
+    mask = (a >= lo) & (a <= hi)
+    u, v = c[cu][mask], c[cv][mask]
+    W = int(np.max(u)) + 1 if len(u) else 1
+    H = int(np.max(v)) + 1 if len(v) else 1
+    if _ow is not None:
+        return _ow.raster_project(x, y, z, None, p, W, H, axis=axis, lo=lo, hi=hi, mode=op), W, H
+    u, v, p = u.astype(np.intp), v.astype(np.intp), p[mask].astype(float)
     img = np.zeros((H, W), dtype=float)
-    img[y, x] = p
+    if op == "max":
+        np.maximum.at(img, (v, u), p)  # probabilities are >= 0, so 0 stands for empty
+        return img, W, H
+    np.add.at(img, (v, u), p)
+    if op == "mean":
+        hits = np.zeros((H, W), dtype=float)
+        np.add.at(hits, (v, u), 1.0)
+        img = np.divide(img, hits, out=np.zeros_like(img), where=hits > 0)
     return img, W, H
 
 
+def _make_grid(data) -> tuple[np.ndarray, int, int]:
+    return _project(data, "z")
+
+
+def depth_histograms(csv_path: str, bins: int = 10, lo: float = 0.0, hi: float = 1.0) -> dict[int, np.ndarray]:
+    """Probability histogram (counts over `bins` even bins of [lo, hi]) per leaf depth."""
+    _, _, _, d, p = _cols(_load_csv(csv_path))
+    if _ow is not None:
+        counts = _ow.depth_histogram(d, p, bins=bins, lo=lo, hi=hi)
+    else:
+        maxd = int(np.max(d)) if len(d) else 0
+        counts = np.zeros((maxd + 1, bins), dtype=np.uint64)
+        for dd in np.unique(d):
+            counts[int(dd)] = np.histogram(p[d == dd], bins=bins, range=(lo, hi))[0]
+    return {int(k): counts[int(k)] for k in np.unique(d)}
+
+
 def _norm_for_discrete(discrete_levels: Sequence[float] | None, cmap_name: str):
     if not discrete_levels:
         return None, plt.get_cmap(cmap_name)
@@ -155,38 +204,20 @@ def render_max_projection_png(csv_path: str, out_png: str, z_range: tuple[int,in
                               figsize=(6,6), dpi=150, colorbar: bool = True, op: str = 'max',
                               discrete_levels: Sequence[float] | None = None,
                               legend: bool = False,
-                              preset: str | None = None):
+                              preset: str | None = None, axis: str = 'z'):
     zmin, zmax = z_range
-    zs = list(range(zmin, zmax+1))
+    if axis not in _PLANE:
+        raise ValueError("axis must be 'x', 'y' or 'z'")
+    if op not in ('max', 'mean', 'sum'):
+        raise ValueError("op must be 'max', 'mean' or 'sum'")
     data = _load_csv(csv_path)
-    df, depth = _filter_depth_and_z(data, depth, zs)
+    df, depth = _filter_depth_and_z(data, depth, None)
+    # mean over the whole range (absent leaves count as 0), as a stack of slices would give
+    img, _, _ = _project(df, axis, zmin, zmax, 'max' if op == 'max' else 'sum')
+    if op == 'mean':
+        img = img / float(zmax - zmin + 1)
 
-    if pd is not None and isinstance(df, pd.DataFrame):
-        xmax = int(df["x"].max()) if len(df) else 0
-        ymax = int(df["y"].max()) if len(df) else 0
-        W, H = xmax + 1, ymax + 1
-        stack = np.zeros((len(zs), H, W), dtype=float)
-        for i, z in enumerate(zs):
-            s = df[df["z"] == z]
-            for _, r in s.iterrows():
-                stack[i, int(r["y"]), int(r["x"])] = float(r["prob"])
-    else:
-        x = df["x"]; y = df["y"]; z = df["z"]; p = df["prob"]
-        W = int(np.max(x)) + 1 if len(x) else 1
-        H = int(np.max(y)) + 1 if len(y) else 1
-        stack = np.zeros((len(zs), H, W), dtype=float)
-        for i, zi in enumerate(zs):
-            mask = (z == zi)
-            stack[i][y[mask], x[mask]] = p[mask]
-
-    if op == 'max':
-        img = np.max(stack, axis=0)
-    elif op == 'mean':
-        img = np.mean(stack, axis=0)
-    else:
-        raise ValueError("op must be 'max' or 'mean'")
-
-    preset_labels: Optional[List[str]] = None
+    preset_labels: list[str] | None = None
     if preset:
         levels, cmap, preset_labels = occupancy_colormap_preset(preset)
         discrete_levels = levels
@@ -196,8 +227,8 @@ def render_max_projection_png(csv_path: str, out_png: str, z_range: tuple[int,in
         norm, cmap = _norm_for_discrete(discrete_levels, colormap)
     fig, ax = plt.subplots(figsize=figsize, dpi=dpi)
     im = ax.imshow(img, origin='lower', cmap=cmap, vmin=None if norm else vmin, vmax=None if norm else vmax, norm=norm)
-    ax.set_title(f"z∈[{zmin},{zmax}], depth={depth}, {op} projection")
-    ax.set_xlabel("x"); ax.set_ylabel("y")
+    ax.set_title(f"{axis}∈[{zmin},{zmax}], depth={depth}, {op} projection")
+    ax.set_xlabel(_PLANE[axis][0]); ax.set_ylabel(_PLANE[axis][1])
     ax.set_aspect('equal')
     if grid:
         ax.set_xticks(np.arange(-.5, img.shape[1], 1), minor=True)
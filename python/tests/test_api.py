@@ -0,0 +1,156 @@
+import os
+import sys
+import random
+
+sys.path.insert(0, os.path.join(os.path.dirname(__file__), ".."))
+from octoweave_py import OctoWeave, ChunkParams, Session
+import octoweave_py
+
+
+def _cloud(k=2000, seed=1):
+    rng = random.Random(seed)
+    return [(rng.uniform(0, 8), rng.uniform(0, 8), rng.uniform(0, 8)) for _ in range(k)]
+
+
+def test_chunked_build_matches_single_build():
+    pts = _cloud()
+    p = ChunkParams(res=0.25, emit_res=0.5, max_depth_cap=12)
+    single = OctoWeave().build_hierarchy_from_points(pts, p)
+    # Chunk borders on the emit grid: no leaf is shared between chunks
+    chunked = OctoWeave().build_hierarchy_chunked(pts, p, n=4, threads=3, box=(0, 8, 0, 8, 0, 8))
+    ref = single.leaf_columns(copy=True)
+    assert chunked.num_leaves() == single.num_leaves() > 0
+    for k in ("x", "y", "z", "depth", "prob"):
+        assert list(chunked.leaf_columns(copy=True)[k]) == list(ref[k])
+    # Default box from the point bounds
+    auto = OctoWeave().build_hierarchy_chunked(pts, p, n=3)
+    assert auto.num_leaves() > 0
+    for ow in (single, chunked, auto):
+        ow.close()
+
+
+def test_trace_summary_and_chrome_export(tmp_path):
+    import json
+    octoweave_py.trace_reset()
+    octoweave_py.trace_enable(True)
+    try:
+        ow = OctoWeave().build_hierarchy_chunked(_cloud(500), ChunkParams(res=0.25, emit_res=0.5, max_depth_cap=12),
+                                                 n=2, box=(0, 8, 0, 8, 0, 8))
+    finally:
+        octoweave_py.trace_enable(False)
+    s = octoweave_py.trace_summary()
+    for stage in ("bin", "merge", "emit"):
+        assert s["stages"][stage]["calls"] >= 1
+    assert s["counters"]["points_binned"] == 500
+    out = tmp_path / "trace.json"
+    octoweave_py.trace_write_chrome(str(out))
+    assert any(e["name"] == "merge" for e in json.load(open(out))["traceEvents"])
+    octoweave_py.trace_reset()
+    assert octoweave_py.trace_summary()["stages"] == {}
+    ow.close()
+
+
+def test_float32_strided_points_read_in_place():
+    import pytest
+    np = pytest.importorskip("numpy")
+    pts = np.array(_cloud(500), dtype=np.float64)
+    # float32 x, y, z, intensity records: a (k, 4) array read with a 16-byte stride
+    rec = np.concatenate([pts.astype(np.float32), np.ones((len(pts), 1), np.float32)], axis=1)
+    p = ChunkParams(res=0.25, emit_res=0.5, max_depth_cap=12)
+    ref = OctoWeave().build_hierarchy_from_points(pts.astype(np.float32).astype(np.float64), p)
+    a = OctoWeave().build_hierarchy_from_points(rec, p)
+    b = OctoWeave().build_hierarchy_chunked(rec, p, n=2, box=(0, 8, 0, 8, 0, 8))
+    for ow in (a, b):
+        assert ow.num_leaves() == ref.num_leaves()
+        assert np.array_equal(ow.leaf_columns()["x"], ref.leaf_columns()["x"])
+
+
+def test_leaf_column_views_outlive_close():
+    import pytest
+    np = pytest.importorskip("numpy")
+    p = ChunkParams(res=0.25, emit_res=0.5, max_depth_cap=12)
+    ow = OctoWeave().build_hierarchy_from_points(_cloud(500), p)
+    ref = ow.leaf_columns(copy=True)
+    view = ow.leaf_columns()
+    ow.close()
+    del ow
+    for k in ("x", "y", "z", "depth", "prob"):
+        assert np.array_equal(view[k], ref[k])
+
+
+def test_session_scans_match_chunked_build():
+    p = ChunkParams(res=0.25, emit_res=0.5, max_depth_cap=12)
+    box = (0, 8, 0, 8, 0, 8)
+    s = Session(box, p, n=4, threads=2)
+    pts = _cloud(1500, seed=3)
+    for k in range(0, len(pts), 500):
+        assert s.insert(pts[k:k + 500], origin=p.origin) > 0
+    # A scan in one corner only touches that chunk
+    corner = [(x / 8, y / 8, z / 8) for (x, y, z) in _cloud(100, seed=4)]
+    assert s.insert(corner) == 1
+    ref = OctoWeave().build_hierarchy_chunked(pts + corner, p, n=4, box=box)
+    h = s.hierarchy()
+    assert h.num_leaves() == ref.num_leaves() > 0
+    for k in ("x", "y", "z", "depth"):
+        assert list(h.leaf_columns(copy=True)[k]) == list(ref.leaf_columns(copy=True)[k])
+    assert s.forest_num_quadrants(2, 1) == 64
+    h.close()
+    s.close()
+    ref.close()
+
+
+def test_session_views_outlive_close_and_inserts():
+    import pytest
+    np = pytest.importorskip("numpy")
+    p = ChunkParams(res=0.25, emit_res=0.5, max_depth_cap=12)
+    s = Session((0, 8, 0, 8, 0, 8), p, n=2)
+    s.insert(_cloud(500, seed=7))
+    h = s.hierarchy()
+    ref = h.leaf_columns(copy=True)
+    view = h.leaf_columns()
+    # The next hierarchy() after an insert retires the index the views point into
+    s.insert(_cloud(500, seed=8))
+    assert s.hierarchy().num_leaves() > 0
+    s.close()
+    # h still holds the native session; its handle reflects both scans
+    assert h.num_leaves() > 0
+    for k in ("x", "y", "z", "depth", "prob"):
+        assert np.array_equal(view[k], ref[k])
+    h.close()
+    del s, h
+    assert np.array_equal(view["prob"], ref["prob"])
+
+
+def test_arrow_and_parquet_input_read_in_place(tmp_path):
+    import pytest
+    pa = pytest.importorskip("pyarrow")
+    pq = pytest.importorskip("pyarrow.parquet")
+    pts = _cloud(1200, seed=6)
+    p = ChunkParams(res=0.25, emit_res=0.5, max_depth_cap=12)
+    box = (0, 8, 0, 8, 0, 8)
+    cols = {k: [q[i] for q in pts] for i, k in enumerate("xyz")}
+    # Three chunks per column, plus a column the build ignores
+    table = pa.Table.from_batches([
+        pa.record_batch({"i": list(range(k, k + 400)), **{c: v[k:k + 400] for c, v in cols.items()}})
+        for k in range(0, 1200, 400)
+    ])
+    ref = OctoWeave().build_hierarchy_chunked(pts, p, n=2, box=box)
+    a = OctoWeave().build_hierarchy_from_arrow(table, p, n=2, box=box)
+    s = Session(box, p, n=2)
+    assert s.insert_arrow(table) == 3
+    path = str(tmp_path / "pts.parquet")
+    pq.write_table(table, path, row_group_size=500)
+    b = OctoWeave().build_hierarchy_from_parquet(path, p, n=2, box=box)
+    for ow in (a, s.hierarchy(), b):
+        assert ow.num_leaves() == ref.num_leaves() > 0
+        assert list(ow.leaf_columns(copy=True)["x"]) == list(ref.leaf_columns(copy=True)["x"])
+    s.close()
+    # By default the file is one scan; with batch_size every batch is one
+    one, per = Session(box, p, n=2), Session(box, p, n=2)
+    one.insert(pts, origin=p.origin)
+    for k in range(0, 1200, 300):
+        per.insert(pts[k:k + 300], origin=p.origin)
+    c = OctoWeave().build_hierarchy_from_parquet(path, p, n=2, box=box, batch_size=300)
+    for ow, sess in ((b, one), (c, per)):
+        got, want = ow.leaf_columns(copy=True), sess.hierarchy().leaf_columns(copy=True)
+        assert all(list(got[k]) == list(want[k]) for k in ("x", "y", "z", "depth", "prob"))
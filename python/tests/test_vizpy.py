@@ -12,6 +12,8 @@ from octoweave_py.viz import (
     render_montage,
     render_overlay_slices,
     export_slice_grid,
+    depth_histograms,
+    _project,
 )
 
 
@@ -62,3 +64,47 @@ def test_render_overlay_and_export_grid():
     export_slice_grid(csv, grid_out, z=0)
     assert os.path.exists(grid_out) and os.path.getsize(grid_out) > 0
 
+
+
+def test_native_kernels_match_numpy():
+    import numpy as np
+    from octoweave_py import _ctypes as ow
+    rng = np.random.default_rng(3)
+    n = 5000
+    x, y, z = (rng.integers(0, 16, n) for _ in range(3))
+    d = rng.integers(3, 5, n)
+    p = rng.random(n)
+    img = ow.raster_project(x, y, z, d, p, 16, 16, axis='x', lo=2, hi=5, mode='sum', depth=4)
+    ref = np.zeros((16, 16))
+    m = (d == 4) & (x >= 2) & (x <= 5)
+    np.add.at(ref, (z[m], y[m]), p[m])
+    assert np.allclose(img, ref)
+    hist = ow.depth_histogram(d, p, bins=5)
+    assert hist.shape == (5, 5) and int(hist.sum()) == n
+    assert list(hist[4]) == list(np.histogram(p[d == 4], bins=5, range=(0.0, 1.0))[0])
+
+
+def test_axis_projection_and_histograms():
+    csv = _pipeline_csv('pyviz_tmp/leaves5.csv')
+    out = 'pyviz_tmp/proj_y.png'
+    render_max_projection_png(csv, out, (0, 3), axis='y', op='sum')
+    assert os.path.exists(out) and os.path.getsize(out) > 0
+    hist = depth_histograms(csv, bins=4)
+    assert hist and all(len(h) == 4 for h in hist.values())
+
+
+def test_leaf_columns_zero_copy():
+    import numpy as np
+    ow = OctoWeave()
+    pts = [(0.2,0.2,0.2),(1.1,0.2,0.2),(0.5,1.3,0.2),(2.2,0.1,0.3)]
+    ow.build_hierarchy_from_points(pts, ChunkParams(res=0.25, emit_res=0.5, max_depth_cap=12))
+    view = ow.leaf_columns()
+    copy = ow.leaf_columns(copy=True)
+    assert len(view["prob"]) == ow.num_leaves() > 0
+    assert not view["x"].flags.writeable
+    for k in ("x", "y", "z", "depth", "prob"):
+        assert np.array_equal(view[k], copy[k])
+    out = 'pyviz_tmp/slice_mem.png'
+    render_slice_png(ow, out, z=int(view["z"][-1]))
+    assert os.path.exists(out) and os.path.getsize(out) > 0
+    ow.close()
@@ -1,28 +1,74 @@
 #include "octoweave/c_api.h"
+#include "octoweave/arrow_points.hpp"
+#include "octoweave/chunk_grid.hpp"
 #include "octoweave/octo_iface.hpp"
 #include "octoweave/hierarchy.hpp"
 #include "octoweave/p4est_builder.hpp"
+#include "octoweave/parallel.hpp"
+#include "octoweave/raster.hpp"
+#include "octoweave/session.hpp"
+#include "octoweave/trace.hpp"
 #include "octoweave/viz.hpp"
 #include <vector>
 #include <fstream>
 #include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
 
-struct ow_hierarchy_s { octoweave::Hierarchy H; };
-struct ow_forest_s { void* impl; /* reserved */ };
+struct ow_hierarchy_s {
+  octoweave::Hierarchy own;
+  // Session handles view the session's hierarchy instead and are freed with the session
+  const octoweave::Hierarchy* view = nullptr;
+  const octoweave::Hierarchy& H() const { return view ? *view : own; }
+  // Tree mapping honored by forest builds and level functions (n supplied per call)
+  octoweave::P4estBuilder::TreeMapping mapping = octoweave::P4estBuilder::TreeMapping::Modulo;
+  octoweave::P4estBuilder::BlockLayout block;
+  octoweave::P4estBuilder::TreeMap tree_map(int n) const { return {n, mapping, block}; }
+  // Leaf index for raster calls and columnar export, built on first use (calls may run
+  // concurrently); dropped when a session updates the viewed hierarchy. Shared so that
+  // retained column references keep a retired index alive.
+  std::mutex index_mu;
+  std::shared_ptr<const octoweave::LeafIndex> index;
+  std::shared_ptr<const octoweave::LeafIndex> leaf_index() {
+    std::lock_guard<std::mutex> lock(index_mu);
+    if (!index) index = std::make_shared<const octoweave::LeafIndex>(H());
+    return index;
+  }
+  void invalidate_index() {
+    std::lock_guard<std::mutex> lock(index_mu);
+    index.reset();
+  }
+};
+struct ow_leaf_columns_ref_s {
+  std::shared_ptr<const octoweave::LeafIndex> index;
+};
+struct ow_forest_s {
+  void* impl;
+  bool borrowed = false; // owned by a session
+};
+
+struct ow_session_s {
+  explicit ow_session_s(const octoweave::Session::Options& opt) : session(opt) {
+    hier.view = &session.hierarchy();
+    forest.impl = nullptr; forest.borrowed = true;
+  }
+  octoweave::Session session;
+  ow_hierarchy_s hier;
+  ow_forest_s forest;
+  size_t synced_scans = 0; // scans reflected in hier's leaf index
+  int forest_level = -1;   // level policy of the session forest (< 0: default)
+};
+
+// Last stages / counters handed out through ow_trace_stages / ow_trace_counters (own the
+// names); one per call kind so that either call leaves the other's names intact
+static std::mutex g_trace_mu;
+static std::vector<octoweave::trace::StageSummary> g_trace_stages;
+static std::vector<std::pair<std::string, int64_t>> g_trace_counters;
 
 extern "C" {
 
-ow_hierarchy_t ow_build_hierarchy_from_points(const double* xyz, size_t count,
-                                              const ow_chunk_params_t* params,
-                                              double tau,
-                                              double p_unknown,
-                                              int base_depth)
-{
-  if (!xyz || !params) return nullptr;
-  std::vector<octoweave::Pt> pts; pts.reserve(count);
-  for (size_t i=0;i<count;++i) {
-    pts.push_back(octoweave::Pt{ xyz[3*i+0], xyz[3*i+1], xyz[3*i+2] });
-  }
+static octoweave::OctoChunker::Params to_params(const ow_chunk_params_t* params) {
   octoweave::OctoChunker::Params p;
   p.res = params->res;
   p.prob_hit = params->prob_hit;
@@ -35,19 +81,74 @@ ow_hierarchy_t ow_build_hierarchy_from_points(const double* xyz, size_t count,
   p.discretize = params->discretize != 0;
   p.emit_res = params->emit_res;
   p.max_depth_cap = params->max_depth_cap;
+  return p;
+}
+
+static bool to_span(const ow_points_t* pts, octoweave::PointSpan& s) {
+  if (!pts || (pts->count && !pts->data)) return false;
+  if (pts->type == OW_POINTS_F64)
+    s = octoweave::PointSpan(static_cast<const double*>(pts->data), pts->count, pts->stride);
+  else if (pts->type == OW_POINTS_F32)
+    s = octoweave::PointSpan(static_cast<const float*>(pts->data), pts->count, pts->stride);
+  else return false;
+  // A stride shorter than one x, y, z triple would overlap points
+  return s.stride >= 3 * (pts->type == OW_POINTS_F32 ? sizeof(float) : sizeof(double));
+}
 
-  octoweave::WorkerOut w = octoweave::OctoChunker::build_and_export(pts, p);
+ow_hierarchy_t ow_build_hierarchy_from_span(const ow_points_t* pts,
+                                            const ow_chunk_params_t* params,
+                                            double tau, double p_unknown, int base_depth)
+{
+  octoweave::PointSpan span;
+  if (!to_span(pts, span) || !params) return nullptr;
+  octoweave::WorkerOut w = octoweave::OctoChunker::build_and_export(span, to_params(params));
   std::vector<octoweave::WorkerOut> outs; outs.push_back(std::move(w));
   octoweave::Hierarchy H = octoweave::make_hierarchy_from_workers(outs, tau, /*use_logodds=*/false, p_unknown, base_depth);
-  auto* h = new ow_hierarchy_s(); h->H = std::move(H);
+  auto* h = new ow_hierarchy_s(); h->own = std::move(H);
   return h;
 }
 
+ow_hierarchy_t ow_build_hierarchy_from_points(const double* xyz, size_t count,
+                                              const ow_chunk_params_t* params,
+                                              double tau,
+                                              double p_unknown,
+                                              int base_depth)
+{
+  if (!xyz) return nullptr;
+  ow_points_t pts{ xyz, count, 0, OW_POINTS_F64 };
+  return ow_build_hierarchy_from_span(&pts, params, tau, p_unknown, base_depth);
+}
+
+ow_hierarchy_t ow_build_hierarchy_chunked_span(const ow_points_t* pts,
+                                               const ow_chunk_params_t* params,
+                                               const double box[6], int n, int threads,
+                                               double tau, double p_unknown, int base_depth)
+{
+  octoweave::PointSpan span;
+  if (!to_span(pts, span) || !params || !box || n <= 0) return nullptr;
+  if (!(box[1] > box[0] && box[3] > box[2] && box[5] > box[4])) return nullptr;
+  octoweave::ChunkGrid grid(n, octoweave::AABB{ box[0], box[1], box[2], box[3], box[4], box[5] });
+  auto outs = octoweave::build_chunked_workers(grid, span, to_params(params), threads);
+  octoweave::Hierarchy H = octoweave::make_hierarchy_from_workers(outs, tau, /*use_logodds=*/false, p_unknown, base_depth);
+  auto* h = new ow_hierarchy_s(); h->own = std::move(H);
+  return h;
+}
+
+ow_hierarchy_t ow_build_hierarchy_chunked(const double* xyz, size_t count,
+                                          const ow_chunk_params_t* params,
+                                          const double box[6], int n, int threads,
+                                          double tau, double p_unknown, int base_depth)
+{
+  if (!xyz && count) return nullptr;
+  ow_points_t pts{ xyz, count, 0, OW_POINTS_F64 };
+  return ow_build_hierarchy_chunked_span(&pts, params, box, n, threads, tau, p_unknown, base_depth);
+}
+
 int ow_hierarchy_write_csv(ow_hierarchy_t h, const char* path) {
   if (!h || !path) return 1;
   std::ofstream f(path);
   if (!f) return 2;
-  for (auto& kv : h->H.nodes) if (kv.second.is_leaf) {
+  for (auto& kv : h->H().nodes) if (kv.second.is_leaf) {
     auto k = kv.first.k; int d = kv.first.d; double p = kv.second.p;
     f << k.x << "," << k.y << "," << k.z << "," << d << "," << p << "\n";
   }
@@ -55,34 +156,61 @@ int ow_hierarchy_write_csv(ow_hierarchy_t h, const char* path) {
 }
 
 void ow_hierarchy_free(ow_hierarchy_t h) {
+  if (h && h->view) return; // session handle
   delete h;
 }
 
 ow_forest_t ow_build_forest_uniform(ow_hierarchy_t h, int n, int level) {
   if (!h || n <= 0) return nullptr;
   octoweave::P4estBuilder::Config cfg; cfg.n = n; cfg.min_level = 0; cfg.max_level = 30;
+  cfg.mapping = h->mapping; cfg.block = h->block;
   cfg.level_policy = octoweave::P4estBuilder::Policy::uniform(level);
-#ifdef OCTOWEAVE_WITH_P4EST
-  auto* fh = octoweave::P4estBuilder::build_forest_handle(h->H, cfg);
+  auto* fh = octoweave::P4estBuilder::build_forest_handle(h->H(), cfg);
+  if (!fh) return nullptr;
   auto* f = new ow_forest_s(); f->impl = (void*) fh; return f;
-#else
-  octoweave::P4estBuilder::prepare_want_sets(h->H, cfg);
-  auto* f = new ow_forest_s(); f->impl = nullptr; return f;
-#endif
+}
+
+int ow_forest_adapt_levels(ow_forest_t f, ow_hierarchy_t h, const int* levels, size_t len) {
+  if (!f || !f->impl || !h || !levels) return -1;
+  auto* fh = reinterpret_cast<octoweave::P4estBuilder::ForestHandle*>(f->impl);
+  const int n = fh->n;
+  if (len < (size_t)n*n*n) return -2;
+  octoweave::P4estBuilder::Config cfg; cfg.n = n; cfg.min_level = 0; cfg.max_level = 30;
+  cfg.mapping = h->mapping; cfg.block = h->block;
+  cfg.level_policy = octoweave::P4estBuilder::Policy::from_levels(std::vector<int>(levels, levels + (size_t)n*n*n));
+  std::vector<int> touched;
+  if (octoweave::P4estBuilder::adapt_forest(fh, h->H(), cfg, {}, &touched) != 0) return -3;
+  return (int) touched.size();
+}
+
+size_t ow_forest_num_quadrants(ow_forest_t f) {
+  if (!f || !f->impl) return 0;
+  return reinterpret_cast<octoweave::P4estBuilder::ForestHandle*>(f->impl)->num_quadrants();
 }
 
 void ow_forest_free(ow_forest_t f) {
-#ifdef OCTOWEAVE_WITH_P4EST
+  if (f && f->borrowed) return; // session handle
   if (f && f->impl) {
     auto* fh = reinterpret_cast<octoweave::P4estBuilder::ForestHandle*>(f->impl);
     delete fh; f->impl = nullptr;
   }
-#endif
   delete f;
 }
 
-static inline size_t flat_tree_index(const octoweave::Key3& t, int n) {
-  return (size_t)t.x + (size_t)n * ((size_t)t.y + (size_t)n * (size_t)t.z);
+int ow_hierarchy_set_tree_mapping(ow_hierarchy_t h, int mapping,
+                                  const unsigned int origin[3], const unsigned int extent[3],
+                                  int depth)
+{
+  if (!h) return 1;
+  using TM = octoweave::P4estBuilder::TreeMapping;
+  if (mapping == OW_TREE_MAPPING_MODULO) { h->mapping = TM::Modulo; h->block = {}; return 0; }
+  if (mapping != OW_TREE_MAPPING_BLOCK) return 2;
+  octoweave::P4estBuilder::BlockLayout b;
+  if (origin) b.origin = octoweave::Key3{ origin[0], origin[1], origin[2] };
+  if (extent) b.extent = octoweave::Key3{ extent[0], extent[1], extent[2] };
+  b.depth = depth;
+  h->mapping = TM::Block; h->block = b;
+  return 0;
 }
 
 int ow_levels_by_leafcount_quantiles(ow_hierarchy_t h, int n,
@@ -93,14 +221,9 @@ int ow_levels_by_leafcount_quantiles(ow_hierarchy_t h, int n,
   if (!h || n <= 0 || !out_levels) return 1;
   const size_t T = (size_t)n*n*n;
   if (out_len < T) return 2;
+  auto stats = octoweave::P4estBuilder::tree_stats(h->H(), h->tree_map(n));
   std::vector<size_t> counts(T, 0);
-  for (const auto& kv : h->H.nodes) {
-    const octoweave::NDKey& nd = kv.first; const octoweave::NodeRec& rec = kv.second;
-    if (!rec.is_leaf || nd.d != (uint16_t)h->H.td) continue;
-    auto split = octoweave::P4estBuilder::split_global_to_tree_local(nd.k, nd.d, n);
-    size_t idx = flat_tree_index(split.first, n);
-    if (idx < T) counts[idx] += 1;
-  }
+  for (size_t i=0;i<T;++i) counts[i] = stats[i].leaf_count;
   std::vector<size_t> sorted = counts;
   std::sort(sorted.begin(), sorted.end());
   auto qidx = [&](double q){ if (sorted.empty()) return (size_t)0; double pos = std::clamp(q,0.0,1.0) * (sorted.size()-1); size_t i=(size_t)std::round(pos); if (i>=sorted.size()) i=sorted.size()-1; return i; };
@@ -123,16 +246,9 @@ int ow_levels_bands_by_mean_prob(ow_hierarchy_t h, int n,
   if (llen != tlen + 1) return 2;
   const size_t T = (size_t)n*n*n;
   if (out_len < T) return 3;
-  std::vector<double> sum(T, 0.0); std::vector<size_t> cnt(T, 0);
-  for (const auto& kv : h->H.nodes) {
-    const octoweave::NDKey& nd = kv.first; const octoweave::NodeRec& rec = kv.second;
-    if (!rec.is_leaf || nd.d != (uint16_t)h->H.td) continue;
-    auto split = octoweave::P4estBuilder::split_global_to_tree_local(nd.k, nd.d, n);
-    size_t idx = flat_tree_index(split.first, n);
-    if (idx < T) { sum[idx] += rec.p; cnt[idx] += 1; }
-  }
+  auto stats = octoweave::P4estBuilder::tree_stats(h->H(), h->tree_map(n));
   for (size_t i=0;i<T;++i) {
-    double m = cnt[i] ? (sum[i] / (double)cnt[i]) : 0.0;
+    double m = stats[i].mean();
     size_t b = 0; while (b < tlen && m > thresholds[b]) ++b;
     if (b >= llen) b = llen-1;
     out_levels[i] = levels[b];
@@ -144,14 +260,280 @@ int ow_viz_slice(const char* csv_path, int slice_z, int depth,
                  const char* out_pgm, const char* out_svg)
 {
   if (!csv_path || !out_pgm) return 1;
-  const char* argv[12]; int argc = 0;
-  argv[argc++] = "octoweave_viz";
-  argv[argc++] = "--csv"; argv[argc++] = csv_path;
-  argv[argc++] = "--slice_z"; static char zbuf[32]; snprintf(zbuf,sizeof zbuf, "%d", slice_z); argv[argc++] = zbuf;
-  if (depth >= 0) { argv[argc++] = "--depth"; static char dbuf[32]; snprintf(dbuf,sizeof dbuf, "%d", depth); argv[argc++] = dbuf; }
-  argv[argc++] = "--out"; argv[argc++] = out_pgm;
-  if (out_svg && *out_svg) { argv[argc++] = "--hist"; argv[argc++] = out_svg; }
-  return octoweave::viz_main(argc, const_cast<char**>(argv));
+  std::vector<std::string> args = { "octoweave_viz", "--csv", csv_path, "--slice_z", std::to_string(slice_z) };
+  if (depth >= 0) { args.push_back("--depth"); args.push_back(std::to_string(depth)); }
+  args.push_back("--out"); args.push_back(out_pgm);
+  if (out_svg && *out_svg) { args.push_back("--hist"); args.push_back(out_svg); }
+  std::vector<char*> argv;
+  for (auto& a : args) argv.push_back(&a[0]);
+  return octoweave::viz_main((int)argv.size(), argv.data());
+}
+
+static int resolve_depth(const octoweave::LeafIndex& idx, int depth) {
+  if (depth >= 0) return depth;
+  auto ds = idx.depths();
+  return ds.empty() ? 0 : ds.back();
+}
+
+int ow_hierarchy_leaf_extent(ow_hierarchy_t h, int depth, unsigned int out_extent[3]) {
+  if (!h || !out_extent) return 1;
+  const auto idx = h->leaf_index();
+  octoweave::Key3 e = idx->extent(resolve_depth(*idx, depth));
+  out_extent[0] = e.x; out_extent[1] = e.y; out_extent[2] = e.z;
+  return 0;
+}
+
+long ow_render_slice(ow_hierarchy_t h, int depth, unsigned int z,
+                     double* out, int width, int height, double background)
+{
+  if (!h || !out || width <= 0 || height <= 0) return -1;
+  const auto idx = h->leaf_index();
+  return (long) octoweave::render_slice(*idx, resolve_depth(*idx, depth), z, out, width, height, background);
+}
+
+long ow_render_projection(ow_hierarchy_t h, int depth, int mode,
+                          double* out, int width, int height, double background)
+{
+  if (!h || !out || width <= 0 || height <= 0) return -1;
+  octoweave::Projection m;
+  if (mode == OW_PROJECTION_MAX) m = octoweave::Projection::Max;
+  else if (mode == OW_PROJECTION_MEAN) m = octoweave::Projection::Mean;
+  else if (mode == OW_PROJECTION_SUM) m = octoweave::Projection::Sum;
+  else return -2;
+  const auto idx = h->leaf_index();
+  return (long) octoweave::render_projection(*idx, resolve_depth(*idx, depth), m, out, width, height, background);
+}
+
+static bool to_columns(const ow_leaf_columns_t* cols, octoweave::LeafColumns& c) {
+  if (!cols || (cols->n && (!cols->x || !cols->y || !cols->z || !cols->p))) return false;
+  static_assert(sizeof(unsigned int) == sizeof(uint32_t) && sizeof(int) == sizeof(int32_t),
+                "leaf columns are passed as 32-bit integers");
+  c.x = reinterpret_cast<const uint32_t*>(cols->x);
+  c.y = reinterpret_cast<const uint32_t*>(cols->y);
+  c.z = reinterpret_cast<const uint32_t*>(cols->z);
+  c.d = reinterpret_cast<const int32_t*>(cols->d);
+  c.p = cols->p; c.size = cols->n;
+  return true;
+}
+
+static bool to_axis(int axis, octoweave::Axis& a) {
+  if (axis == OW_AXIS_X) a = octoweave::Axis::X;
+  else if (axis == OW_AXIS_Y) a = octoweave::Axis::Y;
+  else if (axis == OW_AXIS_Z) a = octoweave::Axis::Z;
+  else return false;
+  return true;
+}
+
+long ow_raster_project(const ow_leaf_columns_t* cols, int depth, int axis,
+                       unsigned int lo, unsigned int hi, int mode,
+                       double* out, int width, int height, double background, int threads)
+{
+  octoweave::LeafColumns c; octoweave::Axis a;
+  if (!to_columns(cols, c) || !out || width <= 0 || height <= 0) return -1;
+  if (!to_axis(axis, a)) return -2;
+  octoweave::Projection m;
+  if (mode == OW_PROJECTION_MAX) m = octoweave::Projection::Max;
+  else if (mode == OW_PROJECTION_MEAN) m = octoweave::Projection::Mean;
+  else if (mode == OW_PROJECTION_SUM) m = octoweave::Projection::Sum;
+  else return -2;
+  return (long) octoweave::project_columns(c, depth, a, lo, hi, m, out, width, height, background, threads);
+}
+
+long ow_raster_slice(const ow_leaf_columns_t* cols, int depth, int axis, unsigned int coord,
+                     double* out, int width, int height, double background, int threads)
+{
+  octoweave::LeafColumns c; octoweave::Axis a;
+  if (!to_columns(cols, c) || !out || width <= 0 || height <= 0) return -1;
+  if (!to_axis(axis, a)) return -2;
+  return (long) octoweave::slice_columns(c, depth, a, coord, out, width, height, background, threads);
+}
+
+long ow_depth_histogram(const ow_leaf_columns_t* cols, int max_depth, int bins,
+                        double lo, double hi, unsigned long long* out, int threads)
+{
+  if (!cols || (cols->n && !cols->p) || !out || max_depth < 0 || bins <= 0) return -1;
+  static_assert(sizeof(unsigned long long) == sizeof(uint64_t), "64-bit histogram counts");
+  octoweave::LeafColumns c;
+  c.d = reinterpret_cast<const int32_t*>(cols->d); c.p = cols->p; c.size = cols->n;
+  return (long) octoweave::depth_histogram(c, max_depth, bins, lo, hi,
+                                           reinterpret_cast<uint64_t*>(out), threads);
+}
+
+size_t ow_hierarchy_num_leaves(ow_hierarchy_t h) {
+  return h ? h->leaf_index()->size() : 0;
+}
+
+long ow_hierarchy_copy_leaves(ow_hierarchy_t h, unsigned int* x, unsigned int* y,
+                              unsigned int* z, int* d, double* p, size_t cap)
+{
+  if (!h) return -1;
+  const auto idx = h->leaf_index();
+  const auto c = idx->columns();
+  const size_t n = std::min(cap, c.size);
+  if (x) std::copy(c.x, c.x + n, x);
+  if (y) std::copy(c.y, c.y + n, y);
+  if (z) std::copy(c.z, c.z + n, z);
+  if (d) std::copy(c.d, c.d + n, d);
+  if (p) std::copy(c.p, c.p + n, p);
+  return (long)n;
+}
+
+static void fill_columns(const octoweave::LeafIndex& idx, ow_leaf_columns_t* out) {
+  const auto c = idx.columns();
+  out->x = c.x; out->y = c.y; out->z = c.z;
+  out->d = c.d; out->p = c.p; out->n = c.size;
+}
+
+int ow_hierarchy_leaf_columns(ow_hierarchy_t h, ow_leaf_columns_t* out) {
+  if (!h || !out) return 1;
+  fill_columns(*h->leaf_index(), out);
+  return 0;
+}
+
+ow_leaf_columns_ref_t ow_hierarchy_leaf_columns_retain(ow_hierarchy_t h, ow_leaf_columns_t* out) {
+  if (!h || !out) return nullptr;
+  auto* ref = new ow_leaf_columns_ref_s{h->leaf_index()};
+  fill_columns(*ref->index, out);
+  return ref;
+}
+
+void ow_leaf_columns_release(ow_leaf_columns_ref_t ref) {
+  delete ref;
+}
+
+ow_session_t ow_session_create(const ow_chunk_params_t* params, const double box[6], int n,
+                               int threads, double tau, double p_unknown, int base_depth)
+{
+  if (!params || !box || n <= 0) return nullptr;
+  octoweave::Session::Options opt;
+  opt.box = octoweave::AABB{ box[0], box[1], box[2], box[3], box[4], box[5] };
+  opt.n = n; opt.params = to_params(params); opt.threads = threads;
+  opt.tau = tau; opt.p_unknown = p_unknown; opt.base_depth = base_depth;
+  return new ow_session_s(opt);
+}
+
+static octoweave::Pt to_origin(const double origin[3]) {
+  return origin ? octoweave::Pt{ origin[0], origin[1], origin[2] } : octoweave::Pt{};
+}
+
+long ow_session_insert(ow_session_t s, const ow_points_t* pts, const double origin[3]) {
+  octoweave::PointSpan span;
+  if (!s || !to_span(pts, span)) return -1;
+  return (long) s->session.insert(span, to_origin(origin));
+}
+
+ow_hierarchy_t ow_session_hierarchy(ow_session_t s) {
+  if (!s) return nullptr;
+  s->session.hierarchy();
+  if (s->synced_scans != s->session.scans()) {
+    s->hier.invalidate_index();
+    s->synced_scans = s->session.scans();
+  }
+  return &s->hier;
+}
+
+ow_forest_t ow_session_forest(ow_session_t s, int n, int level) {
+  if (!s || n <= 0) return nullptr;
+  ow_hierarchy_t h = ow_session_hierarchy(s);
+  octoweave::P4estBuilder::Config cfg; cfg.n = n; cfg.min_level = 0; cfg.max_level = 30;
+  cfg.mapping = h->mapping; cfg.block = h->block;
+  if (level >= 0) cfg.level_policy = octoweave::P4estBuilder::Policy::uniform(level);
+  // The session re-evaluates the policy only in changed trees; a new level rebuilds
+  if (std::max(level, -1) != s->forest_level) {
+    s->session.reset_forest();
+    s->forest_level = std::max(level, -1);
+  }
+  s->forest.impl = (void*) s->session.forest(cfg);
+  return s->forest.impl ? &s->forest : nullptr;
+}
+
+void ow_session_free(ow_session_t s) {
+  delete s;
+}
+
+static octoweave::ArrowColumns to_arrow_columns(const char* const columns[3]) {
+  octoweave::ArrowColumns c;
+  if (columns) { c.x = columns[0]; c.y = columns[1]; c.z = columns[2]; }
+  return c;
+}
+
+long ow_session_insert_arrow(ow_session_t s, const struct ArrowSchema* schema,
+                             const struct ArrowArray* batch, const char* const columns[3],
+                             const double origin[3])
+{
+  if (!s || !schema || !batch || (columns && (!columns[0] || !columns[1] || !columns[2]))) return -1;
+  octoweave::PointSpan span;
+  if (!octoweave::arrow_point_span(*schema, *batch, to_arrow_columns(columns), span)) return -2;
+  return (long) s->session.insert(span, to_origin(origin));
+}
+
+long ow_session_insert_arrow_stream(ow_session_t s, struct ArrowArrayStream* stream,
+                                    const char* const columns[3], const double origin[3])
+{
+  if (!s || !stream || (columns && (!columns[0] || !columns[1] || !columns[2]))) return -1;
+  const octoweave::Pt o = to_origin(origin);
+  const long rc = octoweave::consume_arrow_stream(stream, to_arrow_columns(columns),
+      [&](const octoweave::PointSpan& span) { s->session.insert(span, o); });
+  return rc < 0 ? -2 : rc;
+}
+
+ow_hierarchy_t ow_build_hierarchy_from_arrow_stream(struct ArrowArrayStream* stream,
+                                                    const char* const columns[3],
+                                                    const ow_chunk_params_t* params,
+                                                    const double box[6], int n, int threads,
+                                                    double tau, double p_unknown, int base_depth)
+{
+  if (!stream || !params || n <= 0 || (!box && n != 1)) return nullptr;
+  const double unit[6] = { 0, 1, 0, 1, 0, 1 }; // one chunk takes every point
+  std::unique_ptr<ow_session_s> s(ow_session_create(params, box ? box : unit, n, threads,
+                                                    tau, p_unknown, base_depth));
+  if (!s || ow_session_insert_arrow_stream(s.get(), stream, columns, params->origin_xyz) < 0)
+    return nullptr;
+  auto* h = new ow_hierarchy_s(); h->own = s->session.hierarchy();
+  return h;
+}
+
+void ow_trace_enable(int on) { octoweave::trace::set_enabled(on != 0); }
+
+int ow_trace_enabled(void) { return octoweave::trace::enabled() ? 1 : 0; }
+
+void ow_trace_reset(void) {
+  std::lock_guard<std::mutex> lock(g_trace_mu);
+  octoweave::trace::reset();
+  g_trace_stages.clear(); g_trace_counters.clear();
+}
+
+size_t ow_trace_stages(ow_trace_stage_t* out, size_t cap) {
+  std::lock_guard<std::mutex> lock(g_trace_mu);
+  g_trace_stages = octoweave::trace::summary().stages;
+  const auto& st = g_trace_stages;
+  for (size_t i=0; out && i<std::min(cap, st.size()); ++i)
+    out[i] = ow_trace_stage_t{ st[i].name.c_str(), (unsigned long long)st[i].calls,
+                               st[i].total_ms, st[i].max_ms };
+  return st.size();
+}
+
+size_t ow_trace_counters(ow_trace_counter_t* out, size_t cap) {
+  std::lock_guard<std::mutex> lock(g_trace_mu);
+  g_trace_counters = octoweave::trace::summary().counters;
+  const auto& cs = g_trace_counters;
+  for (size_t i=0; out && i<std::min(cap, cs.size()); ++i)
+    out[i] = ow_trace_counter_t{ cs[i].first.c_str(), (long long)cs[i].second };
+  return cs.size();
+}
+
+size_t ow_trace_memory(ow_trace_memory_t* out, size_t cap) {
+  if (!octoweave::mem::tracking_enabled()) return 0;
+  const auto pools = octoweave::mem::usage();
+  for (size_t i=0; out && i<std::min(cap, pools.size()); ++i)
+    out[i] = ow_trace_memory_t{ pools[i].name, (long long)pools[i].current_bytes,
+                                (long long)pools[i].peak_bytes };
+  return pools.size();
+}
+
+int ow_trace_write_chrome(const char* path) {
+  if (!path) return 1;
+  return octoweave::trace::write_chrome_trace(path) ? 0 : 1;
 }
 
 } // extern "C"
@@ -1,64 +1,107 @@
 #include "octoweave/hierarchy.hpp"
+#include "octoweave/flat_map.hpp"
+#include "octoweave/key_traits.hpp"
+#include "octoweave/trace.hpp"
 #include "octoweave/union.hpp"
+#include <algorithm>
 #include <array>
 #include <cmath>
 #include <functional>
+#include <memory_resource>
+#include <type_traits>
+#include <unordered_set>
 
 namespace octoweave {
 
-static inline Key3 parentKey(Key3 kc){ return { kc.x>>1, kc.y>>1, kc.z>>1 }; }
-static inline int  childIndex(Key3 kc){ return (kc.x&1) | ((kc.y&1)<<1) | ((kc.z&1)<<2); }
-static inline Key3 childKey (Key3 kp,int i){ return { (kp.x<<1)|((i>>0)&1), (kp.y<<1)|((i>>1)&1), (kp.z<<1)|((i>>2)&1) }; }
+namespace {
 
-Hierarchy make_hierarchy_from_workers(const std::vector<WorkerOut>& outs,
-                                      double tau, bool use_logodds,
-                                      double p_unknown, int base_depth)
+// Batch build over packed (depth, key) codes of KeyTraits<MaxDepth>, storing probabilities
+// as Prob: double, or int16_t log-odds codes (ProbStorage::logodds16). Returns false (and
+// no hierarchy) when some input key is too wide for the codes.
+template <class Traits, class Prob>
+bool build_hierarchy(const std::vector<WorkerOut>& outs, int td, size_t largest,
+                     double tau, bool use_logodds, double p_unknown, int base_depth,
+                     std::pmr::memory_resource* scratch, Hierarchy& H)
 {
-  // 1) Collect max td and union-merge all per-chunk maps into global P[td]
-  int td = 0;
-  for (auto& o : outs) td = std::max(td, o.td);
-
-  // P[d][Key3] = prob
-  std::unordered_map<int, std::unordered_map<Key3,double,Key3Hash>> P;
-  auto& Ptd = P[td];
-
-  for (auto& o : outs) {
-    for (auto& kv : o.Ptd) {
-      auto it = Ptd.find(kv.first);
-      if (it == Ptd.end()) {
-        Ptd.emplace(kv.first, std::clamp(kv.second, 0.0, 1.0));
-      } else {
-        double s = std::clamp(it->second, 0.0, 1.0);
-        double p = std::clamp(kv.second, 0.0, 1.0);
-        it->second = 1.0 - (1.0 - s) * (1.0 - p);
+  using Key = typename Traits::Key;
+  using DepthTable = FlatMap<Key, Prob>;
+  using Buckets = FlatMap<Key, std::array<Prob,8>>;
+  constexpr bool kLogOdds16 = std::is_same<Prob, int16_t>::value;
+  auto to_prob = [](Prob v)->double {
+    if constexpr (kLogOdds16) return prob_from_logodds16(v);
+    else return v;
+  };
+
+  // Per-depth tables live in one arena until emission; each roll-up step's buckets in a
+  // second arena released after the step. Both draw blocks from `scratch`.
+  mem::TrackingResource maps_up(mem::Pool::depth_maps, scratch);
+  mem::TrackingResource buckets_up(mem::Pool::rollup_buckets, scratch);
+  std::pmr::monotonic_buffer_resource maps_arena(&maps_up);
+  std::pmr::monotonic_buffer_resource buckets_arena(&buckets_up);
+
+  // P[d][key] = prob
+  std::vector<DepthTable> P;
+  P.reserve((size_t)std::max(td, 0) + 1);
+  for (int d=0; d<=td; ++d) P.emplace_back(&maps_arena);
+  auto& Ptd = P[(size_t)td];
+  Ptd.reserve(largest);
+
+  // 1) Union-merge all per-chunk maps into global P[td]
+  {
+    trace::Scope ts("merge");
+    for (auto& o : outs) {
+      for (auto& kv : o.Ptd) {
+        if (!Traits::fits(kv.first)) return false;
+        auto slot = Ptd.try_emplace(Traits::make(kv.first, td));
+        if constexpr (kLogOdds16) {
+          const int16_t q = logodds16_from_prob(kv.second, p_unknown);
+          *slot.first = slot.second ? q : union_logodds16(*slot.first, q);
+        } else {
+          const double p = std::clamp(kv.second, 0.0, 1.0);
+          if (slot.second) {
+            *slot.first = p;
+          } else {
+            double s = std::clamp(*slot.first, 0.0, 1.0);
+            *slot.first = 1.0 - (1.0 - s) * (1.0 - p);
+          }
+        }
       }
     }
   }
+  trace::count("keys_merged", (int64_t)Ptd.size());
 
   // 2) Roll up: td-1 ... base_depth
-  for (int d = td-1; d >= base_depth; --d) {
-    auto &Pc = P[d+1];
-    auto &Pp = P[d];
-    std::unordered_map<Key3, std::array<double,8>, Key3Hash> buckets;
-    buckets.reserve(Pc.size()/4 + 8);
-
-    for (auto& kv : Pc) {
-      const Key3 kc = kv.first;
-      const Key3 kp = parentKey(kc);
-      auto &arr = buckets[kp];
-      // default init (value-init leaves zeros); we will fill and then patch with p_unknown
-      arr[childIndex(kc)] = kv.second;
-    }
+  for (int d = td-1; d >= base_depth && d >= 0; --d) {
+    trace::Scope ts("rollup", d);
+    auto &Pc = P[(size_t)d+1];
+    auto &Pp = P[(size_t)d];
+    {
+      Buckets buckets(&buckets_arena);
+      buckets.reserve(Pc.size()/4 + 8);
 
-    for (auto& kv : buckets) {
-      std::array<double,8> p8;
-      for (int i=0;i<8;++i) {
-        double v = kv.second[i];
-        if (!(v >= 0.0 && v <= 1.0)) v = p_unknown;
-        p8[i] = v;
+      for (const auto& kv : Pc) {
+        // absent children stay 0 (value-initialized, or the p = 0 code)
+        auto slot = buckets.try_emplace(Traits::parent(kv.first));
+        if constexpr (kLogOdds16) if (slot.second) slot.first->fill(kLogOdds16Min);
+        (*slot.first)[Traits::child_index(kv.first)] = kv.second;
+      }
+
+      Pp.reserve(buckets.size());
+      for (const auto& kv : buckets) {
+        if constexpr (kLogOdds16) {
+          Pp[kv.first] = union_logodds16(kv.second);
+        } else {
+          std::array<double,8> p8;
+          for (int i=0;i<8;++i) {
+            double v = kv.second[i];
+            if (!(v >= 0.0 && v <= 1.0)) v = p_unknown;
+            p8[i] = v;
+          }
+          Pp[kv.first] = union_prob8_stable(p8, p_unknown);
+        }
       }
-      Pp[kv.first] = union_prob8_stable(p8, p_unknown);
     }
+    buckets_arena.release(); // the step's buckets, in bulk
   }
 
   // 3) Emit hierarchy with threshold and evidence guard
@@ -66,29 +109,179 @@ Hierarchy make_hierarchy_from_workers(const std::vector<WorkerOut>& outs,
     if (!use_logodds) return p >= tau;
     return std::log(p/(1.0-p)) >= tau;
   };
-  auto has_child_evidence = [&](const Key3& k, int d)->bool{
-    auto it = P.find(d+1);
-    if (it == P.end()) return false;
-    for (int i=0;i<8;++i) if (it->second.count(childKey(k,i))) return true;
+  auto has_child_evidence = [&](const Key& k, int d)->bool{
+    if (d >= td) return false;
+    for (int i=0;i<8;++i) if (P[(size_t)d+1].contains(Traits::child(k,i))) return true;
     return false;
   };
 
-  Hierarchy H; H.base_depth = base_depth; H.td = td;
-  std::function<void(const Key3&,int)> emit = [&](const Key3& k, int d){
-    double p = P[d].at(k);
+  H.base_depth = base_depth; H.td = td;
+  std::function<void(const Key&,double,int)> emit = [&](const Key& k, double p, int d){
     bool refine_ok = (d < td) && passes(p) && has_child_evidence(k, d);
-    NDKey nd{ k, (uint16_t)d };
+    const NDKey nd = Traits::nd(k);
     if (!refine_ok) { H.nodes[nd] = NodeRec{ p, true }; return; }
     H.nodes[nd] = NodeRec{ p, false };
     for (int i=0;i<8;++i) {
-      Key3 kc = childKey(k,i);
-      auto it = P[d+1].find(kc);
-      if (it != P[d+1].end()) emit(kc, d+1);
+      const Key kc = Traits::child(k,i);
+      if (const Prob* pc = P[(size_t)d+1].find(kc)) emit(kc, to_prob(*pc), d+1);
     }
   };
 
-  for (auto& kv : P[base_depth]) emit(kv.first, base_depth);
+  if (base_depth >= 0 && base_depth <= td) {
+    trace::Scope ts("emit");
+    for (const auto& kv : P[(size_t)base_depth]) emit(kv.first, to_prob(kv.second), base_depth);
+  }
+  trace::count("nodes_emitted", (int64_t)H.nodes.size());
+  return true;
+}
+
+// 64-bit keys up to depth 19 unless a coordinate is too wide for them, 128-bit otherwise
+template <class Prob>
+Hierarchy build_hierarchy(const std::vector<WorkerOut>& outs, double tau, bool use_logodds,
+                          double p_unknown, int base_depth, std::pmr::memory_resource* scratch)
+{
+  int td = 0;
+  size_t largest = 0;
+  for (auto& o : outs) { td = std::max(td, o.td); largest = std::max(largest, o.Ptd.size()); }
+
+  Hierarchy H;
+  if (td <= KeyTraits<19>::kMaxDepth &&
+      build_hierarchy<KeyTraits<19>, Prob>(outs, td, largest, tau, use_logodds, p_unknown, base_depth, scratch, H))
+    return H;
+  H = Hierarchy{};
+  build_hierarchy<KeyTraits<32>, Prob>(outs, td, largest, tau, use_logodds, p_unknown, base_depth, scratch, H);
   return H;
 }
 
+} // namespace
+
+Hierarchy make_hierarchy_from_workers(const std::vector<WorkerOut>& outs,
+                                      double tau, bool use_logodds,
+                                      double p_unknown, int base_depth,
+                                      std::pmr::memory_resource* scratch,
+                                      ProbStorage storage)
+{
+  if (storage == ProbStorage::logodds16)
+    return build_hierarchy<int16_t>(outs, tau, use_logodds, p_unknown, base_depth, scratch);
+  return build_hierarchy<double>(outs, tau, use_logodds, p_unknown, base_depth, scratch);
+}
+
+HierarchyBuilder::HierarchyBuilder(int td, double tau, bool use_logodds,
+                                   double p_unknown, int base_depth,
+                                   std::pmr::memory_resource* scratch)
+  : td_(std::max(td, 0)), tau_(tau), use_logodds_(use_logodds), p_unknown_(p_unknown),
+    base_depth_(base_depth), scratch_(scratch), P_((size_t)std::max(td, 0) + 1)
+{
+  H_.base_depth = base_depth; H_.td = td_;
+}
+
+void HierarchyBuilder::set(const Key3& k, double p) {
+  P_[(size_t)td_][k] = std::clamp(p, 0.0, 1.0);
+  pending_.push_back(k);
+}
+
+void HierarchyBuilder::erase(const Key3& k) {
+  if (P_[(size_t)td_].erase(k)) pending_.push_back(k);
+}
+
+size_t HierarchyBuilder::refresh(std::vector<NDKey>* changed, std::vector<LeafDelta>* leaf_deltas) {
+  if (pending_.empty()) return 0;
+  trace::Scope ts("hierarchy_refresh");
+  using KeySet = std::pmr::unordered_set<Key3,Key3Hash>;
+  // dirty[d]: keys at depth d whose probability may have changed, appeared or vanished;
+  // all of them live in one arena dropped at return
+  std::pmr::monotonic_buffer_resource arena(scratch_ ? scratch_ : std::pmr::get_default_resource());
+  std::pmr::vector<KeySet> dirty(&arena);
+  dirty.reserve((size_t)td_ + 1);
+  for (int d=0; d<=td_; ++d) dirty.emplace_back();
+  dirty[(size_t)td_].insert(pending_.begin(), pending_.end());
+  pending_.clear();
+
+  // 1) Roll the edits up, recomputing each affected parent from its 8 children exactly as
+  //    make_hierarchy_from_workers does (absent children contribute 0)
+  for (int d = td_-1; d >= base_depth_ && d >= 0; --d) {
+    const Level& Pc = P_[(size_t)d+1];
+    Level& Pp = P_[(size_t)d];
+    KeySet& up = dirty[(size_t)d];
+    for (const Key3& kc : dirty[(size_t)d+1]) up.insert(parent_key(kc));
+    for (const Key3& kp : up) {
+      std::array<double,8> p8{};
+      bool any = false;
+      for (int i=0;i<8;++i) {
+        auto it = Pc.find(child_key(kp,i));
+        if (it == Pc.end()) continue;
+        p8[i] = it->second; any = true;
+      }
+      if (!any) { Pp.erase(kp); continue; }
+      for (int i=0;i<8;++i) if (!(p8[i] >= 0.0 && p8[i] <= 1.0)) p8[i] = p_unknown_;
+      Pp[kp] = union_prob8_stable(p8, p_unknown_);
+    }
+  }
+  if (base_depth_ > td_ || base_depth_ < 0) return 0;
+
+  // 2) Re-emit below dirty keys, with the threshold and evidence guard of the batch build
+  size_t count = 0;
+  auto touch = [&](const NDKey& nd) { ++count; if (changed) changed->push_back(nd); };
+  auto passes = [&](double p)->bool{
+    if (!use_logodds_) return p >= tau_;
+    return std::log(p/(1.0-p)) >= tau_;
+  };
+  auto has_child_evidence = [&](const Key3& k, int d)->bool{
+    if (d >= td_) return false;
+    for (int i=0;i<8;++i) if (P_[(size_t)d+1].count(child_key(k,i))) return true;
+    return false;
+  };
+  std::function<void(const Key3&,int)> erase_subtree = [&](const Key3& k, int d){
+    auto it = H_.nodes.find(NDKey{ k, (uint16_t)d });
+    if (it == H_.nodes.end()) return;
+    const bool leaf = it->second.is_leaf;
+    if (leaf_deltas && d == td_) leaf_deltas->push_back(LeafDelta{ k, -1, -it->second.p });
+    H_.nodes.erase(it); touch(NDKey{ k, (uint16_t)d });
+    if (!leaf) for (int i=0;i<8;++i) erase_subtree(child_key(k,i), d+1);
+  };
+  std::function<void(const Key3&,int)> emit = [&](const Key3& k, int d){
+    double p = P_[(size_t)d].at(k);
+    bool refine_ok = (d < td_) && passes(p) && has_child_evidence(k, d);
+    NDKey nd{ k, (uint16_t)d };
+    touch(nd);
+    if (!refine_ok) {
+      if (leaf_deltas && d == td_) {
+        auto it = H_.nodes.find(nd);
+        const bool existed = it != H_.nodes.end();
+        leaf_deltas->push_back(LeafDelta{ k, existed ? 0 : 1, existed ? p - it->second.p : p });
+      }
+      H_.nodes[nd] = NodeRec{ p, true };
+      return;
+    }
+    H_.nodes[nd] = NodeRec{ p, false };
+    for (int i=0;i<8;++i) {
+      Key3 kc = child_key(k,i);
+      if (P_[(size_t)d+1].count(kc)) emit(kc, d+1);
+    }
+  };
+  std::function<void(const Key3&,int)> update = [&](const Key3& k, int d){
+    NDKey nd{ k, (uint16_t)d };
+    auto pit = P_[(size_t)d].find(k);
+    auto hit = H_.nodes.find(nd);
+    if (pit == P_[(size_t)d].end()) { erase_subtree(k, d); return; }
+    const double p = pit->second;
+    const bool refine_ok = (d < td_) && passes(p) && has_child_evidence(k, d);
+    if (hit == H_.nodes.end() || hit->second.is_leaf || !refine_ok) {
+      // New node or a changed refinement decision: rebuild the subtree
+      if (hit != H_.nodes.end() && !hit->second.is_leaf)
+        for (int i=0;i<8;++i) erase_subtree(child_key(k,i), d+1);
+      emit(k, d);
+      return;
+    }
+    // Still refined: update in place and descend only into dirty children
+    hit->second.p = p; touch(nd);
+    for (int i=0;i<8;++i) {
+      Key3 kc = child_key(k,i);
+      if (dirty[(size_t)d+1].count(kc)) update(kc, d+1);
+    }
+  };
+  for (const Key3& k : dirty[(size_t)base_depth_]) update(k, base_depth_);
+  return count;
+}
+
 } // namespace octoweave
@@ -0,0 +1,104 @@
+#include "octoweave/arrow_points.hpp"
+#include <cstring>
+
+namespace octoweave {
+
+namespace {
+
+bool fail(std::string* err, const std::string& msg) {
+  if (err) *err = msg;
+  return false;
+}
+
+// Child index of the column named `name` in a struct schema, or -1
+int64_t find_child(const ArrowSchema& schema, const char* name) {
+  for (int64_t i=0; i<schema.n_children; ++i) {
+    const ArrowSchema* c = schema.children[i];
+    if (c && c->name && std::strcmp(c->name, name) == 0) return i;
+  }
+  return -1;
+}
+
+// Validity buffer present with nulls (or an unknown null count) cannot be read in place
+bool may_have_nulls(const ArrowArray& a) {
+  return a.null_count != 0 && a.n_buffers > 0 && a.buffers && a.buffers[0];
+}
+
+// Releases a producer-owned struct on scope exit
+template <class T>
+struct Released {
+  T v{};
+  ~Released() { if (v.release) v.release(&v); }
+};
+
+} // namespace
+
+bool arrow_point_span(const ArrowSchema& schema, const ArrowArray& batch,
+                      const ArrowColumns& cols, PointSpan& out, std::string* err)
+{
+  if (!schema.format || std::strcmp(schema.format, "+s") != 0)
+    return fail(err, "arrow: expected a struct array (record batch)");
+  if (batch.n_children != schema.n_children)
+    return fail(err, "arrow: schema and array children differ");
+  if (may_have_nulls(batch)) return fail(err, "arrow: null rows are not supported");
+
+  const char* names[3] = { cols.x, cols.y, cols.z };
+  const void* data[3];
+  char type = 0;
+  for (int k=0; k<3; ++k) {
+    const int64_t i = find_child(schema, names[k]);
+    if (i < 0) return fail(err, std::string("arrow: missing column '") + names[k] + "'");
+    const char* f = schema.children[i]->format;
+    if (!f || (std::strcmp(f, "f") != 0 && std::strcmp(f, "g") != 0))
+      return fail(err, std::string("arrow: column '") + names[k] + "' is not float32/float64");
+    if (type && f[0] != type) return fail(err, "arrow: x, y, z columns differ in type");
+    type = f[0];
+    const ArrowArray* c = batch.children[i];
+    if (!c || c->n_buffers != 2) return fail(err, "arrow: malformed column array");
+    if (may_have_nulls(*c))
+      return fail(err, std::string("arrow: column '") + names[k] + "' has nulls");
+    const size_t size = type == 'f' ? sizeof(float) : sizeof(double);
+    const char* values = static_cast<const char*>(c->buffers[1]);
+    if (!values && batch.length > 0) return fail(err, "arrow: missing value buffer");
+    // Struct and child offsets both shift into the child's values
+    data[k] = values ? values + (size_t)(batch.offset + c->offset) * size : nullptr;
+  }
+  const size_t n = batch.length > 0 ? (size_t)batch.length : 0;
+  if (type == 'f')
+    out = PointSpan::columns(static_cast<const float*>(data[0]), static_cast<const float*>(data[1]),
+                             static_cast<const float*>(data[2]), n);
+  else
+    out = PointSpan::columns(static_cast<const double*>(data[0]), static_cast<const double*>(data[1]),
+                             static_cast<const double*>(data[2]), n);
+  return true;
+}
+
+long consume_arrow_stream(ArrowArrayStream* stream, const ArrowColumns& cols,
+                          const std::function<void(const PointSpan&)>& fn, std::string* err)
+{
+  if (!stream || !stream->release) { fail(err, "arrow: released or null stream"); return -1; }
+  Released<ArrowArrayStream> owned;
+  owned.v = *stream; stream->release = nullptr; // moved: the caller's struct is now released
+  ArrowArrayStream* s = &owned.v;
+  auto stream_error = [&](const char* what) {
+    const char* msg = s->get_last_error ? s->get_last_error(s) : nullptr;
+    fail(err, std::string("arrow: ") + what + (msg ? std::string(": ") + msg : std::string()));
+    return -1L;
+  };
+
+  Released<ArrowSchema> schema;
+  if (s->get_schema(s, &schema.v) != 0) return stream_error("get_schema failed");
+  long batches = 0;
+  for (;;) {
+    Released<ArrowArray> batch;
+    if (s->get_next(s, &batch.v) != 0) return stream_error("get_next failed");
+    if (!batch.v.release) break; // end of stream
+    PointSpan span;
+    if (!arrow_point_span(schema.v, batch.v, cols, span, err)) return -1;
+    if (span.size()) fn(span);
+    ++batches;
+  }
+  return batches;
+}
+
+} // namespace octoweave
@@ -0,0 +1,225 @@
+#include "octoweave/csv.hpp"
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define OCTOWEAVE_CSV_MMAP 1
+#else
+#include <fstream>
+#include <iterator>
+#endif
+
+namespace octoweave {
+
+namespace {
+
+// Read-only view of the whole file: mmap where available, otherwise a heap copy
+class FileView {
+public:
+  bool open(const std::string& path) {
+#ifdef OCTOWEAVE_CSV_MMAP
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (::fstat(fd, &st) != 0) { ::close(fd); return false; }
+    size_ = (size_t) st.st_size;
+    if (size_ > 0) {
+      void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p == MAP_FAILED) { ::close(fd); return false; }
+#ifdef MADV_SEQUENTIAL
+      ::madvise(p, size_, MADV_SEQUENTIAL);
+#endif
+      map_ = p;
+      data_ = static_cast<const char*>(p);
+    }
+    ::close(fd);
+    return true;
+#else
+    std::ifstream f(path, std::ios::binary);
+    if (!f) return false;
+    buf_.assign(std::istreambuf_iterator<char>(f), {});
+    data_ = buf_.data(); size_ = buf_.size();
+    return true;
+#endif
+  }
+  ~FileView() {
+#ifdef OCTOWEAVE_CSV_MMAP
+    if (map_) ::munmap(map_, size_);
+#endif
+  }
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+
+private:
+  const char* data_ = nullptr;
+  size_t size_ = 0;
+#ifdef OCTOWEAVE_CSV_MMAP
+  void* map_ = nullptr;
+#else
+  std::string buf_;
+#endif
+};
+
+inline const char* skip_blanks(const char* p, const char* e) {
+  while (p < e && (*p == ' ' || *p == '\t')) ++p;
+  return p;
+}
+
+// Field parsers advance `p` past the value and an optional trailing comma
+template <typename T>
+inline bool parse_int(const char*& p, const char* e, T& v) {
+  p = skip_blanks(p, e);
+  if (p < e && *p == '+') ++p;
+  auto r = std::from_chars(p, e, v);
+  if (r.ec != std::errc()) return false;
+  p = skip_blanks(r.ptr, e);
+  if (p < e && *p == ',') ++p;
+  return true;
+}
+
+inline bool parse_double(const char*& p, const char* e, double& v) {
+  p = skip_blanks(p, e);
+  if (p < e && *p == '+') ++p;
+#if defined(__cpp_lib_to_chars) && __cpp_lib_to_chars >= 201611L
+  auto r = std::from_chars(p, e, v);
+  if (r.ec != std::errc()) return false;
+  p = r.ptr;
+#else
+  // strtod needs a terminated copy; the mapping has no terminator at end of file
+  char tmp[64];
+  size_t n = 0;
+  while (p + n < e && n + 1 < sizeof(tmp) && p[n] != ',' && p[n] != '\n' && p[n] != '\r') { tmp[n] = p[n]; ++n; }
+  tmp[n] = '\0';
+  char* end = nullptr;
+  v = std::strtod(tmp, &end);
+  if (end == tmp) return false;
+  p += (end - tmp);
+#endif
+  p = skip_blanks(p, e);
+  if (p < e && *p == ',') ++p;
+  return true;
+}
+
+struct RangeOut {
+  std::vector<CsvLeaf> leaves;
+  std::map<int, size_t> counts;
+  size_t rows = 0;
+  bool ok = true;
+};
+
+// Membership test for a set of non-negative values: a flat table for small values, a
+// sorted list otherwise. An empty set keeps everything.
+struct ValueSet {
+  static constexpr int64_t kTableMax = int64_t(1) << 20;
+  std::vector<char> bits;
+  std::vector<int64_t> sorted;
+  bool active = false;
+  template <typename T>
+  explicit ValueSet(const std::vector<T>& vals) {
+    active = !vals.empty();
+    for (T v : vals) if (v >= 0) sorted.push_back((int64_t)v);
+    std::sort(sorted.begin(), sorted.end());
+    if (!sorted.empty() && sorted.back() < kTableMax) {
+      bits.assign((size_t)sorted.back() + 1, 0);
+      for (int64_t v : sorted) bits[(size_t)v] = 1;
+      sorted.clear();
+    }
+  }
+  bool keep(int64_t v) const {
+    if (!active) return true;
+    if (v < 0) return false;
+    if (!bits.empty()) return (size_t)v < bits.size() && bits[(size_t)v];
+    return std::binary_search(sorted.begin(), sorted.end(), v);
+  }
+};
+
+void parse_range(const char* b, const char* e, const CsvReadOptions& opt, RangeOut& out) {
+  const ValueSet depth_set(opt.depths), slice_set(opt.slices);
+  // depth -> count; depths are small so a flat table avoids map lookups per row
+  std::vector<size_t> counts;
+  const char* p = b;
+  while (p < e) {
+    const char* nl = static_cast<const char*>(std::memchr(p, '\n', (size_t)(e - p)));
+    const char* le = nl ? nl : e;
+    const char* line_end = le;
+    if (line_end > p && line_end[-1] == '\r') --line_end;
+    const char* q = skip_blanks(p, line_end);
+    if (q < line_end) {
+      CsvLeaf r{};
+      if (!parse_int(q, line_end, r.x) || !parse_int(q, line_end, r.y) || !parse_int(q, line_end, r.z) ||
+          !parse_int(q, line_end, r.d) || !parse_double(q, line_end, r.p)) {
+        out.ok = false;
+        return;
+      }
+      ++out.rows;
+      if (r.d >= 0 && r.d < 4096) {
+        if ((size_t)r.d >= counts.size()) counts.resize((size_t)r.d + 1, 0);
+        ++counts[(size_t)r.d];
+      } else {
+        ++out.counts[r.d];
+      }
+      if ((opt.depth < 0 || r.d == opt.depth) && (opt.slice_z < 0 || (int64_t)r.z == opt.slice_z) &&
+          depth_set.keep(r.d) && slice_set.keep((int64_t)r.z))
+        out.leaves.push_back(r);
+    }
+    p = le + 1;
+  }
+  for (size_t d=0; d<counts.size(); ++d) if (counts[d]) out.counts[(int)d] += counts[d];
+}
+
+} // namespace
+
+bool read_leaves_csv(const std::string& path, const CsvReadOptions& opt, CsvReadResult& out) {
+  out = CsvReadResult{};
+  FileView f;
+  if (!f.open(path)) return false;
+  const char* data = f.data();
+  const size_t size = f.size();
+  if (size == 0) return true;
+
+  // Automatic: about one range per 4 MiB, capped by the hardware threads
+  constexpr size_t kMinRange = size_t(4) << 20;
+  size_t T = opt.threads > 0 ? (size_t)opt.threads
+                             : std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()),
+                                                (size + kMinRange - 1) / kMinRange);
+  T = std::max<size_t>(1, std::min(T, size));
+
+  // Line-aligned boundaries: each range starts right after a newline
+  std::vector<const char*> cut(T + 1);
+  cut[0] = data; cut[T] = data + size;
+  for (size_t t=1; t<T; ++t) {
+    const char* guess = data + size * t / T;
+    if (guess < cut[t-1]) guess = cut[t-1];
+    const char* nl = static_cast<const char*>(std::memchr(guess, '\n', (size_t)(data + size - guess)));
+    cut[t] = nl ? nl + 1 : data + size;
+  }
+
+  std::vector<RangeOut> parts(T);
+  if (T == 1) {
+    parse_range(cut[0], cut[1], opt, parts[0]);
+  } else {
+    std::vector<std::thread> threads; threads.reserve(T);
+    for (size_t t=0; t<T; ++t)
+      threads.emplace_back([&, t]{ parse_range(cut[t], cut[t+1], opt, parts[t]); });
+    for (auto& th : threads) th.join();
+  }
+
+  size_t total = 0;
+  for (const auto& r : parts) { if (!r.ok) return false; total += r.leaves.size(); }
+  out.leaves.reserve(total);
+  for (auto& r : parts) {
+    out.leaves.insert(out.leaves.end(), r.leaves.begin(), r.leaves.end());
+    for (const auto& kv : r.counts) out.depth_counts[kv.first] += kv.second;
+    out.rows += r.rows;
+  }
+  return true;
+}
+
+} // namespace octoweave
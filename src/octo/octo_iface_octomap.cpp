@@ -1,45 +1,101 @@
 #ifdef OCTOWEAVE_WITH_OCTOMAP
 #include "octoweave/octo_iface.hpp"
+#include "octoweave/flat_map.hpp"
 #include <octomap/OcTree.h>
+#include <algorithm>
+#include <cmath>
+#include <istream>
+#include <ostream>
 
 namespace octoweave {
 
-WorkerOut OctoChunker::build_and_export(const std::vector<Pt>& pts, const Params& p) {
-  octomap::OcTree tree(p.res);
-  tree.setProbHit(p.prob_hit);
-  tree.setProbMiss(p.prob_miss);
-  tree.setClampingThresMin(p.clamp_min);
-  tree.setClampingThresMax(p.clamp_max);
+// OcTree keys are 16 bits per axis
+static constexpr int kTreeDepth = 16;
 
-  // Insert point cloud with free-space ray updates from the given origin
+struct ChunkState::Impl {
+  OctoChunker::Params p;
+  octomap::OcTree tree;
+  explicit Impl(const OctoChunker::Params& p_) : p(p_), tree(p_.res) {
+    tree.setProbHit(p.prob_hit);
+    tree.setProbMiss(p.prob_miss);
+    tree.setClampingThresMin(p.clamp_min);
+    tree.setClampingThresMax(p.clamp_max);
+  }
+};
+
+ChunkState::ChunkState(const OctoChunker::Params& p) : impl_(new Impl(p)) {}
+ChunkState::~ChunkState() = default;
+
+size_t ChunkState::insert(const PointSpan& pts, const Pt& o) {
+  const OctoChunker::Params& p = impl_->p;
+  octomap::OcTree& tree = impl_->tree;
+  // Optionally collapse points sharing a voxel first: each remaining point is one ray cast
+  VoxelFiltered vf;
+  const bool filter = p.prefilter_res > 0.0;
+  if (filter) vf = voxel_filter(pts, p.prefilter_res, p.prefilter_threads);
+  const PointSpan in = filter ? PointSpan(vf.points) : pts;
+  // Insert point cloud with free-space ray updates from the given origin. The float cloud
+  // is the only copy: points are read from the span in place.
   octomap::Pointcloud cloud;
-  cloud.reserve(pts.size());
-  for (const auto& pt : pts) {
+  cloud.reserve(in.size());
+  for (size_t i=0; i<in.size(); ++i) {
+    const Pt pt = in[i];
     cloud.push_back((float)pt.x, (float)pt.y, (float)pt.z);
   }
-  octomap::point3d origin((float)p.origin.x, (float)p.origin.y, (float)p.origin.z);
+  octomap::point3d origin((float)o.x, (float)o.y, (float)o.z);
   double maxrange = p.max_range > 0.0 ? p.max_range : -1.0;
   tree.insertPointCloud(cloud, origin, maxrange, p.lazy_eval, p.discretize);
+  if (filter && p.prefilter_weighted) {
+    // The ray above carried one hit; the representative's other points add theirs
+    for (size_t i=0; i<cloud.size(); ++i) {
+      if (vf.weights[i] < 2) continue;
+      if (maxrange > 0.0 && (cloud[i] - origin).norm() > maxrange) continue;
+      for (uint32_t h=1; h<vf.weights[i]; ++h) tree.updateNode(cloud[i], true, p.lazy_eval);
+    }
+  }
   tree.updateInnerOccupancy();
+  return vf.removed;
+}
 
-  // Determine emission depth from desired resolution with a safety cap.
-  const int td_tree = (int) tree.getTreeDepth();
-  const double res_tree = tree.getResolution();
-  int d_cap = p.max_depth_cap > 0 ? std::min(p.max_depth_cap, td_tree) : td_tree;
-  int d_emit = d_cap;
-  if (p.emit_res > 0.0) {
-    double ratio = p.emit_res / res_tree;
-    if (ratio > 1.0) {
-      int shift = (int)std::floor(std::log2(ratio));
-      d_emit = std::max(d_cap - shift, 0);
+void ChunkState::insert_segments(const RaySegment* segs, size_t n) {
+  const OctoChunker::Params& p = impl_->p;
+  octomap::OcTree& tree = impl_->tree;
+  octomap::KeySet free_cells, occupied_cells;
+  octomap::KeyRay ray;
+  // One update per scan, with OcTree::insertPointCloud's rules: a ray frees the cells up to
+  // (not including) its end cell, and cells hit in the same scan are not freed
+  for (size_t i=0; i<n; ) {
+    const uint32_t scan = segs[i].scan;
+    free_cells.clear(); occupied_cells.clear();
+    for (; i<n && segs[i].scan == scan; ++i) {
+      const RaySegment& s = segs[i];
+      const octomap::point3d a((float)s.a.x, (float)s.a.y, (float)s.a.z);
+      const octomap::point3d b((float)s.b.x, (float)s.b.y, (float)s.b.z);
+      if (tree.computeRayKeys(a, b, ray)) free_cells.insert(ray.begin(), ray.end());
+      octomap::OcTreeKey end;
+      if (s.terminal && tree.coordToKeyChecked(b, end)) occupied_cells.insert(end);
     }
+    for (const auto& k : free_cells)
+      if (!occupied_cells.count(k)) tree.updateNode(k, false, p.lazy_eval);
+    for (const auto& k : occupied_cells) tree.updateNode(k, true, p.lazy_eval);
   }
+  tree.updateInnerOccupancy();
+}
+
+WorkerOut ChunkState::export_worker() const {
+  const octomap::OcTree& tree = impl_->tree;
+  // Determine emission depth from desired resolution with a safety cap.
+  const int td_tree = (int) tree.getTreeDepth();
+  const int d_emit = OctoChunker::emit_depth(impl_->p);
 
   WorkerOut out;
   out.td = d_emit;
   const int shift = td_tree - d_emit;
 
-  // Export probabilities aggregated to the target emission depth
+  // Export probabilities aggregated to the target emission depth; 16-bit keys pack into
+  // Morton codes for the accumulation table
+  FlatMap<uint64_t, double> acc;
+  acc.reserve(tree.getNumLeafNodes());
   for (auto it = tree.begin_leafs(); it != tree.end_leafs(); ++it) {
     octomap::OcTreeKey key;
     if (!tree.coordToKeyChecked(it.getCoordinate(), key)) continue;
@@ -47,14 +103,74 @@ WorkerOut OctoChunker::build_and_export(const std::vector<Pt>& pts, const Params
     uint32_t ky = key.k[1];
     uint32_t kz = key.k[2];
     if (shift > 0) { kx >>= shift; ky >>= shift; kz >>= shift; }
-    Key3 k{ kx, ky, kz };
     double prob = it->getOccupancy();
-    double &slot = out.Ptd[k];
+    double &slot = acc[morton_encode(Key3{ kx, ky, kz })];
     slot = 1.0 - (1.0 - slot) * (1.0 - prob);
   }
+  out.Ptd.reserve(acc.size());
+  for (const auto& kv : acc) out.Ptd.emplace(morton_decode(kv.first), kv.second);
   return out;
 }
 
+size_t ChunkState::memory_bytes() const { return sizeof(Impl) + impl_->tree.memoryUsage(); }
+
+// OctoMap chunk file: magic, a non-empty flag, then OcTree::writeData (per-node log-odds and
+// child masks, no header)
+static constexpr uint32_t kOctoMagic = 0x314f574f; // "OWO1"
+
+bool ChunkState::save(std::ostream& os) const {
+  const uint8_t has_root = impl_->tree.size() > 0 ? 1 : 0;
+  os.write(reinterpret_cast<const char*>(&kOctoMagic), sizeof(kOctoMagic));
+  os.write(reinterpret_cast<const char*>(&has_root), sizeof(has_root));
+  if (has_root) impl_->tree.writeData(os);
+  return (bool)os;
+}
+
+bool ChunkState::load(std::istream& is) {
+  impl_->tree.clear();
+  uint32_t magic = 0;
+  uint8_t has_root = 0;
+  is.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  is.read(reinterpret_cast<char*>(&has_root), sizeof(has_root));
+  if (!is || magic != kOctoMagic) return false;
+  if (!has_root) return true;
+  impl_->tree.readData(is);
+  if (!is) { impl_->tree.clear(); return false; }
+  return true;
+}
+
+WorkerOut OctoChunker::build_and_export(const PointSpan& pts, const Params& p) {
+  ChunkState state(p);
+  state.insert(pts, p.origin);
+  return state.export_worker();
+}
+
+int OctoChunker::emit_depth(const Params& p) {
+  const int td_tree = kTreeDepth;
+  int d_cap = p.max_depth_cap > 0 ? std::min(p.max_depth_cap, td_tree) : td_tree;
+  int d_emit = d_cap;
+  if (p.emit_res > 0.0) {
+    double ratio = p.emit_res / p.res;
+    if (ratio > 1.0) {
+      int shift = (int)std::floor(std::log2(ratio));
+      d_emit = std::max(d_cap - shift, 0);
+    }
+  }
+  return d_emit;
+}
+
+Key3 OctoChunker::coord_to_key(const Pt& pt, const Params& p, int depth) {
+  // Same discretization as OcTreeBaseImpl::coordToKey, then shifted to `depth`
+  const double inv = 1.0 / p.res;
+  const int max_val = 1 << (kTreeDepth - 1);
+  auto axis = [&](double c) -> uint32_t {
+    long long k = (long long)std::floor(inv * c) + max_val;
+    k = std::clamp<long long>(k, 0, (1LL << kTreeDepth) - 1);
+    return (uint32_t)k >> std::max(0, kTreeDepth - depth);
+  };
+  return Key3{ axis(pt.x), axis(pt.y), axis(pt.z) };
+}
+
 } // namespace octoweave
 
 #endif // OCTOWEAVE_WITH_OCTOMAP
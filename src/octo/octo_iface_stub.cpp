@@ -1,5 +1,7 @@
 #include "octoweave/octo_iface.hpp"
-#include <unordered_map>
+#include "octoweave/flat_map.hpp"
+#include <istream>
+#include <ostream>
 
 namespace octoweave {
 
@@ -15,18 +17,118 @@ public:
 };
 
 #ifndef OCTOWEAVE_WITH_OCTOMAP
-WorkerOut OctoChunker::build_and_export(const std::vector<Pt>& pts, const Params& p) {
-  // Stub: place points in a trivial grid cell and accumulate with a simple union
-  (void) p;
-  WorkerOut out; out.td = p.max_depth_cap > 0 ? p.max_depth_cap : 8;
-  for (auto& pt : pts) {
-    Key3 k{ (uint32_t)(pt.x), (uint32_t)(pt.y), (uint32_t)(pt.z) };
-    double &slot = out.Ptd[k];
+using StubCells = FlatMap<Key3, double>;
+
+// Stub: place points in a trivial grid cell and accumulate with a simple union, one hit per
+// point or `weights[i]` hits
+static void stub_accumulate(StubCells& cells, const PointSpan& pts, const OctoChunker::Params& p,
+                            const uint32_t* weights = nullptr) {
+  const int td = OctoChunker::emit_depth(p);
+  for (size_t i=0; i<pts.size(); ++i) {
+    Key3 k = OctoChunker::coord_to_key(pts[i], p, td);
+    double &slot = cells[k];
     double p1 = 0.7; // pretend-hit
-    slot = 1.0 - (1.0 - slot) * (1.0 - p1);
+    for (uint32_t h = weights ? weights[i] : 1; h > 0; --h) slot = 1.0 - (1.0 - slot) * (1.0 - p1);
   }
+}
+
+// Accumulate a scan, through the pre-insertion filter when enabled; returns points removed
+static size_t stub_insert(StubCells& cells, const PointSpan& pts, const OctoChunker::Params& p) {
+  if (p.prefilter_res <= 0.0) { stub_accumulate(cells, pts, p); return 0; }
+  const VoxelFiltered vf = voxel_filter(pts, p.prefilter_res, p.prefilter_threads);
+  stub_accumulate(cells, vf.points, p, p.prefilter_weighted ? vf.weights.data() : nullptr);
+  return vf.removed;
+}
+
+static WorkerOut stub_export(const StubCells& cells, const OctoChunker::Params& p) {
+  WorkerOut out; out.td = OctoChunker::emit_depth(p);
+  out.Ptd.reserve(cells.size());
+  for (const auto& kv : cells) out.Ptd.emplace(kv.first, kv.second);
   return out;
 }
+
+WorkerOut OctoChunker::build_and_export(const PointSpan& pts, const Params& p) {
+  StubCells cells;
+  stub_insert(cells, pts, p);
+  return stub_export(cells, p);
+}
+
+struct ChunkState::Impl {
+  OctoChunker::Params p;
+  StubCells cells;
+};
+
+ChunkState::ChunkState(const OctoChunker::Params& p) : impl_(new Impl{ p, StubCells{} }) {}
+ChunkState::~ChunkState() = default;
+
+size_t ChunkState::insert(const PointSpan& pts, const Pt& /*origin: the stub has no rays*/) {
+  return stub_insert(impl_->cells, pts, impl_->p);
+}
+
+void ChunkState::insert_segments(const RaySegment* segs, size_t n) {
+  // No free space in the stub: terminal pieces are its hits
+  std::vector<Pt> hits;
+  for (size_t i=0; i<n; ++i) if (segs[i].terminal) hits.push_back(segs[i].b);
+  stub_accumulate(impl_->cells, hits, impl_->p);
+}
+
+WorkerOut ChunkState::export_worker() const { return stub_export(impl_->cells, impl_->p); }
+
+size_t ChunkState::memory_bytes() const {
+  return sizeof(Impl) + impl_->cells.capacity() * (sizeof(Key3) + sizeof(double) + 1);
+}
+
+// Stub chunk file: magic, cell count, then (x, y, z, p) records
+static constexpr uint32_t kStubMagic = 0x3153574f; // "OWS1"
+
+bool ChunkState::save(std::ostream& os) const {
+  const uint64_t count = impl_->cells.size();
+  os.write(reinterpret_cast<const char*>(&kStubMagic), sizeof(kStubMagic));
+  os.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  for (const auto& kv : impl_->cells) {
+    os.write(reinterpret_cast<const char*>(&kv.first), sizeof(Key3));
+    os.write(reinterpret_cast<const char*>(&kv.second), sizeof(double));
+  }
+  return (bool)os;
+}
+
+bool ChunkState::load(std::istream& is) {
+  impl_->cells = StubCells{};
+  uint32_t magic = 0;
+  uint64_t count = 0;
+  is.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+  is.read(reinterpret_cast<char*>(&count), sizeof(count));
+  if (!is || magic != kStubMagic) return false;
+  StubCells cells;
+  // A corrupt count must not drive the reservation: it is checked against the bytes left
+  // when the stream is seekable, and nothing is reserved otherwise
+  const std::streampos at = is.tellg();
+  if (at != std::streampos(-1)) {
+    is.seekg(0, std::ios::end);
+    const std::streamoff left = is.tellg() - at;
+    is.seekg(at);
+    if (!is || count > (uint64_t)left / (sizeof(Key3) + sizeof(double))) return false;
+    cells.reserve((size_t)count);
+  }
+  for (uint64_t i=0; i<count; ++i) {
+    Key3 k; double p;
+    is.read(reinterpret_cast<char*>(&k), sizeof(Key3));
+    is.read(reinterpret_cast<char*>(&p), sizeof(double));
+    if (!is) return false;
+    cells[k] = p;
+  }
+  impl_->cells = std::move(cells);
+  return true;
+}
+
+int OctoChunker::emit_depth(const Params& p) {
+  return p.max_depth_cap > 0 ? p.max_depth_cap : 8;
+}
+
+Key3 OctoChunker::coord_to_key(const Pt& pt, const Params& /*p*/, int /*depth*/) {
+  // Stub keys are unit voxels regardless of depth
+  return Key3{ (uint32_t)(pt.x), (uint32_t)(pt.y), (uint32_t)(pt.z) };
+}
 #endif
 
 std::unique_ptr<IOctoTree> make_stub_tree_from_worker(const WorkerOut& w) {
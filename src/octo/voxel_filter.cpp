@@ -0,0 +1,79 @@
+#include "octoweave/octo_iface.hpp"
+#include "octoweave/flat_map.hpp"
+#include "octoweave/parallel.hpp"
+#include "octoweave/trace.hpp"
+#include <algorithm>
+#include <cmath>
+
+namespace octoweave {
+
+namespace {
+
+struct VoxelAcc {
+  double x, y, z;   // coordinate sums
+  uint32_t n;
+  size_t first;     // index of the voxel's first point
+};
+using VoxelMap = FlatMap<Key3, VoxelAcc>;
+
+// Points per binning task; fixed so partial sums do not depend on the thread count
+constexpr size_t kSlice = size_t(1) << 16;
+
+// Signed voxel coordinates wrap to 32 bits, which only aliases voxels 2^32 apart
+Key3 voxel_of(const Pt& q, double inv) {
+  auto axis = [inv](double c) { return (uint32_t)(int64_t)std::floor(c * inv); };
+  return Key3{ axis(q.x), axis(q.y), axis(q.z) };
+}
+
+} // namespace
+
+VoxelFiltered voxel_filter(const PointSpan& pts, double res, int threads) {
+  trace::Scope ts("prefilter");
+  VoxelFiltered out;
+  const size_t N = pts.size();
+  if (N == 0 || !(res > 0.0)) return out;
+  const double inv = 1.0 / res;
+
+  const size_t slices = (N + kSlice - 1) / kSlice;
+  std::vector<VoxelMap> part(slices);
+  parallel_for_index((int)slices, [&](int s) {
+    VoxelMap& m = part[(size_t)s];
+    const size_t b = (size_t)s * kSlice, e = std::min(N, b + kSlice);
+    for (size_t i=b; i<e; ++i) {
+      const Pt q = pts[i];
+      auto slot = m.try_emplace(voxel_of(q, inv));
+      VoxelAcc& a = *slot.first;
+      if (slot.second) a.first = i;
+      a.x += q.x; a.y += q.y; a.z += q.z; ++a.n;
+    }
+  }, threads);
+
+  // Fold the slices in order: earlier slices hold the earlier first appearances
+  VoxelMap& all = part[0];
+  for (size_t s=1; s<slices; ++s) {
+    for (const auto& kv : part[s]) {
+      auto slot = all.try_emplace(kv.first);
+      VoxelAcc& a = *slot.first;
+      if (slot.second) a.first = kv.second.first;
+      a.x += kv.second.x; a.y += kv.second.y; a.z += kv.second.z; a.n += kv.second.n;
+    }
+    part[s] = VoxelMap{};
+  }
+
+  std::vector<VoxelAcc> voxels;
+  voxels.reserve(all.size());
+  for (const auto& kv : all) voxels.push_back(kv.second);
+  std::sort(voxels.begin(), voxels.end(),
+            [](const VoxelAcc& a, const VoxelAcc& b) { return a.first < b.first; });
+  out.points.reserve(voxels.size());
+  out.weights.reserve(voxels.size());
+  for (const VoxelAcc& a : voxels) {
+    out.points.push_back(Pt{ a.x / a.n, a.y / a.n, a.z / a.n });
+    out.weights.push_back(a.n);
+  }
+  out.removed = N - voxels.size();
+  trace::count("points_prefiltered", (int64_t)out.removed);
+  return out;
+}
+
+} // namespace octoweave
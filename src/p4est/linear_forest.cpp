@@ -0,0 +1,128 @@
+#include "linear_forest.hpp"
+#include <algorithm>
+
+namespace octoweave { namespace detail {
+
+namespace {
+  inline uint64_t spread3(uint32_t v) {
+    uint64_t x = v & 0x1fffff;
+    x = (x | x << 32) & 0x1f00000000ffffULL;
+    x = (x | x << 16) & 0x1f0000ff0000ffULL;
+    x = (x | x << 8)  & 0x100f00f00f00f00fULL;
+    x = (x | x << 4)  & 0x10c30c30c30c30c3ULL;
+    x = (x | x << 2)  & 0x1249249249249249ULL;
+    return x;
+  }
+
+  // Quadrant waiting for a neighbor check during balance
+  struct Pending { size_t tree; uint32_t x, y, z; uint8_t level; };
+}
+
+uint64_t morton3(uint32_t x, uint32_t y, uint32_t z) {
+  return spread3(x) | (spread3(y) << 1) | (spread3(z) << 2);
+}
+
+LinearForest::LinearForest(int n) : n_(n > 0 ? n : 0) {
+  trees_.resize((size_t)n_ * n_ * n_);
+  for (size_t t=0; t<trees_.size(); ++t) set_uniform(t, 0);
+}
+
+size_t LinearForest::num_quadrants() const {
+  size_t total = 0;
+  for (const auto& v : trees_) total += v.size();
+  return total;
+}
+
+void LinearForest::set_uniform(size_t t, int level) {
+  level = std::clamp(level, 0, kMaxLevel);
+  auto& q = trees_[t];
+  q.clear();
+  const uint32_t side = 1u << level;
+  const uint32_t h = kRootLen >> level;
+  q.reserve((size_t)side * side * side);
+  // Cells in Morton order are the de-interleaved bits of 0..8^level-1
+  const uint64_t count = 1ULL << (3 * level);
+  for (uint64_t m = 0; m < count; ++m) {
+    uint32_t x = 0, y = 0, z = 0;
+    for (int b = 0; b < level; ++b) {
+      x |= (uint32_t)((m >> (3*b))     & 1u) << b;
+      y |= (uint32_t)((m >> (3*b + 1)) & 1u) << b;
+      z |= (uint32_t)((m >> (3*b + 2)) & 1u) << b;
+    }
+    q.push_back(LinearQuad{ x*h, y*h, z*h, (uint8_t)level, 0.0, kStaleLeaves });
+  }
+}
+
+size_t LinearForest::find(size_t t, uint32_t x, uint32_t y, uint32_t z) const {
+  const auto& q = trees_[t];
+  const uint64_t code = morton3(x, y, z);
+  auto it = std::upper_bound(q.begin(), q.end(), code, [](uint64_t c, const LinearQuad& a) {
+    return c < morton3(a.x, a.y, a.z);
+  });
+  return it == q.begin() ? 0 : (size_t)(it - q.begin()) - 1;
+}
+
+std::vector<char> LinearForest::balance(const std::vector<char>* seed) {
+  const size_t T = trees_.size();
+  std::vector<char> split_any(T, 0);
+  std::vector<Pending> work;
+  for (size_t t=0; t<T; ++t) {
+    if (seed && (t >= seed->size() || !(*seed)[t])) continue;
+    for (const auto& q : trees_[t]) if (q.level >= 2) work.push_back(Pending{ t, q.x, q.y, q.z, q.level });
+  }
+
+  const int64_t R = (int64_t)kRootLen;
+  std::vector<std::vector<char>> mark(T);
+  std::vector<Pending> next;
+  while (!work.empty()) {
+    next.clear();
+    for (const Pending& w : work) {
+      const int64_t h = (int64_t)(kRootLen >> w.level);
+      const int tx0 = (int)(w.tree % (size_t)n_), ty0 = (int)((w.tree / (size_t)n_) % (size_t)n_), tz0 = (int)(w.tree / ((size_t)n_*n_));
+      bool marked = false;
+      for (int dz=-1; dz<=1; ++dz) for (int dy=-1; dy<=1; ++dy) for (int dx=-1; dx<=1; ++dx) {
+        if (!dx && !dy && !dz) continue;
+        int64_t nx = (int64_t)w.x + dx*h, ny = (int64_t)w.y + dy*h, nz = (int64_t)w.z + dz*h;
+        int tx = tx0, ty = ty0, tz = tz0;
+        if (nx < 0) { nx += R; --tx; } else if (nx >= R) { nx -= R; ++tx; }
+        if (ny < 0) { ny += R; --ty; } else if (ny >= R) { ny -= R; ++ty; }
+        if (nz < 0) { nz += R; --tz; } else if (nz >= R) { nz -= R; ++tz; }
+        if (tx<0 || ty<0 || tz<0 || tx>=n_ || ty>=n_ || tz>=n_) continue;
+        const size_t nt = (size_t)tx + (size_t)n_ * ((size_t)ty + (size_t)n_ * (size_t)tz);
+        // The leaf holding the neighbor's corner covers the whole neighbor cube when coarser
+        const size_t idx = find(nt, (uint32_t)nx, (uint32_t)ny, (uint32_t)nz);
+        if ((int)trees_[nt][idx].level >= (int)w.level - 1) continue;
+        if (mark[nt].empty()) mark[nt].assign(trees_[nt].size(), 0);
+        mark[nt][idx] = 1;
+        marked = true;
+      }
+      // Still too coarse after one split if the level gap exceeded two; check again
+      if (marked) next.push_back(w);
+    }
+
+    for (size_t t=0; t<T; ++t) {
+      if (mark[t].empty()) continue;
+      const auto& old = trees_[t];
+      std::vector<LinearQuad> out;
+      out.reserve(old.size() + 7 * (size_t)std::count(mark[t].begin(), mark[t].end(), 1));
+      for (size_t i=0; i<old.size(); ++i) {
+        const LinearQuad& q = old[i];
+        if (!mark[t][i]) { out.push_back(q); continue; }
+        const uint8_t l = (uint8_t)(q.level + 1);
+        const uint32_t hh = kRootLen >> l;
+        for (uint32_t c = 0; c < 8; ++c) {
+          LinearQuad ch{ q.x + ((c & 1u) ? hh : 0), q.y + ((c & 2u) ? hh : 0), q.z + ((c & 4u) ? hh : 0), l, 0.0, kStaleLeaves };
+          out.push_back(ch);
+          if (l >= 2) next.push_back(Pending{ t, ch.x, ch.y, ch.z, l });
+        }
+      }
+      trees_[t] = std::move(out);
+      mark[t].clear();
+      split_any[t] = 1;
+    }
+    work.swap(next);
+  }
+  return split_any;
+}
+
+} } // namespace octoweave::detail
@@ -0,0 +1,54 @@
+#pragma once
+// Native linear-octree forest used when p4est is not available. Not installed.
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace octoweave { namespace detail {
+
+// Leaf of a linear octree. Coordinates are the lower corner in units of the finest level
+// (tree side = 2^kMaxLevel); mean/leaves match the p4est backend's per-quadrant data.
+struct LinearQuad {
+  uint32_t x, y, z;
+  uint8_t level;
+  double mean;
+  uint32_t leaves;
+};
+
+// Morton code of a lower corner (x in the lowest bit of each triple)
+uint64_t morton3(uint32_t x, uint32_t y, uint32_t z);
+
+// n×n×n brick of complete linear octrees, each kept as a Morton-sorted leaf array.
+class LinearForest {
+public:
+  static constexpr int kMaxLevel = 19;
+  static constexpr uint32_t kRootLen = 1u << kMaxLevel;
+  // Marks quadrants created by set_uniform/balance until their data is refreshed
+  static constexpr uint32_t kStaleLeaves = UINT32_MAX;
+
+  explicit LinearForest(int n);
+
+  int n() const { return n_; }
+  size_t num_trees() const { return trees_.size(); }
+  size_t num_quadrants() const;
+  const std::vector<LinearQuad>& tree(size_t t) const { return trees_[t]; }
+  std::vector<LinearQuad>& tree(size_t t) { return trees_[t]; }
+
+  // Replace tree t by a uniform refinement at `level` (clamped to [0, kMaxLevel])
+  void set_uniform(size_t t, int level);
+
+  // Index of the leaf of tree t containing the finest-level cell (x, y, z)
+  size_t find(size_t t, uint32_t x, uint32_t y, uint32_t z) const;
+
+  // Ripple 2:1 balance across faces, edges and corners, including between trees. Only
+  // quadrants of trees with seed[t] != 0 (all trees when null) are checked initially;
+  // quadrants created by splits are checked in later rounds. Returns per-tree flags of
+  // trees in which quadrants were split.
+  std::vector<char> balance(const std::vector<char>* seed = nullptr);
+
+private:
+  int n_;
+  std::vector<std::vector<LinearQuad>> trees_;
+};
+
+} } // namespace octoweave::detail
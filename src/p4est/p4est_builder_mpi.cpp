@@ -0,0 +1,126 @@
+#if defined(OCTOWEAVE_WITH_P4EST) && defined(OCTOWEAVE_WITH_MPI)
+#include "octoweave/p4est_mpi.hpp"
+#include "octoweave/parallel.hpp"
+#include "p4est_internal.hpp"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+
+#ifndef P4EST_ENABLE_MPI
+#error "OCTOWEAVE_WITH_MPI requires a p4est/sc build configured with MPI"
+#endif
+
+namespace octoweave {
+
+namespace {
+  struct TreeWeightCtx { const std::vector<int>* flat; std::vector<int> weight; };
+
+  int tree_weight_cb(p8est_t* p8, p4est_topidx_t which_tree, p8est_quadrant_t*) {
+    auto* c = static_cast<TreeWeightCtx*>(p8->user_pointer);
+    size_t idx = (size_t)(*c->flat)[(size_t)which_tree];
+    return idx < c->weight.size() ? c->weight[idx] : 1;
+  }
+
+  int leaf_weight_cb(p8est_t*, p4est_topidx_t, p8est_quadrant_t* q) {
+    const auto* d = static_cast<const detail::QuadData*>(q->p.user_data);
+    return 1 + (int) std::min<uint32_t>(d ? d->leaves : 0, INT_MAX - 1);
+  }
+}
+
+P4estBuilder::ForestHandle* build_forest_handle_mpi(
+    const std::function<WorkerOut(int)>& build_chunk,
+    const P4estBuilder::Config& cfg, const MpiBuildOptions& opt, MPI_Comm comm,
+    MpiBuildStats* stats)
+{
+  const int n = cfg.n;
+  if (n <= 0 || cfg.mapping != P4estBuilder::TreeMapping::Block) return nullptr;
+  const size_t T = (size_t)n*n*n;
+  const P4estBuilder::TreeMap tm = cfg.tree_map();
+  MpiBuildStats st;
+
+  p8est_connectivity_t* conn = detail::new_brick(n);
+  if (!conn) return nullptr;
+  // One root quadrant per tree, spread evenly over the ranks
+  p8est_t* p8 = p8est_new_ext(comm, conn, 0, 0, 1, sizeof(detail::QuadData), NULL, NULL);
+  if (!p8) { p8est_connectivity_destroy(conn); return nullptr; }
+  auto* impl = new detail::ForestImpl();
+  impl->conn = conn; impl->forest = p8;
+  impl->flat_of_tree = detail::brick_flat_index(conn, n);
+  auto* handle = new P4estBuilder::ForestHandle();
+  handle->impl = impl;
+
+  // 1) Balance root trees by the caller's cost hints before any chunk is built
+  double t0 = MPI_Wtime();
+  if (opt.chunk_weights.size() == T) {
+    double wmax = 0.0;
+    for (double w : opt.chunk_weights) wmax = std::max(wmax, w);
+    TreeWeightCtx wc{ &impl->flat_of_tree, std::vector<int>(T, 1) };
+    if (wmax > 0.0) {
+      for (size_t i=0;i<T;++i) wc.weight[i] = 1 + (int) std::lround(std::max(0.0, opt.chunk_weights[i]) / wmax * 1.0e6);
+    }
+    p8->user_pointer = &wc;
+    p8est_partition(p8, 0, tree_weight_cb);
+    p8->user_pointer = NULL;
+  }
+
+  // 2) Build the chunks of the local trees into a rank-local hierarchy slice
+  std::vector<int> owned;
+  for (p4est_topidx_t t = p8->first_local_tree; t <= p8->last_local_tree; ++t) {
+    p8est_tree_t* tree = p8est_tree_array_index(p8->trees, t);
+    if (tree->quadrants.elem_count) owned.push_back(impl->flat_of_tree[(size_t)t]);
+  }
+  auto outs = parallel_build_workers((int)owned.size(), [&](int i){ return build_chunk(owned[(size_t)i]); }, opt.threads);
+  Hierarchy H = make_hierarchy_from_workers(outs, opt.tau, opt.use_logodds, opt.p_unknown, opt.base_depth);
+  outs.clear();
+  st.local_chunks = owned.size();
+  double t1 = MPI_Wtime();
+  st.seconds_build = t1 - t0;
+
+  // 3) Global per-tree evidence (n^3 entries, not the hierarchy)
+  auto local = P4estBuilder::tree_stats(H, tm);
+  std::vector<unsigned long long> cnt(T, 0); std::vector<double> sum(T, 0.0);
+  for (size_t i=0;i<T && i<local.size();++i) {
+    cnt[i] = local[i].leaf_count; sum[i] = local[i].prob_sum; st.local_leaves += local[i].leaf_count;
+  }
+  MPI_Allreduce(MPI_IN_PLACE, cnt.data(), (int)T, MPI_UNSIGNED_LONG_LONG, MPI_SUM, comm);
+  MPI_Allreduce(MPI_IN_PLACE, sum.data(), (int)T, MPI_DOUBLE, MPI_SUM, comm);
+  std::vector<P4estBuilder::TreeStats> global(T);
+  std::vector<char> content(T, 0);
+  for (size_t i=0;i<T;++i) { global[i].leaf_count = (size_t)cnt[i]; global[i].prob_sum = sum[i]; content[i] = cnt[i] ? 1 : 0; }
+
+  // 4) Per-tree levels: global policy, or the owner's evaluation against its slice
+  std::vector<int> levels;
+  if (opt.levels_from_stats) {
+    levels = opt.levels_from_stats(global);
+    levels.resize(T, std::max(0, H.td - H.base_depth));
+    for (int& L : levels) L = std::clamp(L, cfg.min_level, cfg.max_level);
+  } else {
+    std::vector<int> mine = P4estBuilder::resolve_levels(H, cfg);
+    levels.assign(T, INT_MIN);
+    for (int t : owned) levels[(size_t)t] = mine[(size_t)t];
+    MPI_Allreduce(MPI_IN_PLACE, levels.data(), (int)T, MPI_INT, MPI_MAX, comm);
+    for (int& L : levels) if (L == INT_MIN) L = cfg.min_level;
+  }
+
+  // 5) Refine and balance; quadrants stay on the rank that built their tree until the
+  //    final partition, so their data comes from the local slice only
+  detail::refine_to_levels(p8, impl->flat_of_tree, content, levels);
+  p8est_balance(p8, P8EST_CONNECT_FULL, NULL);
+  auto agg = detail::aggregate_quadrants(H, tm, levels);
+  detail::fill_quadrant_data(p8, impl->flat_of_tree, levels, agg);
+  agg.clear();
+
+  // 6) Final partition weighted by leaf evidence; p8est moves the quadrant data along
+  p8est_partition(p8, 0, leaf_weight_cb);
+  st.global_quadrants = (size_t) p8->global_num_quadrants;
+  handle->n = n;
+  handle->levels = std::move(levels);
+  handle->stats = std::move(global);
+  st.seconds_forest = MPI_Wtime() - t1;
+  if (stats) *stats = st;
+  return handle;
+}
+
+} // namespace octoweave
+
+#endif // OCTOWEAVE_WITH_P4EST && OCTOWEAVE_WITH_MPI
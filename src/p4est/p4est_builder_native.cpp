@@ -0,0 +1,198 @@
+#include "octoweave/p4est_builder.hpp"
+#include "linear_forest.hpp"
+#include "octoweave/trace.hpp"
+#include <algorithm>
+#include <unordered_map>
+#include <utility>
+
+namespace octoweave {
+
+#ifndef OCTOWEAVE_WITH_P4EST
+using detail::LinearForest;
+using detail::LinearQuad;
+
+void P4estBuilder::prepare_want_sets(const Hierarchy& H, const Config&) {
+  size_t leaves = 0, internals = 0;
+  for (auto& kv : H.nodes) {
+    if (kv.second.is_leaf) ++leaves; else ++internals;
+  }
+  trace::count("want_leaves", (int64_t)leaves);
+  trace::count("want_internals", (int64_t)internals);
+}
+
+namespace {
+
+struct QuadAgg { double sum = 0.0; uint32_t cnt = 0; };
+
+static int clamp_level(int L) { return std::clamp(L, 0, LinearForest::kMaxLevel); }
+
+// Per-quadrant means at each tree's target level, as in the p4est backend: quadrants
+// finer than the target (from balance) share their target-level ancestor's value.
+static void fill_quadrant_data(LinearForest& F, const Hierarchy& H, const P4estBuilder::TreeMap& tm,
+                               const std::vector<int>& levels, const std::vector<char>* only)
+{
+  trace::Scope ts("aggregate");
+  const int n = tm.n;
+  const size_t T = F.num_trees();
+  std::vector<mem::HashMap<uint64_t, QuadAgg, std::hash<uint64_t>, mem::Pool::forest_aggregation>> agg(T);
+  for (const auto& kv : H.nodes) {
+    const NDKey& nd = kv.first; const NodeRec& rec = kv.second;
+    if (!rec.is_leaf || nd.d != (uint16_t)H.td) continue;
+    auto split = P4estBuilder::split_global_to_tree_local(nd.k, nd.d, tm);
+    const Key3& t = split.first; const Key3& local = split.second;
+    size_t tidx = (size_t)t.x + (size_t)n * ((size_t)t.y + (size_t)n * (size_t)t.z);
+    if (tidx >= T || tidx >= levels.size()) continue;
+    if (only && !(*only)[tidx]) continue;
+    int shift = P4estBuilder::tree_local_depth(nd.d, tm) - clamp_level(levels[tidx]); if (shift < 0) shift = 0;
+    QuadAgg& a = agg[tidx][detail::morton3(local.x >> shift, local.y >> shift, local.z >> shift)];
+    a.sum += rec.p; a.cnt += 1;
+  }
+  for (size_t t=0; t<T; ++t) {
+    if (only && !(*only)[t]) continue;
+    const int s = LinearForest::kMaxLevel - clamp_level(t < levels.size() ? levels[t] : 0);
+    for (LinearQuad& q : F.tree(t)) {
+      auto it = agg[t].find(detail::morton3(q.x >> s, q.y >> s, q.z >> s));
+      if (it == agg[t].end()) { q.mean = 0.0; q.leaves = 0; }
+      else { q.mean = it->second.sum / (double) it->second.cnt; q.leaves = it->second.cnt; }
+    }
+  }
+}
+
+} // namespace
+
+int P4estBuilder::build_forest(const Hierarchy& H, const Config& cfg) {
+  ForestHandle* fh = build_forest_handle(H, cfg);
+  if (!fh) return 1;
+  delete fh;
+  return 0;
+}
+
+P4estBuilder::ForestHandle::~ForestHandle() {
+  delete reinterpret_cast<LinearForest*>(impl);
+  impl = nullptr;
+}
+
+size_t P4estBuilder::ForestHandle::num_quadrants() const {
+  return impl ? reinterpret_cast<const LinearForest*>(impl)->num_quadrants() : 0;
+}
+
+void P4estBuilder::ForestHandle::for_each_quadrant(const std::function<void(const QuadrantView&)>& fn) const {
+  if (!impl || !fn) return;
+  const LinearForest* F = reinterpret_cast<const LinearForest*>(impl);
+  for (size_t t=0; t<F->num_trees(); ++t) {
+    for (const LinearQuad& q : F->tree(t)) {
+      const int s = LinearForest::kMaxLevel - q.level;
+      fn(QuadrantView{ (int)t, Key3{ q.x >> s, q.y >> s, q.z >> s }, q.level, q.mean, q.leaves });
+    }
+  }
+}
+
+P4estBuilder::ForestHandle* P4estBuilder::build_forest_handle(const Hierarchy& H, const Config& cfg) {
+  if (cfg.n <= 0) return nullptr;
+  auto stats = tree_stats(H, cfg.tree_map());
+  auto levels = resolve_levels(H, cfg);
+
+  auto* F = new LinearForest(cfg.n);
+  {
+    trace::Scope ts("refine");
+    for (size_t t=0; t<F->num_trees(); ++t)
+      if (stats[t].leaf_count) F->set_uniform(t, levels[t]);
+  }
+  {
+    trace::Scope ts("balance");
+    F->balance();
+  }
+  trace::count("quadrants", (int64_t)F->num_quadrants());
+  fill_quadrant_data(*F, H, cfg.tree_map(), levels, nullptr);
+
+  auto* fh = new ForestHandle();
+  fh->impl = F;
+  fh->n = cfg.n;
+  fh->levels = std::move(levels);
+  fh->stats = std::move(stats);
+  return fh;
+}
+
+// Shared by adapt_forest and adapt_forest_trees once the new stats and levels are known
+static void adapt_in_place(P4estBuilder::ForestHandle* fh, const Hierarchy& H,
+                           const P4estBuilder::Config& cfg, std::vector<P4estBuilder::TreeStats> stats,
+                           std::vector<int> levels, const std::vector<int>& dirty,
+                           std::vector<int>* touched)
+{
+  const int n = cfg.n;
+  const size_t T = (size_t)n*n*n;
+  const auto changed = P4estBuilder::changed_trees(*fh, levels, stats, dirty);
+
+  // Changed trees plus their neighbors (whose grading toward the old levels must go) are
+  // reset to their targets; balance starts from them and the next ring around them.
+  auto neighbors = [n](const std::vector<char>& in) {
+    std::vector<char> out(in.size(), 0);
+    for (size_t t=0; t<in.size(); ++t) {
+      if (!in[t]) continue;
+      const int x = (int)(t % (size_t)n), y = (int)((t / (size_t)n) % (size_t)n), z = (int)(t / ((size_t)n*n));
+      for (int dz=-1; dz<=1; ++dz) for (int dy=-1; dy<=1; ++dy) for (int dx=-1; dx<=1; ++dx) {
+        int ux = x+dx, uy = y+dy, uz = z+dz;
+        if (ux<0 || uy<0 || uz<0 || ux>=n || uy>=n || uz>=n) continue;
+        out[(size_t)ux + (size_t)n * ((size_t)uy + (size_t)n * (size_t)uz)] = 1;
+      }
+    }
+    return out;
+  };
+  std::vector<char> refresh(T, 0);
+  for (int t : changed) refresh[(size_t)t] = 1;
+
+  if (!changed.empty()) {
+    LinearForest* F = reinterpret_cast<LinearForest*>(fh->impl);
+    const std::vector<char> reset = neighbors(refresh);
+    {
+      trace::Scope ts("refine");
+      for (size_t t=0; t<T; ++t) {
+        if (!reset[t]) continue;
+        F->set_uniform(t, stats[t].leaf_count ? levels[t] : 0);
+        refresh[t] = 1;
+      }
+    }
+    const std::vector<char> seed = neighbors(reset);
+    std::vector<char> split;
+    {
+      trace::Scope ts("balance");
+      split = F->balance(&seed);
+    }
+    for (size_t t=0; t<T; ++t) if (split[t]) refresh[t] = 1;
+    fill_quadrant_data(*F, H, cfg.tree_map(), levels, &refresh);
+  }
+
+  fh->levels = std::move(levels);
+  fh->stats = std::move(stats);
+  if (touched) {
+    touched->clear();
+    for (size_t t=0; t<T; ++t) if (refresh[t]) touched->push_back((int)t);
+  }
+}
+
+int P4estBuilder::adapt_forest(ForestHandle* fh, const Hierarchy& H, const Config& cfg,
+                               const std::vector<int>& dirty, std::vector<int>* touched)
+{
+  if (!fh || !fh->impl || fh->n != cfg.n) return 1;
+  adapt_in_place(fh, H, cfg, tree_stats(H, cfg.tree_map()), resolve_levels(H, cfg), dirty, touched);
+  return 0;
+}
+
+int P4estBuilder::adapt_forest_trees(ForestHandle* fh, const Hierarchy& H, const Config& cfg,
+                                     std::vector<TreeStats> stats, const std::vector<int>& dirty,
+                                     std::vector<int>* touched)
+{
+  if (!fh || !fh->impl || fh->n != cfg.n || cfg.n <= 0) return 1;
+  const size_t T = (size_t)cfg.n * cfg.n * cfg.n;
+  if (stats.size() != T || fh->levels.size() != T) return 1;
+  std::vector<int> levels = fh->levels;
+  {
+    trace::Scope ts("policy");
+    for (int t : dirty) if (t >= 0 && (size_t)t < T) levels[(size_t)t] = resolve_level(H, cfg, t);
+  }
+  adapt_in_place(fh, H, cfg, std::move(stats), std::move(levels), dirty, touched);
+  return 0;
+}
+#endif
+
+} // namespace octoweave
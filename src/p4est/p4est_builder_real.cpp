@@ -1,146 +1,148 @@
 #ifdef OCTOWEAVE_WITH_P4EST
-#include "octoweave/p4est_builder.hpp"
-extern "C" {
-#include <p8est.h>
-#include <p8est_connectivity.h>
-#include <p8est_iterate.h>
-}
-#include <cstdio>
+#include "p4est_internal.hpp"
+#include "octoweave/trace.hpp"
+#include <cmath>
+#include <utility>
 #include <vector>
-#include <unordered_map>
 
 namespace octoweave {
 
 void P4estBuilder::prepare_want_sets(const Hierarchy& H, const Config& cfg) {
   // Touch p4est project (p8est API for 3D) to validate link.
-  p8est_connectivity_t *conn = p8est_connectivity_new_brick(cfg.n, cfg.n, cfg.n, 1, 0);
+  p8est_connectivity_t *conn = detail::new_brick(cfg.n);
   p8est_connectivity_destroy(conn);
 
   size_t leaves = 0, internals = 0;
   for (auto& kv : H.nodes) {
     if (kv.second.is_leaf) ++leaves; else ++internals;
   }
-  std::printf("[P4estBuilder(real)] n=%d, nodes=%zu (leaves=%zu, internals=%zu)\n",
-              cfg.n, H.nodes.size(), leaves, internals);
-}
-
-std::pair<Key3, Key3> P4estBuilder::split_global_to_tree_local(const Key3& k, int /*d*/, int n) {
-  Key3 tree{ (uint32_t)(k.x % (uint32_t)n), (uint32_t)(k.y % (uint32_t)n), (uint32_t)(k.z % (uint32_t)n) };
-  Key3 local{ (uint32_t)(k.x / (uint32_t)n), (uint32_t)(k.y / (uint32_t)n), (uint32_t)(k.z / (uint32_t)n) };
-  return {tree, local};
+  trace::count("want_leaves", (int64_t)leaves);
+  trace::count("want_internals", (int64_t)internals);
 }
 
-namespace {
-  struct ForestImpl {
-    p8est_connectivity_t* conn = nullptr;
-    p8est_t* forest = nullptr;
-  };
+namespace detail {
 
-  struct QuadKey {
-    int tree;
-    uint32_t x, y, z;
-    bool operator==(const QuadKey& o) const noexcept {
-      return tree==o.tree && x==o.x && y==o.y && z==o.z;
-    }
-  };
-  struct QuadKeyHash {
-    size_t operator()(QuadKey const& k) const noexcept {
-      uint64_t h = (uint64_t) (k.tree + 0x9e37);
-      h ^= ((uint64_t)k.x * 0x9e3779b185ebca87ULL) + (h<<6) + (h>>2);
-      h ^= ((uint64_t)k.y * 0x94d049bb133111ebULL) + (h<<6) + (h>>2);
-      h ^= ((uint64_t)k.z * 0xda942042e4dd58b5ULL) + (h<<6) + (h>>2);
-      return (size_t)h;
-    }
-  };
+p8est_connectivity_t* new_brick(int n) {
+  return p8est_connectivity_new_brick(n, n, n, 0, 0, 0);
 }
 
-int P4estBuilder::build_forest(const Hierarchy& H, const Config& cfg) {
-  int n = cfg.n;
-  int Ltarget_default = H.td - H.base_depth;
-  if (Ltarget_default < 0) Ltarget_default = 0;
+std::vector<int> brick_flat_index(const p8est_connectivity_t* conn, int n) {
+  std::vector<int> flat((size_t)conn->num_trees, 0);
+  for (p4est_topidx_t t = 0; t < conn->num_trees; ++t) {
+    // Vertex 0 of each brick tree is its lower corner at integer brick coordinates
+    const double* v = conn->vertices + 3 * conn->tree_to_vertex[P8EST_CHILDREN * t];
+    int x = (int) std::lround(v[0]), y = (int) std::lround(v[1]), z = (int) std::lround(v[2]);
+    flat[(size_t)t] = x + n * (y + n * z);
+  }
+  return flat;
+}
 
-  std::vector<char> tree_has_content((size_t)n*n*n, 0);
+QuadAggMap aggregate_quadrants(const Hierarchy& H, const P4estBuilder::TreeMap& tm,
+                               const std::vector<int>& levels, const std::vector<char>* only)
+{
+  const int n = tm.n;
+  QuadAggMap agg;
   for (const auto& kv : H.nodes) {
-    const NDKey& nd = kv.first;
-    const NodeRec& rec = kv.second;
+    const NDKey& nd = kv.first; const NodeRec& rec = kv.second;
     if (!rec.is_leaf || nd.d != (uint16_t)H.td) continue;
-    auto split = P4estBuilder::split_global_to_tree_local(nd.k, nd.d, n);
-    const Key3& t = split.first;
-    size_t idx = (size_t)t.x + (size_t)n * ((size_t)t.y + (size_t)n * (size_t)t.z);
-    if (idx < tree_has_content.size()) tree_has_content[idx] = 1;
+    auto split = P4estBuilder::split_global_to_tree_local(nd.k, nd.d, tm);
+    const Key3& t = split.first; const Key3& local = split.second;
+    size_t tidx = (size_t)t.x + (size_t)n * ((size_t)t.y + (size_t)n * (size_t)t.z);
+    if (tidx >= levels.size()) continue;
+    if (only && (tidx >= only->size() || !(*only)[tidx])) continue;
+    int Lt = levels[tidx];
+    int shift = P4estBuilder::tree_local_depth(nd.d, tm) - Lt; if (shift < 0) shift = 0;
+    QuadAgg& a = agg[QuadKey{ (int)tidx, local.x >> shift, local.y >> shift, local.z >> shift }];
+    a.sum += rec.p; a.cnt += 1;
   }
+  return agg;
+}
 
-  // Per-tree target level via policy or default
-  std::vector<int> tree_levels((size_t)n*n*n, Ltarget_default);
-  if (cfg.level_policy) {
-    for (size_t ti = 0; ti < tree_levels.size(); ++ti) {
-      int lvl = cfg.level_policy((int)ti, H);
-      if (lvl < cfg.min_level) lvl = cfg.min_level;
-      if (lvl > cfg.max_level) lvl = cfg.max_level;
-      tree_levels[ti] = lvl;
-    }
-  }
+namespace {
+  struct RefineCtx {
+    const std::vector<int>* flat;
+    const std::vector<char>* content;
+    const std::vector<int>* levels;
+  };
 
-  p8est_connectivity_t *conn = p8est_connectivity_new_brick(n, n, n, 1, 0);
-  if (!conn) return 1;
+  struct IterCtx {
+    const std::vector<int>* flat;
+    const std::vector<int>* levels;
+    const QuadAggMap* agg;
+    const std::vector<char>* only;
+  };
 
-  struct RefineCtx { const std::vector<char>* refine; const std::vector<int>* levels; } rctx{ &tree_has_content, &tree_levels };
-  sc_MPI_Comm mpicomm = sc_MPI_COMM_SELF;
-  p8est_t *p8 = p8est_new_ext(mpicomm, conn, /*min_quadrants*/ 0, /*min_level*/ 0,
-                              /*fill_uniform*/ 0, /*data_size*/ (int)sizeof(double),
-                              /*init_fn*/ NULL, /*user_pointer*/ &rctx);
-  if (!p8) { p8est_connectivity_destroy(conn); return 2; }
+  // Trees being re-adapted and their targets; levels apply to trees with content only
+  struct AdaptCtx {
+    const std::vector<int>* flat;
+    const std::vector<char>* reset;
+    const std::vector<char>* content;
+    const std::vector<int>* levels;
+    int target(p4est_topidx_t which_tree) const {
+      size_t idx = (size_t)(*flat)[(size_t)which_tree];
+      return (*content)[idx] ? (*levels)[idx] : 0;
+    }
+    bool in_reset(p4est_topidx_t which_tree) const {
+      return (size_t)which_tree < flat->size() && (*reset)[(size_t)(*flat)[(size_t)which_tree]];
+    }
+  };
 
-  auto refine_cb = [](p8est_t* p8est, p8est_topidx_t which_tree, p8est_quadrant_t* q) -> int {
+  // New quadrants from refine/coarsen/balance are marked stale until their tree is refreshed
+  constexpr uint32_t kStaleLeaves = UINT32_MAX;
+  void mark_stale(p8est_t*, p4est_topidx_t, p8est_quadrant_t* q) {
+    auto* d = static_cast<QuadData*>(q->p.user_data);
+    d->mean = 0.0; d->leaves = kStaleLeaves;
+  }
+}
+
+void refine_to_levels(p8est_t* p8, const std::vector<int>& flat_of_tree,
+                      const std::vector<char>& content, const std::vector<int>& levels)
+{
+  RefineCtx rctx{ &flat_of_tree, &content, &levels };
+  void* saved = p8->user_pointer;
+  p8->user_pointer = &rctx;
+  auto refine_cb = [](p8est_t* p8est, p4est_topidx_t which_tree, p8est_quadrant_t* q) -> int {
     RefineCtx* c = static_cast<RefineCtx*>(p8est->user_pointer);
-    if (!c || !c->refine || !c->levels) return 0;
-    size_t idx = (size_t) which_tree;
-    if (idx >= c->refine->size() || idx >= c->levels->size()) return 0;
-    if (!(*(c->refine))[idx]) return 0;
-    int target = (*(c->levels))[idx];
-    return q->level < target ? 1 : 0;
+    if (!c || (size_t)which_tree >= c->flat->size()) return 0;
+    size_t idx = (size_t)(*c->flat)[(size_t)which_tree];
+    if (idx >= c->content->size() || idx >= c->levels->size()) return 0;
+    if (!(*c->content)[idx]) return 0;
+    return q->level < (*c->levels)[idx] ? 1 : 0;
   };
   p8est_refine(p8, 1, refine_cb, NULL);
-  p8est_balance(p8, P8EST_CONNECT_FULL, NULL);
-
-  // Build per-quadrant means at tree-specific levels
-  std::unordered_map<QuadKey, double, QuadKeyHash> sum;
-  std::unordered_map<QuadKey, uint32_t, QuadKeyHash> cnt;
-  for (const auto& kv : H.nodes) {
-    const NDKey& nd = kv.first; const NodeRec& rec = kv.second;
-    if (!rec.is_leaf || nd.d != (uint16_t)H.td) continue;
-    auto split = P4estBuilder::split_global_to_tree_local(nd.k, nd.d, n);
-    const Key3& t = split.first; const Key3& local = split.second;
-    size_t tidx = (size_t)t.x + (size_t)n * ((size_t)t.y + (size_t)n * (size_t)t.z);
-    int Lt = (tidx < tree_levels.size()) ? tree_levels[tidx] : Ltarget_default;
-    int shift = (int)nd.d - Lt; if (shift < 0) shift = 0;
-    QuadKey qk{ (int)tidx, local.x >> shift, local.y >> shift, local.z >> shift };
-    sum[qk] += rec.p; cnt[qk] += 1;
-  }
-  std::unordered_map<QuadKey, double, QuadKeyHash> mean;
-  mean.reserve(sum.size());
-  for (auto& kv : sum) mean.emplace(kv.first, kv.second / (double) cnt[kv.first]);
+  p8->user_pointer = saved;
+}
 
-  struct IterCtx { const std::vector<int>* levels; decltype(mean)* pmean; } ictx{ &tree_levels, &mean };
+void fill_quadrant_data(p8est_t* p8, const std::vector<int>& flat_of_tree,
+                        const std::vector<int>& levels, const QuadAggMap& agg,
+                        const std::vector<char>* only)
+{
+  trace::Scope ts("aggregate");
+  IterCtx ictx{ &flat_of_tree, &levels, &agg, only };
   auto volume_cb = [](p8est_iter_volume_info_t* info, void* u) {
     IterCtx* ic = static_cast<IterCtx*>(u);
-    int tree = (int) info->treeid;
-    int Lt = 0;
-    if (ic->levels && (size_t)tree < ic->levels->size()) Lt = (*(ic->levels))[tree];
+    int tree = (size_t)info->treeid < ic->flat->size() ? (*ic->flat)[(size_t)info->treeid] : 0;
+    if (ic->only && ((size_t)tree >= ic->only->size() || !(*ic->only)[(size_t)tree])) return;
+    int Lt = (size_t)tree < ic->levels->size() ? (*ic->levels)[(size_t)tree] : 0;
     int len = P8EST_QUADRANT_LEN(Lt);
-    uint32_t cx = (uint32_t) (info->quad->x / len);
-    uint32_t cy = (uint32_t) (info->quad->y / len);
-    uint32_t cz = (uint32_t) (info->quad->z / len);
-    QuadKey qk{ tree, cx, cy, cz };
-    auto it = ic->pmean->find(qk);
-    double val = (it == ic->pmean->end()) ? 0.0 : it->second;
-    double* d = (double*) info->quad->p.user_data;
-    if (d) *d = val;
+    QuadKey qk{ tree, (uint32_t)(info->quad->x / len), (uint32_t)(info->quad->y / len), (uint32_t)(info->quad->z / len) };
+    auto it = ic->agg->find(qk);
+    QuadData* d = (QuadData*) info->quad->p.user_data;
+    if (!d) return;
+    if (it == ic->agg->end()) { d->mean = 0.0; d->leaves = 0; }
+    else { d->mean = it->second.sum / (double) it->second.cnt; d->leaves = it->second.cnt; }
   };
   p8est_iterate(p8, NULL, &ictx, volume_cb, NULL, NULL, NULL);
+}
 
-  p8est_destroy(p8);
-  p8est_connectivity_destroy(conn);
+} // namespace detail
+
+using detail::ForestImpl;
+
+int P4estBuilder::build_forest(const Hierarchy& H, const Config& cfg) {
+  ForestHandle* fh = build_forest_handle(H, cfg);
+  if (!fh) return 1;
+  delete fh;
   return 0;
 }
 
@@ -153,65 +155,173 @@ P4estBuilder::ForestHandle::~ForestHandle() {
   impl = nullptr;
 }
 
-P4estBuilder::ForestHandle* P4estBuilder::build_forest_handle(const Hierarchy& H, const Config& cfg) {
-  int n = cfg.n;
-  int Ltarget_default = H.td - H.base_depth;
-  if (Ltarget_default < 0) Ltarget_default = 0;
+size_t P4estBuilder::ForestHandle::num_quadrants() const {
+  if (!impl) return 0;
+  const ForestImpl* f = reinterpret_cast<const ForestImpl*>(impl);
+  return f->forest ? (size_t) f->forest->local_num_quadrants : 0;
+}
 
-  std::vector<char> tree_has_content((size_t)n*n*n, 0);
-  std::vector<double> tree_means((size_t)n*n*n, 0.0);
-  std::vector<size_t> tree_counts((size_t)n*n*n, 0);
-  for (const auto& kv : H.nodes) {
-    const NDKey& nd = kv.first; const NodeRec& rec = kv.second;
-    if (!rec.is_leaf || nd.d != (uint16_t)H.td) continue;
-    auto split = P4estBuilder::split_global_to_tree_local(nd.k, nd.d, n);
-    const Key3& t = split.first;
-    size_t idx = (size_t)t.x + (size_t)n * ((size_t)t.y + (size_t)n * (size_t)t.z);
-    if (idx < tree_has_content.size()) tree_has_content[idx] = 1;
-    if (idx < tree_means.size()) { tree_means[idx] += rec.p; tree_counts[idx] += 1; }
-  }
-  for (size_t i=0;i<tree_means.size();++i) if (tree_counts[i]) tree_means[i] /= (double) tree_counts[i];
+void P4estBuilder::ForestHandle::for_each_quadrant(const std::function<void(const QuadrantView&)>& fn) const {
+  if (!impl || !fn) return;
+  const ForestImpl* f = reinterpret_cast<const ForestImpl*>(impl);
+  if (!f->forest) return;
+  std::pair<const ForestImpl*, const std::function<void(const QuadrantView&)>*> ctx{ f, &fn };
+  auto volume_cb = [](p8est_iter_volume_info_t* info, void* u) {
+    auto* c = static_cast<std::pair<const ForestImpl*, const std::function<void(const QuadrantView&)>*>*>(u);
+    const p8est_quadrant_t* q = info->quad;
+    const auto* d = static_cast<const detail::QuadData*>(q->p.user_data);
+    const int s = P8EST_MAXLEVEL - q->level;
+    (*c->second)(QuadrantView{ c->first->flat_of_tree[(size_t)info->treeid],
+                               Key3{ (uint32_t)q->x >> s, (uint32_t)q->y >> s, (uint32_t)q->z >> s },
+                               (int)q->level, d ? d->mean : 0.0, d ? d->leaves : 0u });
+  };
+  p8est_iterate(f->forest, NULL, &ctx, volume_cb, NULL, NULL, NULL);
+}
 
-  p8est_connectivity_t *conn = p8est_connectivity_new_brick(n, n, n, 1, 0);
-  if (!conn) return nullptr;
+static std::vector<char> content_flags(const std::vector<P4estBuilder::TreeStats>& stats) {
+  std::vector<char> has(stats.size(), 0);
+  for (size_t i=0;i<stats.size();++i) has[i] = stats[i].leaf_count ? 1 : 0;
+  return has;
+}
 
-  std::vector<int> tree_levels((size_t)n*n*n, Ltarget_default);
-  if (cfg.level_policy) {
-    for (size_t ti = 0; ti < tree_levels.size(); ++ti) {
-      int lvl = cfg.level_policy((int)ti, H);
-      if (lvl < cfg.min_level) lvl = cfg.min_level;
-      if (lvl > cfg.max_level) lvl = cfg.max_level;
-      tree_levels[ti] = lvl;
-    }
-  }
-  struct RefineCtx { const std::vector<char>* refine; const std::vector<int>* levels; } rctx{ &tree_has_content, &tree_levels };
+P4estBuilder::ForestHandle* P4estBuilder::build_forest_handle(const Hierarchy& H, const Config& cfg) {
+  const int n = cfg.n;
+  auto stats = tree_stats(H, cfg.tree_map());
+  const std::vector<char> tree_has_content = content_flags(stats);
+  std::vector<int> tree_levels = resolve_levels(H, cfg);
+
+  p8est_connectivity_t *conn = detail::new_brick(n);
+  if (!conn) return nullptr;
 
   sc_MPI_Comm mpicomm = sc_MPI_COMM_SELF;
-  p8est_t *p8 = p8est_new_ext(mpicomm, conn, 0, 0, 0, (int)sizeof(double), NULL, &rctx);
+  p8est_t *p8 = p8est_new_ext(mpicomm, conn, /*min_quadrants*/ 0, /*min_level*/ 0,
+                              /*fill_uniform*/ 0, /*data_size*/ sizeof(detail::QuadData),
+                              /*init_fn*/ NULL, /*user_pointer*/ NULL);
   if (!p8) { p8est_connectivity_destroy(conn); return nullptr; }
 
-  auto refine_cb = [](p8est_t* p8est, p8est_topidx_t which_tree, p8est_quadrant_t* q) -> int {
-    struct RefineCtx { const std::vector<char>* refine; const std::vector<int>* levels; };
-    RefineCtx* c = static_cast<RefineCtx*>(p8est->user_pointer);
-    if (!c || !c->refine || !c->levels) return 0;
-    size_t idx = (size_t) which_tree;
-    if (idx >= c->refine->size() || idx >= c->levels->size()) return 0;
-    if (!(*(c->refine))[idx]) return 0;
-    int target = (*(c->levels))[idx];
-    return q->level < target ? 1 : 0;
-  };
-  p8est_refine(p8, 1, refine_cb, NULL);
-  p8est_balance(p8, P8EST_CONNECT_FULL, NULL);
-
-  // Build per-quadrant means and attach nothing here; the handle keeps the forest.
   ForestImpl* impl = new ForestImpl();
   impl->conn = conn;
   impl->forest = p8;
+  impl->flat_of_tree = detail::brick_flat_index(conn, n);
+
+  {
+    trace::Scope ts("refine");
+    detail::refine_to_levels(p8, impl->flat_of_tree, tree_has_content, tree_levels);
+  }
+  {
+    trace::Scope ts("balance");
+    p8est_balance(p8, P8EST_CONNECT_FULL, NULL);
+  }
+  trace::count("quadrants", (int64_t)p8->global_num_quadrants);
+
+  // Per-quadrant means at tree-specific levels
+  auto agg = detail::aggregate_quadrants(H, cfg.tree_map(), tree_levels);
+  detail::fill_quadrant_data(p8, impl->flat_of_tree, tree_levels, agg);
+
   auto* handle = new P4estBuilder::ForestHandle();
   handle->impl = impl;
+  handle->n = n;
+  handle->levels = std::move(tree_levels);
+  handle->stats = std::move(stats);
   return handle;
 }
 
+// Shared by adapt_forest and adapt_forest_trees once the new stats and levels are known
+static void adapt_in_place(P4estBuilder::ForestHandle* fh, const Hierarchy& H,
+                           const P4estBuilder::Config& cfg, std::vector<P4estBuilder::TreeStats> stats,
+                           std::vector<int> levels, const std::vector<int>& dirty,
+                           std::vector<int>* touched)
+{
+  const int n = cfg.n;
+  const size_t T = (size_t)n*n*n;
+  const auto changed = P4estBuilder::changed_trees(*fh, levels, stats, dirty);
+  const std::vector<char> content = content_flags(stats);
+
+  // Changed trees plus their neighbors, whose grading toward the old levels must go too
+  std::vector<char> reset(T, 0);
+  for (int t : changed) {
+    const int x = t % n, y = (t / n) % n, z = t / (n*n);
+    for (int dz=-1; dz<=1; ++dz) for (int dy=-1; dy<=1; ++dy) for (int dx=-1; dx<=1; ++dx) {
+      int ux = x+dx, uy = y+dy, uz = z+dz;
+      if (ux<0 || uy<0 || uz<0 || ux>=n || uy>=n || uz>=n) continue;
+      reset[(size_t)ux + (size_t)n * ((size_t)uy + (size_t)n * (size_t)uz)] = 1;
+    }
+  }
+
+  ForestImpl* f = reinterpret_cast<ForestImpl*>(fh->impl);
+  std::vector<char> refresh(T, 0);
+  for (int t : changed) refresh[(size_t)t] = 1;
+  if (f && f->forest && !changed.empty()) {
+    p8est_t* p8 = f->forest;
+    detail::AdaptCtx actx{ &f->flat_of_tree, &reset, &content, &levels };
+    void* saved = p8->user_pointer;
+    p8->user_pointer = &actx;
+    auto coarsen_cb = [](p8est_t* p8est, p4est_topidx_t which_tree, p8est_quadrant_t* fam[]) -> int {
+      auto* c = static_cast<detail::AdaptCtx*>(p8est->user_pointer);
+      if (!c->in_reset(which_tree)) return 0;
+      return fam[0]->level > c->target(which_tree) ? 1 : 0;
+    };
+    auto refine_cb = [](p8est_t* p8est, p4est_topidx_t which_tree, p8est_quadrant_t* q) -> int {
+      auto* c = static_cast<detail::AdaptCtx*>(p8est->user_pointer);
+      if (!c->in_reset(which_tree)) return 0;
+      return q->level < c->target(which_tree) ? 1 : 0;
+    };
+    {
+      trace::Scope ts("refine");
+      p8est_coarsen(p8, 1, coarsen_cb, detail::mark_stale);
+      p8est_refine(p8, 1, refine_cb, detail::mark_stale);
+    }
+    {
+      trace::Scope ts("balance");
+      p8est_balance(p8, P8EST_CONNECT_FULL, detail::mark_stale);
+    }
+    p8->user_pointer = saved;
+
+    // Trees holding stale quadrants (reset trees and trees that balance refined)
+    auto stale_cb = [](p8est_iter_volume_info_t* info, void* u) {
+      auto* ctx = static_cast<std::pair<const std::vector<int>*, std::vector<char>*>*>(u);
+      const auto* d = static_cast<const detail::QuadData*>(info->quad->p.user_data);
+      if (d->leaves == detail::kStaleLeaves) (*ctx->second)[(size_t)(*ctx->first)[(size_t)info->treeid]] = 1;
+    };
+    std::pair<const std::vector<int>*, std::vector<char>*> sctx{ &f->flat_of_tree, &refresh };
+    p8est_iterate(p8, NULL, &sctx, stale_cb, NULL, NULL, NULL);
+
+    auto agg = detail::aggregate_quadrants(H, cfg.tree_map(), levels, &refresh);
+    detail::fill_quadrant_data(p8, f->flat_of_tree, levels, agg, &refresh);
+  }
+
+  fh->levels = std::move(levels);
+  fh->stats = std::move(stats);
+  if (touched) {
+    touched->clear();
+    for (size_t t=0; t<T; ++t) if (refresh[t]) touched->push_back((int)t);
+  }
+}
+
+int P4estBuilder::adapt_forest(ForestHandle* fh, const Hierarchy& H, const Config& cfg,
+                               const std::vector<int>& dirty, std::vector<int>* touched)
+{
+  if (!fh || fh->n != cfg.n) return 1;
+  adapt_in_place(fh, H, cfg, tree_stats(H, cfg.tree_map()), resolve_levels(H, cfg), dirty, touched);
+  return 0;
+}
+
+int P4estBuilder::adapt_forest_trees(ForestHandle* fh, const Hierarchy& H, const Config& cfg,
+                                     std::vector<TreeStats> stats, const std::vector<int>& dirty,
+                                     std::vector<int>* touched)
+{
+  if (!fh || fh->n != cfg.n || cfg.n <= 0) return 1;
+  const size_t T = (size_t)cfg.n * cfg.n * cfg.n;
+  if (stats.size() != T || fh->levels.size() != T) return 1;
+  std::vector<int> levels = fh->levels;
+  {
+    trace::Scope ts("policy");
+    for (int t : dirty) if (t >= 0 && (size_t)t < T) levels[(size_t)t] = resolve_level(H, cfg, t);
+  }
+  adapt_in_place(fh, H, cfg, std::move(stats), std::move(levels), dirty, touched);
+  return 0;
+}
+
 } // namespace octoweave
 
 #endif // OCTOWEAVE_WITH_P4EST
@@ -0,0 +1,66 @@
+#pragma once
+// Shared internals of the p4est-backed (p8est) builders. Not installed.
+#ifdef OCTOWEAVE_WITH_P4EST
+#include "octoweave/p4est_builder.hpp"
+extern "C" {
+#include <p8est.h>
+#include <p8est_connectivity.h>
+#include <p8est_iterate.h>
+}
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+namespace octoweave { namespace detail {
+
+// Per-quadrant user data: mean leaf probability and number of contributing leaves
+struct QuadData { double mean; uint32_t leaves; };
+
+struct ForestImpl {
+  p8est_connectivity_t* conn = nullptr;
+  p8est_t* forest = nullptr;
+  std::vector<int> flat_of_tree; // p8est tree id -> flattened brick index x + n*(y + n*z)
+};
+
+struct QuadKey {
+  int tree;
+  uint32_t x, y, z;
+  bool operator==(const QuadKey& o) const noexcept {
+    return tree==o.tree && x==o.x && y==o.y && z==o.z;
+  }
+};
+struct QuadKeyHash {
+  size_t operator()(QuadKey const& k) const noexcept {
+    uint64_t h = (uint64_t) (k.tree + 0x9e37);
+    h ^= ((uint64_t)k.x * 0x9e3779b185ebca87ULL) + (h<<6) + (h>>2);
+    h ^= ((uint64_t)k.y * 0x94d049bb133111ebULL) + (h<<6) + (h>>2);
+    h ^= ((uint64_t)k.z * 0xda942042e4dd58b5ULL) + (h<<6) + (h>>2);
+    return (size_t)h;
+  }
+};
+struct QuadAgg { double sum = 0.0; uint32_t cnt = 0; };
+// Keyed by flattened tree index and tree-local coordinates at the tree's target level
+using QuadAggMap = mem::HashMap<QuadKey, QuadAgg, QuadKeyHash, mem::Pool::forest_aggregation>;
+
+// Non-periodic n×n×n brick
+p8est_connectivity_t* new_brick(int n);
+// The brick numbers trees along a space-filling curve; recover x + n*(y + n*z) per tree
+std::vector<int> brick_flat_index(const p8est_connectivity_t* conn, int n);
+
+// Leaf probabilities at H.td summed per quadrant at each tree's target level; when
+// `only` is given, trees with only[t] == 0 are skipped
+QuadAggMap aggregate_quadrants(const Hierarchy& H, const P4estBuilder::TreeMap& tm,
+                               const std::vector<int>& levels,
+                               const std::vector<char>* only = nullptr);
+
+// Refine each local quadrant of trees with content up to the tree's target level
+void refine_to_levels(p8est_t* p8, const std::vector<int>& flat_of_tree,
+                      const std::vector<char>& content, const std::vector<int>& levels);
+// Write QuadData for all local quadrants (or those of trees with only[t] != 0)
+void fill_quadrant_data(p8est_t* p8, const std::vector<int>& flat_of_tree,
+                        const std::vector<int>& levels, const QuadAggMap& agg,
+                        const std::vector<char>* only = nullptr);
+
+} } // namespace octoweave::detail
+
+#endif // OCTOWEAVE_WITH_P4EST
@@ -0,0 +1,170 @@
+#include "octoweave/p4est_builder.hpp"
+#include "octoweave/trace.hpp"
+#include <queue>
+#include <limits>
+
+namespace octoweave {
+
+std::vector<P4estBuilder::TreeStats> P4estBuilder::tree_stats(const Hierarchy& H, const TreeMap& tm) {
+  trace::Scope ts("tree_stats");
+  const int n = tm.n;
+  if (n <= 0) return {};
+  const size_t T = (size_t)n*n*n;
+  std::vector<TreeStats> stats(T);
+  for (const auto& kv : H.nodes) {
+    const NDKey& nd = kv.first; const NodeRec& rec = kv.second;
+    if (!rec.is_leaf || nd.d != (uint16_t)H.td) continue;
+    auto split = split_global_to_tree_local(nd.k, nd.d, tm);
+    const Key3& t = split.first;
+    size_t idx = (size_t)t.x + (size_t)n * ((size_t)t.y + (size_t)n * (size_t)t.z);
+    if (idx < T) { stats[idx].leaf_count += 1; stats[idx].prob_sum += rec.p; }
+  }
+  return stats;
+}
+
+std::vector<int> P4estBuilder::resolve_levels(const Hierarchy& H, const Config& cfg) {
+  const int n = cfg.n;
+  if (n <= 0) return {};
+  trace::Scope ts("policy");
+  std::vector<int> levels((size_t)n*n*n);
+  for (size_t ti = 0; ti < levels.size(); ++ti) levels[ti] = resolve_level(H, cfg, (int)ti);
+  return levels;
+}
+
+int P4estBuilder::resolve_level(const Hierarchy& H, const Config& cfg, int tree) {
+  if (!cfg.level_policy) return std::max(0, H.td - H.base_depth);
+  int lvl = cfg.level_policy(tree, H);
+  if (lvl < cfg.min_level) lvl = cfg.min_level;
+  if (lvl > cfg.max_level) lvl = cfg.max_level;
+  return lvl;
+}
+
+std::vector<int> P4estBuilder::changed_trees(const ForestHandle& fh, const std::vector<int>& levels,
+                                             const std::vector<TreeStats>& stats,
+                                             const std::vector<int>& dirty)
+{
+  const size_t T = levels.size();
+  std::vector<char> mark(T, 0);
+  const bool comparable = fh.levels.size() == T && fh.stats.size() == T && stats.size() == T;
+  for (size_t t=0; t<T; ++t) {
+    if (!comparable) { mark[t] = 1; continue; }
+    const TreeStats& a = fh.stats[t]; const TreeStats& b = stats[t];
+    mark[t] = (fh.levels[t] != levels[t] || a.leaf_count != b.leaf_count || a.prob_sum != b.prob_sum) ? 1 : 0;
+  }
+  for (int t : dirty) if (t >= 0 && (size_t)t < T) mark[(size_t)t] = 1;
+  std::vector<int> out;
+  for (size_t t=0; t<T; ++t) if (mark[t]) out.push_back((int)t);
+  return out;
+}
+
+namespace {
+
+// Balanced quadrant estimate for a brick of n^3 trees; doubles avoid 8^L overflow.
+struct BudgetModel {
+  int n;
+  const std::vector<P4estBuilder::TreeStats>* stats;
+
+  int effective_level(const std::vector<int>& levels, size_t t) const {
+    return (*stats)[t].leaf_count ? levels[t] : 0;
+  }
+
+  double tree_cost(const std::vector<int>& levels, int x, int y, int z) const {
+    const size_t t = (size_t)x + (size_t)n * ((size_t)y + (size_t)n * (size_t)z);
+    const int l = effective_level(levels, t);
+    double cost = std::ldexp(1.0, 3*l);
+    double extra = 0.0;
+    int finest = l;
+    for (int dz=-1; dz<=1; ++dz) for (int dy=-1; dy<=1; ++dy) for (int dx=-1; dx<=1; ++dx) {
+      if (!dx && !dy && !dz) continue;
+      int ux = x+dx, uy = y+dy, uz = z+dz;
+      if (ux<0 || uy<0 || uz<0 || ux>=n || uy>=n || uz>=n) continue;
+      const size_t u = (size_t)ux + (size_t)n * ((size_t)uy + (size_t)n * (size_t)uz);
+      const int L = effective_level(levels, u);
+      if (L <= l + 1) continue;
+      finest = std::max(finest, L);
+      // Shared entity dimension: face (2), edge (1) or corner (0)
+      const int dim = 3 - (std::abs(dx) + std::abs(dy) + std::abs(dz));
+      // Each graded layer k splits the parents at level k-1 touching the shared entity
+      for (int k = l+1; k <= L-1; ++k) extra += 7.0 * std::ldexp(1.0, dim*(k-1));
+    }
+    if (extra > 0.0) cost = std::min(cost + extra, std::ldexp(1.0, 3*(finest-1)));
+    return cost;
+  }
+
+  // Sum of costs of tree t and its neighbors (the only trees affected by changing t)
+  double local_cost(const std::vector<int>& levels, size_t t) const {
+    const int x = (int)(t % (size_t)n), y = (int)((t / (size_t)n) % (size_t)n), z = (int)(t / ((size_t)n*n));
+    double sum = 0.0;
+    for (int dz=-1; dz<=1; ++dz) for (int dy=-1; dy<=1; ++dy) for (int dx=-1; dx<=1; ++dx) {
+      int ux = x+dx, uy = y+dy, uz = z+dz;
+      if (ux<0 || uy<0 || uz<0 || ux>=n || uy>=n || uz>=n) continue;
+      sum += tree_cost(levels, ux, uy, uz);
+    }
+    return sum;
+  }
+
+  double total_cost(const std::vector<int>& levels) const {
+    double sum = 0.0;
+    for (int z=0; z<n; ++z) for (int y=0; y<n; ++y) for (int x=0; x<n; ++x)
+      sum += tree_cost(levels, x, y, z);
+    return sum;
+  }
+};
+
+static size_t to_count(double v) {
+  if (!(v < (double)std::numeric_limits<size_t>::max())) return std::numeric_limits<size_t>::max();
+  return (size_t)v;
+}
+
+} // namespace
+
+size_t P4estBuilder::estimate_balanced_quadrants(const std::vector<int>& levels,
+                                                 const std::vector<TreeStats>& stats, int n)
+{
+  if (n <= 0) return 0;
+  const size_t T = (size_t)n*n*n;
+  if (levels.size() < T || stats.size() < T) return 0;
+  BudgetModel m{ n, &stats };
+  return to_count(m.total_cost(levels));
+}
+
+std::vector<int> P4estBuilder::budget_levels(const std::vector<TreeStats>& stats, int n,
+                                             size_t max_quadrants, int Lmin, int Lmax)
+{
+  if (n <= 0) return {};
+  const size_t T = (size_t)n*n*n;
+  std::vector<int> levels(T, Lmin);
+  if (stats.size() < T || Lmax <= Lmin) return levels;
+
+  BudgetModel m{ n, &stats };
+  double total = m.total_cost(levels);
+  const double budget = (double)max_quadrants;
+  if (total > budget) return levels;
+
+  // Evidence per quadrant at the next level; ties broken by lower tree index
+  struct Cand { double score; size_t tree; int level; };
+  auto cmp = [](const Cand& a, const Cand& b) {
+    if (a.score != b.score) return a.score < b.score;
+    return a.tree > b.tree;
+  };
+  std::priority_queue<Cand, std::vector<Cand>, decltype(cmp)> pq(cmp);
+  auto score = [&](size_t t, int L) { return stats[t].prob_sum / std::ldexp(1.0, 3*(L+1)); };
+  for (size_t t=0; t<T; ++t) {
+    if (stats[t].leaf_count == 0 || stats[t].prob_sum <= 0.0) continue;
+    pq.push(Cand{ score(t, Lmin), t, Lmin });
+  }
+
+  while (!pq.empty()) {
+    Cand c = pq.top(); pq.pop();
+    if (levels[c.tree] != c.level) continue;
+    double before = m.local_cost(levels, c.tree);
+    levels[c.tree] = c.level + 1;
+    double after = m.local_cost(levels, c.tree);
+    if (total - before + after > budget) { levels[c.tree] = c.level; continue; }
+    total += after - before;
+    if (c.level + 1 < Lmax) pq.push(Cand{ score(c.tree, c.level + 1), c.tree, c.level + 1 });
+  }
+  return levels;
+}
+
+} // namespace octoweave
@@ -0,0 +1,81 @@
+#include "octoweave/p4est_builder.hpp"
+
+namespace octoweave {
+
+std::pair<Key3, Key3> P4estBuilder::split_global_to_tree_local(const Key3& k, int /*d*/, int n) {
+  Key3 tree{ (uint32_t)(k.x % (uint32_t)n), (uint32_t)(k.y % (uint32_t)n), (uint32_t)(k.z % (uint32_t)n) };
+  Key3 local{ (uint32_t)(k.x / (uint32_t)n), (uint32_t)(k.y / (uint32_t)n), (uint32_t)(k.z / (uint32_t)n) };
+  return {tree, local};
+}
+
+namespace {
+
+// Block layout of one axis rescaled to depth d: [origin, origin + extent)
+struct AxisBlock { uint64_t origin, extent; };
+
+static AxisBlock axis_block(uint32_t origin, uint32_t extent, int layout_depth, int d) {
+  uint64_t o = origin;
+  uint64_t e = extent ? (uint64_t)extent : (1ULL << std::min(layout_depth, 63));
+  if (d >= layout_depth) {
+    int s = std::min(d - layout_depth, 32);
+    o <<= s; e <<= s;
+  } else {
+    int s = std::min(layout_depth - d, 63);
+    uint64_t end = (o + e + (1ULL << s) - 1) >> s; // keep partially covered cells
+    o >>= s; e = end > o ? end - o : 1;
+  }
+  return { o, e };
+}
+
+static std::pair<uint32_t, uint32_t> split_axis(uint32_t k, const AxisBlock& b, int n) {
+  uint64_t rel = k > b.origin ? (uint64_t)k - b.origin : 0;
+  if (rel >= b.extent) rel = b.extent - 1;
+  uint64_t t = rel * (uint64_t)n / b.extent;
+  if (t >= (uint64_t)n) t = (uint64_t)n - 1;
+  uint64_t start = t * b.extent / (uint64_t)n;
+  return { (uint32_t)t, (uint32_t)(rel - start) };
+}
+
+static int ceil_log2(uint64_t v) {
+  int l = 0;
+  while ((1ULL << l) < v && l < 63) ++l;
+  return l;
+}
+
+} // namespace
+
+std::pair<Key3, Key3> P4estBuilder::split_global_to_tree_local(const Key3& k, int d, const TreeMap& tm) {
+  if (tm.mapping == TreeMapping::Modulo || tm.n <= 0) return split_global_to_tree_local(k, d, tm.n);
+  const int D = tm.block.depth >= 0 ? tm.block.depth : d;
+  const auto& o = tm.block.origin; const auto& e = tm.block.extent;
+  auto sx = split_axis(k.x, axis_block(o.x, e.x, D, d), tm.n);
+  auto sy = split_axis(k.y, axis_block(o.y, e.y, D, d), tm.n);
+  auto sz = split_axis(k.z, axis_block(o.z, e.z, D, d), tm.n);
+  return { Key3{ sx.first, sy.first, sz.first }, Key3{ sx.second, sy.second, sz.second } };
+}
+
+int P4estBuilder::tree_local_depth(int d, const TreeMap& tm) {
+  if (tm.mapping == TreeMapping::Modulo || tm.n <= 0) return d;
+  const int D = tm.block.depth >= 0 ? tm.block.depth : d;
+  const auto& o = tm.block.origin; const auto& e = tm.block.extent;
+  uint64_t cells = 1;
+  for (auto b : { axis_block(o.x, e.x, D, d), axis_block(o.y, e.y, D, d), axis_block(o.z, e.z, D, d) }) {
+    cells = std::max(cells, (b.extent + (uint64_t)tm.n - 1) / (uint64_t)tm.n);
+  }
+  return ceil_log2(cells);
+}
+
+P4estBuilder::BlockLayout P4estBuilder::block_layout(const ChunkGrid& grid, const OctoChunker::Params& p) {
+  const int d = OctoChunker::emit_depth(p);
+  const AABB& b = grid.box();
+  Key3 lo = OctoChunker::coord_to_key(Pt{ b.xmin, b.ymin, b.zmin }, p, d);
+  Key3 hi = OctoChunker::coord_to_key(Pt{ b.xmax, b.ymax, b.zmax }, p, d);
+  auto span = [](uint32_t a, uint32_t z) { return z > a ? z - a : 1u; };
+  BlockLayout L;
+  L.origin = lo;
+  L.extent = Key3{ span(lo.x, hi.x), span(lo.y, hi.y), span(lo.z, hi.z) };
+  L.depth = d;
+  return L;
+}
+
+} // namespace octoweave
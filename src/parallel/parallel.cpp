@@ -1,31 +1,142 @@
 #include "octoweave/parallel.hpp"
+#include "octoweave/trace.hpp"
+#include "sparse_bins.hpp"
 #include <thread>
 #include <atomic>
 
 namespace octoweave {
 
-std::vector<WorkerOut> parallel_build_workers(int num_chunks,
-                                              const std::function<WorkerOut(int)>& build,
-                                              int max_threads)
-{
-  if (num_chunks <= 0) return {};
+void parallel_for_index(int n, const std::function<void(int)>& fn, int max_threads) {
+  if (n <= 0) return;
   if (max_threads <= 0) max_threads = (int)std::max(1u, std::thread::hardware_concurrency());
-  std::vector<WorkerOut> out(num_chunks);
   std::atomic<int> next{0};
-  int T = std::min(max_threads, num_chunks);
+  int T = std::min(max_threads, n);
   std::vector<std::thread> threads; threads.reserve(T);
   for (int t=0;t<T;++t) {
     threads.emplace_back([&]{
       while (true) {
         int i = next.fetch_add(1);
-        if (i >= num_chunks) break;
-        out[i] = build(i);
+        if (i >= n) break;
+        fn(i);
       }
     });
   }
   for (auto& th : threads) th.join();
+}
+
+std::vector<WorkerOut> parallel_build_workers(int num_chunks,
+                                              const std::function<WorkerOut(int)>& build,
+                                              int max_threads)
+{
+  if (num_chunks <= 0) return {};
+  std::vector<WorkerOut> out(num_chunks);
+  parallel_for_index(num_chunks, [&](int i){ out[i] = build(i); }, max_threads);
   return out;
 }
 
-} // namespace octoweave
+void bin_points(const ChunkGrid& grid, const PointSpan& pts,
+                std::vector<size_t>& perm, ChunkBins& bins)
+{
+  trace::Scope ts("bin");
+  const size_t N = pts.size();
+  trace::count("points_binned", (int64_t)N);
+  auto chunk_of = [&](size_t i) {
+    const Pt q = pts[i];
+    return (uint64_t)std::get<3>(grid.which(q.x, q.y, q.z));
+  };
+  // Recomputing the chunk in the second pass is cheaper than keeping it per point
+  detail::ChunkCounts counts;
+  for (size_t i=0; i<N; ++i) ++counts[chunk_of(i)];
+  detail::sparse_offsets(counts, bins);
+  perm.resize(N);
+  for (size_t i=0; i<N; ++i) perm[counts[chunk_of(i)]++] = pts.index ? pts.index[i] : i;
+}
 
+std::vector<WorkerOut> build_chunked_workers(const ChunkGrid& grid, const PointSpan& pts,
+                                             const OctoChunker::Params& p,
+                                             int max_threads, std::vector<int>* chunk_ids)
+{
+  std::vector<size_t> perm;
+  ChunkBins bins;
+  bin_points(grid, pts, perm, bins);
+  const PointSpan all = pts.select(nullptr, 0);
+  auto outs = parallel_build_workers((int)bins.chunks.size(), [&](int k) {
+    trace::Scope ts("chunk_build", bins.chunks[(size_t)k]);
+    const size_t b = bins.begin[(size_t)k], e = bins.begin[(size_t)k + 1];
+    return OctoChunker::build_and_export(all.select(perm.data() + b, e - b), p);
+  }, max_threads);
+  if (chunk_ids) *chunk_ids = std::move(bins.chunks);
+  return outs;
+}
+
+void bin_scans(const ChunkGrid& grid, const std::vector<Scan>& scans,
+               std::vector<size_t>& idx, std::vector<uint32_t>& scan_of,
+               ChunkBins& bins, int max_threads)
+{
+  trace::Scope ts("bin");
+  const size_t S = scans.size();
+  // Chunk of every point, one scan per task
+  std::vector<std::vector<uint32_t>> chunk_of(S);
+  parallel_for_index((int)S, [&](int s) {
+    const PointSpan& pts = scans[(size_t)s].points;
+    auto& co = chunk_of[(size_t)s];
+    co.resize(pts.size());
+    for (size_t i=0; i<pts.size(); ++i) {
+      const Pt q = pts[i];
+      co[i] = (uint32_t)std::get<3>(grid.which(q.x, q.y, q.z));
+    }
+  }, max_threads);
+
+  detail::ChunkCounts counts;
+  size_t N = 0;
+  for (const auto& co : chunk_of) { N += co.size(); for (uint32_t c : co) ++counts[c]; }
+  trace::count("points_binned", (int64_t)N);
+  detail::sparse_offsets(counts, bins);
+  idx.resize(N);
+  scan_of.resize(N);
+  for (size_t s=0; s<S; ++s) {
+    const PointSpan& pts = scans[s].points;
+    const auto& co = chunk_of[s];
+    for (size_t i=0; i<co.size(); ++i) {
+      const size_t at = counts[co[i]]++;
+      idx[at] = pts.index ? pts.index[i] : i;
+      scan_of[at] = (uint32_t)s;
+    }
+  }
+}
+
+void insert_binned_scans(ChunkState& state, const std::vector<Scan>& scans,
+                         const size_t* idx, const uint32_t* scan_of, size_t n)
+{
+  // One insertion per run of a scan's points, from that scan's origin
+  for (size_t a=0; a<n; ) {
+    const uint32_t s = scan_of[a];
+    size_t b = a + 1;
+    while (b < n && scan_of[b] == s) ++b;
+    const Scan& scan = scans[s];
+    state.insert(scan.points.select(idx + a, b - a), scan.origin);
+    a = b;
+  }
+}
+
+std::vector<WorkerOut> build_chunked_scans(const ChunkGrid& grid, const std::vector<Scan>& scans,
+                                           const OctoChunker::Params& p,
+                                           int max_threads, std::vector<int>* chunk_ids)
+{
+  std::vector<size_t> idx;
+  std::vector<uint32_t> scan_of;
+  ChunkBins bins;
+  bin_scans(grid, scans, idx, scan_of, bins, max_threads);
+  auto outs = parallel_build_workers((int)bins.chunks.size(), [&](int k) {
+    trace::Scope ts("chunk_build", bins.chunks[(size_t)k]);
+    ChunkState state(p);
+    const size_t b = bins.begin[(size_t)k];
+    insert_binned_scans(state, scans, idx.data() + b, scan_of.data() + b,
+                        bins.begin[(size_t)k + 1] - b);
+    return state.export_worker();
+  }, max_threads);
+  if (chunk_ids) *chunk_ids = std::move(bins.chunks);
+  return outs;
+}
+
+} // namespace octoweave
@@ -0,0 +1,143 @@
+#include "octoweave/parallel.hpp"
+#include "octoweave/trace.hpp"
+#include "sparse_bins.hpp"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace octoweave {
+
+namespace {
+
+using Routed = std::vector<std::pair<uint32_t, RaySegment>>; // (chunk, piece)
+
+// Walk the chunks crossed by o -> pt (3D DDA over the grid) and append one piece per chunk
+void route_ray(const ChunkGrid& grid, const Pt& o, const Pt& pt, double max_range,
+               uint32_t scan, Routed& out)
+{
+  const AABB& box = grid.box();
+  const int n = grid.n();
+  double d[3] = { pt.x - o.x, pt.y - o.y, pt.z - o.z };
+  Pt e = pt;
+  bool hit = true;
+  const double len = std::sqrt(d[0]*d[0] + d[1]*d[1] + d[2]*d[2]);
+  if (max_range > 0.0 && len > max_range) {
+    // Cut short: free space up to max_range and no hit, as OcTree::insertPointCloud does
+    const double s = max_range / len;
+    for (double& v : d) v *= s;
+    e = Pt{ o.x + d[0], o.y + d[1], o.z + d[2] };
+    hit = false;
+  }
+  const double org[3] = { o.x, o.y, o.z };
+  const double lo[3] = { box.xmin, box.ymin, box.zmin };
+  const double hi[3] = { box.xmax, box.ymax, box.zmax };
+  auto at = [&](double t) { return Pt{ o.x + t * d[0], o.y + t * d[1], o.z + t * d[2] }; };
+
+  // Slab clip of o + t d, t in [0, 1], against the grid box
+  double t0 = 0.0, t1 = 1.0;
+  for (int a=0; a<3; ++a) {
+    if (d[a] == 0.0) {
+      if (org[a] < lo[a] || org[a] > hi[a]) { t0 = 1.0; t1 = 0.0; }
+      continue;
+    }
+    double ta = (lo[a] - org[a]) / d[a], tb = (hi[a] - org[a]) / d[a];
+    if (ta > tb) std::swap(ta, tb);
+    t0 = std::max(t0, ta); t1 = std::min(t1, tb);
+  }
+
+  const size_t first = out.size();
+  if (t0 <= t1) {
+    constexpr double kInf = std::numeric_limits<double>::infinity();
+    int cell[3], step[3];
+    double tmax[3], tdelta[3];
+    for (int a=0; a<3; ++a) {
+      const double size = (hi[a] - lo[a]) / n;
+      const double x = org[a] + t0 * d[a];
+      cell[a] = std::clamp((int)std::floor((x - lo[a]) / size), 0, n - 1);
+      if (d[a] > 0.0) {
+        step[a] = 1; tmax[a] = (lo[a] + (cell[a] + 1) * size - org[a]) / d[a]; tdelta[a] = size / d[a];
+      } else if (d[a] < 0.0) {
+        step[a] = -1; tmax[a] = (lo[a] + cell[a] * size - org[a]) / d[a]; tdelta[a] = -size / d[a];
+      } else {
+        step[a] = 0; tmax[a] = kInf; tdelta[a] = kInf;
+      }
+    }
+    double t = t0;
+    while (true) {
+      const int a = tmax[0] < tmax[1] ? (tmax[0] < tmax[2] ? 0 : 2) : (tmax[1] < tmax[2] ? 1 : 2);
+      const double tb = std::min(tmax[a], t1);
+      const uint32_t c = (uint32_t)(cell[0] + n * (cell[1] + n * cell[2]));
+      if (tb > t) out.emplace_back(c, RaySegment{ at(t), at(tb), scan, false });
+      t = tb;
+      if (tmax[a] >= t1) break;
+      cell[a] += step[a];
+      if (cell[a] < 0 || cell[a] >= n) break;
+      tmax[a] += tdelta[a];
+    }
+  }
+  if (!hit) return;
+
+  // The hit goes to the chunk the point bins to, like bin_points; its piece ends exactly there
+  const uint32_t term = (uint32_t)std::get<3>(grid.which(e.x, e.y, e.z));
+  if (out.size() > first && out.back().first == term) {
+    out.back().second.b = e;
+    out.back().second.terminal = true;
+  } else {
+    out.emplace_back(term, RaySegment{ out.size() > first ? at(t1) : e, e, scan, true });
+  }
+}
+
+// Pieces of every scan's rays, one scan per task
+std::vector<Routed> route_all(const ChunkGrid& grid, const std::vector<Scan>& scans,
+                              double max_range, int max_threads)
+{
+  std::vector<Routed> routed(scans.size());
+  parallel_for_index((int)scans.size(), [&](int s) {
+    const Scan& scan = scans[(size_t)s];
+    Routed& r = routed[(size_t)s];
+    r.reserve(scan.points.size() + scan.points.size() / 2);
+    for (size_t i=0; i<scan.points.size(); ++i)
+      route_ray(grid, scan.origin, scan.points[i], max_range, (uint32_t)s, r);
+  }, max_threads);
+  return routed;
+}
+
+} // namespace
+
+void route_rays(const ChunkGrid& grid, const std::vector<Scan>& scans, double max_range,
+                std::vector<RaySegment>& segs, ChunkBins& bins, int max_threads)
+{
+  trace::Scope ts("route");
+  std::vector<Routed> routed = route_all(grid, scans, max_range, max_threads);
+  // Counting sort by chunk in scan order, as bin_scans
+  detail::ChunkCounts counts;
+  size_t N = 0;
+  for (const auto& r : routed) { N += r.size(); for (const auto& pc : r) ++counts[pc.first]; }
+  trace::count("ray_segments", (int64_t)N);
+  detail::sparse_offsets(counts, bins);
+  segs.resize(N);
+  for (auto& r : routed) {
+    for (const auto& pc : r) segs[counts[pc.first]++] = pc.second;
+    Routed().swap(r);
+  }
+}
+
+std::vector<WorkerOut> build_routed_scans(const ChunkGrid& grid, const std::vector<Scan>& scans,
+                                          const OctoChunker::Params& p,
+                                          int max_threads, std::vector<int>* chunk_ids)
+{
+  std::vector<RaySegment> segs;
+  ChunkBins bins;
+  route_rays(grid, scans, p.max_range, segs, bins, max_threads);
+  auto outs = parallel_build_workers((int)bins.chunks.size(), [&](int k) {
+    trace::Scope ts("chunk_build", bins.chunks[(size_t)k]);
+    ChunkState state(p);
+    const size_t b = bins.begin[(size_t)k];
+    state.insert_segments(segs.data() + b, bins.begin[(size_t)k + 1] - b);
+    return state.export_worker();
+  }, max_threads);
+  if (chunk_ids) *chunk_ids = std::move(bins.chunks);
+  return outs;
+}
+
+} // namespace octoweave
@@ -0,0 +1,26 @@
+#pragma once
+// Counting sort over the touched chunks only, shared by bin_points, bin_scans and route_rays
+#include "octoweave/flat_map.hpp"
+#include "octoweave/parallel.hpp"
+#include <algorithm>
+
+namespace octoweave { namespace detail {
+
+using ChunkCounts = FlatMap<uint64_t, size_t>;
+
+// Entries per chunk -> ascending bins.chunks and their offsets; each count is replaced by
+// the chunk's first slot, so `counts[c]++` then yields the fill position
+inline void sparse_offsets(ChunkCounts& counts, ChunkBins& bins) {
+  bins.chunks.clear();
+  bins.chunks.reserve(counts.size());
+  for (const auto& kv : counts) bins.chunks.push_back((int)kv.first);
+  std::sort(bins.chunks.begin(), bins.chunks.end());
+  bins.begin.assign(bins.chunks.size() + 1, 0);
+  for (size_t j=0; j<bins.chunks.size(); ++j) {
+    size_t& c = *counts.find((uint64_t)bins.chunks[j]);
+    bins.begin[j + 1] = bins.begin[j] + c;
+    c = bins.begin[j];
+  }
+}
+
+}} // namespace octoweave::detail
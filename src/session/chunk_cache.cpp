@@ -0,0 +1,229 @@
+#include "octoweave/chunk_cache.hpp"
+#include "octoweave/parallel.hpp"
+#include "octoweave/trace.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+
+namespace octoweave {
+
+namespace fs = std::filesystem;
+
+ChunkCache::ChunkCache(const Options& opt)
+  : opt_(opt), grid_(std::max(1, opt.n), opt.box)
+{
+  std::error_code ec;
+  fs::path dir = opt_.spill_dir.empty() ? fs::temp_directory_path(ec) : fs::path(opt_.spill_dir);
+  fs::create_directories(dir, ec); // a missing directory surfaces as io_errors on spill
+  char tag[24];
+  std::snprintf(tag, sizeof(tag), "%016llx-", (unsigned long long)std::random_device{}() << 32 ^
+                (unsigned long long)(uintptr_t)this);
+  dir_ = dir.string();
+  tag_ = tag;
+}
+
+ChunkCache::~ChunkCache() {
+  std::error_code ec;
+  for (int c : spilled_ids()) fs::remove(path_of(c), ec);
+}
+
+std::string ChunkCache::path_of(int c) const {
+  return (fs::path(dir_) / (tag_ + std::to_string(c) + ".owc")).string();
+}
+
+std::vector<int> ChunkCache::spilled_ids() const {
+  std::vector<int> ids;
+  std::error_code ec;
+  for (fs::directory_iterator it(dir_, ec), end; !ec && it != end; it.increment(ec)) {
+    const std::string name = it->path().filename().string();
+    if (name.size() <= tag_.size() + 4 || name.compare(0, tag_.size(), tag_) != 0 ||
+        name.compare(name.size() - 4, 4, ".owc") != 0) continue;
+    ids.push_back(std::atoi(name.c_str() + tag_.size()));
+  }
+  return ids;
+}
+
+std::vector<int> ChunkCache::chunk_ids() const {
+  std::vector<int> ids = spilled_ids();
+  for (const auto& kv : entries_) ids.push_back(kv.first);
+  std::sort(ids.begin(), ids.end());
+  ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+  return ids;
+}
+
+bool ChunkCache::spill(int c) {
+  trace::Scope ts("cache_spill", c);
+  Entry& e = entries_.at(c);
+  const std::string path = path_of(c);
+  size_t bytes = 0;
+  {
+    std::ofstream os(path, std::ios::binary | std::ios::trunc);
+    bool ok = os && e.state->save(os);
+    if (ok) { bytes = (size_t)os.tellp(); os.close(); ok = !os.fail(); }
+    if (!ok) {
+      std::error_code ec;
+      fs::remove(path, ec);
+      ++stats_.io_errors;
+      return false;
+    }
+  }
+  stats_.resident_bytes -= e.bytes;
+  --stats_.resident_chunks;
+  lru_.erase(e.lru);
+  entries_.erase(c);
+  stats_.spilled_bytes += bytes;
+  ++stats_.spilled_chunks;
+  ++stats_.evictions;
+  trace::count("chunks_spilled", 1);
+  return true;
+}
+
+// Re-measure a resident chunk after an update and move it to the front of the LRU
+void ChunkCache::touch(Entry& e) {
+  const size_t bytes = e.state->memory_bytes();
+  stats_.resident_bytes = stats_.resident_bytes - e.bytes + bytes;
+  e.bytes = bytes;
+  lru_.splice(lru_.begin(), lru_, e.lru);
+}
+
+void ChunkCache::enforce_budget() {
+  // Oldest first; a chunk that fails to write stays resident and the next one is tried
+  auto it = lru_.end();
+  while (stats_.resident_bytes > opt_.budget_bytes && it != lru_.begin()) {
+    auto victim = std::prev(it);
+    if (!spill(*victim)) it = victim;
+  }
+}
+
+size_t ChunkCache::insert(const PointSpan& pts, const Pt& origin) {
+  return insert(std::vector<Scan>{ Scan{ pts, origin } });
+}
+
+size_t ChunkCache::insert(const std::vector<Scan>& scans) {
+  if (scans.empty()) return 0;
+  trace::Scope ts("cache_insert");
+  std::vector<size_t> idx;
+  std::vector<uint32_t> scan_of;
+  ChunkBins bins;
+  bin_scans(grid_, scans, idx, scan_of, bins, opt_.threads);
+
+  // Entries are created up front; the parallel round below only reads the map
+  const std::vector<int>& touched = bins.chunks;
+  std::vector<Entry*> slot;
+  std::vector<char> reload;
+  for (int c : touched) {
+    auto it = entries_.find(c);
+    if (it != entries_.end()) { slot.push_back(&it->second); reload.push_back(0); continue; }
+    std::error_code ec;
+    reload.push_back(fs::exists(path_of(c), ec) ? 1 : 0);
+    Entry& e = entries_[c];
+    e.state.reset(new ChunkState(opt_.params));
+    e.lru = lru_.insert(lru_.begin(), c);
+    ++stats_.resident_chunks;
+    slot.push_back(&e);
+  }
+
+  // Each chunk's state (and file) is touched by exactly one worker. A file that cannot be
+  // read is the chunk's only copy: it is kept and the chunk's points are skipped.
+  std::vector<char> failed(touched.size(), 0);
+  std::vector<size_t> file_bytes(touched.size(), 0);
+  parallel_for_index((int)touched.size(), [&](int k) {
+    const int c = touched[(size_t)k];
+    Entry& e = *slot[(size_t)k];
+    if (reload[(size_t)k]) {
+      trace::Scope tl("cache_load", c);
+      const std::string path = path_of(c);
+      std::error_code ec;
+      file_bytes[(size_t)k] = (size_t)fs::file_size(path, ec);
+      std::ifstream is(path, std::ios::binary);
+      if (ec || !is || !e.state->load(is)) { failed[(size_t)k] = 1; return; }
+      is.close();
+      fs::remove(path, ec);
+    }
+    trace::Scope tc("chunk_insert", c);
+    const size_t b = bins.begin[(size_t)k];
+    insert_binned_scans(*e.state, scans, idx.data() + b, scan_of.data() + b,
+                        bins.begin[(size_t)k + 1] - b);
+  }, opt_.threads);
+
+  size_t updated = 0;
+  for (size_t k=0; k<touched.size(); ++k) {
+    Entry& e = *slot[k];
+    if (failed[k]) {
+      lru_.erase(e.lru);
+      --stats_.resident_chunks;
+      entries_.erase(touched[k]);
+      ++stats_.io_errors;
+      continue;
+    }
+    if (reload[k]) {
+      stats_.spilled_bytes -= file_bytes[k];
+      --stats_.spilled_chunks;
+      ++stats_.reloads;
+    }
+    touch(e);
+    ++updated;
+  }
+  trace::count("chunks_reloaded", (int64_t)std::count(reload.begin(), reload.end(), 1));
+  stats_.peak_resident_bytes = std::max(stats_.peak_resident_bytes, stats_.resident_bytes);
+  enforce_budget();
+  return updated;
+}
+
+bool ChunkCache::export_chunk(int c, WorkerOut& out) const {
+  auto it = entries_.find(c);
+  if (it != entries_.end()) { out = it->second.state->export_worker(); return true; }
+  trace::Scope tl("cache_load", c);
+  ChunkState tmp(opt_.params);
+  std::ifstream is(path_of(c), std::ios::binary);
+  const bool ok = is && tmp.load(is);
+  out = tmp.export_worker();
+  return ok;
+}
+
+void ChunkCache::for_each_worker(const std::function<void(int chunk, WorkerOut&& w)>& fn) {
+  for (int c : chunk_ids()) {
+    WorkerOut w;
+    if (!export_chunk(c, w)) ++stats_.io_errors;
+    fn(c, std::move(w));
+  }
+}
+
+std::vector<WorkerOut> ChunkCache::export_workers(std::vector<int>* chunk_ids_out) {
+  trace::Scope ts("cache_export");
+  std::vector<int> ids = chunk_ids();
+  // At most `threads` spilled chunks are loaded at a time
+  std::vector<char> failed(ids.size(), 0);
+  auto outs = parallel_build_workers((int)ids.size(), [&](int k) {
+    WorkerOut w;
+    failed[(size_t)k] = !export_chunk(ids[(size_t)k], w);
+    return w;
+  }, opt_.threads);
+  stats_.io_errors += (size_t)std::count(failed.begin(), failed.end(), 1);
+  if (chunk_ids_out) *chunk_ids_out = std::move(ids);
+  return outs;
+}
+
+Hierarchy ChunkCache::hierarchy(double tau, double p_unknown, int base_depth,
+                                std::pmr::memory_resource* scratch) {
+  trace::Scope ts("cache_hierarchy");
+  HierarchyBuilder hb(OctoChunker::emit_depth(opt_.params), tau, /*use_logodds=*/false,
+                      p_unknown, base_depth, scratch);
+  // Keys shared by chunks are union-merged in ascending chunk order, as the batch merge does
+  for_each_worker([&](int, WorkerOut&& w) {
+    const DepthMap& merged = hb.leaves();
+    for (const auto& kv : w.Ptd) {
+      const double p = std::clamp(kv.second, 0.0, 1.0);
+      auto it = merged.find(kv.first);
+      hb.set(kv.first, it == merged.end() ? p : 1.0 - (1.0 - it->second) * (1.0 - p));
+    }
+  });
+  hb.refresh();
+  return hb.hierarchy();
+}
+
+} // namespace octoweave
@@ -0,0 +1,192 @@
+#include "octoweave/session.hpp"
+#include "octoweave/parallel.hpp"
+#include "octoweave/trace.hpp"
+#include <algorithm>
+
+namespace octoweave {
+
+Session::Session(const Options& opt)
+  : opt_(opt), grid_(std::max(1, opt.n), opt.box),
+    builder_(OctoChunker::emit_depth(opt.params), opt.tau, /*use_logodds=*/false,
+             opt.p_unknown, opt.base_depth, opt.scratch)
+{}
+
+Session::~Session() = default;
+
+size_t Session::active_chunks() const { return chunks_.size(); }
+
+std::vector<Session::Chunk*> Session::touch(const std::vector<int>& ids) {
+  std::vector<Chunk*> out;
+  out.reserve(ids.size());
+  for (int c : ids) {
+    Chunk& ch = chunks_[c];
+    if (!ch.state) ch.state.reset(new ChunkState(opt_.params));
+    if (!ch.dirty) { ch.dirty = true; dirty_.push_back(c); }
+    out.push_back(&ch);
+  }
+  return out;
+}
+
+size_t Session::insert(const PointSpan& pts, const Pt& origin) {
+  if (opt_.route_rays) return insert(std::vector<Scan>{ Scan{ pts, origin } });
+  ++scans_;
+  if (pts.size() == 0) return 0;
+  trace::Scope ts("session_insert");
+  std::vector<size_t> perm;
+  ChunkBins bins;
+  bin_points(grid_, pts, perm, bins);
+  const std::vector<Chunk*> touched = touch(bins.chunks);
+  // Each chunk's state is touched by exactly one worker
+  const PointSpan all = pts.select(nullptr, 0);
+  parallel_for_index((int)touched.size(), [&](int k) {
+    trace::Scope tc("chunk_insert", bins.chunks[(size_t)k]);
+    const size_t b = bins.begin[(size_t)k], e = bins.begin[(size_t)k + 1];
+    touched[(size_t)k]->state->insert(all.select(perm.data() + b, e - b), origin);
+  }, opt_.threads);
+  return touched.size();
+}
+
+size_t Session::insert(const std::vector<Scan>& scans) {
+  scans_ += scans.size();
+  if (scans.empty()) return 0;
+  trace::Scope ts("session_insert");
+  std::vector<size_t> idx;
+  std::vector<uint32_t> scan_of;
+  std::vector<RaySegment> segs;
+  ChunkBins bins;
+  if (opt_.route_rays) route_rays(grid_, scans, opt_.params.max_range, segs, bins, opt_.threads);
+  else bin_scans(grid_, scans, idx, scan_of, bins, opt_.threads);
+  const std::vector<Chunk*> touched = touch(bins.chunks);
+  parallel_for_index((int)touched.size(), [&](int k) {
+    trace::Scope tc("chunk_insert", bins.chunks[(size_t)k]);
+    ChunkState& state = *touched[(size_t)k]->state;
+    const size_t b = bins.begin[(size_t)k], n = bins.begin[(size_t)k + 1] - b;
+    if (opt_.route_rays) state.insert_segments(segs.data() + b, n);
+    else insert_binned_scans(state, scans, idx.data() + b, scan_of.data() + b, n);
+  }, opt_.threads);
+  return touched.size();
+}
+
+const Hierarchy& Session::hierarchy() {
+  if (dirty_.empty()) return builder_.hierarchy();
+  trace::Scope ts("session_merge");
+  trace::count("chunks_reexported", (int64_t)dirty_.size());
+  std::sort(dirty_.begin(), dirty_.end());
+  auto fresh = parallel_build_workers((int)dirty_.size(), [&](int k) {
+    trace::Scope tc("chunk_emit", dirty_[(size_t)k]);
+    return chunks_.at(dirty_[(size_t)k]).state->export_worker();
+  }, opt_.threads);
+
+  // Keys whose merged value may change, with a dirty chunk that exported them before or now
+  std::unordered_map<Key3, int, Key3Hash> edited;
+  for (size_t k=0; k<dirty_.size(); ++k) {
+    const int c = dirty_[k];
+    Chunk& ch = chunks_.at(c);
+    auto& old = ch.exported.Ptd;
+    auto& now = fresh[k].Ptd;
+    for (const auto& kv : old)
+      if (!now.count(kv.first)) { --owners_[kv.first]; edited.emplace(kv.first, c); }
+    for (const auto& kv : now) {
+      auto it = old.find(kv.first);
+      if (it == old.end()) ++owners_[kv.first];
+      if (it == old.end() || it->second != kv.second) edited.emplace(kv.first, c);
+    }
+    ch.exported = std::move(fresh[k]);
+    ch.dirty = false;
+  }
+  dirty_.clear();
+
+  // Re-merge edited keys in ascending chunk order, as make_hierarchy_from_workers does over
+  // build_chunked_workers output. Owners are looked up among the 27 chunks around the one
+  // that reported the key; a count mismatch (cells wider than chunks) falls back to a scan.
+  const int n = grid_.n();
+  auto merge = [&](const Key3& key, const std::vector<int>& cands, uint32_t expect,
+                   double& out) -> uint32_t {
+    uint32_t found = 0;
+    for (int c : cands) {
+      auto ch = chunks_.find(c);
+      if (ch == chunks_.end()) continue;
+      const auto& ptd = ch->second.exported.Ptd;
+      auto it = ptd.find(key);
+      if (it == ptd.end()) continue;
+      const double p = std::clamp(it->second, 0.0, 1.0);
+      out = found ? 1.0 - (1.0 - out) * (1.0 - p) : p;
+      if (++found == expect) break;
+    }
+    return found;
+  };
+  std::vector<int> cands, all_chunks;
+  for (const auto& e : edited) {
+    const Key3& key = e.first;
+    auto ow = owners_.find(key);
+    if (ow == owners_.end() || ow->second == 0) {
+      if (ow != owners_.end()) owners_.erase(ow);
+      builder_.erase(key);
+      continue;
+    }
+    auto [cx, cy, cz] = grid_.unravel(e.second);
+    cands.clear();
+    for (int dz=-1; dz<=1; ++dz) for (int dy=-1; dy<=1; ++dy) for (int dx=-1; dx<=1; ++dx) {
+      const int x = cx + dx, y = cy + dy, z = cz + dz;
+      if (x < 0 || y < 0 || z < 0 || x >= n || y >= n || z >= n) continue;
+      cands.push_back(x + n * (y + n * z));
+    }
+    std::sort(cands.begin(), cands.end());
+    double p = 0.0;
+    if (merge(key, cands, ow->second, p) != ow->second) {
+      if (all_chunks.empty()) {
+        for (const auto& kv : chunks_) all_chunks.push_back(kv.first);
+        std::sort(all_chunks.begin(), all_chunks.end());
+      }
+      merge(key, all_chunks, ow->second, p);
+    }
+    builder_.set(key, p);
+  }
+  if (forest_) builder_.refresh(&forest_pending_, &forest_deltas_);
+  else builder_.refresh();
+  return builder_.hierarchy();
+}
+
+P4estBuilder::ForestHandle* Session::forest(const P4estBuilder::Config& cfg) {
+  const Hierarchy& H = hierarchy();
+  if (!forest_ || forest_->n != cfg.n) {
+    forest_.reset(P4estBuilder::build_forest_handle(H, cfg));
+    forest_pending_.clear();
+    forest_deltas_.clear();
+    return forest_.get();
+  }
+  // Trees holding changed nodes, and their stats moved by the changed depth-td leaves
+  const P4estBuilder::TreeMap tm = cfg.tree_map();
+  auto tree_of = [&](const Key3& k, int d) {
+    const Key3 t = P4estBuilder::split_global_to_tree_local(k, d, tm).first;
+    return (size_t)t.x + (size_t)cfg.n * ((size_t)t.y + (size_t)cfg.n * (size_t)t.z);
+  };
+  std::vector<char> mark((size_t)cfg.n * (size_t)cfg.n * (size_t)cfg.n, 0);
+  std::vector<int> dirty;
+  for (const NDKey& nd : forest_pending_) {
+    const size_t idx = tree_of(nd.k, nd.d);
+    if (!mark[idx]) { mark[idx] = 1; dirty.push_back((int)idx); }
+  }
+  std::sort(dirty.begin(), dirty.end());
+  std::vector<P4estBuilder::TreeStats> stats = forest_->stats;
+  if (stats.size() == mark.size()) {
+    for (const HierarchyBuilder::LeafDelta& ld : forest_deltas_) {
+      P4estBuilder::TreeStats& st = stats[tree_of(ld.k, H.td)];
+      st.leaf_count = (size_t)((long long)st.leaf_count + ld.count);
+      st.prob_sum = st.leaf_count ? st.prob_sum + ld.dp : 0.0;
+    }
+  }
+  forest_pending_.clear();
+  forest_deltas_.clear();
+  if (P4estBuilder::adapt_forest_trees(forest_.get(), H, cfg, std::move(stats), dirty) != 0)
+    forest_.reset(P4estBuilder::build_forest_handle(H, cfg));
+  return forest_.get();
+}
+
+void Session::reset_forest() {
+  forest_.reset();
+  forest_pending_.clear();
+  forest_deltas_.clear();
+}
+
+} // namespace octoweave
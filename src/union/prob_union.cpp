@@ -1,4 +1,6 @@
 #include "octoweave/union.hpp"
+#include <limits>
+#include <vector>
 
 namespace octoweave {
 
@@ -17,4 +19,42 @@ double union_prob8_stable(const std::array<double,8>& p8, double p_unknown) {
   return P;
 }
 
+namespace {
+
+// softplus(q * step) = -log(1 - p) per code, indexed by q + 32768 (saturated codes: 0, inf)
+const float* softplus_table() {
+  static const std::vector<float> t = [] {
+    std::vector<float> v(65536);
+    for (int q = kLogOdds16Min + 1; q < kLogOdds16Max; ++q) {
+      const double l = q * kLogOdds16Step;
+      v[(size_t)(q + 32768)] = (float)(l > 0.0 ? l + std::log1p(std::exp(-l)) : std::log1p(std::exp(l)));
+    }
+    v[0] = v[(size_t)(kLogOdds16Min + 32768)] = 0.0f;
+    v[(size_t)(kLogOdds16Max + 32768)] = std::numeric_limits<float>::infinity();
+    return v;
+  }();
+  return t.data();
+}
+
+// Code of P = 1 - exp(-s) for s = -log(1 - P): logit(P) = log(expm1(s))
+int16_t logodds16_from_log_complement(double s) {
+  if (s <= 0.0) return kLogOdds16Min;
+  if (s == std::numeric_limits<double>::infinity()) return kLogOdds16Max;
+  return logodds16_from_logit(s > 40.0 ? s : std::log(std::expm1(s)));
+}
+
+} // namespace
+
+int16_t union_logodds16(int16_t a, int16_t b) {
+  const float* sp = softplus_table() + 32768;
+  return logodds16_from_log_complement((double)sp[a] + (double)sp[b]);
+}
+
+int16_t union_logodds16(const std::array<int16_t,8>& q8) {
+  const float* sp = softplus_table() + 32768;
+  double s = 0.0;
+  for (int16_t q : q8) s += (double)sp[q];
+  return logodds16_from_log_complement(s);
+}
+
 } // namespace octoweave
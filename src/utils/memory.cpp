@@ -0,0 +1,35 @@
+#include "octoweave/memory.hpp"
+
+namespace octoweave { namespace mem {
+
+namespace detail {
+Counter g_pools[(int)Pool::count];
+}
+
+const char* pool_name(Pool p) {
+  switch (p) {
+    case Pool::worker_maps: return "worker_maps";
+    case Pool::depth_maps: return "depth_maps";
+    case Pool::rollup_buckets: return "rollup_buckets";
+    case Pool::hierarchy_nodes: return "hierarchy_nodes";
+    case Pool::forest_aggregation: return "forest_aggregation";
+    default: return "unknown";
+  }
+}
+
+std::vector<PoolUsage> usage() {
+  std::vector<PoolUsage> out;
+  for (int i=0; i<(int)Pool::count; ++i) {
+    const detail::Counter& c = detail::g_pools[i];
+    out.push_back(PoolUsage{ pool_name((Pool)i), c.current.load(std::memory_order_relaxed),
+                             c.peak.load(std::memory_order_relaxed) });
+  }
+  return out;
+}
+
+void reset_peaks() {
+  for (auto& c : detail::g_pools)
+    c.peak.store(c.current.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+}} // namespace octoweave::mem
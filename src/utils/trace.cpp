@@ -0,0 +1,225 @@
+#include "octoweave/trace.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <unordered_map>
+
+namespace octoweave { namespace trace {
+
+namespace detail {
+std::atomic<bool> g_enabled{false};
+}
+
+namespace {
+
+struct Span { const char* name; int64_t arg; uint64_t t0, t1; };
+
+// One per recording thread. The owning thread appends under its own (uncontended) lock so
+// readers can snapshot at any time.
+struct ThreadBuf {
+  uint32_t tid = 0;
+  std::mutex mu;
+  std::vector<Span> spans;
+  std::vector<std::pair<const char*, int64_t>> counters; // few names: linear lookup
+  bool empty() const { return spans.empty() && counters.empty(); }
+};
+
+// Buffers of live threads, and of exited threads whose records are still to be reported
+// (until the next reset). Buffers of threads that exit with nothing recorded are dropped.
+struct Registry {
+  std::mutex mu;
+  std::vector<std::shared_ptr<ThreadBuf>> bufs;
+  std::vector<std::shared_ptr<ThreadBuf>> retired;
+  uint32_t next_tid = 1;
+};
+
+Registry& registry() {
+  static Registry* r = new Registry(); // never destroyed: threads may record during exit
+  return *r;
+}
+
+std::atomic<uint64_t> g_epoch{ detail::clock_ns() };
+
+// Retires the thread's buffer at thread exit
+struct Holder {
+  std::shared_ptr<ThreadBuf> buf;
+  ~Holder() {
+    if (!buf) return;
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mu);
+    r.bufs.erase(std::find(r.bufs.begin(), r.bufs.end(), buf));
+    std::lock_guard<std::mutex> l(buf->mu);
+    if (buf->empty()) return;
+    buf->spans.shrink_to_fit();
+    r.retired.push_back(std::move(buf));
+  }
+};
+
+ThreadBuf& local() {
+  thread_local Holder h;
+  if (!h.buf) {
+    h.buf = std::make_shared<ThreadBuf>();
+    Registry& r = registry();
+    std::lock_guard<std::mutex> lock(r.mu);
+    h.buf->tid = r.next_tid++;
+    r.bufs.push_back(h.buf);
+  }
+  return *h.buf;
+}
+
+std::vector<std::shared_ptr<ThreadBuf>> buffers() {
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mu);
+  std::vector<std::shared_ptr<ThreadBuf>> all(r.retired);
+  all.insert(all.end(), r.bufs.begin(), r.bufs.end());
+  return all;
+}
+
+std::string stage_name(const Span& s) {
+  return s.arg >= 0 ? std::string(s.name) + "/" + std::to_string(s.arg) : std::string(s.name);
+}
+
+void json_string(std::ostream& o, const std::string& s) {
+  o << '"';
+  for (char c : s) {
+    if (c == '"' || c == '\\') o << '\\' << c;
+    else if ((unsigned char)c < 0x20) { char b[8]; std::snprintf(b, sizeof(b), "\\u%04x", c); o << b; }
+    else o << c;
+  }
+  o << '"';
+}
+
+} // namespace
+
+namespace detail {
+
+uint64_t clock_ns() {
+  return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()).count() + 1;
+}
+
+void record(const char* name, int64_t arg, uint64_t t0, uint64_t t1) {
+  ThreadBuf& b = local();
+  std::lock_guard<std::mutex> lock(b.mu);
+  // Read under the buffer lock: reset() moves the epoch before emptying the buffers. A span
+  // open across a reset keeps only its part after the reset.
+  const uint64_t epoch = g_epoch.load(std::memory_order_relaxed);
+  if (t1 <= epoch) return;
+  t0 = std::max(t0, epoch);
+  b.spans.push_back(Span{ name, arg, t0 - epoch + 1, t1 - epoch + 1 });
+}
+
+void add_count(const char* name, int64_t delta) {
+  ThreadBuf& b = local();
+  std::lock_guard<std::mutex> lock(b.mu);
+  for (auto& c : b.counters)
+    if (c.first == name) { c.second += delta; return; }
+  b.counters.emplace_back(name, delta);
+}
+
+} // namespace detail
+
+void set_enabled(bool on) { detail::g_enabled.store(on, std::memory_order_relaxed); }
+
+uint64_t now_ns() {
+  const uint64_t t = detail::clock_ns(), e = g_epoch.load(std::memory_order_relaxed);
+  return t > e ? t - e + 1 : 1;
+}
+
+Summary summary() {
+  Summary s;
+  std::unordered_map<std::string, size_t> stage_at, counter_at;
+  for (const auto& b : buffers()) {
+    std::lock_guard<std::mutex> lock(b->mu);
+    if (!b->spans.empty() || !b->counters.empty()) ++s.threads;
+    for (const Span& sp : b->spans) {
+      const std::string name = stage_name(sp);
+      auto it = stage_at.find(name);
+      if (it == stage_at.end()) {
+        it = stage_at.emplace(name, s.stages.size()).first;
+        s.stages.push_back(StageSummary{ name });
+      }
+      StageSummary& st = s.stages[it->second];
+      const double ms = (double)(sp.t1 - sp.t0) * 1e-6;
+      ++st.calls; st.total_ms += ms; st.max_ms = std::max(st.max_ms, ms);
+    }
+    for (const auto& c : b->counters) {
+      auto it = counter_at.find(c.first);
+      if (it == counter_at.end()) {
+        it = counter_at.emplace(c.first, s.counters.size()).first;
+        s.counters.emplace_back(c.first, 0);
+      }
+      s.counters[it->second].second += c.second;
+    }
+  }
+  if (mem::tracking_enabled()) s.memory = mem::usage();
+  return s;
+}
+
+std::string chrome_trace_json() {
+  std::ostringstream o;
+  o << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[";
+  bool first = true;
+  auto sep = [&] { if (!first) o << ",\n"; first = false; };
+  uint64_t end = 0;
+  for (const auto& b : buffers()) {
+    std::lock_guard<std::mutex> lock(b->mu);
+    if (b->spans.empty()) continue;
+    sep();
+    o << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << b->tid
+      << ",\"args\":{\"name\":\"octoweave-" << b->tid << "\"}}";
+    for (const Span& sp : b->spans) {
+      sep();
+      o << "{\"name\":"; json_string(o, sp.name);
+      char ts[64];
+      std::snprintf(ts, sizeof(ts), ",\"ts\":%.3f,\"dur\":%.3f", (double)sp.t0 * 1e-3,
+                    (double)(sp.t1 - sp.t0) * 1e-3);
+      o << ",\"cat\":\"octoweave\",\"ph\":\"X\",\"pid\":1,\"tid\":" << b->tid << ts;
+      if (sp.arg >= 0) o << ",\"args\":{\"arg\":" << sp.arg << "}";
+      o << "}";
+      end = std::max(end, sp.t1);
+    }
+  }
+  // Counter totals and memory pools as one sample at the end of the trace
+  const Summary s = summary();
+  char ts[32]; std::snprintf(ts, sizeof(ts), "%.3f", (double)end * 1e-3);
+  for (const auto& c : s.counters) {
+    sep();
+    o << "{\"name\":"; json_string(o, c.first);
+    o << ",\"ph\":\"C\",\"pid\":1,\"ts\":" << ts << ",\"args\":{\"value\":" << c.second << "}}";
+  }
+  for (const auto& m : s.memory) {
+    sep();
+    o << "{\"name\":"; json_string(o, std::string("mem/") + m.name);
+    o << ",\"ph\":\"C\",\"pid\":1,\"ts\":" << ts << ",\"args\":{\"current_bytes\":"
+      << m.current_bytes << ",\"peak_bytes\":" << m.peak_bytes << "}}";
+  }
+  o << "]}\n";
+  return o.str();
+}
+
+bool write_chrome_trace(const std::string& path) {
+  std::ofstream f(path);
+  f << chrome_trace_json();
+  return (bool)f;
+}
+
+void reset() {
+  Registry& r = registry();
+  std::lock_guard<std::mutex> lock(r.mu);
+  g_epoch.store(detail::clock_ns(), std::memory_order_relaxed);
+  // Buffers of exited threads are dropped; live ones are emptied in place
+  r.retired.clear();
+  for (auto& b : r.bufs) {
+    std::lock_guard<std::mutex> l(b->mu);
+    b->spans.clear(); b->counters.clear();
+  }
+  mem::reset_peaks();
+}
+
+}} // namespace octoweave::trace
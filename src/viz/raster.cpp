@@ -0,0 +1,218 @@
+#include "octoweave/raster.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <thread>
+
+namespace octoweave {
+
+LeafIndex::LeafIndex(const Hierarchy& H) {
+  // Bucket leaves by depth first so every depth lands in its final range
+  std::vector<size_t> count;
+  for (const auto& kv : H.nodes) {
+    if (!kv.second.is_leaf) continue;
+    size_t d = kv.first.d;
+    if (d >= count.size()) count.resize(d + 1, 0);
+    ++count[d];
+  }
+  begin_.assign(count.size() + 1, 0);
+  for (size_t d=0; d<count.size(); ++d) begin_[d + 1] = begin_[d] + count[d];
+  const size_t n = begin_.back();
+  std::vector<std::pair<Key3, double>> tmp(n);
+  std::vector<size_t> fill(begin_.begin(), begin_.end() - 1);
+  for (const auto& kv : H.nodes)
+    if (kv.second.is_leaf) tmp[fill[kv.first.d]++] = { kv.first.k, kv.second.p };
+
+  x_.resize(n); y_.resize(n); z_.resize(n); d_.resize(n); p_.resize(n);
+  extent_.assign(count.size(), Key3{0, 0, 0});
+  for (size_t d=0; d<count.size(); ++d) {
+    std::sort(tmp.begin() + (std::ptrdiff_t)begin_[d], tmp.begin() + (std::ptrdiff_t)begin_[d + 1],
+              [](const auto& a, const auto& b) {
+      const Key3& ka = a.first; const Key3& kb = b.first;
+      if (ka.z != kb.z) return ka.z < kb.z;
+      if (ka.y != kb.y) return ka.y < kb.y;
+      return ka.x < kb.x;
+    });
+    Key3& e = extent_[d];
+    for (size_t i=begin_[d]; i<begin_[d + 1]; ++i) {
+      const Key3& k = tmp[i].first;
+      x_[i] = k.x; y_[i] = k.y; z_[i] = k.z; d_[i] = (int32_t)d; p_[i] = tmp[i].second;
+      e.x = std::max(e.x, k.x + 1);
+      e.y = std::max(e.y, k.y + 1);
+      e.z = std::max(e.z, k.z + 1);
+    }
+  }
+}
+
+std::vector<int> LeafIndex::depths() const {
+  std::vector<int> out;
+  for (size_t d=0; d<extent_.size(); ++d) if (begin_[d + 1] > begin_[d]) out.push_back((int)d);
+  return out;
+}
+
+Key3 LeafIndex::extent(int d) const {
+  if (d < 0 || (size_t)d >= extent_.size()) return Key3{0, 0, 0};
+  return extent_[(size_t)d];
+}
+
+LeafIndex::Span LeafIndex::depth_span(int d) const {
+  if (d < 0 || (size_t)d >= extent_.size()) return Span{};
+  const size_t b = begin_[(size_t)d];
+  return Span{ x_.data() + b, y_.data() + b, z_.data() + b, p_.data() + b, begin_[(size_t)d + 1] - b };
+}
+
+LeafIndex::Span LeafIndex::slice_span(int d, uint32_t z) const {
+  if (d < 0 || (size_t)d >= extent_.size()) return Span{};
+  auto first = z_.begin() + (std::ptrdiff_t)begin_[(size_t)d];
+  auto last = z_.begin() + (std::ptrdiff_t)begin_[(size_t)d + 1];
+  auto lo = std::lower_bound(first, last, z);
+  auto hi = std::upper_bound(lo, last, z);
+  size_t b = (size_t)(lo - z_.begin());
+  return Span{ x_.data() + b, y_.data() + b, z_.data() + b, p_.data() + b, (size_t)(hi - lo) };
+}
+
+LeafColumns LeafIndex::columns() const {
+  LeafColumns c;
+  c.x = x_.data(); c.y = y_.data(); c.z = z_.data(); c.d = d_.data(); c.p = p_.data();
+  c.size = p_.size();
+  return c;
+}
+
+size_t render_slice(const LeafIndex& idx, int d, uint32_t z,
+                    double* out, int width, int height, double background)
+{
+  if (!out || width <= 0 || height <= 0) return 0;
+  std::fill(out, out + (size_t)width * (size_t)height, background);
+  const auto s = idx.slice_span(d, z);
+  size_t drawn = 0;
+  for (size_t i=0; i<s.size; ++i) {
+    if (s.x[i] >= (uint32_t)width || s.y[i] >= (uint32_t)height) continue;
+    out[(size_t)s.y[i] * (size_t)width + s.x[i]] = s.p[i];
+    ++drawn;
+  }
+  return drawn;
+}
+
+size_t render_projection(const LeafIndex& idx, int d, Projection mode,
+                         double* out, int width, int height, double background)
+{
+  const auto s = idx.depth_span(d);
+  LeafColumns c;
+  c.x = s.x; c.y = s.y; c.z = s.z; c.p = s.p; c.size = s.size;
+  return project_columns(c, d, Axis::Z, 0, UINT32_MAX, mode, out, width, height, background);
+}
+
+namespace {
+
+// Leaves per worker below which extra threads cost more than they save
+constexpr size_t kLeavesPerThread = size_t(1) << 16;
+
+int worker_count(int threads, size_t work, size_t per_thread) {
+  size_t T = threads > 0 ? (size_t)threads : (size_t)std::max(1u, std::thread::hardware_concurrency());
+  T = std::min(T, std::max<size_t>(1, work / std::max<size_t>(1, per_thread)));
+  return (int)T;
+}
+
+template <class Fn>
+void run_workers(int T, Fn&& fn) {
+  if (T <= 1) { fn(0); return; }
+  std::vector<std::thread> pool; pool.reserve((size_t)T);
+  for (int t=0; t<T; ++t) pool.emplace_back([&fn, t]{ fn(t); });
+  for (auto& th : pool) th.join();
+}
+
+} // namespace
+
+size_t project_columns(const LeafColumns& c, int d, Axis axis, uint32_t lo, uint32_t hi,
+                       Projection mode, double* out, int width, int height,
+                       double background, int threads)
+{
+  if (!out || width <= 0 || height <= 0) return 0;
+  const size_t N = (size_t)width * (size_t)height;
+  const bool usable = c.size && c.x && c.y && c.z && c.p && lo <= hi;
+  // Private accumulators are N cells each: cap workers so they stay proportional to leaves
+  const int T = usable ? std::min(worker_count(threads, c.size, kLeavesPerThread),
+                                  (int)std::max<size_t>(1, c.size / N)) : 1;
+  const uint32_t* a = axis == Axis::X ? c.x : axis == Axis::Y ? c.y : c.z;
+  const uint32_t* u = axis == Axis::X ? c.y : c.x;
+  const uint32_t* v = axis == Axis::Z ? c.y : c.z;
+
+  std::vector<double> acc((size_t)T * N, 0.0);
+  std::vector<uint32_t> hits((size_t)T * N, 0);
+  std::vector<size_t> drawn((size_t)T, 0);
+  if (usable) run_workers(T, [&](int t) {
+    const size_t b = c.size * (size_t)t / (size_t)T, e = c.size * (size_t)(t + 1) / (size_t)T;
+    double* A = acc.data() + (size_t)t * N;
+    uint32_t* H = hits.data() + (size_t)t * N;
+    size_t n = 0;
+    for (size_t i=b; i<e; ++i) {
+      if (c.d && c.d[i] != d) continue;
+      if (a[i] < lo || a[i] > hi) continue;
+      if (u[i] >= (uint32_t)width || v[i] >= (uint32_t)height) continue;
+      const size_t k = (size_t)v[i] * (size_t)width + u[i];
+      if (mode == Projection::Max) A[k] = H[k] ? std::max(A[k], c.p[i]) : c.p[i];
+      else A[k] += c.p[i];
+      ++H[k];
+      ++n;
+    }
+    drawn[(size_t)t] = n;
+  });
+
+  // Merge worker buffers by cell range
+  const int M = worker_count(threads, N * (size_t)T, kLeavesPerThread);
+  run_workers(M, [&](int m) {
+    const size_t b = N * (size_t)m / (size_t)M, e = N * (size_t)(m + 1) / (size_t)M;
+    for (size_t k=b; k<e; ++k) {
+      double r = 0.0; uint32_t h = 0;
+      for (int t=0; t<T; ++t) {
+        const size_t j = (size_t)t * N + k;
+        if (!hits[j]) continue;
+        if (mode == Projection::Max) r = h ? std::max(r, acc[j]) : acc[j];
+        else r += acc[j];
+        h += hits[j];
+      }
+      if (!h) out[k] = background;
+      else out[k] = mode == Projection::Mean ? r / (double)h : r;
+    }
+  });
+
+  size_t total = 0;
+  for (size_t n : drawn) total += n;
+  return total;
+}
+
+size_t slice_columns(const LeafColumns& c, int d, Axis axis, uint32_t coord,
+                     double* out, int width, int height, double background, int threads)
+{
+  return project_columns(c, d, axis, coord, coord, Projection::Max,
+                         out, width, height, background, threads);
+}
+
+size_t depth_histogram(const LeafColumns& c, int max_depth, int bins, double lo, double hi,
+                       uint64_t* out, int threads)
+{
+  if (!out || max_depth < 0 || bins <= 0) return 0;
+  const size_t R = (size_t)max_depth + 1, N = R * (size_t)bins;
+  std::fill(out, out + N, uint64_t(0));
+  if (!c.p || !c.size || !(hi > lo)) return 0;
+  const int T = worker_count(threads, c.size, kLeavesPerThread);
+  const double scale = (double)bins / (hi - lo);
+
+  std::vector<uint64_t> counts((size_t)T * N, 0);
+  run_workers(T, [&](int t) {
+    const size_t b = c.size * (size_t)t / (size_t)T, e = c.size * (size_t)(t + 1) / (size_t)T;
+    uint64_t* C = counts.data() + (size_t)t * N;
+    for (size_t i=b; i<e; ++i) {
+      const int dd = c.d ? c.d[i] : 0;
+      const double p = c.p[i];
+      if (dd < 0 || dd > max_depth || !(p >= lo && p <= hi)) continue;
+      const int bin = std::min(bins - 1, (int)((p - lo) * scale));
+      ++C[(size_t)dd * (size_t)bins + (size_t)bin];
+    }
+  });
+  size_t total = 0;
+  for (int t=0; t<T; ++t)
+    for (size_t k=0; k<N; ++k) { out[k] += counts[(size_t)t * N + k]; total += counts[(size_t)t * N + k]; }
+  return total;
+}
+
+} // namespace octoweave
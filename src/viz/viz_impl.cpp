@@ -1,50 +1,61 @@
 #include "octoweave/viz.hpp"
+#include "octoweave/csv.hpp"
 #include <vector>
 #include <string>
 #include <fstream>
-#include <sstream>
-#include <unordered_map>
+#include <map>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
 #include <limits>
 #include <cmath>
+#include <thread>
 
 namespace octoweave {
 
 namespace {
-struct Rec { int x,y,z,d; double p; };
-
-static bool parse_csv(const std::string& path, std::vector<Rec>& out) {
-  std::ifstream f(path);
-  if (!f) return false;
-  std::string line;
-  while (std::getline(f, line)) {
-    if (line.empty()) continue;
-    std::istringstream ss(line);
-    std::string tok;
-    Rec r{};
-    if (!std::getline(ss, tok, ',')) return false; r.x = std::stoi(tok);
-    if (!std::getline(ss, tok, ',')) return false; r.y = std::stoi(tok);
-    if (!std::getline(ss, tok, ',')) return false; r.z = std::stoi(tok);
-    if (!std::getline(ss, tok, ',')) return false; r.d = std::stoi(tok);
-    if (!std::getline(ss, tok, ',')) return false; r.p = std::stod(tok);
-    out.push_back(r);
-  }
-  return true;
+enum class ImageFormat { P2, P5, P6 };
+
+static bool parse_format(const std::string& s, ImageFormat& f) {
+  if (s == "pgm" || s == "p2") { f = ImageFormat::P2; return true; }
+  if (s == "p5") { f = ImageFormat::P5; return true; }
+  if (s == "ppm" || s == "p6") { f = ImageFormat::P6; return true; }
+  return false;
 }
 
-static bool write_pgm(const std::string& path, int W, int H, const std::vector<int>& img) {
-  std::ofstream o(path);
+// Viridis-like ramp for PPM output
+static void colormap(uint8_t v, uint8_t rgb[3]) {
+  static const uint8_t stops[5][3] = { {68,1,84}, {59,82,139}, {33,145,140}, {94,201,98}, {253,231,37} };
+  double t = v / 255.0 * 4.0;
+  int i = std::min(3, (int)t); double f = t - i;
+  for (int c=0;c<3;++c) rgb[c] = (uint8_t)std::lround(stops[i][c] + f * (stops[i+1][c] - stops[i][c]));
+}
+
+static bool write_image(const std::string& path, int W, int H, const std::vector<uint8_t>& img, ImageFormat fmt) {
+  std::ofstream o(path, std::ios::binary);
   if (!o) return false;
-  o << "P2\n" << W << " " << H << "\n255\n";
-  for (int y=0;y<H;++y){
-    for (int x=0;x<W;++x){ o << img[y*W + x]; if (x+1<W) o << ' '; }
-    o << '\n';
+  if (fmt == ImageFormat::P2) {
+    o << "P2\n" << W << " " << H << "\n255\n";
+    for (int y=0;y<H;++y){
+      for (int x=0;x<W;++x){ o << (int)img[y*W + x]; if (x+1<W) o << ' '; }
+      o << '\n';
+    }
+  } else if (fmt == ImageFormat::P5) {
+    o << "P5\n" << W << " " << H << "\n255\n";
+    o.write(reinterpret_cast<const char*>(img.data()), (std::streamsize)img.size());
+  } else {
+    o << "P6\n" << W << " " << H << "\n255\n";
+    std::vector<uint8_t> rgb(img.size() * 3);
+    for (size_t i=0;i<img.size();++i) colormap(img[i], &rgb[3*i]);
+    o.write(reinterpret_cast<const char*>(rgb.data()), (std::streamsize)rgb.size());
   }
-  return true;
+  return (bool)o;
 }
 
-static bool write_hist_svg(const std::string& path, const std::unordered_map<int,int>& counts) {
+static bool write_hist_svg(const std::string& path, const std::map<int,size_t>& counts) {
   int W = 400, H = 200, pad = 20;
-  int max_count = 1;
+  size_t max_count = 1;
   for (auto& kv : counts) if (kv.second > max_count) max_count = kv.second;
   std::ofstream o(path);
   if (!o) return false;
@@ -52,7 +63,7 @@ static bool write_hist_svg(const std::string& path, const std::unordered_map<int
   o << "<rect x=\"0\" y=\"0\" width=\""<<W<<"\" height=\""<<H<<"\" fill=\"white\"/>\n";
   int n = (int)counts.size(); if (n==0) n=1; double barW = (W - 2*pad) / (double)n;
   int i=0; for (auto& kv : counts) {
-    int d = kv.first, c = kv.second;
+    int d = kv.first; size_t c = kv.second;
     double h = (H - 2*pad) * (c / (double)max_count);
     double x = pad + i*barW; double y = H - pad - h;
     o << "<rect x=\""<<x<<"\" y=\""<<y<<"\" width=\""<<barW-2<<"\" height=\""<<h<<"\" fill=\"#4a90e2\"/>\n";
@@ -62,49 +73,173 @@ static bool write_hist_svg(const std::string& path, const std::unordered_map<int
   o << "</svg>\n";
   return true;
 }
+
+static uint8_t to_gray(double p) {
+  return (uint8_t)std::lround(std::max(0.0, std::min(1.0, p)) * 255.0);
+}
+
+// "0:15,20,30:40:5" -> 0..15, 20, 30,35,40 (inclusive ranges with optional step)
+static bool parse_int_list(const std::string& s, std::vector<int>& out) {
+  size_t pos = 0;
+  while (pos <= s.size()) {
+    size_t end = s.find(',', pos); if (end == std::string::npos) end = s.size();
+    std::string item = s.substr(pos, end - pos);
+    if (item.empty()) return false;
+    int v[3] = {0, 0, 1}; int nv = 0;
+    size_t p = 0;
+    while (nv < 3) {
+      size_t c = item.find(':', p);
+      std::string tok = item.substr(p, c == std::string::npos ? std::string::npos : c - p);
+      try { size_t used = 0; v[nv++] = std::stoi(tok, &used); if (used != tok.size()) return false; }
+      catch (...) { return false; }
+      if (c == std::string::npos) break;
+      p = c + 1;
+      if (nv == 3) return false;
+    }
+    if (nv == 1) out.push_back(v[0]);
+    else {
+      if (v[2] <= 0 || v[1] < v[0]) return false;
+      for (int x = v[0]; x <= v[1]; x += v[2]) out.push_back(x);
+    }
+    pos = end + 1;
+  }
+  std::sort(out.begin(), out.end());
+  out.erase(std::unique(out.begin(), out.end()), out.end());
+  return true;
+}
+
+// Substitute {d} and {z}; without placeholders insert _d<d>_z<z> before the extension
+static std::string expand_out(const std::string& pattern, int d, int z) {
+  std::string s = pattern;
+  bool any = false;
+  for (const auto& kv : { std::make_pair(std::string("{d}"), d), std::make_pair(std::string("{z}"), z) }) {
+    size_t p;
+    while ((p = s.find(kv.first)) != std::string::npos) { s.replace(p, kv.first.size(), std::to_string(kv.second)); any = true; }
+  }
+  if (any) return s;
+  size_t slash = s.find_last_of('/');
+  size_t dot = s.find_last_of('.');
+  if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) dot = s.size();
+  return s.substr(0, dot) + "_d" + std::to_string(d) + "_z" + std::to_string(z) + s.substr(dot);
+}
+
+// Read once, scatter every kept row into its (depth, slice) image, write images in parallel.
+// Images of one depth share a size: the x/y extent of that depth over all requested slices.
+static int run_batch(const std::string& csv, const std::string& out_pattern, const std::string& out_svg,
+                     std::vector<int> depths, const std::vector<int>& slices, ImageFormat fmt, int threads)
+{
+  CsvReadOptions ropt; ropt.threads = threads; ropt.depths = depths;
+  ropt.slices.assign(slices.begin(), slices.end());
+  CsvReadResult res;
+  if (!read_leaves_csv(csv, ropt, res)) return 3;
+  if (depths.empty()) depths.push_back(res.depth_counts.empty() ? 0 : std::max(0, res.depth_counts.rbegin()->first));
+
+  const size_t D = depths.size(), S = slices.size();
+  auto depth_index = [&](int d) -> long {
+    auto it = std::lower_bound(depths.begin(), depths.end(), d);
+    return (it != depths.end() && *it == d) ? (long)(it - depths.begin()) : -1;
+  };
+  auto slice_index = [&](uint32_t z) -> long {
+    auto it = std::lower_bound(slices.begin(), slices.end(), (int)z);
+    return (it != slices.end() && *it == (int)z) ? (long)(it - slices.begin()) : -1;
+  };
+
+  std::vector<int> W(D, 1), H(D, 1);
+  for (const auto& r : res.leaves) {
+    long di = depth_index(r.d); if (di < 0) continue;
+    W[(size_t)di] = std::max(W[(size_t)di], (int)r.x + 1);
+    H[(size_t)di] = std::max(H[(size_t)di], (int)r.y + 1);
+  }
+  std::vector<std::vector<uint8_t>> imgs(D * S);
+  for (size_t di=0; di<D; ++di)
+    for (size_t si=0; si<S; ++si) imgs[di*S + si].assign((size_t)W[di] * (size_t)H[di], 0);
+  for (const auto& r : res.leaves) {
+    long di = depth_index(r.d), si = slice_index(r.z);
+    if (di < 0 || si < 0) continue;
+    imgs[(size_t)di*S + (size_t)si][(size_t)r.y * (size_t)W[(size_t)di] + r.x] = to_gray(r.p);
+  }
+
+  int T = threads > 0 ? threads : (int)std::max(1u, std::thread::hardware_concurrency());
+  T = std::max(1, std::min(T, (int)imgs.size()));
+  std::atomic<size_t> next{0};
+  std::atomic<bool> ok{true};
+  std::vector<std::thread> pool; pool.reserve((size_t)T);
+  for (int t=0; t<T; ++t) {
+    pool.emplace_back([&]{
+      while (true) {
+        size_t i = next.fetch_add(1);
+        if (i >= imgs.size()) break;
+        size_t di = i / S, si = i % S;
+        if (!write_image(expand_out(out_pattern, depths[di], slices[si]), W[di], H[di], imgs[i], fmt)) ok = false;
+      }
+    });
+  }
+  for (auto& th : pool) th.join();
+  if (!ok) return 4;
+  if (!out_svg.empty()) { if (!write_hist_svg(out_svg, res.depth_counts)) return 5; }
+  return 0;
+}
 }
 
 int viz_main(int argc, char** argv) {
   // Parse args
   std::string csv, out_img, out_svg; int slice_z = 0; int depth = std::numeric_limits<int>::min();
+  int threads = 0;
+  std::string slices_arg, depths_arg, format = "pgm";
   for (int i=1;i<argc;++i) {
     std::string a = argv[i];
-    auto need = [&](int& i){ return (i+1<argc) ? i+1 : i; };
     if (a == "--csv" && i+1<argc) { csv = argv[++i]; }
     else if (a == "--out" && i+1<argc) { out_img = argv[++i]; }
     else if (a == "--hist" && i+1<argc) { out_svg = argv[++i]; }
     else if (a == "--slice_z" && i+1<argc) { slice_z = std::stoi(argv[++i]); }
     else if (a == "--depth" && i+1<argc) { depth = std::stoi(argv[++i]); }
+    else if (a == "--threads" && i+1<argc) { threads = std::stoi(argv[++i]); }
+    else if (a == "--slices" && i+1<argc) { slices_arg = argv[++i]; }
+    else if (a == "--depths" && i+1<argc) { depths_arg = argv[++i]; }
+    else if (a == "--format" && i+1<argc) { format = argv[++i]; }
   }
-  if (csv.empty() || out_img.empty()) {
-    std::fprintf(stderr, "Usage: octoweave_viz --csv file.csv --slice_z k --out out.pgm [--depth d] [--hist out.svg]\n");
+  ImageFormat fmt;
+  if (csv.empty() || out_img.empty() || !parse_format(format, fmt)) {
+    std::fprintf(stderr, "Usage: octoweave_viz --csv file.csv --slice_z k --out out.pgm [--depth d] [--hist out.svg] [--threads t]\n"
+                         "       octoweave_viz --csv file.csv --slices 0:31 [--depths 3,5] --out 'slice_d{d}_z{z}.pgm'\n"
+                         "                     [--format pgm|p5|ppm] [--hist out.svg] [--threads t]\n");
     return 2;
   }
 
-  std::vector<Rec> recs; if (!parse_csv(csv, recs)) return 3;
-  // Determine depth if not provided (use max)
+  // Batch: one read for every requested (depth, slice) image
+  if (!slices_arg.empty() || !depths_arg.empty()) {
+    std::vector<int> slices, depths;
+    if (!slices_arg.empty() && !parse_int_list(slices_arg, slices)) return 2;
+    if (!depths_arg.empty() && !parse_int_list(depths_arg, depths)) return 2;
+    if (slices.empty()) slices.push_back(slice_z);
+    if (depths.empty() && depth != std::numeric_limits<int>::min()) depths.push_back(depth);
+    return run_batch(csv, out_img, out_svg, depths, slices, fmt, threads);
+  }
+
+  // Filter while parsing; without --depth keep the whole z-slice and pick the max depth
+  CsvReadOptions ropt; ropt.threads = threads; ropt.depth = depth == std::numeric_limits<int>::min() ? -1 : depth;
+  ropt.slice_z = slice_z < 0 ? std::numeric_limits<int64_t>::max() : slice_z;
+  CsvReadResult res;
+  if (!read_leaves_csv(csv, ropt, res)) return 3;
+  const std::map<int,size_t>& counts = res.depth_counts;
   if (depth == std::numeric_limits<int>::min()) {
-    depth = 0; for (auto& r : recs) depth = std::max(depth, r.d);
+    depth = 0; if (!counts.empty()) depth = std::max(depth, counts.rbegin()->first);
   }
 
   // Build slice image
   int xmax=0, ymax=0; bool any=false;
-  for (auto& r : recs) if (r.d==depth && r.z==slice_z) { xmax = std::max(xmax, r.x); ymax = std::max(ymax, r.y); any=true; }
+  for (auto& r : res.leaves) if (r.d==depth) { xmax = std::max(xmax, (int)r.x); ymax = std::max(ymax, (int)r.y); any=true; }
   int W = xmax+1, H = ymax+1;
   if (!any) { W = H = 1; }
-  std::vector<int> img(W*H, 0);
-  std::unordered_map<int,int> counts;
-  for (auto& r : recs) {
-    counts[r.d] += 1;
-    if (r.d!=depth || r.z!=slice_z) continue;
-    int val = (int)std::lround(std::max(0.0, std::min(1.0, r.p)) * 255.0);
-    int idx = r.y*W + r.x; if (idx >= 0 && idx < (int)img.size()) img[idx] = val;
+  std::vector<uint8_t> img((size_t)W*H, 0);
+  for (auto& r : res.leaves) {
+    if (r.d!=depth) continue;
+    size_t idx = (size_t)r.y*W + r.x; if (idx < img.size()) img[idx] = to_gray(r.p);
   }
-  if (!write_pgm(out_img, W, H, img)) return 4;
+  if (!write_image(out_img, W, H, img, fmt)) return 4;
   if (!out_svg.empty()) { if (!write_hist_svg(out_svg, counts)) return 5; }
 
   return 0;
 }
 
 } // namespace octoweave
-
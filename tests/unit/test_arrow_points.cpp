@@ -0,0 +1,130 @@
+#include <catch2/catch_test_macros.hpp>
+#include "octoweave/arrow_points.hpp"
+#include <string>
+#include <vector>
+
+using namespace octoweave;
+
+namespace {
+
+// Minimal producer: a record batch of float columns owned by the test
+struct Batch {
+  std::vector<std::vector<double>> cols;
+  std::vector<std::string> names;
+  const char* format = "g";
+  int64_t offset = 0;
+
+  std::vector<ArrowSchema> child_schema;
+  std::vector<ArrowSchema*> child_schema_ptr;
+  std::vector<ArrowArray> child_array;
+  std::vector<ArrowArray*> child_array_ptr;
+  std::vector<std::vector<const void*>> bufs;
+  const void* struct_bufs[1] = { nullptr };
+  ArrowSchema schema{};
+  ArrowArray array{};
+
+  void finish() {
+    const size_t n = cols.size();
+    child_schema.assign(n, ArrowSchema{}); child_array.assign(n, ArrowArray{});
+    bufs.assign(n, {});
+    for (size_t i=0; i<n; ++i) {
+      child_schema[i].format = format; child_schema[i].name = names[i].c_str();
+      bufs[i] = { nullptr, cols[i].data() };
+      child_array[i].length = (int64_t)cols[i].size();
+      child_array[i].n_buffers = 2; child_array[i].buffers = bufs[i].data();
+    }
+    for (auto& s : child_schema) child_schema_ptr.push_back(&s);
+    for (auto& a : child_array) child_array_ptr.push_back(&a);
+    schema.format = "+s"; schema.n_children = (int64_t)n; schema.children = child_schema_ptr.data();
+    array.length = (int64_t)cols[0].size() - offset; array.offset = offset;
+    array.n_buffers = 1; array.buffers = struct_bufs;
+    array.n_children = (int64_t)n; array.children = child_array_ptr.data();
+  }
+};
+
+// Stream over `batches`, each exported as a shallow copy with a no-op release
+struct Stream {
+  std::vector<Batch*> batches;
+  size_t next = 0;
+  int released = 0;
+};
+
+int stream_schema(ArrowArrayStream* s, ArrowSchema* out) {
+  auto* st = static_cast<Stream*>(s->private_data);
+  *out = st->batches[0]->schema; out->release = [](ArrowSchema* a) { a->release = nullptr; };
+  return 0;
+}
+int stream_next(ArrowArrayStream* s, ArrowArray* out) {
+  auto* st = static_cast<Stream*>(s->private_data);
+  if (st->next == st->batches.size()) { *out = ArrowArray{}; return 0; }
+  *out = st->batches[st->next++]->array;
+  out->release = [](ArrowArray* a) { a->release = nullptr; };
+  return 0;
+}
+const char* stream_error(ArrowArrayStream*) { return nullptr; }
+void stream_release(ArrowArrayStream* s) {
+  ++static_cast<Stream*>(s->private_data)->released; s->release = nullptr;
+}
+
+} // namespace
+
+TEST_CASE("Arrow: record batch columns are viewed in place") {
+  Batch b;
+  b.names = { "id", "z", "x", "y" };
+  b.cols = { { 0, 1, 2, 3 }, { 0.3, 1.3, 2.3, 3.3 }, { 0.1, 1.1, 2.1, 3.1 }, { 0.2, 1.2, 2.2, 3.2 } };
+  b.offset = 1;
+  b.finish();
+  PointSpan s;
+  REQUIRE(arrow_point_span(b.schema, b.array, ArrowColumns{}, s));
+  REQUIRE(s.size() == 3);
+  REQUIRE(s.data == b.cols[2].data() + 1);
+  REQUIRE(s[0].x == 1.1);
+  REQUIRE(s[2].y == 3.2);
+  REQUIRE(s[2].z == 3.3);
+
+  ArrowColumns named; named.x = "id";
+  REQUIRE(arrow_point_span(b.schema, b.array, named, s));
+  REQUIRE(s[1].x == 2.0);
+
+  std::string err;
+  ArrowColumns missing; missing.z = "w";
+  REQUIRE(!arrow_point_span(b.schema, b.array, missing, s, &err));
+  REQUIRE(err.find("'w'") != std::string::npos);
+  b.child_schema[1].format = "f"; // z as float32 while x, y are float64
+  REQUIRE(!arrow_point_span(b.schema, b.array, ArrowColumns{}, s));
+  b.child_schema[1].format = "g";
+  b.child_array[1].null_count = 1;
+  uint8_t validity = 0x7;
+  b.bufs[1][0] = &validity;
+  REQUIRE(!arrow_point_span(b.schema, b.array, ArrowColumns{}, s));
+}
+
+TEST_CASE("Arrow: streams are consumed batch by batch and released") {
+  Batch a, b;
+  for (Batch* x : { &a, &b }) x->names = { "x", "y", "z" };
+  a.cols = { { 1, 2 }, { 3, 4 }, { 5, 6 } };
+  b.cols = { { 7 }, { 8 }, { 9 } };
+  a.finish(); b.finish();
+  Stream st; st.batches = { &a, &b };
+  ArrowArrayStream s{ stream_schema, stream_next, stream_error, stream_release, &st };
+
+  std::vector<Pt> seen;
+  long n = consume_arrow_stream(&s, ArrowColumns{}, [&](const PointSpan& span) {
+    for (size_t i=0; i<span.size(); ++i) seen.push_back(span[i]);
+  });
+  REQUIRE(n == 2);
+  REQUIRE(seen.size() == 3);
+  REQUIRE(seen[1].y == 4.0);
+  REQUIRE(seen[2].z == 9.0);
+  REQUIRE(st.released == 1);
+  REQUIRE(s.release == nullptr);
+
+  // Columnar spans build the same chunk as interleaved points
+  OctoChunker::Params p; p.max_depth_cap = 6;
+  std::vector<Pt> pts = { { 1, 3, 5 }, { 2, 4, 6 } };
+  auto w1 = OctoChunker::build_and_export(PointSpan::columns(a.cols[0].data(), a.cols[1].data(),
+                                                             a.cols[2].data(), 2), p);
+  auto w2 = OctoChunker::build_and_export(pts, p);
+  REQUIRE(w1.Ptd.size() == w2.Ptd.size());
+  for (const auto& kv : w2.Ptd) REQUIRE(w1.Ptd.at(kv.first) == kv.second);
+}
@@ -0,0 +1,61 @@
+#include <catch2/catch_test_macros.hpp>
+#include "octoweave/csv.hpp"
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+using namespace octoweave;
+
+TEST_CASE("csv reader: filters while parsing and counts depths") {
+  namespace fs = std::filesystem;
+  const fs::path dir = fs::temp_directory_path() / "octoweave_test_csv";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  const std::string path = (dir / "leaves.csv").string();
+  {
+    std::ofstream f(path, std::ios::binary);
+    f << "0,0,0,3,1.0\n";
+    f << "1,0,0,3,0.5\r\n";      // CRLF
+    f << "\n";                   // blank line
+    f << " 0, 1, 0, 3, 0.25\n";  // blanks around fields
+    f << "2,0,1,3,0.75\n";
+    f << "4,4,0,2,1e-1";         // no trailing newline
+  }
+
+  CsvReadResult all;
+  REQUIRE(read_leaves_csv(path, CsvReadOptions{}, all));
+  REQUIRE(all.rows == 5);
+  REQUIRE(all.leaves.size() == 5);
+  REQUIRE(all.depth_counts.size() == 2);
+  REQUIRE(all.depth_counts.at(3) == 4);
+  REQUIRE(all.depth_counts.at(2) == 1);
+  REQUIRE(all.leaves[2].y == 1);
+  REQUIRE(all.leaves[2].p == Approx(0.25));
+  REQUIRE(all.leaves[4].p == Approx(0.1));
+
+  CsvReadOptions opt; opt.depth = 3; opt.slice_z = 0;
+  CsvReadResult sl;
+  REQUIRE(read_leaves_csv(path, opt, sl));
+  REQUIRE(sl.leaves.size() == 3);
+  REQUIRE(sl.depth_counts.at(2) == 1); // counts are taken before filtering
+
+  // Any split into ranges yields the same rows in file order
+  for (int t : { 2, 3, 7, 64 }) {
+    CsvReadOptions o; o.threads = t;
+    CsvReadResult r;
+    REQUIRE(read_leaves_csv(path, o, r));
+    REQUIRE(r.leaves.size() == all.leaves.size());
+    for (size_t i=0; i<r.leaves.size(); ++i) {
+      REQUIRE(r.leaves[i].x == all.leaves[i].x);
+      REQUIRE(r.leaves[i].z == all.leaves[i].z);
+      REQUIRE(r.leaves[i].p == Approx(all.leaves[i].p));
+    }
+  }
+
+  const std::string bad_path = (dir / "bad.csv").string();
+  { std::ofstream f(bad_path); f << "1,2,3\n"; }
+  CsvReadResult bad;
+  REQUIRE(!read_leaves_csv(bad_path, CsvReadOptions{}, bad));
+  REQUIRE(!read_leaves_csv((dir / "missing.csv").string(), CsvReadOptions{}, bad));
+  fs::remove_all(dir);
+}
@@ -35,11 +35,25 @@ TEST_CASE("End-to-end: points -> chunks -> hierarchy -> forest -> viz") {
   REQUIRE(leaf_count >= 8); // should have at least one leaf per chunk
 
   // 4) p4est mapping (stub)
-  P4estBuilder::prepare_want_sets(H, P4estBuilder::Config{2});
+  P4estBuilder::Config cfg; cfg.n = 2;
+  P4estBuilder::prepare_want_sets(H, cfg);
+
+  // Block mapping from the chunk grid: every leaf lands in the tree of the chunk that built it
+  P4estBuilder::TreeMap tm(2, P4estBuilder::TreeMapping::Block, P4estBuilder::block_layout(grid, params));
+  for (int c=0; c<8; ++c) for (const auto& pt : per_chunk[c]) {
+    Key3 k = OctoChunker::coord_to_key(pt, params, H.td);
+    auto split = P4estBuilder::split_global_to_tree_local(k, H.td, tm);
+    int t = (int)(split.first.x + 2 * (split.first.y + 2 * split.first.z));
+    REQUIRE(t == std::get<3>(grid.which(pt.x, pt.y, pt.z)));
+  }
+  auto stats = P4estBuilder::tree_stats(H, tm);
+  for (auto& s : stats) REQUIRE(s.leaf_count == 2);
 
   // 5) Viz: export leaves to CSV and render one slice
-  std::filesystem::create_directories("e2e_tmp");
-  std::string csv = "e2e_tmp/leaves.csv";
+  const std::filesystem::path dir = std::filesystem::temp_directory_path() / "octoweave_test_e2e";
+  std::filesystem::remove_all(dir);
+  std::filesystem::create_directories(dir);
+  std::string csv = (dir / "leaves.csv").string();
   std::ofstream f(csv);
   int slice_z = -1; int slice_depth = H.td;
   for (auto& kv : H.nodes) if (kv.second.is_leaf) {
@@ -49,7 +63,7 @@ TEST_CASE("End-to-end: points -> chunks -> hierarchy -> forest -> viz") {
   }
   f.close(); if (slice_z < 0) slice_z = 0;
 
-  std::string out = "e2e_tmp/slice.pgm";
+  std::string out = (dir / "slice.pgm").string();
   std::string s_slice = std::to_string(slice_z);
   std::string s_depth = std::to_string(slice_depth);
   std::vector<const char*> argv {
@@ -64,4 +78,6 @@ TEST_CASE("End-to-end: points -> chunks -> hierarchy -> forest -> viz") {
   REQUIRE(magic == "P2");
   int sum=0; for (int i=0;i<W*HH;++i){ int v; pgm >> v; sum += v; }
   REQUIRE(sum > 0);
+  pgm.close();
+  std::filesystem::remove_all(dir);
 }
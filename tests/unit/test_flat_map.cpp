@@ -0,0 +1,61 @@
+#include <catch2/catch_test_macros.hpp>
+#include "octoweave/flat_map.hpp"
+#include <random>
+#include <unordered_map>
+
+using namespace octoweave;
+
+TEST_CASE("Morton packing round-trips and nests parent/child like Key3") {
+  std::mt19937 rng(5);
+  std::uniform_int_distribution<uint32_t> c(0, (1u << kMortonAxisBits) - 1);
+  for (int i=0; i<1000; ++i) {
+    const Key3 k{ c(rng), c(rng), c(rng) };
+    REQUIRE(morton_fits(k));
+    REQUIRE(morton_decode(morton_encode(k)) == k);
+    const Key3 parent{ k.x >> 1, k.y >> 1, k.z >> 1 };
+    REQUIRE(morton_encode(k) >> 3 == morton_encode(parent));
+    REQUIRE((int)(morton_encode(k) & 7) == (int)((k.x & 1) | ((k.y & 1) << 1) | ((k.z & 1) << 2)));
+  }
+  REQUIRE(!morton_fits(Key3{ 1u << kMortonAxisBits, 0, 0 }));
+}
+
+TEST_CASE("FlatMap matches std::unordered_map under growth and reuse") {
+  std::mt19937 rng(9);
+  std::uniform_int_distribution<uint32_t> c(0, 63);
+  FlatMap<uint64_t, double> fm;
+  for (int round=0; round<3; ++round) {
+    std::unordered_map<uint64_t, double> ref;
+    for (int i=0; i<20000; ++i) {
+      const uint64_t k = morton_encode(Key3{ c(rng), c(rng), c(rng) });
+      fm[k] += 1.0; ref[k] += 1.0;
+    }
+    REQUIRE(fm.size() == ref.size());
+    size_t seen = 0;
+    for (const auto& kv : fm) { REQUIRE(ref.at(kv.first) == kv.second); ++seen; }
+    REQUIRE(seen == ref.size());
+    REQUIRE(fm.find(morton_encode(Key3{ 64, 0, 0 })) == nullptr);
+    const size_t cap = fm.capacity();
+    fm.clear();
+    REQUIRE(fm.empty());
+    REQUIRE(fm.capacity() == cap);
+    REQUIRE(fm.begin() == fm.end());
+  }
+}
+
+TEST_CASE("FlatMap with Key3 keys, reserve and a caller resource") {
+  std::pmr::monotonic_buffer_resource arena;
+  FlatMap<Key3, int> fm(&arena);
+  fm.reserve(1000);
+  const size_t cap = fm.capacity();
+  for (uint32_t i=0; i<1000; ++i) {
+    auto r = fm.try_emplace(Key3{ i, i * 3u, 0xffffffffu - i });
+    REQUIRE(r.second);
+    *r.first = (int)i;
+  }
+  REQUIRE(fm.capacity() == cap);
+  REQUIRE(!fm.try_emplace(Key3{ 7, 21, 0xffffffffu - 7 }).second);
+  for (uint32_t i=0; i<1000; ++i) REQUIRE(*fm.find(Key3{ i, i * 3u, 0xffffffffu - i }) == (int)i);
+  FlatMap<Key3, int> moved(std::move(fm));
+  REQUIRE(moved.size() == 1000);
+  REQUIRE(fm.size() == 0);
+}
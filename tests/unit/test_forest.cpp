@@ -0,0 +1,84 @@
+#include <catch2/catch_test_macros.hpp>
+#include "octoweave/p4est_builder.hpp"
+#include <cstdlib>
+#include <memory>
+
+using namespace octoweave;
+
+// Leaves at depth 4 per tree of a 2x2x2 brick (modulo mapping): `count[t]` leaves in tree t
+static Hierarchy make_hierarchy(const std::vector<int>& count, double p) {
+  Hierarchy H; H.base_depth = 1; H.td = 4;
+  for (uint32_t t=0; t<8; ++t) {
+    for (int i=0; i<count[t]; ++i) {
+      Key3 k{ (t & 1u) + 2u*(uint32_t)i, (t>>1) & 1u, (t>>2) & 1u };
+      H.nodes[NDKey{ k, (uint16_t)H.td }] = NodeRec{ p, true };
+    }
+  }
+  return H;
+}
+
+struct GlobalQuad { int64_t x0, y0, z0, len; int level; };
+
+// Every pair of touching quadrants (faces, edges, corners) differs by at most one level
+static bool is_balanced(const P4estBuilder::ForestHandle& fh, int n) {
+  const int kTop = 20; // global coordinates in units of 2^-kTop tree lengths
+  std::vector<GlobalQuad> qs;
+  fh.for_each_quadrant([&](const P4estBuilder::QuadrantView& q){
+    int64_t tx = q.tree % n, ty = (q.tree / n) % n, tz = q.tree / (n*n);
+    int64_t len = (int64_t)1 << (kTop - q.level);
+    qs.push_back(GlobalQuad{ (tx << kTop) + q.coord.x * len, (ty << kTop) + q.coord.y * len,
+                             (tz << kTop) + q.coord.z * len, len, q.level });
+  });
+  for (size_t i=0; i<qs.size(); ++i) for (size_t j=i+1; j<qs.size(); ++j) {
+    const auto& a = qs[i]; const auto& b = qs[j];
+    bool touch = a.x0 <= b.x0 + b.len && b.x0 <= a.x0 + a.len &&
+                 a.y0 <= b.y0 + b.len && b.y0 <= a.y0 + a.len &&
+                 a.z0 <= b.z0 + b.len && b.z0 <= a.z0 + a.len;
+    if (touch && std::abs(a.level - b.level) > 1) return false;
+  }
+  return true;
+}
+
+TEST_CASE("forest: uniform levels, quadrant counts and data") {
+  auto H = make_hierarchy({1,1,1,1,1,1,1,1}, 0.75);
+  P4estBuilder::Config cfg; cfg.n = 2; cfg.level_policy = P4estBuilder::Policy::uniform(1);
+  std::unique_ptr<P4estBuilder::ForestHandle> fh(P4estBuilder::build_forest_handle(H, cfg));
+  REQUIRE(fh);
+  REQUIRE(fh->num_quadrants() == 64);
+  size_t with_data = 0, visited = 0;
+  fh->for_each_quadrant([&](const P4estBuilder::QuadrantView& q){
+    ++visited;
+    REQUIRE(q.level == 1);
+    if (q.leaves) { ++with_data; REQUIRE(q.mean == Approx(0.75)); }
+  });
+  REQUIRE(visited == 64);
+  // One leaf per tree lands in exactly one quadrant of that tree
+  REQUIRE(with_data == 8);
+}
+
+TEST_CASE("forest: empty trees stay coarse and 2:1 balance grades neighbors") {
+  auto H = make_hierarchy({2,0,0,0,0,0,0,1}, 0.6);
+  std::vector<int> lv(8, 1); lv[0] = 4;
+  P4estBuilder::Config cfg; cfg.n = 2; cfg.level_policy = P4estBuilder::Policy::from_levels(lv);
+  std::unique_ptr<P4estBuilder::ForestHandle> fh(P4estBuilder::build_forest_handle(H, cfg));
+  REQUIRE(fh);
+  REQUIRE(is_balanced(*fh, 2));
+  // More than tree 0 at level 4 (4096) plus roots, less than refining all neighbors to 3
+  REQUIRE(fh->num_quadrants() > 4096 + 8 + 6);
+  REQUIRE(fh->num_quadrants() < 4096 + 7 * 512 + 8);
+}
+
+TEST_CASE("forest: adapt keeps the forest balanced") {
+  auto H = make_hierarchy({1,1,1,1,1,1,1,1}, 0.5);
+  std::vector<int> lv(8, 0);
+  P4estBuilder::Config cfg; cfg.n = 2; cfg.level_policy = P4estBuilder::Policy::from_levels(lv);
+  std::unique_ptr<P4estBuilder::ForestHandle> fh(P4estBuilder::build_forest_handle(H, cfg));
+  REQUIRE(fh->num_quadrants() == 8);
+  lv[3] = 3; cfg.level_policy = P4estBuilder::Policy::from_levels(lv);
+  REQUIRE(P4estBuilder::adapt_forest(fh.get(), H, cfg) == 0);
+  REQUIRE(is_balanced(*fh, 2));
+  REQUIRE(fh->num_quadrants() > 512 + 7);
+  lv[3] = 0; cfg.level_policy = P4estBuilder::Policy::from_levels(lv);
+  REQUIRE(P4estBuilder::adapt_forest(fh.get(), H, cfg) == 0);
+  REQUIRE(fh->num_quadrants() == 8);
+}
@@ -0,0 +1,60 @@
+#include <catch2/catch_test_macros.hpp>
+#include "octoweave/p4est_builder.hpp"
+#include <algorithm>
+#include <memory>
+
+using namespace octoweave;
+
+// One leaf per tree of a 2x2x2 brick (modulo mapping)
+static Hierarchy make_one_per_tree(double p) {
+  Hierarchy H; H.base_depth = 1; H.td = 4;
+  for (uint32_t t=0; t<8; ++t)
+    H.nodes[NDKey{ Key3{ t & 1u, (t>>1) & 1u, (t>>2) & 1u }, (uint16_t)H.td }] = NodeRec{ p, true };
+  return H;
+}
+
+static bool contains(const std::vector<int>& v, int t) { return std::find(v.begin(), v.end(), t) != v.end(); }
+
+TEST_CASE("adapt_forest: only changed trees are re-adapted") {
+  auto H = make_one_per_tree(0.8);
+  std::vector<int> lv(8, 2);
+  P4estBuilder::Config cfg; cfg.n = 2; cfg.level_policy = P4estBuilder::Policy::from_levels(lv);
+  std::unique_ptr<P4estBuilder::ForestHandle> fh(P4estBuilder::build_forest_handle(H, cfg));
+  REQUIRE(fh);
+  REQUIRE(fh->levels == lv);
+  const size_t q0 = fh->num_quadrants();
+
+  // Same hierarchy and levels: nothing to do
+  std::vector<int> touched{ -1 };
+  REQUIRE(P4estBuilder::adapt_forest(fh.get(), H, cfg, {}, &touched) == 0);
+  REQUIRE(touched.empty());
+
+  // Raise tree 5's level
+  lv[5] = 3; cfg.level_policy = P4estBuilder::Policy::from_levels(lv);
+  REQUIRE(P4estBuilder::adapt_forest(fh.get(), H, cfg, {}, &touched) == 0);
+  REQUIRE(contains(touched, 5));
+  REQUIRE(fh->levels[5] == 3);
+
+  // New evidence in tree 2 only
+  H.nodes[NDKey{ Key3{ 2, 1, 0 }, (uint16_t)H.td }] = NodeRec{ 0.9, true };
+  auto changed = P4estBuilder::changed_trees(*fh, P4estBuilder::resolve_levels(H, cfg),
+                                             P4estBuilder::tree_stats(H, cfg.tree_map()));
+  REQUIRE(changed == std::vector<int>{ 2 });
+  REQUIRE(P4estBuilder::adapt_forest(fh.get(), H, cfg, {}, &touched) == 0);
+  REQUIRE(contains(touched, 2));
+  REQUIRE(fh->stats[2].leaf_count == 2);
+
+  // Explicit dirty trees are refreshed even when their stats did not change
+  REQUIRE(P4estBuilder::adapt_forest(fh.get(), H, cfg, { 7 }, &touched) == 0);
+  REQUIRE(contains(touched, 7));
+
+  // Back to uniform levels: the forest returns to its original size
+  lv[5] = 2; cfg.level_policy = P4estBuilder::Policy::from_levels(lv);
+  REQUIRE(P4estBuilder::adapt_forest(fh.get(), H, cfg) == 0);
+  REQUIRE(fh->num_quadrants() == q0);
+
+  // Brick size must match the handle
+  cfg.n = 3;
+  REQUIRE(P4estBuilder::adapt_forest(fh.get(), H, cfg) == 1);
+  REQUIRE(P4estBuilder::adapt_forest(nullptr, H, cfg) == 1);
+}
@@ -36,3 +36,54 @@ TEST_CASE("Hierarchy missing children use p_unknown in rollup") {
   double expected = 1.0 - std::pow(1.0 - p_unknown, 7); // since one child has p=0
   REQUIRE(H.nodes.at(ndp).p == Approx(expected).epsilon(1e-12));
 }
+
+namespace {
+// Upstream for the scratch arenas that counts what it hands out
+struct CountingResource : std::pmr::memory_resource {
+  size_t allocs = 0, outstanding = 0;
+  void* do_allocate(size_t b, size_t a) override {
+    ++allocs; outstanding += b;
+    return std::pmr::new_delete_resource()->allocate(b, a);
+  }
+  void do_deallocate(void* p, size_t b, size_t a) override {
+    outstanding -= b;
+    std::pmr::new_delete_resource()->deallocate(p, b, a);
+  }
+  bool do_is_equal(const std::pmr::memory_resource& o) const noexcept override { return this == &o; }
+};
+}
+
+TEST_CASE("Hierarchy scratch resource backs the roll-up and is released in bulk") {
+  WorkerOut w; w.td = 6;
+  for (uint32_t i=0; i<2000; ++i) w.Ptd[{ (i * 7u) % 64, (i * 13u) % 64, i % 64 }] = 0.1 + 0.8 * ((i % 10) / 10.0);
+  const auto ref = make_hierarchy_from_workers({w}, 0.4, false, 0.5, 1);
+  CountingResource up;
+  const auto H = make_hierarchy_from_workers({w}, 0.4, false, 0.5, 1, &up);
+  REQUIRE(up.allocs > 0);
+  REQUIRE(up.outstanding == 0);
+  REQUIRE(H.nodes.size() == ref.nodes.size());
+  for (const auto& kv : ref.nodes) {
+    REQUIRE(H.nodes.count(kv.first) == 1);
+    REQUIRE(H.nodes.at(kv.first).is_leaf == kv.second.is_leaf);
+    REQUIRE(H.nodes.at(kv.first).p == kv.second.p);
+  }
+}
+
+TEST_CASE("Hierarchy with logodds16 storage stays within the documented bound") {
+  std::vector<WorkerOut> outs(3);
+  uint32_t s = 12345;
+  auto next = [&s] { s = s * 1664525u + 1013904223u; return s >> 8; };
+  for (auto& w : outs) {
+    w.td = 7;
+    for (int i=0; i<3000; ++i) w.Ptd[{ next() % 96, next() % 96, next() % 96 }] = (next() % 1000) / 999.0;
+  }
+  const auto ref = make_hierarchy_from_workers(outs, 0.0, false, 0.5, 1);
+  const auto H = make_hierarchy_from_workers(outs, 0.0, false, 0.5, 1, nullptr, ProbStorage::logodds16);
+  // tau = 0 refines everywhere, so both emit the same nodes
+  REQUIRE(H.nodes.size() == ref.nodes.size());
+  for (const auto& kv : ref.nodes) {
+    REQUIRE(H.nodes.count(kv.first) == 1);
+    REQUIRE(H.nodes.at(kv.first).is_leaf == kv.second.is_leaf);
+    REQUIRE(std::fabs(H.nodes.at(kv.first).p - kv.second.p) <= 5e-4);
+  }
+}
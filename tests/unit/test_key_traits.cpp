@@ -0,0 +1,56 @@
+#include <catch2/catch_test_macros.hpp>
+#include "octoweave/key_traits.hpp"
+#include <random>
+
+using namespace octoweave;
+
+static_assert(sizeof(KeyTraits<19>::Key) == 8, "depth <= 19 packs into 64 bits");
+static_assert(sizeof(KeyTraits<20>::Key) == 16, "deeper maps use 128-bit keys");
+
+template <class Traits>
+static void check_traits(uint32_t seed) {
+  std::mt19937 rng(seed);
+  const int D = Traits::kMaxDepth;
+  std::uniform_int_distribution<int> depth(1, D - 1);
+  for (int i=0; i<2000; ++i) {
+    const int d = depth(rng);
+    const uint32_t side_mask = d >= 32 ? 0xffffffffu : ((1u << d) - 1);
+    const Key3 k{ (uint32_t)rng() & side_mask, (uint32_t)rng() & side_mask, (uint32_t)rng() & side_mask };
+    REQUIRE(Traits::fits(k));
+    const auto key = Traits::make(k, d);
+    REQUIRE(Traits::nd(key) == (NDKey{ k, (uint16_t)d }));
+    REQUIRE(Traits::depth(Traits::parent(key)) == d - 1);
+    REQUIRE(Traits::key3(Traits::parent(key)) == parent_key(k));
+    REQUIRE(Traits::child_index(key) == child_index(k));
+    for (int c=0; c<8; ++c) {
+      const auto kc = Traits::child(key, c);
+      REQUIRE(Traits::nd(kc) == (NDKey{ child_key(k, c), (uint16_t)(d + 1) }));
+      REQUIRE(Traits::parent(kc) == key);
+    }
+  }
+}
+
+TEST_CASE("KeyTraits: packed keys agree with the Key3 helpers") {
+  check_traits<KeyTraits<19>>(3);
+  check_traits<KeyTraits<32>>(4);
+  REQUIRE(!KeyTraits<19>::fits(Key3{ 0, 1u << 19, 0 }));
+  const Key3 wide{ 0xfedcba98u, 0x01234567u, 0x80000001u };
+  REQUIRE(morton_decode_wide(morton_encode_wide(wide)) == wide);
+}
+
+TEST_CASE("Hierarchy builds deep maps with 128-bit keys") {
+  // A single occupied leaf at depth td yields one refined chain from base_depth down to it
+  for (int td : { 12, 24, 30 }) {
+    const Key3 leaf{ 0x2aaaaaau >> (30 - td), 0x1555555u >> (30 - td), 0x3000001u >> (30 - td) };
+    WorkerOut w; w.td = td;
+    w.Ptd[leaf] = 0.9;
+    const auto H = make_hierarchy_from_workers({ w }, 0.5, false, 0.5, 1);
+    REQUIRE(H.nodes.size() == (size_t)td);
+    for (int d=1; d<=td; ++d) {
+      const int s = td - d;
+      const NDKey nd{ Key3{ leaf.x >> s, leaf.y >> s, leaf.z >> s }, (uint16_t)d };
+      REQUIRE(H.nodes.count(nd) == 1);
+      REQUIRE(H.nodes.at(nd).is_leaf == (d == td));
+    }
+  }
+}
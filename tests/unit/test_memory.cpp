@@ -0,0 +1,42 @@
+#include <catch2/catch_test_macros.hpp>
+#include "octoweave/hierarchy.hpp"
+#include "octoweave/memory.hpp"
+#include <string>
+#include <vector>
+
+using namespace octoweave;
+
+static mem::PoolUsage pool(mem::Pool p) { return mem::usage()[(size_t)p]; }
+
+TEST_CASE("TrackingAllocator charges its pool and tracks the high-water mark") {
+  // rollup_buckets is only touched inside make_hierarchy_from_workers
+  const int64_t base = pool(mem::Pool::rollup_buckets).current_bytes;
+  mem::reset_peaks();
+  {
+    std::vector<double, mem::TrackingAllocator<double, mem::Pool::rollup_buckets>> v;
+    v.reserve(1000);
+    REQUIRE(pool(mem::Pool::rollup_buckets).current_bytes == base + 8000);
+    v.shrink_to_fit();
+  }
+  const auto u = pool(mem::Pool::rollup_buckets);
+  REQUIRE(u.current_bytes == base);
+  REQUIRE(u.peak_bytes >= base + 8000);
+  REQUIRE(std::string(u.name) == "rollup_buckets");
+  mem::reset_peaks();
+  REQUIRE(pool(mem::Pool::rollup_buckets).peak_bytes == base);
+}
+
+TEST_CASE("memory: pipeline containers are accounted when tracking is built in") {
+  if (!mem::tracking_enabled()) return;
+  WorkerOut w; w.td = 6;
+  for (uint32_t i=0; i<512; ++i) w.Ptd.emplace(Key3{ i % 64, i / 64, 3 }, 0.8);
+  const int64_t nodes0 = pool(mem::Pool::hierarchy_nodes).current_bytes;
+  mem::reset_peaks();
+  {
+    Hierarchy H = make_hierarchy_from_workers({ w }, 0.5, false, 0.5, 1);
+    REQUIRE(pool(mem::Pool::hierarchy_nodes).current_bytes > nodes0);
+  }
+  REQUIRE(pool(mem::Pool::hierarchy_nodes).current_bytes == nodes0);
+  REQUIRE(pool(mem::Pool::depth_maps).peak_bytes > pool(mem::Pool::depth_maps).current_bytes);
+  REQUIRE(pool(mem::Pool::rollup_buckets).peak_bytes > 0);
+}
@@ -1,5 +1,8 @@
 #include <catch2/catch_test_macros.hpp>
 #include "octoweave/octo_iface.hpp"
+#include <cmath>
+#include <sstream>
+#include <unordered_map>
 
 using namespace octoweave;
 
@@ -33,3 +36,95 @@ TEST_CASE("OctoChunker stub: chunk -> leaves at forced td") {
   REQUIRE(seen_a && seen_b);
 }
 
+
+TEST_CASE("OctoChunker: strided float32 and indexed spans read points in place") {
+  std::vector<Pt> pts = { {0.2,0.2,0.2}, {0.25,0.2,0.2}, {1.1,0.2,0.2}, {2.5,3.5,1.5} };
+  // x, y, z, intensity records as a sensor driver would hand them over
+  std::vector<float> rec;
+  for (const auto& q : pts) { rec.push_back((float)q.x); rec.push_back((float)q.y); rec.push_back((float)q.z); rec.push_back(42.f); }
+  PointSpan f32(rec.data(), pts.size(), 4 * sizeof(float));
+  REQUIRE(f32.size() == 4);
+  REQUIRE(f32[3].y == Approx(3.5));
+
+  OctoChunker::Params p;
+  auto a = OctoChunker::build_and_export(pts, p);
+  auto b = OctoChunker::build_and_export(f32, p);
+  REQUIRE(a.Ptd.size() == b.Ptd.size());
+  for (auto& kv : a.Ptd) REQUIRE(b.Ptd.at(kv.first) == Approx(kv.second));
+
+  // Index selection: points 3 and 0 only, in that order
+  const size_t idx[] = { 3, 0 };
+  PointSpan sel = f32.select(idx, 2);
+  REQUIRE(sel.size() == 2);
+  REQUIRE(sel[0].x == Approx(2.5));
+  auto c = OctoChunker::build_and_export(sel, p);
+  REQUIRE(c.Ptd.size() == 2);
+  REQUIRE(c.Ptd.count(Key3{2,3,1}) == 1);
+}
+
+TEST_CASE("Voxel pre-filter keeps one representative per voxel and bounded evidence") {
+  std::vector<Pt> pts;
+  uint32_t s = 2024;
+  auto next = [&s] { s = s * 1664525u + 1013904223u; return (s >> 8) / double(1u << 24); };
+  for (int i=0; i<150000; ++i) pts.push_back(Pt{ 8.0 * next(), 8.0 * next(), 2.0 * next() });
+
+  const double res = 0.5;
+  const VoxelFiltered vf = voxel_filter(pts, res, 4);
+  REQUIRE(vf.points.size() == vf.weights.size());
+  REQUIRE(vf.removed + vf.points.size() == pts.size());
+  size_t total = 0;
+  for (uint32_t w : vf.weights) total += w;
+  REQUIRE(total == pts.size());
+  // Each representative is the centroid of its voxel, so it stays inside it
+  auto voxel = [res](const Pt& q) {
+    return Key3{ (uint32_t)std::floor(q.x / res), (uint32_t)std::floor(q.y / res), (uint32_t)std::floor(q.z / res) };
+  };
+  std::unordered_map<Key3, int, Key3Hash> reps;
+  for (const Pt& q : vf.points) REQUIRE(reps.emplace(voxel(q), 0).second);
+  for (const Pt& q : pts) REQUIRE(reps.count(voxel(q)) == 1);
+  // Fixed slices: the thread count does not change the result
+  const VoxelFiltered one = voxel_filter(pts, res, 1);
+  REQUIRE(one.points.size() == vf.points.size());
+  for (size_t i=0; i<one.points.size(); ++i) {
+    REQUIRE(one.points[i].x == vf.points[i].x);
+    REQUIRE(one.weights[i] == vf.weights[i]);
+  }
+
+  // Voxels nested in the emission voxels: weighted keeps the evidence exactly, unweighted
+  // keeps every key with at least one hit of it
+  OctoChunker::Params p;
+  const auto ref = OctoChunker::build_and_export(pts, p);
+  p.prefilter_res = res; p.prefilter_weighted = true; p.prefilter_threads = 0;
+  const auto weighted = OctoChunker::build_and_export(pts, p);
+  p.prefilter_weighted = false;
+  const auto plain = OctoChunker::build_and_export(pts, p);
+  REQUIRE(weighted.Ptd.size() == ref.Ptd.size());
+  REQUIRE(plain.Ptd.size() == ref.Ptd.size());
+  for (const auto& kv : ref.Ptd) {
+    REQUIRE(weighted.Ptd.at(kv.first) == kv.second);
+    REQUIRE(plain.Ptd.at(kv.first) >= 0.7);
+    REQUIRE(plain.Ptd.at(kv.first) <= kv.second);
+  }
+
+  ChunkState st(p);
+  REQUIRE(st.insert(pts, Pt{ 0, 0, 0 }) == vf.removed);
+}
+
+TEST_CASE("ChunkState: save/load round trip and a corrupt record count") {
+  OctoChunker::Params p; p.max_depth_cap = 4;
+  ChunkState a(p);
+  a.insert(std::vector<Pt>{ Pt{ 0.5, 0.5, 0.5 }, Pt{ 1.5, 0.5, 0.5 } }, Pt{ 0, 0, 0 });
+  std::stringstream ss;
+  REQUIRE(a.save(ss));
+  ChunkState b(p);
+  REQUIRE(b.load(ss));
+  REQUIRE(b.export_worker().Ptd == a.export_worker().Ptd);
+
+  // The stub header (magic, record count) claiming far more records than follow
+  std::stringstream bad;
+  const uint32_t magic = 0x3153574f;
+  const uint64_t count = uint64_t(1) << 60;
+  bad.write(reinterpret_cast<const char*>(&magic), sizeof(magic));
+  bad.write(reinterpret_cast<const char*>(&count), sizeof(count));
+  REQUIRE(!b.load(bad));
+}
@@ -20,3 +20,26 @@ TEST_CASE("p4est mapping stub: global (k,d) -> (tree, local)") {
   REQUIRE(l2.x==1 && l2.y==1 && l2.z==2);
 }
 
+TEST_CASE("block mapping: contiguous aligned blocks") {
+  P4estBuilder::BlockLayout B; B.origin = Key3{0,0,0}; B.extent = Key3{8,8,8}; B.depth = 3;
+  P4estBuilder::TreeMap tm(2, P4estBuilder::TreeMapping::Block, B);
+  auto [t0, l0] = P4estBuilder::split_global_to_tree_local(Key3{5,1,7}, 3, tm);
+  REQUIRE(t0.x==1 && t0.y==0 && t0.z==1);
+  REQUIRE(l0.x==1 && l0.y==1 && l0.z==3);
+  REQUIRE(P4estBuilder::tree_local_depth(3, tm) == 2);
+  // Keys one level deeper address the same blocks at twice the resolution
+  auto [t1, l1] = P4estBuilder::split_global_to_tree_local(Key3{11,3,15}, 4, tm);
+  REQUIRE(t1.x==1 && t1.y==0 && t1.z==1);
+  REQUIRE(l1.x==3 && l1.y==3 && l1.z==7);
+  REQUIRE(P4estBuilder::tree_local_depth(4, tm) == 3);
+  // Offset origin; keys outside the box clamp to the boundary trees
+  B.origin = Key3{100,100,100};
+  tm.block = B;
+  auto [t2, l2] = P4estBuilder::split_global_to_tree_local(Key3{104,99,200}, 3, tm);
+  REQUIRE(t2.x==1 && t2.y==0 && t2.z==1);
+  REQUIRE(l2.x==0 && l2.y==0 && l2.z==3);
+  // Default TreeMap keeps the modulo contract
+  auto [t3, l3] = P4estBuilder::split_global_to_tree_local(Key3{5,7,9}, 3, P4estBuilder::TreeMap(4));
+  REQUIRE(t3.x==1 && t3.y==3 && t3.z==1);
+  REQUIRE(l3.x==1 && l3.y==1 && l3.z==2);
+}
@@ -1,5 +1,7 @@
 #include <catch2/catch_test_macros.hpp>
 #include "octoweave/parallel.hpp"
+#include <algorithm>
+#include <cmath>
 #include <random>
 
 using namespace octoweave;
@@ -37,3 +39,207 @@ TEST_CASE("parallel_build_workers determinism and race-free") {
   }
 }
 
+
+TEST_CASE("build_chunked_workers bins by index and matches per-chunk vectors") {
+  ChunkGrid grid(2, AABB{0,4, 0,4, 0,4});
+  std::mt19937 rng(7);
+  std::uniform_real_distribution<double> u(0.0, 4.0);
+  std::vector<double> xyz;
+  for (int i=0;i<500;++i) { xyz.push_back(u(rng)); xyz.push_back(u(rng)); xyz.push_back(u(rng)); }
+  PointSpan span(xyz.data(), xyz.size() / 3);
+
+  // Reference: copy points into per-chunk vectors in input order
+  std::vector<std::vector<Pt>> per_chunk(8);
+  for (size_t i=0;i<span.size();++i) {
+    Pt q = span[i];
+    per_chunk[std::get<3>(grid.which(q.x, q.y, q.z))].push_back(q);
+  }
+  OctoChunker::Params p; p.max_depth_cap = 12;
+  std::vector<int> ids;
+  auto outs = build_chunked_workers(grid, span, p, 3, &ids);
+  REQUIRE(outs.size() == ids.size());
+  REQUIRE(ids.size() == 8);
+  for (size_t k=0;k<ids.size();++k) {
+    auto ref = OctoChunker::build_and_export(per_chunk[(size_t)ids[k]], p);
+    REQUIRE(outs[k].Ptd.size() == ref.Ptd.size());
+    for (auto& kv : ref.Ptd) REQUIRE(outs[k].Ptd.at(kv.first) == Approx(kv.second));
+  }
+}
+
+TEST_CASE("build_chunked_scans fuses scans like one concatenated cloud") {
+  ChunkGrid grid(3, AABB{0,6, 0,6, 0,6});
+  std::mt19937 rng(11);
+  std::uniform_real_distribution<double> u(0.0, 6.0);
+  std::vector<std::vector<Pt>> clouds(40);
+  std::vector<Pt> concat;
+  std::vector<Scan> scans;
+  for (size_t s=0; s<clouds.size(); ++s) {
+    for (int i=0; i<60; ++i) clouds[s].push_back(Pt{ u(rng), u(rng), u(rng) });
+    concat.insert(concat.end(), clouds[s].begin(), clouds[s].end());
+  }
+  for (size_t s=0; s<clouds.size(); ++s) scans.push_back(Scan{ clouds[s], Pt{ (double)s, 0.0, 0.0 } });
+  // An indexed span: the last scan contributes only two of its points
+  const size_t sel[] = { 5, 1 };
+  scans.back().points = PointSpan(clouds.back()).select(sel, 2);
+  concat.resize(concat.size() - clouds.back().size());
+  concat.push_back(clouds.back()[5]); concat.push_back(clouds.back()[1]);
+
+  OctoChunker::Params p; p.max_depth_cap = 12;
+  std::vector<int> ids, ref_ids, ids1;
+  auto outs = build_chunked_scans(grid, scans, p, 4, &ids);
+  auto ref = build_chunked_workers(grid, concat, p, 2, &ref_ids);
+  auto one = build_chunked_scans(grid, scans, p, 1, &ids1);
+  REQUIRE(ids == ref_ids);
+  REQUIRE(ids == ids1);
+  for (size_t k=0; k<ids.size(); ++k) {
+    REQUIRE(outs[k].Ptd.size() == ref[k].Ptd.size());
+    for (const auto& kv : ref[k].Ptd) {
+      REQUIRE(outs[k].Ptd.at(kv.first) == kv.second);
+      REQUIRE(one[k].Ptd.at(kv.first) == kv.second);
+    }
+  }
+}
+
+TEST_CASE("route_rays splits rays at chunk borders and ends them in the point's chunk") {
+  ChunkGrid grid(4, AABB{0,4, 0,4, 0,4});
+  std::vector<Pt> line = { {3.5, 0.5, 0.5} };
+  std::vector<RaySegment> segs;
+  ChunkBins bins;
+  route_rays(grid, { Scan{ line, Pt{ 0.5, 0.5, 0.5 } } }, -1.0, segs, bins, 1);
+  REQUIRE((bins.chunks == std::vector<int>{ 0, 1, 2, 3 }));
+  for (int c=0; c<4; ++c) {
+    REQUIRE(bins.begin[(size_t)c + 1] - bins.begin[(size_t)c] == 1);
+    const RaySegment& s = segs[bins.begin[(size_t)c]];
+    REQUIRE(s.a.x == Approx(c == 0 ? 0.5 : c));
+    REQUIRE(s.b.x == Approx(c == 3 ? 3.5 : c + 1));
+    REQUIRE(s.terminal == (c == 3));
+  }
+
+  // Random rays, one per scan: pieces chain from the origin to the point
+  std::mt19937 rng(3);
+  std::uniform_real_distribution<double> u(0.0, 4.0);
+  std::vector<std::vector<Pt>> pts(300);
+  std::vector<Scan> scans;
+  for (auto& v : pts) {
+    v.push_back(Pt{ u(rng), u(rng), u(rng) });
+    scans.push_back(Scan{ v, Pt{ u(rng), u(rng), u(rng) } });
+  }
+  route_rays(grid, scans, -1.0, segs, bins, 3);
+  std::vector<std::vector<RaySegment>> by_ray(scans.size());
+  for (size_t j=0; j<bins.chunks.size(); ++j)
+    for (size_t i=bins.begin[j]; i<bins.begin[j + 1]; ++i) {
+      by_ray[segs[i].scan].push_back(segs[i]);
+      if (segs[i].terminal) {
+        const Pt& q = pts[segs[i].scan][0];
+        REQUIRE(bins.chunks[j] == std::get<3>(grid.which(q.x, q.y, q.z)));
+      }
+    }
+  auto dist = [](const Pt& a, const Pt& b) { return std::sqrt((a.x-b.x)*(a.x-b.x) + (a.y-b.y)*(a.y-b.y) + (a.z-b.z)*(a.z-b.z)); };
+  for (size_t r=0; r<scans.size(); ++r) {
+    auto& v = by_ray[r];
+    const Pt o = scans[r].origin;
+    std::sort(v.begin(), v.end(), [&](const RaySegment& a, const RaySegment& b) { return dist(o, a.a) < dist(o, b.a); });
+    double len = 0.0;
+    int terminal = 0;
+    for (size_t i=0; i<v.size(); ++i) {
+      len += dist(v[i].a, v[i].b);
+      terminal += v[i].terminal ? 1 : 0;
+      if (i > 0) REQUIRE(dist(v[i - 1].b, v[i].a) < 1e-9);
+    }
+    REQUIRE(terminal == 1);
+    REQUIRE(len == Approx(dist(o, pts[r][0])).epsilon(1e-9));
+  }
+
+  // Rays longer than max_range stop there without a hit
+  route_rays(grid, { Scan{ line, Pt{ 0.5, 0.5, 0.5 } } }, 1.2, segs, bins, 1);
+  REQUIRE(segs.size() == 2);
+  REQUIRE(!segs[0].terminal);
+  REQUIRE(!segs[1].terminal);
+  REQUIRE(segs[1].b.x == Approx(1.7));
+}
+
+TEST_CASE("build_routed_scans adds pass-through chunks and keeps the hits") {
+  ChunkGrid grid(3, AABB{0,6, 0,6, 0,6});
+  std::mt19937 rng(21);
+  std::uniform_real_distribution<double> u(0.0, 6.0);
+  std::vector<std::vector<Pt>> clouds(16);
+  std::vector<Scan> scans;
+  for (size_t s=0; s<clouds.size(); ++s) {
+    for (int i=0; i<50; ++i) clouds[s].push_back(Pt{ u(rng), u(rng), u(rng) });
+    scans.push_back(Scan{ clouds[s], Pt{ u(rng), u(rng), u(rng) } });
+  }
+  OctoChunker::Params p; p.max_depth_cap = 12;
+  std::vector<int> ids, routed_ids;
+  auto ref = build_chunked_scans(grid, scans, p, 2, &ids);
+  auto outs = build_routed_scans(grid, scans, p, 3, &routed_ids);
+  REQUIRE(routed_ids.size() >= ids.size());
+  // The stub backend carves no free space: chunks with hits match the endpoint binning
+  size_t k = 0;
+  for (size_t r=0; r<routed_ids.size(); ++r) {
+    if (k < ids.size() && routed_ids[r] == ids[k]) {
+      REQUIRE(outs[r].Ptd.size() == ref[k].Ptd.size());
+      for (const auto& kv : ref[k].Ptd) REQUIRE(outs[r].Ptd.at(kv.first) == kv.second);
+      ++k;
+    } else {
+      REQUIRE(outs[r].Ptd.empty());
+    }
+  }
+  REQUIRE(k == ids.size());
+}
+
+TEST_CASE("ChunkBins list the touched chunks in order, entries grouped as documented") {
+  const ChunkGrid grid(6, AABB{0,6, 0,6, 0,6});
+  std::mt19937 rng(21);
+  std::uniform_real_distribution<double> u(-1.0, 4.0); // some points clamp to border chunks
+  std::vector<std::vector<Pt>> clouds(5);
+  std::vector<Scan> scans;
+  for (size_t s=0; s<clouds.size(); ++s) {
+    for (int i=0; i<200; ++i) clouds[s].push_back(Pt{ u(rng), u(rng), u(rng) });
+    scans.push_back(Scan{ clouds[s], Pt{ 1.0 + (double)s, 2.0, 2.0 } });
+  }
+  auto chunk_of = [&](const Pt& q) { return std::get<3>(grid.which(q.x, q.y, q.z)); };
+  // Ascending non-empty chunks covering `n` entries; before(a, b) orders entries in a chunk
+  auto layout = [](const ChunkBins& bins, size_t n, auto&& in_chunk, auto&& before) {
+    REQUIRE(bins.begin.size() == bins.chunks.size() + 1);
+    REQUIRE(bins.begin.front() == 0);
+    REQUIRE(bins.begin.back() == n);
+    for (size_t j=0; j<bins.chunks.size(); ++j) {
+      if (j > 0) REQUIRE(bins.chunks[j - 1] < bins.chunks[j]);
+      REQUIRE(bins.begin[j] < bins.begin[j + 1]);
+      for (size_t i=bins.begin[j]; i<bins.begin[j + 1]; ++i) {
+        REQUIRE(in_chunk(i, bins.chunks[j]));
+        if (i > bins.begin[j]) REQUIRE(before(i - 1, i));
+      }
+    }
+  };
+
+  std::vector<size_t> perm;
+  ChunkBins bins;
+  bin_points(grid, scans[0].points, perm, bins);
+  layout(bins, clouds[0].size(), [&](size_t i, int c) { return chunk_of(clouds[0][perm[i]]) == c; },
+         [&](size_t a, size_t b) { return perm[a] < perm[b]; });
+
+  std::vector<size_t> idx;
+  std::vector<uint32_t> scan_of;
+  bin_scans(grid, scans, idx, scan_of, bins, 3);
+  layout(bins, clouds.size() * 200, [&](size_t i, int c) { return chunk_of(clouds[scan_of[i]][idx[i]]) == c; },
+         [&](size_t a, size_t b) { return scan_of[a] < scan_of[b] || (scan_of[a] == scan_of[b] && idx[a] < idx[b]); });
+
+  std::vector<RaySegment> segs;
+  route_rays(grid, scans, 2.5, segs, bins, 3);
+  layout(bins, segs.size(), [&](size_t i, int c) {
+    // A terminal piece ends at its point, which may lie outside the grid
+    const RaySegment& s = segs[i];
+    if (s.terminal) return chunk_of(s.b) == c;
+    return chunk_of(Pt{ (s.a.x + s.b.x) / 2, (s.a.y + s.b.y) / 2, (s.a.z + s.b.z) / 2 }) == c;
+  }, [&](size_t a, size_t b) { return segs[a].scan <= segs[b].scan; });
+
+  // A 1024³ grid: binning and chunked builds follow the input, not the grid
+  const ChunkGrid big(1024, AABB{0,1024, 0,1024, 0,1024});
+  const std::vector<Pt> few{ {1000.5, 1000.5, 1000.5}, {3.5, 2.5, 1.5}, {1000.5, 1000.5, 1000.5} };
+  OctoChunker::Params p; p.max_depth_cap = 4;
+  std::vector<int> ids;
+  REQUIRE(build_chunked_workers(big, few, p, 2, &ids).size() == 2);
+  const int lo = std::get<3>(big.which(3.5, 2.5, 1.5)), hi = std::get<3>(big.which(1000.5, 1000.5, 1000.5));
+  REQUIRE((ids == std::vector<int>{ lo, hi }));
+}
@@ -0,0 +1,62 @@
+#include <catch2/catch_test_macros.hpp>
+#include "octoweave/p4est_builder.hpp"
+
+using namespace octoweave;
+
+// Leaves at depth td placed so that modulo mapping puts `count[t]` leaves in tree t (n=2)
+static Hierarchy make_counts_hierarchy(const std::vector<int>& count, double p) {
+  Hierarchy H; H.base_depth = 1; H.td = 6;
+  for (int t=0; t<8; ++t) {
+    uint32_t tx = t & 1, ty = (t>>1) & 1, tz = (t>>2) & 1;
+    for (int i=0; i<count[t]; ++i) {
+      Key3 k{ tx + 2u*(uint32_t)i, ty, tz };
+      H.nodes[NDKey{ k, (uint16_t)H.td }] = NodeRec{ p, true };
+    }
+  }
+  return H;
+}
+
+TEST_CASE("tree_stats aggregates leaves per tree") {
+  auto H = make_counts_hierarchy({3,0,1,0,0,0,0,2}, 0.5);
+  auto st = P4estBuilder::tree_stats(H, 2);
+  REQUIRE(st.size() == 8);
+  REQUIRE(st[0].leaf_count == 3); REQUIRE(st[2].leaf_count == 1); REQUIRE(st[7].leaf_count == 2);
+  REQUIRE(st[1].leaf_count == 0);
+  REQUIRE(st[0].mean() == Approx(0.5));
+}
+
+TEST_CASE("estimate_balanced_quadrants: uniform and graded neighbors") {
+  std::vector<P4estBuilder::TreeStats> st(8);
+  for (auto& s : st) { s.leaf_count = 1; s.prob_sum = 1.0; }
+  // Uniform level 2 everywhere: no balance growth
+  REQUIRE(P4estBuilder::estimate_balanced_quadrants(std::vector<int>(8, 2), st, 2) == 8 * 64);
+  // One tree at level 3, rest at 1: neighbors gain graded layers
+  std::vector<int> lv(8, 1); lv[0] = 3;
+  size_t est = P4estBuilder::estimate_balanced_quadrants(lv, st, 2);
+  REQUIRE(est > 512 + 7 * 8);
+  REQUIRE(est <= 512 + 7 * 64);
+  // Empty trees stay at their root quadrant
+  std::vector<P4estBuilder::TreeStats> empty(8);
+  REQUIRE(P4estBuilder::estimate_balanced_quadrants(std::vector<int>(8, 5), empty, 2) == 8);
+}
+
+TEST_CASE("by_quadrant_budget respects budget and favors evidence") {
+  auto H = make_counts_hierarchy({20,1,5,0,0,0,0,10}, 0.9);
+  const int n = 2, Lmin = 1, Lmax = 8;
+  auto st = P4estBuilder::tree_stats(H, n);
+  for (size_t budget : {size_t(8), size_t(100), size_t(2000), size_t(50000)}) {
+    auto lv = P4estBuilder::budget_levels(st, n, budget, Lmin, Lmax);
+    REQUIRE(lv.size() == 8);
+    size_t minimal = P4estBuilder::estimate_balanced_quadrants(std::vector<int>(8, Lmin), st, n);
+    if (minimal <= budget) REQUIRE(P4estBuilder::estimate_balanced_quadrants(lv, st, n) <= budget);
+    for (int L : lv) { REQUIRE(L >= Lmin); REQUIRE(L <= Lmax); }
+    REQUIRE(lv[0] >= lv[7]); REQUIRE(lv[7] >= lv[2]); REQUIRE(lv[2] >= lv[1]);
+  }
+  // Unlimited budget refines every tree with evidence to Lmax
+  auto lv = P4estBuilder::budget_levels(st, n, (size_t)-1, Lmin, Lmax);
+  REQUIRE(lv[0] == Lmax); REQUIRE(lv[1] == Lmax); REQUIRE(lv[3] == Lmin);
+
+  auto pol = P4estBuilder::Policy::by_byte_budget(H, n, 2000 * P4estBuilder::kQuadrantBytes, Lmin, Lmax);
+  auto ref = P4estBuilder::budget_levels(st, n, 2000, Lmin, Lmax);
+  for (int t=0; t<8; ++t) REQUIRE(pol(t, H) == ref[t]);
+}
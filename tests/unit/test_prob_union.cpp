@@ -27,3 +27,25 @@ TEST_CASE("union_prob8_stable symmetry and stability") {
   auto m = mix; m[1] = pu; m[2] = pu; // expected replacements
   REQUIRE(union_prob8_stable(mix, pu) == Approx(union_prob8_stable(m, pu)));
 }
+
+TEST_CASE("logodds16 codes round-trip and union within half a step") {
+  REQUIRE(logodds16_from_prob(0.0) == kLogOdds16Min);
+  REQUIRE(logodds16_from_prob(1.0) == kLogOdds16Max);
+  REQUIRE(prob_from_logodds16(kLogOdds16Min) == 0.0);
+  REQUIRE(prob_from_logodds16(kLogOdds16Max) == 1.0);
+  REQUIRE(logodds16_from_prob(std::nan(""), 0.3) == logodds16_from_prob(0.3));
+  for (double p = 0.001; p < 1.0; p += 0.0137) {
+    const double back = prob_from_logodds16(logodds16_from_prob(p));
+    REQUIRE(std::fabs(back - p) <= p * (1.0 - p) * kLogOdds16Step / 2 + 1e-15);
+  }
+  std::array<double,8> a{0.1, 0.2, 0.3, 0.05, 0.0, 0.9, 0.8, 0.4};
+  std::array<int16_t,8> q{};
+  for (int i=0; i<8; ++i) q[(size_t)i] = logodds16_from_prob(a[(size_t)i]);
+  const double exact = union_prob8_stable(a);
+  REQUIRE(std::fabs(prob_from_logodds16(union_logodds16(q)) - exact) <= 2.5e-4);
+  // Absent (p = 0) children leave the union unchanged; a certain one saturates it
+  std::array<int16_t,8> one{}; one.fill(kLogOdds16Min); one[3] = logodds16_from_prob(0.7);
+  REQUIRE(union_logodds16(one) == one[3]);
+  REQUIRE(union_logodds16(one[3], kLogOdds16Min) == one[3]);
+  REQUIRE(union_logodds16(one[3], kLogOdds16Max) == kLogOdds16Max);
+}
@@ -0,0 +1,117 @@
+#include <catch2/catch_test_macros.hpp>
+#include "octoweave/raster.hpp"
+#include <thread>
+#include <vector>
+
+using namespace octoweave;
+
+static Hierarchy make_raster_hierarchy() {
+  Hierarchy H; H.base_depth = 1; H.td = 3;
+  auto leaf = [&](uint32_t x, uint32_t y, uint32_t z, int d, double p) {
+    H.nodes[NDKey{ Key3{x,y,z}, (uint16_t)d }] = NodeRec{ p, true };
+  };
+  leaf(0,0,0, 3, 1.0);
+  leaf(1,0,0, 3, 0.5);
+  leaf(0,1,0, 3, 0.25);
+  leaf(0,0,2, 3, 0.75);
+  leaf(2,1,1, 3, 0.2);
+  leaf(1,1,1, 2, 0.9);                                            // other depth
+  H.nodes[NDKey{ Key3{0,0,0}, 2 }] = NodeRec{ 0.99, false };      // internal node
+  return H;
+}
+
+TEST_CASE("raster: leaf index and z-slice") {
+  LeafIndex idx(make_raster_hierarchy());
+  REQUIRE(idx.size() == 6);
+  REQUIRE((idx.depths() == std::vector<int>{ 2, 3 }));
+  Key3 e = idx.extent(3);
+  REQUIRE(e.x == 3); REQUIRE(e.y == 2); REQUIRE(e.z == 3);
+  REQUIRE(idx.slice_span(3, 0).size == 3);
+  REQUIRE(idx.slice_span(3, 5).size == 0);
+  REQUIRE(idx.slice_span(7, 0).size == 0);
+
+  // Whole columns: depth 2 first, then depth 3 in (z, y, x) order
+  LeafColumns c = idx.columns();
+  REQUIRE(c.size == 6);
+  REQUIRE(c.d[0] == 2); REQUIRE(c.p[0] == Approx(0.9));
+  REQUIRE(c.d[1] == 3); REQUIRE(c.x[1] == 0); REQUIRE(c.p[1] == Approx(1.0));
+  REQUIRE(c.z[5] == 2); REQUIRE(c.p[5] == Approx(0.75));
+  REQUIRE(idx.depth_span(3).x == c.x + 1);
+
+  std::vector<double> img(3*2, -1.0);
+  REQUIRE(render_slice(idx, 3, 0, img.data(), 3, 2, -1.0) == 3);
+  REQUIRE(img[0] == Approx(1.0)); REQUIRE(img[1] == Approx(0.5)); REQUIRE(img[3] == Approx(0.25));
+  REQUIRE(img[2] == Approx(-1.0));
+  // Leaves outside a smaller raster are skipped
+  std::vector<double> small(1);
+  REQUIRE(render_slice(idx, 3, 0, small.data(), 1, 1) == 1);
+}
+
+TEST_CASE("raster: max/mean projections, concurrent calls") {
+  LeafIndex idx(make_raster_hierarchy());
+  std::vector<double> mx(6), mean(6);
+  REQUIRE(render_projection(idx, 3, Projection::Max, mx.data(), 3, 2) == 5);
+  REQUIRE(render_projection(idx, 3, Projection::Mean, mean.data(), 3, 2) == 5);
+  REQUIRE(mx[0] == Approx(1.0));            // column (0,0): 1.0 and 0.75
+  REQUIRE(mean[0] == Approx(0.875));
+  REQUIRE(mx[5] == Approx(0.2));            // column (2,1)
+  REQUIRE(mean[4] == Approx(0.0));          // empty column -> background
+
+  std::vector<std::vector<double>> outs(8, std::vector<double>(6));
+  std::vector<std::thread> th;
+  for (size_t i=0; i<outs.size(); ++i)
+    th.emplace_back([&, i]{ render_projection(idx, 3, Projection::Mean, outs[i].data(), 3, 2); });
+  for (auto& t : th) t.join();
+  for (const auto& o : outs) REQUIRE(o == mean);
+}
+
+TEST_CASE("raster: column kernels along each axis match a serial scan") {
+  // Pseudo-random leaves over two depths, large enough to split across workers
+  const size_t n = 300000;
+  std::vector<uint32_t> x(n), y(n), z(n);
+  std::vector<int32_t> d(n);
+  std::vector<double> p(n);
+  uint64_t s = 12345;
+  auto next = [&]{ s = s * 6364136223846793005ULL + 1442695040888963407ULL; return (uint32_t)(s >> 33); };
+  for (size_t i=0; i<n; ++i) {
+    x[i] = next() % 40; y[i] = next() % 30; z[i] = next() % 20;
+    d[i] = 4 + (int32_t)(next() % 2); p[i] = (next() % 1000) / 999.0;
+  }
+  LeafColumns c; c.x = x.data(); c.y = y.data(); c.z = z.data(); c.d = d.data(); c.p = p.data(); c.size = n;
+
+  // Projection along y keeps (x, z): 40 columns, 20 rows; z in [0, 9] only
+  const int W = 40, H = 20;
+  std::vector<double> mx(W*H), sum(W*H), mean(W*H), serial_max(W*H, -1.0), serial_sum(W*H, 0.0);
+  std::vector<int> hits(W*H, 0);
+  size_t expect = 0;
+  for (size_t i=0; i<n; ++i) {
+    if (d[i] != 5 || y[i] < 3 || y[i] > 9) continue;
+    size_t k = (size_t)z[i] * W + x[i];
+    serial_max[k] = std::max(serial_max[k], p[i]); serial_sum[k] += p[i]; ++hits[k]; ++expect;
+  }
+  REQUIRE(project_columns(c, 5, Axis::Y, 3, 9, Projection::Max, mx.data(), W, H, -1.0, 4) == expect);
+  REQUIRE(project_columns(c, 5, Axis::Y, 3, 9, Projection::Sum, sum.data(), W, H, 0.0, 3) == expect);
+  REQUIRE(project_columns(c, 5, Axis::Y, 3, 9, Projection::Mean, mean.data(), W, H, 0.0, 1) == expect);
+  for (int k=0; k<W*H; ++k) {
+    REQUIRE(mx[k] == serial_max[k]);
+    REQUIRE(sum[k] == Approx(serial_sum[k]));
+    REQUIRE(mean[k] == Approx(hits[k] ? serial_sum[k] / hits[k] : 0.0));
+  }
+
+  // Slice along x keeps (y, z); a smaller raster clips
+  std::vector<double> sl(10*5);
+  size_t inside = 0;
+  for (size_t i=0; i<n; ++i) if (d[i] == 4 && x[i] == 7 && y[i] < 10 && z[i] < 5) ++inside;
+  REQUIRE(slice_columns(c, 4, Axis::X, 7, sl.data(), 10, 5, 0.0, 2) == inside);
+
+  // Histograms per depth: rows 0..3 empty, all leaves counted once
+  std::vector<uint64_t> hist(6 * 4, 99);
+  REQUIRE(depth_histogram(c, 5, 4, 0.0, 1.0, hist.data(), 4) == n);
+  uint64_t tot = 0, ones = 0;
+  for (int r=0; r<4; ++r) for (int b=0; b<4; ++b) REQUIRE(hist[(size_t)r*4 + b] == 0);
+  for (size_t k=16; k<24; ++k) tot += hist[k];
+  for (size_t i=0; i<n; ++i) if (d[i] == 4 && p[i] >= 0.75) ++ones;
+  REQUIRE(tot == n);
+  REQUIRE(hist[4*4 + 3] == ones);    // p == 1.0 falls in the closed last bin
+  REQUIRE(depth_histogram(c, 3, 4, 0.0, 1.0, hist.data()) == 0);
+}
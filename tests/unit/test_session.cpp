@@ -0,0 +1,257 @@
+#include <catch2/catch_test_macros.hpp>
+#include "octoweave/chunk_cache.hpp"
+#include "octoweave/parallel.hpp"
+#include "octoweave/session.hpp"
+#include <filesystem>
+#include <memory>
+#include <random>
+
+using namespace octoweave;
+
+static void require_same(const Hierarchy& a, const Hierarchy& b) {
+  REQUIRE(a.td == b.td);
+  REQUIRE(a.base_depth == b.base_depth);
+  REQUIRE(a.nodes.size() == b.nodes.size());
+  for (const auto& kv : b.nodes) {
+    auto it = a.nodes.find(kv.first);
+    REQUIRE(it != a.nodes.end());
+    REQUIRE(it->second.is_leaf == kv.second.is_leaf);
+    REQUIRE(it->second.p == Approx(kv.second.p).epsilon(1e-12));
+  }
+}
+
+TEST_CASE("HierarchyBuilder: incremental edits match the batch build") {
+  std::mt19937 rng(11);
+  std::uniform_int_distribution<uint32_t> key(0, 15);
+  std::uniform_real_distribution<double> prob(0.0, 1.0);
+  const int td = 4;
+  HierarchyBuilder hb(td, /*tau=*/0.4, false, 0.5, /*base_depth=*/1);
+  WorkerOut ref; ref.td = td;
+  long long leaves = 0; double psum = 0.0; // running totals from the leaf deltas
+  for (int round=0; round<6; ++round) {
+    for (int i=0; i<40; ++i) {
+      Key3 k{ key(rng), key(rng), key(rng) };
+      if (round > 0 && i % 4 == 0 && !ref.Ptd.empty()) {
+        // Erase an existing key
+        auto it = ref.Ptd.begin(); std::advance(it, (long)(rng() % ref.Ptd.size()));
+        hb.erase(it->first); ref.Ptd.erase(it);
+        continue;
+      }
+      double p = prob(rng);
+      hb.set(k, p); ref.Ptd[k] = p;
+    }
+    std::vector<NDKey> changed;
+    std::vector<HierarchyBuilder::LeafDelta> deltas;
+    REQUIRE(hb.refresh(&changed, &deltas) == changed.size());
+    REQUIRE(!changed.empty());
+    require_same(hb.hierarchy(), make_hierarchy_from_workers({ ref }, 0.4, false, 0.5, 1));
+    for (const auto& ld : deltas) { leaves += ld.count; psum += ld.dp; }
+    long long n_td = 0; double p_td = 0.0;
+    for (const auto& kv : hb.hierarchy().nodes)
+      if (kv.first.d == td) { ++n_td; p_td += kv.second.p; }
+    REQUIRE(leaves == n_td);
+    REQUIRE(psum == Approx(p_td).epsilon(1e-9));
+  }
+  REQUIRE(hb.refresh() == 0);
+}
+
+TEST_CASE("Session: scans update touched chunks and match a batch rebuild") {
+  Session::Options opt;
+  opt.box = AABB{ 0, 8, 0, 8, 0, 8 }; opt.n = 2;
+  opt.params.max_depth_cap = 6; opt.threads = 3;
+  Session s(opt);
+  ChunkGrid grid(opt.n, opt.box);
+
+  std::mt19937 rng(5);
+  std::vector<double> all;
+  auto scan = [&](double lo, double hi, int k) {
+    std::uniform_real_distribution<double> u(lo, hi);
+    std::vector<double> xyz;
+    for (int i=0; i<k; ++i) { xyz.push_back(u(rng)); xyz.push_back(u(rng)); xyz.push_back(u(rng)); }
+    all.insert(all.end(), xyz.begin(), xyz.end());
+    return xyz;
+  };
+  P4estBuilder::Config cfg; cfg.n = 2;
+
+  auto a = scan(0.0, 8.0, 300);
+  REQUIRE(s.insert(PointSpan(a.data(), a.size() / 3), Pt{ 4, 4, 4 }) == 8);
+  auto batch = [&] {
+    auto outs = build_chunked_workers(grid, PointSpan(all.data(), all.size() / 3), opt.params, 2);
+    return make_hierarchy_from_workers(outs, opt.tau, false, opt.p_unknown, opt.base_depth);
+  };
+  require_same(s.hierarchy(), batch());
+  auto* f = s.forest(cfg);
+  REQUIRE(f);
+
+  // Scans confined to the first chunk only touch that chunk
+  for (int k=0; k<3; ++k) {
+    auto b = scan(0.5, 3.5, 50);
+    REQUIRE(s.insert(PointSpan(b.data(), b.size() / 3), Pt{ 1, 1, 1 }) == 1);
+  }
+  REQUIRE(s.scans() == 4);
+  REQUIRE(s.active_chunks() == 8);
+  const Hierarchy& H = s.hierarchy();
+  require_same(H, batch());
+
+  // The session forest is re-adapted in place and agrees with a fresh build; its stats
+  // follow the leaf deltas and match a full pass
+  REQUIRE(s.forest(cfg) == f);
+  const auto full = P4estBuilder::tree_stats(H, cfg.tree_map());
+  REQUIRE(f->stats.size() == full.size());
+  for (size_t t=0; t<full.size(); ++t) {
+    REQUIRE(f->stats[t].leaf_count == full[t].leaf_count);
+    REQUIRE(f->stats[t].prob_sum == Approx(full[t].prob_sum).epsilon(1e-9));
+  }
+  REQUIRE((f->levels == P4estBuilder::resolve_levels(H, cfg)));
+  std::unique_ptr<P4estBuilder::ForestHandle> fresh(P4estBuilder::build_forest_handle(H, cfg));
+  REQUIRE(f->num_quadrants() == fresh->num_quadrants());
+  double sa = 0.0, sb = 0.0;
+  f->for_each_quadrant([&](const P4estBuilder::QuadrantView& q){ sa += q.mean * q.leaves; });
+  fresh->for_each_quadrant([&](const P4estBuilder::QuadrantView& q){ sb += q.mean * q.leaves; });
+  REQUIRE(sa == Approx(sb));
+}
+
+TEST_CASE("Session: a batch of scans matches inserting them one by one") {
+  Session::Options opt;
+  opt.box = AABB{ 0, 8, 0, 8, 0, 8 }; opt.n = 2;
+  opt.params.max_depth_cap = 6; opt.threads = 2;
+  Session one(opt), batch(opt);
+  std::mt19937 rng(9);
+  std::uniform_real_distribution<double> u(0.0, 8.0);
+  std::vector<std::vector<Pt>> clouds(12);
+  std::vector<Scan> scans;
+  for (size_t k=0; k<clouds.size(); ++k) {
+    for (int i=0; i<40; ++i) clouds[k].push_back(Pt{ u(rng), u(rng) / (1.0 + (double)k), u(rng) });
+    scans.push_back(Scan{ clouds[k], Pt{ (double)k, 1.0, 1.0 } });
+    one.insert(clouds[k], scans.back().origin);
+  }
+  REQUIRE(batch.insert(scans) == one.active_chunks());
+  REQUIRE(batch.scans() == one.scans());
+  require_same(batch.hierarchy(), one.hierarchy());
+
+  // Routed rays also reach the chunks they only pass through; the stub's hits are unchanged
+  opt.route_rays = true;
+  Session routed(opt);
+  for (const Scan& sc : scans) routed.insert(sc.points, sc.origin);
+  REQUIRE(routed.active_chunks() >= one.active_chunks());
+  require_same(routed.hierarchy(), one.hierarchy());
+}
+
+TEST_CASE("ChunkCache: a drive under a small budget spills, reloads and matches a Session") {
+  namespace fs = std::filesystem;
+  const fs::path dir = fs::temp_directory_path() / "octoweave_test_chunk_cache";
+  fs::remove_all(dir);
+  ChunkCache::Options copt;
+  copt.box = AABB{ 0, 32, 0, 4, 0, 4 }; copt.n = 8;
+  copt.params.max_depth_cap = 6; copt.threads = 2;
+  copt.budget_bytes = 4096; copt.spill_dir = dir.string();
+  Session::Options sopt;
+  sopt.box = copt.box; sopt.n = copt.n; sopt.params = copt.params; sopt.threads = 2;
+  Session ref(sopt);
+  {
+    ChunkCache cache(copt);
+    std::mt19937 rng(3);
+    std::uniform_real_distribution<double> u(0.0, 4.0);
+    // Out along x and back to the start, so the first chunks are spilled and revisited
+    const double xs[] = { 0, 4, 8, 12, 16, 20, 24, 28, 2, 6 };
+    for (double x0 : xs) {
+      std::vector<Pt> cloud;
+      for (int i=0; i<60; ++i) cloud.push_back(Pt{ x0 + u(rng), u(rng), u(rng) });
+      const Pt origin{ x0 + 2.0, 2.0, 2.0 };
+      REQUIRE(cache.insert(cloud, origin) == ref.insert(cloud, origin));
+      REQUIRE(cache.stats().resident_bytes <= copt.budget_bytes);
+    }
+    const ChunkCache::Stats& st = cache.stats();
+    REQUIRE(st.evictions > 0);
+    REQUIRE(st.reloads > 0);
+    REQUIRE(st.io_errors == 0);
+    REQUIRE(st.resident_chunks + st.spilled_chunks == ref.active_chunks());
+    REQUIRE(st.spilled_bytes > 0);
+
+    // Exports read spilled chunks without bringing them back
+    std::vector<int> ids;
+    auto outs = cache.export_workers(&ids);
+    REQUIRE(ids.size() == ref.active_chunks());
+    REQUIRE(cache.stats().resident_bytes <= copt.budget_bytes);
+    require_same(make_hierarchy_from_workers(outs, sopt.tau, false, sopt.p_unknown, sopt.base_depth),
+                 ref.hierarchy());
+    require_same(cache.hierarchy(sopt.tau, sopt.p_unknown, sopt.base_depth), ref.hierarchy());
+    size_t visited = 0;
+    cache.for_each_worker([&](int c, WorkerOut&& w) {
+      REQUIRE(c == ids[visited]);
+      REQUIRE(w.Ptd.size() == outs[visited].Ptd.size());
+      ++visited;
+    });
+    REQUIRE(visited == ids.size());
+  }
+  REQUIRE(fs::is_empty(dir));
+  fs::remove_all(dir);
+}
+
+TEST_CASE("Session: a large grid costs only the chunks scans reach") {
+  // 1024^3 chunks: dense per-chunk tables would need gigabytes
+  Session::Options opt;
+  opt.box = AABB{ 0, 1024, 0, 1024, 0, 1024 }; opt.n = 1024;
+  opt.params.max_depth_cap = 4; opt.threads = 2;
+  Session s(opt);
+  std::vector<Pt> cloud;
+  for (int i=0; i<8; ++i) cloud.push_back(Pt{ 100.5 + i, 200.5, 300.5 });
+  REQUIRE(s.insert(cloud, Pt{ 100.0, 200.0, 300.0 }) == 8);
+  REQUIRE(s.insert({ Scan{ cloud, Pt{ 90.0, 200.0, 300.0 } } }) == 8);
+  REQUIRE(s.active_chunks() == 8);
+  REQUIRE(!s.hierarchy().nodes.empty());
+}
+
+TEST_CASE("ChunkCache: a large grid keeps bookkeeping to the driven chunks") {
+  namespace fs = std::filesystem;
+  const fs::path dir = fs::temp_directory_path() / "octoweave_test_chunk_cache_large";
+  fs::remove_all(dir);
+  ChunkCache::Options opt;
+  opt.box = AABB{ 0, 1024, 0, 1024, 0, 1024 }; opt.n = 1024;
+  opt.params.max_depth_cap = 4; opt.threads = 2;
+  opt.budget_bytes = 1; opt.spill_dir = dir.string(); // everything spills after each insert
+  {
+    ChunkCache cache(opt);
+    std::vector<Pt> cloud;
+    for (int i=0; i<8; ++i) cloud.push_back(Pt{ 500.5 + i, 20.5, 3.5 });
+    REQUIRE(cache.insert(cloud, Pt{ 500.0, 20.0, 3.0 }) == 8);
+    REQUIRE(cache.insert(cloud, Pt{ 499.0, 20.0, 3.0 }) == 8);
+    REQUIRE(cache.stats().resident_chunks == 0);
+    REQUIRE(cache.stats().spilled_chunks == 8);
+    REQUIRE(cache.stats().reloads == 8);
+    REQUIRE(cache.export_workers().size() == 8);
+  }
+  fs::remove_all(dir);
+}
+
+TEST_CASE("ChunkCache: a chunk file that cannot be read is kept and reported") {
+  namespace fs = std::filesystem;
+  const fs::path dir = fs::temp_directory_path() / "octoweave_test_chunk_cache_corrupt";
+  fs::remove_all(dir);
+  ChunkCache::Options opt;
+  opt.box = AABB{ 0, 4, 0, 4, 0, 4 }; opt.n = 1;
+  opt.params.max_depth_cap = 4; opt.threads = 2;
+  opt.budget_bytes = 1; opt.spill_dir = dir.string();
+  {
+    ChunkCache cache(opt);
+    const std::vector<Pt> cloud{ Pt{ 1.5, 1.5, 1.5 }, Pt{ 2.5, 1.5, 1.5 } };
+    REQUIRE(cache.insert(cloud, Pt{ 0.5, 0.5, 0.5 }) == 1);
+    REQUIRE(cache.stats().spilled_chunks == 1);
+    fs::path file;
+    for (const auto& f : fs::directory_iterator(dir)) file = f.path();
+    fs::resize_file(file, 12); // the header alone: its records are missing
+    const auto bytes = fs::file_size(file);
+    REQUIRE(cache.insert(cloud, Pt{ 0.5, 0.5, 0.5 }) == 0);
+    REQUIRE(cache.stats().io_errors == 1);
+    REQUIRE(cache.stats().reloads == 0);
+    REQUIRE(cache.stats().spilled_chunks == 1);
+    REQUIRE(cache.stats().resident_chunks == 0);
+    REQUIRE(fs::file_size(file) == bytes);
+    size_t visited = 0;
+    cache.for_each_worker([&](int, WorkerOut&& w) { REQUIRE(w.Ptd.empty()); ++visited; });
+    REQUIRE(visited == 1);
+    REQUIRE(cache.stats().io_errors == 2);
+  }
+  REQUIRE(fs::is_empty(dir));
+  fs::remove_all(dir);
+}
@@ -0,0 +1,95 @@
+#include <catch2/catch_test_macros.hpp>
+#include "octoweave/hierarchy.hpp"
+#include "octoweave/parallel.hpp"
+#include "octoweave/trace.hpp"
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace octoweave;
+
+static const trace::StageSummary* find_stage(const trace::Summary& s, const std::string& name) {
+  for (const auto& st : s.stages) if (st.name == name) return &st;
+  return nullptr;
+}
+
+static int64_t find_counter(const trace::Summary& s, const std::string& name) {
+  for (const auto& c : s.counters) if (c.first == name) return c.second;
+  return -1;
+}
+
+TEST_CASE("trace: nothing is recorded while disabled") {
+  trace::set_enabled(false);
+  trace::reset();
+  { trace::Scope ts("idle"); trace::count("idle_count", 3); }
+  auto s = trace::summary();
+  REQUIRE(s.stages.empty());
+  REQUIRE(s.counters.empty());
+  REQUIRE(s.threads == 0);
+}
+
+TEST_CASE("trace: spans and counters from several threads are summed") {
+  trace::reset();
+  trace::set_enabled(true);
+  std::vector<std::thread> ts;
+  for (int t=0; t<4; ++t) ts.emplace_back([] {
+    for (int i=0; i<5; ++i) { trace::Scope sc("work", 2); trace::count("items", 10); }
+  });
+  for (auto& t : ts) t.join();
+  trace::set_enabled(false);
+  auto s = trace::summary();
+  const auto* st = find_stage(s, "work/2");
+  REQUIRE(st != nullptr);
+  REQUIRE(st->calls == 20);
+  REQUIRE(st->max_ms <= st->total_ms);
+  REQUIRE(find_counter(s, "items") == 200);
+  REQUIRE(s.threads == 4);
+
+  const std::string js = trace::chrome_trace_json();
+  REQUIRE(js.find("\"traceEvents\"") != std::string::npos);
+  REQUIRE(js.find("\"name\":\"work\"") != std::string::npos);
+  REQUIRE(js.find("\"ph\":\"C\"") != std::string::npos);
+
+  trace::reset();
+  REQUIRE(trace::summary().stages.empty());
+}
+
+TEST_CASE("trace: pipeline stages are instrumented") {
+  ChunkGrid grid(2, AABB{0,4, 0,4, 0,4});
+  std::vector<Pt> pts;
+  for (int i=0; i<64; ++i) pts.push_back(Pt{ 0.5 + (i % 4), 0.5 + ((i / 4) % 4), 0.5 + (i / 16) });
+  OctoChunker::Params p; p.max_depth_cap = 4;
+
+  trace::reset();
+  trace::set_enabled(true);
+  auto outs = build_chunked_workers(grid, PointSpan(pts), p, 2);
+  Hierarchy H = make_hierarchy_from_workers(outs, 0.5, false, 0.5, 1);
+  trace::set_enabled(false);
+
+  auto s = trace::summary();
+  REQUIRE(find_stage(s, "bin") != nullptr);
+  REQUIRE(find_stage(s, "chunk_build/0") != nullptr);
+  REQUIRE(find_stage(s, "merge") != nullptr);
+  REQUIRE(find_stage(s, "rollup/3") != nullptr);
+  REQUIRE(find_stage(s, "emit") != nullptr);
+  REQUIRE(find_counter(s, "points_binned") == 64);
+  REQUIRE(find_counter(s, "nodes_emitted") == (int64_t)H.nodes.size());
+  trace::reset();
+}
+
+TEST_CASE("trace: a span open across reset keeps only its part after the reset") {
+  trace::reset();
+  trace::set_enabled(true);
+  {
+    trace::Scope sc("straddle");
+    while (trace::now_ns() < 20000000) {} // 20 ms into the epoch
+    trace::reset();
+  }
+  trace::set_enabled(false);
+  auto s = trace::summary();
+  const auto* st = find_stage(s, "straddle");
+  REQUIRE(st != nullptr);
+  REQUIRE(st->calls == 1);
+  REQUIRE(st->total_ms < 20.0);
+  trace::reset();
+}
@@ -9,8 +9,10 @@ using namespace octoweave;
 
 TEST_CASE("octoweave_viz: slice + hist outputs") {
   namespace fs = std::filesystem;
-  fs::create_directories("viz_tmp");
-  std::string csv = "viz_tmp/in.csv";
+  const fs::path dir = fs::temp_directory_path() / "octoweave_test_viz_slice";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  std::string csv = (dir / "in.csv").string();
   std::ofstream f(csv);
   f << "0,0,0,3,1.0\n";
   f << "1,0,0,3,0.5\n";
@@ -18,8 +20,8 @@ TEST_CASE("octoweave_viz: slice + hist outputs") {
   f << "2,0,1,3,0.75\n"; // different z slice
   f.close();
 
-  std::string out = "viz_tmp/out.pgm";
-  std::string svg = "viz_tmp/hist.svg";
+  std::string out = (dir / "out.pgm").string();
+  std::string svg = (dir / "hist.svg").string();
   const char* argv[] = {"octoweave_viz", "--csv", csv.c_str(), "--slice_z", "0", "--depth", "3", "--out", out.c_str(), "--hist", svg.c_str()};
   int rc = viz_main(11, const_cast<char**>(argv));
   REQUIRE(rc == 0);
@@ -40,5 +42,44 @@ TEST_CASE("octoweave_viz: slice + hist outputs") {
   REQUIRE((bool)os);
   std::string content((std::istreambuf_iterator<char>(os)), {});
   REQUIRE(content.find("depth 3: count 4") != std::string::npos);
+  pgm.close(); os.close();
+  fs::remove_all(dir);
 }
 
+TEST_CASE("octoweave_viz: batch slices in one read (P5)") {
+  namespace fs = std::filesystem;
+  const fs::path dir = fs::temp_directory_path() / "octoweave_test_viz_batch";
+  fs::remove_all(dir);
+  fs::create_directories(dir);
+  std::string csv = (dir / "batch.csv").string();
+  std::ofstream f(csv);
+  f << "0,0,0,3,1.0\n";
+  f << "1,0,0,3,0.5\n";
+  f << "2,1,1,3,0.75\n";
+  f << "0,0,1,2,1.0\n";
+  f.close();
+
+  const std::string pattern = (dir / "b_{d}_{z}.pgm").string();
+  const char* argv[] = {"octoweave_viz", "--csv", csv.c_str(), "--slices", "0:1", "--depths", "3",
+                        "--format", "p5", "--out", pattern.c_str()};
+  REQUIRE(viz_main(11, const_cast<char**>(argv)) == 0);
+
+  // Both slices share the depth-3 extent (3x2)
+  for (int z : {0, 1}) {
+    std::ifstream pgm(dir / ("b_3_" + std::to_string(z) + ".pgm"), std::ios::binary);
+    REQUIRE((bool)pgm);
+    std::string magic; int W, H, maxv; pgm >> magic >> W >> H >> maxv; pgm.get();
+    REQUIRE(magic == "P5");
+    REQUIRE(W == 3); REQUIRE(H == 2);
+    std::vector<unsigned char> px((size_t)W*H);
+    pgm.read(reinterpret_cast<char*>(px.data()), (std::streamsize)px.size());
+    int sum = 0; for (auto v : px) sum += v;
+    REQUIRE(sum == (z == 0 ? 255 + 128 : 191));
+  }
+
+  // Malformed range
+  const std::string bad_out = (dir / "x.pgm").string();
+  const char* bad[] = {"octoweave_viz", "--csv", csv.c_str(), "--slices", "3:1", "--out", bad_out.c_str()};
+  REQUIRE(viz_main(7, const_cast<char**>(bad)) == 2);
+  fs::remove_all(dir);
+}